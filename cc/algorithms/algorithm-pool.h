@@ -0,0 +1,189 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
+#include "base/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "algorithms/algorithm.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Hands out reusable algorithm instances so that serving a query does not
+// build a new algorithm, with its mechanisms and bounding histograms, every
+// time. Instances are grouped by a key that must identify all of their
+// parameters, e.g. "bounded_sum_eps1_lower0_upper10".
+//
+// e.g. AlgorithmPool<BoundedSum<int>> pool;
+//      ASSIGN_OR_RETURN(auto sum, pool.Acquire("sum", build_sum));
+//      sum->AddEntries(begin, end);
+//      return sum->PartialResult();
+//
+// The first instance for a key is made by the factory passed to Acquire and is
+// kept as a prototype; further instances are cloned from it (see
+// Algorithm::Clone), or made by the factory if the algorithm cannot be cloned.
+// An instance is Reset when its handle is destroyed and kept for the next
+// Acquire with the same key, so steady-state requests allocate nothing. The
+// pool is thread-safe and must outlive its handles.
+template <typename Alg>
+class AlgorithmPool {
+ public:
+  using Factory = std::function<base::StatusOr<std::unique_ptr<Alg>>()>;
+
+ private:
+  struct Entry {
+    std::unique_ptr<Alg> prototype;
+    std::vector<std::unique_ptr<Alg>> idle;
+  };
+
+ public:
+  // Exclusive use of one pooled instance. Returns the instance to the pool on
+  // destruction.
+  class Handle {
+   public:
+    Handle(Handle&& other) = default;
+    Handle& operator=(Handle&& other) {
+      Release();
+      pool_ = other.pool_;
+      entry_ = other.entry_;
+      algorithm_ = std::move(other.algorithm_);
+      return *this;
+    }
+    ~Handle() { Release(); }
+
+    Alg* get() const { return algorithm_.get(); }
+    Alg* operator->() const { return algorithm_.get(); }
+    Alg& operator*() const { return *algorithm_; }
+
+   private:
+    friend class AlgorithmPool;
+
+    Handle(AlgorithmPool* pool, Entry* entry, std::unique_ptr<Alg> algorithm)
+        : pool_(pool), entry_(entry), algorithm_(std::move(algorithm)) {}
+
+    void Release() {
+      if (algorithm_ != nullptr) {
+        pool_->Return(entry_, std::move(algorithm_));
+      }
+    }
+
+    AlgorithmPool* pool_;
+    Entry* entry_;
+    std::unique_ptr<Alg> algorithm_;
+  };
+
+  // At most max_idle_per_key returned instances are kept for each key; the
+  // rest are destroyed.
+  explicit AlgorithmPool(int max_idle_per_key = 64)
+      : max_idle_per_key_(max_idle_per_key) {}
+
+  AlgorithmPool(const AlgorithmPool&) = delete;
+  AlgorithmPool& operator=(const AlgorithmPool&) = delete;
+
+  // Returns an instance for key. factory builds the prototype the first time
+  // key is seen, and every instance of key if the prototype cannot be cloned.
+  // factory runs without holding the pool's lock, so building a new key does
+  // not stall requests for other keys.
+  base::StatusOr<Handle> Acquire(absl::string_view key,
+                                 const Factory& factory) {
+    Entry* entry;
+    bool has_prototype;
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        it = entries_.try_emplace(std::string(key)).first;
+      }
+      entry = &it->second;
+      if (!entry->idle.empty()) {
+        std::unique_ptr<Alg> algorithm = std::move(entry->idle.back());
+        entry->idle.pop_back();
+        return Handle(this, entry, std::move(algorithm));
+      }
+      has_prototype = entry->prototype != nullptr;
+      if (has_prototype) {
+        base::StatusOr<std::unique_ptr<Alg>> clone = CloneLocked(entry);
+        if (clone.ok()) {
+          return Handle(this, entry, std::move(clone.ValueOrDie()));
+        }
+      }
+    }
+    ASSIGN_OR_RETURN(std::unique_ptr<Alg> algorithm, factory());
+    if (has_prototype) {
+      return Handle(this, entry, std::move(algorithm));
+    }
+    {
+      absl::MutexLock lock(&mutex_);
+      // Another request for key may have installed a prototype while ours was
+      // being built; ours then serves this request.
+      if (entry->prototype != nullptr) {
+        return Handle(this, entry, std::move(algorithm));
+      }
+      entry->prototype = std::move(algorithm);
+      base::StatusOr<std::unique_ptr<Alg>> clone = CloneLocked(entry);
+      if (clone.ok()) {
+        return Handle(this, entry, std::move(clone.ValueOrDie()));
+      }
+    }
+    ASSIGN_OR_RETURN(algorithm, factory());
+    return Handle(this, entry, std::move(algorithm));
+  }
+
+  // Returns the number of instances waiting to be reused, for all keys.
+  int NumIdle() const {
+    absl::MutexLock lock(&mutex_);
+    int num_idle = 0;
+    for (const auto& key_and_entry : entries_) {
+      num_idle += key_and_entry.second.idle.size();
+    }
+    return num_idle;
+  }
+
+ private:
+  base::StatusOr<std::unique_ptr<Alg>> CloneLocked(Entry* entry)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    ASSIGN_OR_RETURN(auto clone, entry->prototype->Clone());
+    return std::unique_ptr<Alg>(static_cast<Alg*>(clone.release()));
+  }
+
+  void Return(Entry* entry, std::unique_ptr<Alg> algorithm) {
+    algorithm->Reset();
+    absl::MutexLock lock(&mutex_);
+    if (entry->idle.size() < max_idle_per_key_) {
+      entry->idle.push_back(std::move(algorithm));
+    }
+  }
+
+  const size_t max_idle_per_key_;
+
+  mutable absl::Mutex mutex_;
+  // Node-based so that handles can hold on to their entry.
+  absl::node_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
@@ -0,0 +1,207 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/algorithm-pool.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+// Counts how often the pool had to build a Count from scratch.
+class CountFactory {
+ public:
+  base::StatusOr<std::unique_ptr<Count<int>>> operator()() {
+    ++num_calls_;
+    return Count<int>::Builder()
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .Build();
+  }
+
+  int num_calls() const { return num_calls_; }
+
+ private:
+  std::atomic<int> num_calls_{0};
+};
+
+// Does not override CloneAlgorithm.
+class UncloneableAlgorithm : public Algorithm<int> {
+ public:
+  UncloneableAlgorithm() : Algorithm<int>(1.0) {}
+  void AddEntry(const int& t) override {}
+  Summary Serialize() override { return Summary(); }
+  absl::Status Merge(const Summary& summary) override {
+    return absl::OkStatus();
+  }
+  int64_t MemoryUsed() override { return sizeof(UncloneableAlgorithm); }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    return Output();
+  }
+  void ResetState() override {}
+};
+
+TEST(AlgorithmPoolTest, ReusesReturnedInstances) {
+  AlgorithmPool<Count<int>> pool;
+  CountFactory factory;
+  auto build = [&factory]() { return factory(); };
+  Count<int>* first;
+  {
+    auto count = pool.Acquire("count", build);
+    ASSERT_OK(count);
+    first = count->get();
+    (*count)->AddEntry(1);
+    (*count)->AddEntry(2);
+  }
+  EXPECT_EQ(pool.NumIdle(), 1);
+
+  auto count = pool.Acquire("count", build);
+  ASSERT_OK(count);
+  EXPECT_EQ(count->get(), first);
+  EXPECT_EQ(pool.NumIdle(), 0);
+
+  // The returned instance was reset.
+  (*count)->AddEntry(3);
+  auto result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 1);
+}
+
+TEST(AlgorithmPoolTest, ClonesPrototypeForConcurrentUsers) {
+  AlgorithmPool<Count<int>> pool;
+  CountFactory factory;
+  auto build = [&factory]() { return factory(); };
+  auto a = pool.Acquire("count", build);
+  ASSERT_OK(a);
+  auto b = pool.Acquire("count", build);
+  ASSERT_OK(b);
+  EXPECT_NE(a->get(), b->get());
+  EXPECT_EQ(factory.num_calls(), 1);
+}
+
+TEST(AlgorithmPoolTest, KeysAreSeparate) {
+  AlgorithmPool<Count<int>> pool;
+  CountFactory factory;
+  auto build = [&factory]() { return factory(); };
+  { ASSERT_OK(pool.Acquire("a", build)); }
+  auto b = pool.Acquire("b", build);
+  ASSERT_OK(b);
+  EXPECT_EQ(factory.num_calls(), 2);
+  EXPECT_EQ(pool.NumIdle(), 1);
+}
+
+TEST(AlgorithmPoolTest, LimitsIdleInstances) {
+  AlgorithmPool<Count<int>> pool(/*max_idle_per_key=*/1);
+  CountFactory factory;
+  auto build = [&factory]() { return factory(); };
+  {
+    auto a = pool.Acquire("count", build);
+    ASSERT_OK(a);
+    auto b = pool.Acquire("count", build);
+    ASSERT_OK(b);
+  }
+  EXPECT_EQ(pool.NumIdle(), 1);
+}
+
+TEST(AlgorithmPoolTest, FallsBackToFactoryWhenCloneIsUnsupported) {
+  AlgorithmPool<UncloneableAlgorithm> pool;
+  int num_calls = 0;
+  auto build =
+      [&num_calls]() -> base::StatusOr<std::unique_ptr<UncloneableAlgorithm>> {
+    ++num_calls;
+    return absl::make_unique<UncloneableAlgorithm>();
+  };
+  auto a = pool.Acquire("alg", build);
+  ASSERT_OK(a);
+  auto b = pool.Acquire("alg", build);
+  ASSERT_OK(b);
+  // One call for the prototype, one for each instance.
+  EXPECT_EQ(num_calls, 3);
+}
+
+TEST(AlgorithmPoolTest, FactoryDoesNotBlockOtherKeys) {
+  AlgorithmPool<Count<int>> pool;
+  CountFactory cold_factory;
+  CountFactory warm_factory;
+  absl::Notification warm_acquired;
+  // Fails instead of hanging if the pool holds its lock while building.
+  auto build_cold =
+      [&]() -> base::StatusOr<std::unique_ptr<Count<int>>> {
+    if (!warm_acquired.WaitForNotificationWithTimeout(absl::Seconds(10))) {
+      return absl::DeadlineExceededError("Blocked by the pool");
+    }
+    return cold_factory();
+  };
+  auto build_warm = [&warm_factory]() { return warm_factory(); };
+
+  std::thread cold_thread(
+      [&]() { EXPECT_OK(pool.Acquire("cold", build_cold)); });
+  EXPECT_OK(pool.Acquire("warm", build_warm));
+  warm_acquired.Notify();
+  cold_thread.join();
+  EXPECT_EQ(pool.NumIdle(), 2);
+}
+
+TEST(AlgorithmPoolTest, KeepsOnePrototypePerKey) {
+  AlgorithmPool<Count<int>> pool;
+  CountFactory factory;
+  auto build = [&factory]() { return factory(); };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 100; ++j) {
+        EXPECT_OK(pool.Acquire("count", build));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  // Racing requests may each build an instance, but later ones only clone.
+  EXPECT_LE(factory.num_calls(), 8);
+}
+
+TEST(AlgorithmPoolTest, PropagatesFactoryErrors) {
+  AlgorithmPool<Count<int>> pool;
+  auto build = []() -> base::StatusOr<std::unique_ptr<Count<int>>> {
+    return absl::InvalidArgumentError("Bad parameters");
+  };
+  EXPECT_THAT(pool.Acquire("count", build),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Bad parameters")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -24,14 +24,18 @@
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/privacy-accountant.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "proto/confidence-interval.pb.h"
 #include "proto/data.pb.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
+#include "base/status_macros.h"
 
 namespace differential_privacy {
 
@@ -94,18 +98,41 @@ class Algorithm {
   // Privacy budget, defined on [0,1], represents the fraction of the total
   // budget to consume.
   base::StatusOr<Output> PartialResult(double privacy_budget) {
-    return GenerateResult(ConsumePrivacyBudget(privacy_budget),
-                          kDefaultConfidenceLevel);
+    return PartialResult(privacy_budget, kDefaultConfidenceLevel);
   }
 
   // Same as above, but provides the confidence level of the noise confidence
   // interval, which may be included in the algorithm output.
   base::StatusOr<Output> PartialResult(double privacy_budget,
                                        double noise_interval_level) {
+    RETURN_IF_ERROR(ChargeAccountant(privacy_budget));
     return GenerateResult(ConsumePrivacyBudget(privacy_budget),
                           noise_interval_level);
   }
 
+  // Same as PartialResult, but returns only the first value of the output,
+  // converted to V. Algorithms that support it skip building the Output proto
+  // with its error report, so this is cheaper for point queries.
+  template <typename V>
+  base::StatusOr<V> PartialResultValue() {
+    return PartialResultValue<V>(RemainingPrivacyBudget());
+  }
+
+  template <typename V>
+  base::StatusOr<V> PartialResultValue(double privacy_budget) {
+    RETURN_IF_ERROR(ChargeAccountant(privacy_budget));
+    ASSIGN_OR_RETURN(ValueType value,
+                     GenerateValue(ConsumePrivacyBudget(privacy_budget)));
+    switch (value.value_case()) {
+      case ValueType::kIntValue:
+        return static_cast<V>(value.int_value());
+      case ValueType::kFloatValue:
+        return static_cast<V>(value.float_value());
+      default:
+        return absl::InternalError("Result is not numeric.");
+    }
+  }
+
   double RemainingPrivacyBudget() { return privacy_budget_; }
 
   // Strictly reduces privacy budget, so is safe to make public.
@@ -130,17 +157,58 @@ class Algorithm {
     ResetState();
   }
 
+  // Returns a new algorithm with the same parameters as this one, no entries
+  // and a full privacy budget, without going through the builder. The clone is
+  // charged to the same privacy accountant, if any. Algorithms that do not
+  // support cloning return an Unimplemented error.
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> Clone() {
+    ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone, CloneAlgorithm());
+    clone->SetPrivacyAccountant(accountant_, accountant_delta_);
+    return clone;
+  }
+
   // Serializes summary data of current entries into Summary proto. This allows
   // results from distributed aggregation to be recorded and later merged.
   // Returns empty summary for algorithms for which serialize is unimplemented.
   virtual Summary Serialize() = 0;
 
+  // Same as Serialize, but writes into an existing summary, replacing its data.
+  // A summary created with google::protobuf::Arena::CreateMessage keeps the
+  // data on that arena, so many summaries can be freed at once. By default the
+  // result of Serialize is copied; algorithms that are serialized often pack
+  // their data into the summary directly.
+  virtual void SerializeTo(Summary* summary) { *summary = Serialize(); }
+
   // Merges serialized summary data into this algorithm. The summary proto must
   // represent data from the same algorithm type with identical parameters. The
   // data field must contain the algorithm summary type of the corresponding
   // algorithm used. The summary proto cannot be empty.
   virtual absl::Status Merge(const Summary& summary) = 0;
 
+  // Same as Merge, but takes the Summary proto serialized, e.g., as received
+  // from another worker. By default the summary is parsed and merged;
+  // algorithms that are merged often read it in place instead, without
+  // parsing it into protos.
+  virtual absl::Status MergeSerialized(absl::string_view summary) {
+    Summary parsed;
+    if (!parsed.ParseFromArray(summary.data(), summary.size())) {
+      return absl::InternalError("Serialized summary is malformed.");
+    }
+    return Merge(parsed);
+  }
+
+  // Merges all summaries in order, with the same requirements as Merge. Stops
+  // at the first summary that cannot be merged and returns its error; the
+  // summaries before it remain merged. Algorithms that are merged often
+  // override this to unpack every summary into the same message, reusing its
+  // memory.
+  virtual absl::Status MergeMany(absl::Span<const Summary> summaries) {
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(Merge(summary));
+    }
+    return absl::OkStatus();
+  }
+
   // Returns the memory currently used by the algorithm in bytes.
   virtual int64_t MemoryUsed() = 0;
 
@@ -165,6 +233,17 @@ class Algorithm {
 
   virtual double GetEpsilon() const { return epsilon_; }
 
+  // Charges every PartialResult to accountant as well as to this algorithm's
+  // own privacy budget: consuming a fraction f of the budget spends f * epsilon
+  // and f * delta of the accountant's budget. Once the accountant cannot cover
+  // a result, PartialResult returns its error without consuming anything.
+  // Usually set through AlgorithmBuilder::SetPrivacyAccountant.
+  void SetPrivacyAccountant(std::shared_ptr<PrivacyAccountant> accountant,
+                            double delta) {
+    accountant_ = std::move(accountant);
+    accountant_delta_ = delta;
+  }
+
  protected:
   // Returns the result of the algorithm when run on all the input that has been
   // provided via AddEntr[y|ies] since the last call to Reset.
@@ -173,14 +252,49 @@ class Algorithm {
   virtual base::StatusOr<Output> GenerateResult(
       double privacy_budget, double noise_interval_level) = 0;
 
+  // Returns the first value of GenerateResult. Algorithms whose result is a
+  // single value override this to compute it without an Output proto.
+  virtual base::StatusOr<ValueType> GenerateValue(double privacy_budget) {
+    ASSIGN_OR_RETURN(Output output,
+                     GenerateResult(privacy_budget, kDefaultConfidenceLevel));
+    if (output.elements_size() == 0) {
+      return absl::InternalError("Result has no value.");
+    }
+    return output.elements(0).value();
+  }
+
   // Allows child classes to reset their state as part of a global reset.
   virtual void ResetState() = 0;
 
+  // Returns an empty algorithm of the same type and parameters for Clone.
+  // Subclasses of cloneable algorithms must override this if they add
+  // parameters or change behavior, or their clones will not.
+  virtual base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() {
+    return absl::UnimplementedError("Clone() unsupported for this algorithm");
+  }
+
  private:
   static constexpr double kFullPrivacyBudget = 1.0;
 
+  // Charges the budget that ConsumePrivacyBudget will actually take to the
+  // accountant, if any.
+  absl::Status ChargeAccountant(double privacy_budget) {
+    if (accountant_ == nullptr) {
+      return absl::OkStatus();
+    }
+    const double fraction =
+        std::min(Clamp(0.0, 1.0, privacy_budget), privacy_budget_);
+    return accountant_->Consume(fraction * epsilon_,
+                                fraction * accountant_delta_);
+  }
+
   const double epsilon_;
   double privacy_budget_;
+
+  // Shared ledger charged on every result, if set, and the delta charged to it
+  // per unit of privacy budget.
+  std::shared_ptr<PrivacyAccountant> accountant_;
+  double accountant_delta_ = 0;
 };
 
 template <typename T, class Algorithm, class Builder>
@@ -218,7 +332,11 @@ class AlgorithmBuilder {
                              "Maximum number of contributions per partition"));
     }  // TODO: Default is set in UpdateAndBuildMechanism() below.
 
-    return BuildAlgorithm();
+    ASSIGN_OR_RETURN(std::unique_ptr<Algorithm> algorithm, BuildAlgorithm());
+    if (accountant_ != nullptr) {
+      algorithm->SetPrivacyAccountant(accountant_, delta_.value_or(0));
+    }
+    return algorithm;
   }
 
   Builder& SetEpsilon(double epsilon) {
@@ -243,6 +361,14 @@ class AlgorithmBuilder {
     return *static_cast<Builder*>(this);
   }
 
+  // Shares a privacy budget ledger between the built algorithm and any other
+  // algorithms or callers using the same accountant. See
+  // Algorithm::SetPrivacyAccountant.
+  Builder& SetPrivacyAccountant(std::shared_ptr<PrivacyAccountant> accountant) {
+    accountant_ = std::move(accountant);
+    return *static_cast<Builder*>(this);
+  }
+
   Builder& SetLaplaceMechanism(
       std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
     mechanism_builder_ = std::move(mechanism_builder);
@@ -254,6 +380,7 @@ class AlgorithmBuilder {
   absl::optional<double> delta_;
   absl::optional<int> l0_sensitivity_;
   absl::optional<int> max_contributions_per_partition_;
+  std::shared_ptr<PrivacyAccountant> accountant_;
 
   // The mechanism builder is used to interject custom mechanisms for testing.
   std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_ =
@@ -125,6 +125,42 @@ TEST(IncrementalAlgorithmTest, MergedPartialResultConsumesBudget) {
   EXPECT_THAT(alg_2.RemainingPrivacyBudget(), DoubleNear(0.0, kTestPrecision));
 }
 
+TEST(IncrementalAlgorithmTest, PartialResultChargesPrivacyAccountant) {
+  std::shared_ptr<PrivacyAccountant> accountant =
+      PrivacyAccountant::Builder().SetEpsilon(2).Build().ValueOrDie();
+  std::unique_ptr<TestAlgorithm<double>> alg_1 =
+      TestAlgorithm<double>::Builder()
+          .SetEpsilon(2)
+          .SetPrivacyAccountant(accountant)
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<TestAlgorithm<double>> alg_2 =
+      TestAlgorithm<double>::Builder()
+          .SetEpsilon(1)
+          .SetPrivacyAccountant(accountant)
+          .Build()
+          .ValueOrDie();
+  ASSERT_OK(alg_1->PartialResult(0.5));
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(1.0, kTestPrecision));
+  ASSERT_OK(alg_2->PartialResult());
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(0.0, kTestPrecision));
+
+  // The accountant is exhausted even though alg_1 has budget left.
+  EXPECT_THAT(alg_1->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Not enough privacy budget")));
+  EXPECT_THAT(alg_1->RemainingPrivacyBudget(), DoubleNear(0.5, kTestPrecision));
+}
+
+TEST(IncrementalAlgorithmTest, PartialResultValueConsumesBudget) {
+  TestAlgorithm<double> alg;
+  // TestAlgorithm's result has no value to return.
+  EXPECT_THAT(alg.PartialResultValue<double>(0.5),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Result has no value")));
+  EXPECT_THAT(alg.RemainingPrivacyBudget(), DoubleNear(0.5, kTestPrecision));
+}
+
 TEST(IncrementalAlgorithmDeathTest, BudgetTooHigh) {
   TestAlgorithm<double> alg;
   ASSERT_OK(alg.PartialResult(0.5));
@@ -24,8 +24,10 @@
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/serialized-summary.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "base/canonical_errors.h"
@@ -224,12 +226,52 @@ class ApproxBounds : public Algorithm<T> {
     return absl::OkStatus();
   }
 
+  // Same as Merge, but reads the serialized summary in place.
+  absl::Status MergeSerialized(absl::string_view summary) override {
+    ASSIGN_OR_RETURN(
+        absl::string_view am_summary,
+        internal::UnpackSerializedSummary<ApproxBoundsSummary>(summary));
+    return MergeSerializedBinCounts(am_summary);
+  }
+
+  // Adds the bin counts of a serialized ApproxBoundsSummary in place, for
+  // algorithms that embed it into their own summaries.
+  absl::Status MergeSerializedBinCounts(absl::string_view am_summary) {
+    // The first pass only counts the bins, so that a summary of a different
+    // histogram is rejected before any bin is changed.
+    int num_pos_bins = 0;
+    int num_neg_bins = 0;
+    RETURN_IF_ERROR(ForEachSerializedBinCount(
+        am_summary, [&](bool positive, int64_t) {
+          ++(positive ? num_pos_bins : num_neg_bins);
+        }));
+    if (pos_bins_.size() != num_pos_bins || neg_bins_.size() != num_neg_bins) {
+      return absl::InternalError(
+          "Merged approximate max summary must have the same number of "
+          "bin counts as this histogram.");
+    }
+    int pos_bin = 0;
+    int neg_bin = 0;
+    return ForEachSerializedBinCount(
+        am_summary, [&](bool positive, int64_t count) {
+          if (positive) {
+            pos_bins_[pos_bin++] += count;
+          } else {
+            neg_bins_[neg_bin++] += count;
+          }
+        });
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(ApproxBounds<T>) +
                    sizeof(int64_t) * neg_bins_.capacity() +
                    sizeof(int64_t) * pos_bins_.capacity() +
+                   sizeof(int64_t) * result_neg_bins_.capacity() +
+                   sizeof(int64_t) * result_pos_bins_.capacity() +
                    sizeof(T) * noisy_neg_bins_.capacity() +
-                   sizeof(T) * noisy_pos_bins_.capacity();
+                   sizeof(T) * noisy_pos_bins_.capacity() +
+                   neg_bin_noised_.capacity() / 8 +
+                   pos_bin_noised_.capacity() / 8;
     if (mechanism_) {
       memory += mechanism_->MemoryUsed();
     }
@@ -415,22 +457,22 @@ class ApproxBounds : public Algorithm<T> {
       threshold /= privacy_budget;
     }
 
-    // Populate noisy versions of the histogram bins.
-    noisy_pos_bins_ = AddNoise(privacy_budget, pos_bins_);
-    noisy_neg_bins_ = AddNoise(privacy_budget, neg_bins_);
+    // Start a new set of noisy histogram bins. Each bin is only noised once it
+    // is read, which for most datasets is a handful of bins.
+    StartNoisyBins(privacy_budget);
 
     Output output;
 
     // Find first bin above threshold for minimum.
     for (int i = neg_bins_.size() - 1; i >= 0; --i) {
-      if (noisy_neg_bins_[i] >= threshold) {
+      if (NoisyNegBin(i) >= threshold) {
         AddToOutput<T>(&output, NegRightBinBoundary(i));
         break;
       }
     }
     if (output.elements_size() == 0) {
       for (int i = 0; i < pos_bins_.size(); ++i) {
-        if (noisy_pos_bins_[i] >= threshold) {
+        if (NoisyPosBin(i) >= threshold) {
           AddToOutput<T>(&output, PosLeftBinBoundary(i));
           break;
         }
@@ -439,14 +481,14 @@ class ApproxBounds : public Algorithm<T> {
 
     // Find first bin above threshold for maximum.
     for (int i = pos_bins_.size() - 1; i >= 0; --i) {
-      if (noisy_pos_bins_[i] >= threshold) {
+      if (NoisyPosBin(i) >= threshold) {
         AddToOutput<T>(&output, PosRightBinBoundary(i));
         break;
       }
     }
     if (output.elements_size() < 2) {
       for (int i = 0; i < neg_bins_.size(); ++i) {
-        if (noisy_neg_bins_[i] >= threshold) {
+        if (NoisyNegBin(i) >= threshold) {
           AddToOutput<T>(&output, NegLeftBinBoundary(i));
           break;
         }
@@ -469,6 +511,14 @@ class ApproxBounds : public Algorithm<T> {
     std::fill(neg_bins_.begin(), neg_bins_.end(), 0);
   }
 
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> mechanism,
+                     mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(new ApproxBounds<T>(
+        Algorithm<T>::GetEpsilon(), pos_bins_.size(), scale_, base_, k_,
+        preset_k_, std::move(mechanism)));
+  }
+
   // Given a bin index, finds the larger-magnitude boundary of the corresponding
   // bin for negative bin.
   T NegRightBinBoundary(int bin_index) {
@@ -484,6 +534,38 @@ class ApproxBounds : public Algorithm<T> {
   T PosRightBinBoundary(int bin_index) { return bin_boundaries_[bin_index]; }
 
  private:
+  // Calls f(positive, count) with every bin count of a serialized
+  // ApproxBoundsSummary, packed or not.
+  template <typename F>
+  static absl::Status ForEachSerializedBinCount(absl::string_view am_summary,
+                                                F f) {
+    internal::SerializedMessageReader reader(am_summary);
+    while (reader.NextField()) {
+      bool ok;
+      switch (reader.field_number()) {
+        case ApproxBoundsSummary::kPosBinCountFieldNumber:
+          ok = reader.ReadRepeatedInt64(
+              [&](int64_t count) { f(/*positive=*/true, count); });
+          break;
+        case ApproxBoundsSummary::kNegBinCountFieldNumber:
+          ok = reader.ReadRepeatedInt64(
+              [&](int64_t count) { f(/*positive=*/false, count); });
+          break;
+        default:
+          ok = reader.SkipField();
+      }
+      if (!ok) {
+        return absl::InternalError(
+            "Approximate bounds summary unable to be unpacked.");
+      }
+    }
+    if (!reader.AtEnd()) {
+      return absl::InternalError(
+          "Approximate bounds summary unable to be unpacked.");
+    }
+    return absl::OkStatus();
+  }
+
   // Add input num_of_entries times to the bins.
   void AddMultipleEntries(const T& input, uint64_t num_of_entries) {
     // REF:
@@ -558,16 +640,38 @@ class ApproxBounds : public Algorithm<T> {
         [](T val1, T val2) { return val1 - val2; });
   }
 
-  // Add noise to each member of bins and return noisy vector.
-  const std::vector<T> AddNoise(double privacy_budget,
-                                const std::vector<int64_t>& bins) {
-    std::vector<T> noisy_bins(bins.size());
-    for (int i = 0; i < bins.size(); ++i) {
+  // Discards the noisy bins of the previous result. Bins read from now on are
+  // the counts at this point, noised with privacy_budget, so that entries
+  // added or merged later do not leak into the bins of this result.
+  void StartNoisyBins(double privacy_budget) {
+    noise_budget_ = privacy_budget;
+    result_pos_bins_ = pos_bins_;
+    result_neg_bins_ = neg_bins_;
+    noisy_pos_bins_.resize(pos_bins_.size());
+    noisy_neg_bins_.resize(neg_bins_.size());
+    pos_bin_noised_.assign(pos_bins_.size(), false);
+    neg_bin_noised_.assign(neg_bins_.size(), false);
+  }
+
+  T NoisyPosBin(int i) {
+    return NoisyBin(i, result_pos_bins_, &noisy_pos_bins_, &pos_bin_noised_);
+  }
+  T NoisyNegBin(int i) {
+    return NoisyBin(i, result_neg_bins_, &noisy_neg_bins_, &neg_bin_noised_);
+  }
+
+  // Returns the noisy count of bins[i] for the current result, adding noise to
+  // it the first time it is read. Noise of all bins is independent, so the
+  // order in which they are read does not matter.
+  T NoisyBin(int i, const std::vector<int64_t>& bins, std::vector<T>* noisy,
+             std::vector<bool>* noised) {
+    if (!(*noised)[i]) {
       double noised_dbl =
-          mechanism_->AddNoise(static_cast<double>(bins[i]), privacy_budget);
-      SafeCastFromDouble<T>(noised_dbl, noisy_bins[i]);
+          mechanism_->AddNoise(static_cast<double>(bins[i]), noise_budget_);
+      SafeCastFromDouble<T>(noised_dbl, (*noisy)[i]);
+      (*noised)[i] = true;
     }
-    return noisy_bins;
+    return (*noisy)[i];
   }
 
   // Given a bin index, finds the smaller-magnitude boundary of the
@@ -590,7 +694,7 @@ class ApproxBounds : public Algorithm<T> {
   // be part of the count. Input lower and upper are rounded to the nearest
   // larger-magnitude bin boundary.
   base::StatusOr<double> NumInputsOutside(T lower, T upper) {
-    // Check that noisy bins have been populated.
+    // Check that a result has been generated.
     if (noisy_pos_bins_.empty()) {
       return absl::InvalidArgumentError(
           "Noisy histogram bins have not been created. Try generating "
@@ -613,10 +717,10 @@ class ApproxBounds : public Algorithm<T> {
       pos_i = lower_msb + 1;
     }
     for (int i = noisy_neg_bins_.size() - 1; i > neg_i; --i) {
-      num_outside += noisy_neg_bins_[i];
+      num_outside += NoisyNegBin(i);
     }
     for (int i = 0; i < pos_i; ++i) {
-      num_outside += noisy_pos_bins_[i];
+      num_outside += NoisyPosBin(i);
     }
 
     // Add the count of inputs above upper.
@@ -631,10 +735,10 @@ class ApproxBounds : public Algorithm<T> {
       pos_i = upper_msb + 1;
     }
     for (int i = neg_i; i >= 0; --i) {
-      num_outside += noisy_neg_bins_[i];
+      num_outside += NoisyNegBin(i);
     }
     for (int i = pos_i; i < noisy_pos_bins_.size(); ++i) {
-      num_outside += noisy_pos_bins_[i];
+      num_outside += NoisyPosBin(i);
     }
 
     return num_outside;
@@ -654,16 +758,27 @@ class ApproxBounds : public Algorithm<T> {
   friend class BoundedMean;
   template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
   friend class BoundedVariance;
+  template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
+  friend class BoundedStatistics;
 
  private:
   // Count the values in each logarithmic bin for positives and negatives.
   std::vector<int64_t> pos_bins_;
   std::vector<int64_t> neg_bins_;
 
-  // Noisy DP counts of the positive and negative bins. Populated upon
-  // generating the result.
+  // The bin counts at the most recent result, which its noisy bins are drawn
+  // from.
+  std::vector<int64_t> result_pos_bins_;
+  std::vector<int64_t> result_neg_bins_;
+  // Noisy DP counts of the positive and negative bins for the most recent
+  // result, filled in as they are read. Sized upon generating the first result.
   std::vector<T> noisy_pos_bins_;
   std::vector<T> noisy_neg_bins_;
+  // Whether the noisy count of each bin has been drawn for the current result.
+  std::vector<bool> pos_bin_noised_;
+  std::vector<bool> neg_bin_noised_;
+  // The privacy budget of the most recent result, used to noise its bins.
+  double noise_budget_ = 0;
 
   // The bin boundary magnitudes, starting from lowest positive magnitude.
   std::vector<T> bin_boundaries_;
@@ -386,6 +386,47 @@ TYPED_TEST(ApproxBoundsTest, SerializeAndMergeTest) {
                   result2->elements(1).value().float_value());
 }
 
+TYPED_TEST(ApproxBoundsTest, MergeSerializedMatchesMerge) {
+  std::vector<TypeParam> a = {-1, -11, 6, 0};
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(3).SetBase(10).SetScale(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds =
+      builder.Build();
+  ASSERT_OK(bounds);
+  (*bounds)->AddEntries(a.begin(), a.end());
+  const Summary summary = (*bounds)->Serialize();
+
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> merged =
+      builder.Build();
+  ASSERT_OK(merged);
+  EXPECT_OK((*merged)->Merge(summary));
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> merged_serialized =
+      builder.Build();
+  ASSERT_OK(merged_serialized);
+  EXPECT_OK((*merged_serialized)->MergeSerialized(summary.SerializeAsString()));
+  EXPECT_THAT((*merged_serialized)->Serialize(),
+              EqualsProto((*merged)->Serialize()));
+}
+
+TEST(ApproxBoundsTest, MergeSerializedRejectsDifferentHistogram) {
+  ApproxBounds<double>::Builder builder;
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> small =
+      builder.SetNumBins(3).Build();
+  ASSERT_OK(small);
+  (*small)->AddEntry(1);
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> large =
+      builder.SetNumBins(4).Build();
+  ASSERT_OK(large);
+  const Summary empty = (*large)->Serialize();
+
+  const std::string serialized = (*small)->Serialize().SerializeAsString();
+  EXPECT_THAT((*large)->MergeSerialized(serialized),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same number of bin counts")));
+  EXPECT_THAT((*large)->Serialize(), EqualsProto(empty));
+}
+
 TYPED_TEST(ApproxBoundsTest, SerializeAndMergeOverflowPosBinsTest) {
   typename ApproxBounds<int64_t>::Builder builder;
 
@@ -902,6 +943,96 @@ TYPED_TEST(ApproxBoundsTest, GetBoundingReport) {
   EXPECT_EQ((*bounds)->GetBoundingReport(-1, 0).num_outside(), 11);  // [-1, 0)
 }
 
+// Adds no noise and counts how often noise was requested.
+class CountingNoiseMechanism : public ZeroNoiseMechanism {
+ public:
+  class Builder : public ZeroNoiseMechanism::Builder {
+   public:
+    explicit Builder(int* num_calls) : num_calls_(num_calls) {}
+
+    base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() override {
+      return base::StatusOr<std::unique_ptr<LaplaceMechanism>>(
+          absl::make_unique<CountingNoiseMechanism>(num_calls_));
+    }
+
+    std::unique_ptr<NumericalMechanismBuilder> Clone() const override {
+      return absl::make_unique<Builder>(*this);
+    }
+
+   private:
+    int* num_calls_;
+  };
+
+  explicit CountingNoiseMechanism(int* num_calls)
+      : ZeroNoiseMechanism(1, 1), num_calls_(num_calls) {}
+
+  double AddNoise(double result, double privacy_budget) override {
+    ++*num_calls_;
+    return result;
+  }
+
+ private:
+  int* num_calls_;
+};
+
+TEST(ApproxBoundsTest, NoisesBinsOnlyWhenRead) {
+  std::vector<int64_t> a = {-100, -100, -100, 100, 100, 100};
+  int num_calls = 0;
+  base::StatusOr<std::unique_ptr<ApproxBounds<int64_t>>> bounds =
+      ApproxBounds<int64_t>::Builder()
+          .SetNumBins(8)
+          .SetBase(2)
+          .SetScale(1)
+          .SetThreshold(3)
+          .SetLaplaceMechanism(
+              absl::make_unique<CountingNoiseMechanism::Builder>(&num_calls))
+          .Build();
+  ASSERT_OK(bounds);
+  (*bounds)->AddEntries(a.begin(), a.end());
+
+  // Both scans stop at the outermost bin.
+  base::StatusOr<Output> result = (*bounds)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(result->elements(0).value().int_value(), -128);
+  EXPECT_EQ(result->elements(1).value().int_value(), 128);
+  EXPECT_EQ(num_calls, 2);
+
+  // The report reads every bin, each noised once for the result.
+  EXPECT_EQ((*bounds)->GetBoundingReport(-128, 128).num_inputs(), a.size());
+  EXPECT_EQ((*bounds)->GetBoundingReport(-1, 1).num_outside(), a.size());
+  EXPECT_EQ(num_calls, 16);
+}
+
+TEST(ApproxBoundsTest, ReportReadsBinsOfLastResult) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<int64_t>>> bounds =
+      ApproxBounds<int64_t>::Builder()
+          .SetNumBins(32)
+          .SetBase(2)
+          .SetScale(1)
+          .SetThreshold(5)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds);
+  for (int i = 0; i < 10; ++i) {
+    (*bounds)->AddEntry(1);
+    (*bounds)->AddEntry(1 << 20);
+  }
+  ASSERT_OK((*bounds)->PartialResult());
+
+  // The threshold scans skip the bin of 1000, so it is noised only for the
+  // report. Entries added and merged after the result must not reach it.
+  for (int i = 0; i < 1000; ++i) {
+    (*bounds)->AddEntry(1000);
+  }
+  ASSERT_OK((*bounds)->Merge((*bounds)->Serialize()));
+  BoundingReport report = (*bounds)->GetBoundingReport(1, 1);
+  EXPECT_EQ(report.num_inputs(), 20);
+  EXPECT_EQ(report.num_outside(), 20);
+
+  (*bounds)->Reset();
+  EXPECT_EQ((*bounds)->GetBoundingReport(1, 1).num_inputs(), 20);
+}
+
 TYPED_TEST(ApproxBoundsTest, Memory) {
   base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds_small =
       typename ApproxBounds<TypeParam>::Builder().SetNumBins(1).Build();
@@ -142,6 +142,25 @@ class BinarySearch : public Algorithm<T> {
 
   void ResetState() override { quantiles_->Reset(); }
 
+  T GetLower() const { return lower_; }
+  T GetUpper() const { return upper_; }
+
+  // Clones the mechanism and creates an empty input sketch for a clone of a
+  // subclass.
+  absl::Status CloneDependencies(
+      std::unique_ptr<LaplaceMechanism>* mechanism,
+      std::unique_ptr<base::Percentile<T>>* quantiles) {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> clone,
+                     mechanism_->Clone());
+    mechanism->reset(dynamic_cast<LaplaceMechanism*>(clone.release()));
+    if (*mechanism == nullptr) {
+      return absl::InvalidArgumentError(
+          "Order statistics are only supported for Laplace mechanism.");
+    }
+    *quantiles = absl::make_unique<base::Percentile<T>>();
+    return absl::OkStatus();
+  }
+
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
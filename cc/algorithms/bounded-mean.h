@@ -23,10 +23,13 @@
 #include "google/protobuf/any.pb.h"
 #include "absl/random/distributions.h"
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/fixed-point-sum.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
@@ -128,12 +131,51 @@ class BoundedMean : public Algorithm<T> {
 
   void AddEntry(const T& input) override { AddMultipleEntries(input, 1); }
 
+  // Adds multiple inputs to the algorithm. With manual bounds, the inputs are
+  // clamped and summed in one pass without a virtual call per entry.
+  template <typename Iterator>
+  void AddEntries(Iterator begin, Iterator end) {
+    if (approx_bounds_) {
+      for (auto it = begin; it != end; ++it) {
+        AddMultipleEntries(*it, 1);
+      }
+      return;
+    }
+    if (exact_sum_) {
+      raw_count_ +=
+          exact_sum_->AddClampedIntegers(begin, end, lower_, upper_);
+      return;
+    }
+    T sum = 0;
+    uint64_t count = 0;
+    for (auto it = begin; it != end; ++it) {
+      if (!std::isnan(static_cast<double>(*it))) {
+        sum += Clamp<T>(lower_, upper_, *it);
+        ++count;
+      }
+    }
+    raw_count_ += count;
+    pos_sum_[0] += sum;
+  }
+
   Summary Serialize() override {
+    Summary summary;
+    SerializeTo(&summary);
+    return summary;
+  }
+
+  void SerializeTo(Summary* summary) override {
     // Create BoundedMeanSummary.
     BoundedMeanSummary bm_summary;
     bm_summary.set_count(raw_count_);
-    for (T x : pos_sum_) {
-      SetValue(bm_summary.add_pos_sum(), x);
+    if (exact_sum_) {
+      // Readers that do not know fixed_point_sum get the saturated sum.
+      SetValue(bm_summary.add_pos_sum(), exact_sum_->SaturatedInteger());
+      *bm_summary.mutable_fixed_point_sum() = exact_sum_->Serialize();
+    } else {
+      for (T x : pos_sum_) {
+        SetValue(bm_summary.add_pos_sum(), x);
+      }
     }
     for (T x : neg_sum_) {
       SetValue(bm_summary.add_neg_sum(), x);
@@ -144,42 +186,19 @@ class BoundedMean : public Algorithm<T> {
           bm_summary.mutable_bounds_summary());
     }
 
-    // Create Summary.
-    Summary summary;
-    summary.mutable_data()->PackFrom(bm_summary);
-    return summary;
+    summary->mutable_data()->PackFrom(bm_summary);
   }
 
   absl::Status Merge(const Summary& summary) override {
-    if (!summary.has_data()) {
-      return absl::InternalError(
-          "Cannot merge summary with no bounded mean data.");
-    }
+    BoundedMeanSummary bm_summary;
+    return MergeWith(summary, &bm_summary);
+  }
 
-    // Add counts and bounded sums.
+  absl::Status MergeMany(absl::Span<const Summary> summaries) override {
     BoundedMeanSummary bm_summary;
-    if (!summary.data().UnpackTo(&bm_summary)) {
-      return absl::InternalError("Bounded mean summary unable to be unpacked.");
-    }
-    raw_count_ += bm_summary.count();
-    if (pos_sum_.size() != bm_summary.pos_sum_size() ||
-        neg_sum_.size() != bm_summary.neg_sum_size()) {
-      return absl::InternalError(
-          "Merged BoundedMeans must have equal number of partial sums.");
-    }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bm_summary.pos_sum(i));
-    }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bm_summary.neg_sum(i));
-    }
-    if (approx_bounds_) {
-      Summary approx_bounds_summary;
-      approx_bounds_summary.mutable_data()->PackFrom(
-          bm_summary.bounds_summary());
-      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(MergeWith(summary, &bm_summary));
     }
-
     return absl::OkStatus();
   }
 
@@ -246,16 +265,116 @@ class BoundedMean : public Algorithm<T> {
     } else {
       pos_sum_.push_back(0);
     }
+    // Integral sums with manual bounds are accumulated in 128 bits, so that
+    // they cannot overflow before the result saturates.
+    if (!approx_bounds_ && std::is_integral<T>::value) {
+      exact_sum_ = FixedPointSum::ForIntegers();
+    }
   }
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
+    Output output;
+    ASSIGN_OR_RETURN(double mean,
+                     NoisyMean(privacy_budget, noise_interval_level, &output));
+    AddToOutput<double>(&output, mean);
+    return output;
+  }
+
+  base::StatusOr<ValueType> GenerateValue(double privacy_budget) override {
+    ASSIGN_OR_RETURN(double mean, NoisyMean(privacy_budget,
+                                            kDefaultConfidenceLevel,
+                                            /*output=*/nullptr));
+    return MakeValueType<double>(mean);
+  }
+
+  void ResetState() override {
+    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
+    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    raw_count_ = 0;
+    if (exact_sum_) {
+      exact_sum_->Reset();
+    }
+    if (approx_bounds_) {
+      approx_bounds_->Reset();
+      sum_mechanism_ = nullptr;
+    }
+  }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<NumericalMechanism> sum_mechanism;
+    std::unique_ptr<ApproxBounds<T>> approx_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone,
+                       approx_bounds_->Clone());
+      approx_bounds.reset(static_cast<ApproxBounds<T>*>(clone.release()));
+    } else {
+      ASSIGN_OR_RETURN(sum_mechanism, sum_mechanism_->Clone());
+    }
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> count_mechanism,
+                     count_mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(new BoundedMean<T>(
+        Algorithm<T>::GetEpsilon(), approx_bounds ? 0 : lower_,
+        approx_bounds ? 0 : upper_, l0_sensitivity_,
+        max_contributions_per_partition_, mechanism_builder_->Clone(),
+        std::move(sum_mechanism), std::move(count_mechanism),
+        std::move(approx_bounds)));
+  }
+
+ private:
+  // Merges summary, unpacking it into bm_summary, which MergeMany reuses
+  // for all summaries.
+  absl::Status MergeWith(const Summary& summary,
+                         BoundedMeanSummary* bm_summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded mean data.");
+    }
+
+    // Add counts and bounded sums.
+    if (!summary.data().UnpackTo(bm_summary)) {
+      return absl::InternalError("Bounded mean summary unable to be unpacked.");
+    }
+    raw_count_ += bm_summary->count();
+    if (pos_sum_.size() != bm_summary->pos_sum_size() ||
+        neg_sum_.size() != bm_summary->neg_sum_size()) {
+      return absl::InternalError(
+          "Merged BoundedMeans must have equal number of partial sums.");
+    }
+    if (exact_sum_) {
+      if (bm_summary->has_fixed_point_sum()) {
+        return exact_sum_->Merge(bm_summary->fixed_point_sum());
+      }
+      exact_sum_->AddInteger(GetValue<T>(bm_summary->pos_sum(0)));
+      return absl::OkStatus();
+    }
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetValue<T>(bm_summary->pos_sum(i));
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetValue<T>(bm_summary->neg_sum(i));
+    }
+    if (approx_bounds_) {
+      Summary approx_bounds_summary;
+      approx_bounds_summary.mutable_data()->PackFrom(
+          bm_summary->bounds_summary());
+      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    }
+
+    return absl::OkStatus();
+  }
+
+  // Finds the bounds, if they are not set manually, and returns the noisy mean.
+  // If output is not null, adds the bounding report to its error report.
+  // Without it, fewer histogram bins of ApproxBounds have to be noised.
+  base::StatusOr<double> NoisyMean(double privacy_budget,
+                                   double noise_interval_level,
+                                   Output* output) {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
 
     double sum = 0;
     double remaining_budget = privacy_budget;
-    Output output;
 
     // Find bounds and sum.
     if (approx_bounds_) {
@@ -275,14 +394,16 @@ class BoundedMean : public Algorithm<T> {
           raw_count_);
 
       // Populate the bounding report with ApproxBounds information.
-      *(output.mutable_error_report()->mutable_bounding_report()) =
-          approx_bounds_->GetBoundingReport(lower_, upper_);
+      if (output != nullptr) {
+        *(output->mutable_error_report()->mutable_bounding_report()) =
+            approx_bounds_->GetBoundingReport(lower_, upper_);
+      }
 
       // Clear the mechanism. The sensitivity might have changed.
       sum_mechanism_.reset();
     } else {
       // Manual bounds were set and clamping was done upon adding entries.
-      sum = pos_sum_[0];
+      sum = exact_sum_ ? exact_sum_->Value() : pos_sum_[0];
     }
 
     // Construct mechanism if needed.
@@ -294,28 +415,22 @@ class BoundedMean : public Algorithm<T> {
                             max_contributions_per_partition_, lower_, upper_));
     }
 
-    double count_budget = remaining_budget / 2;
-    remaining_budget -= count_budget;
+    return AddNoiseToMean(sum, remaining_budget);
+  }
+
+  // Returns the mean of sum over the count within the current bounds, spending
+  // half of privacy_budget each on the noisy count and the noisy sum.
+  double AddNoiseToMean(double sum, double privacy_budget) {
+    double count_budget = privacy_budget / 2;
+    double sum_budget = privacy_budget - count_budget;
     double noised_count =
         std::max(1.0, count_mechanism_->AddNoise(raw_count_, count_budget));
-    double normalized_sum = sum_mechanism_->AddNoise(
-        sum - raw_count_ * midpoint_, remaining_budget);
+    double normalized_sum =
+        sum_mechanism_->AddNoise(sum - raw_count_ * midpoint_, sum_budget);
     double average = normalized_sum / noised_count + midpoint_;
-    AddToOutput<double>(&output, Clamp<double>(lower_, upper_, average));
-    return output;
+    return Clamp<double>(lower_, upper_, average);
   }
 
-  void ResetState() override {
-    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
-    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
-    raw_count_ = 0;
-    if (approx_bounds_) {
-      approx_bounds_->Reset();
-      sum_mechanism_ = nullptr;
-    }
-  }
-
- private:
   void AddMultipleEntries(const T& input, uint64_t num_of_entries) {
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
@@ -325,7 +440,9 @@ class BoundedMean : public Algorithm<T> {
 
     raw_count_ += num_of_entries;
 
-    if (!approx_bounds_) {
+    if (exact_sum_) {
+      exact_sum_->AddInteger(Clamp<T>(lower_, upper_, input), num_of_entries);
+    } else if (!approx_bounds_) {
       pos_sum_[0] += Clamp<T>(lower_, upper_, input) * num_of_entries;
     } else {
       approx_bounds_->AddMultipleEntries(input, num_of_entries);
@@ -376,6 +493,10 @@ class BoundedMean : public Algorithm<T> {
   // If this is not nullptr, we are automatically determining bounds. Otherwise,
   // lower and upper contain the manually set bounds.
   std::unique_ptr<ApproxBounds<T>> approx_bounds_;
+
+  // Set for integral types with manual bounds, in which case it holds the
+  // clamped sum instead of pos_sum_.
+  absl::optional<FixedPointSum> exact_sum_;
 };
 
 }  // namespace differential_privacy
@@ -16,6 +16,9 @@
 
 #include "algorithms/bounded-mean.h"
 
+#include <limits>
+#include <vector>
+
 #include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -66,6 +69,22 @@ TYPED_TEST(BoundedMeanTest, BasicTest) {
   EXPECT_LE(GetValue<double>(*result), 9);
 }
 
+TYPED_TEST(BoundedMeanTest, PartialResultValue) {
+  std::vector<TypeParam> a = {2, 4, 6, 8};
+  auto mean =
+      typename BoundedMean<TypeParam>::Builder()
+          .SetEpsilon(1.0)
+          .SetLower(1)
+          .SetUpper(9)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(mean);
+  (*mean)->AddEntries(a.begin(), a.end());
+  auto result = (*mean)->template PartialResultValue<double>();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(*result, 5);
+}
+
 TYPED_TEST(BoundedMeanTest, RepeatedResultTest) {
   std::vector<TypeParam> a = {2, 4, 6, 8};
 
@@ -297,10 +316,8 @@ TEST(BoundedMeanTest, OverflowAddMultipleEntriesManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bm)->PartialResult();
   ASSERT_OK(result);
-  // Expect -2 / int64_max, since 2 * int64_max should overflow around to -2,
-  // resulting in a mean of -2 / int64_max.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
-                   -2.0 / std::numeric_limits<int64_t>::max());
+  // The sum 2 * int64_max is accumulated in 128 bits and does not overflow.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 2);
 }
 
 TEST(BoundedMeanTest, OverflowAddEntryManualBoundsTest) {
@@ -320,8 +337,9 @@ TEST(BoundedMeanTest, OverflowAddEntryManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bm)->PartialResult();
   EXPECT_OK(result);
-  // Overflowing should result in the running sum wrapping around to zero.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0);
+  // The sum is accumulated in 128 bits and does not wrap around.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::max() / 2.0);
 }
 
 TEST(BoundedMeanTest, UnderflowAddEntryManualBoundsTest) {
@@ -341,8 +359,9 @@ TEST(BoundedMeanTest, UnderflowAddEntryManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bm)->PartialResult();
   EXPECT_OK(result);
-  // Underflowing should result in the running sum wrapping around to zero.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0);
+  // The sum is accumulated in 128 bits and does not wrap around.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::lowest() / 2.0);
 }
 
 TEST(BoundedMeanTest, OverflowRawCountMergeManualBoundsTest) {
@@ -403,8 +422,9 @@ TEST(BoundedMeanTest, OverflowMergeManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bm2)->PartialResult();
   EXPECT_OK(result);
-  // Overflowing should result in the running sum wrapping around to zero.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
+  // The sum is accumulated in 128 bits and does not wrap around.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::max() / 2.0);
 
   // Test post-overflow serialize & merge
   summary = (*bm2)->Serialize();
@@ -412,7 +432,8 @@ TEST(BoundedMeanTest, OverflowMergeManualBoundsTest) {
   EXPECT_OK((*bm2)->Merge(summary));
   result = (*bm2)->PartialResult();
   EXPECT_OK(result);
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::max() / 2.0);
 }
 
 TEST(BoundedMeanTest, UnderflowMergeManualBoundsTest) {
@@ -437,8 +458,9 @@ TEST(BoundedMeanTest, UnderflowMergeManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bm2)->PartialResult();
   EXPECT_OK(result);
-  // Underflowing should result in the running sum wrapping around to zero.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
+  // The sum is accumulated in 128 bits and does not wrap around.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::lowest() / 2.0);
 
   // Test post-overflow serialize & merge
   summary = (*bm2)->Serialize();
@@ -446,7 +468,8 @@ TEST(BoundedMeanTest, UnderflowMergeManualBoundsTest) {
   EXPECT_OK((*bm2)->Merge(summary));
   result = (*bm2)->PartialResult();
   EXPECT_OK(result);
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()),
+                   std::numeric_limits<int64_t>::lowest() / 2.0);
 }
 
 TYPED_TEST(BoundedMeanTest, SerializeMergeTest) {
@@ -597,6 +620,22 @@ TEST(BoundedMeanTest, DropNanEntries) {
   EXPECT_LE(GetValue<double>(*result), 9);
 }
 
+TEST(BoundedMeanTest, AddEntriesManualBounds) {
+  std::vector<double> a = {0, 2, 4, NAN, 20};
+  auto mean =
+      BoundedMean<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1)
+          .SetLower(1)
+          .SetUpper(9)
+          .Build();
+  ASSERT_OK(mean);
+  (*mean)->AddEntries(a.begin(), a.end());
+  auto result = (*mean)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result), 4);
+}
+
 TEST(BoundedMeanTest, SensitivityOverflow) {
   // Check for error when upper - lower causes integer overflow.
   EXPECT_EQ(BoundedMean<int>::Builder()
@@ -791,5 +830,30 @@ TYPED_TEST(BoundedMeanTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT((*bm)->GetAggregationEpsilon(), epsilon);
 }
 
+TEST(BoundedMeanTest, IntegralSumDoesNotOverflow) {
+  constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+  BoundedMean<int64_t>::Builder builder;
+  builder.SetEpsilon(1)
+      .SetLower(0)
+      .SetUpper(kMax)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto bm1 = builder.Build();
+  ASSERT_OK(bm1);
+  const std::vector<int64_t> inputs = {kMax, kMax, 0};
+  (*bm1)->AddEntries(inputs.begin(), inputs.end());
+
+  auto bm2 = builder.Build();
+  ASSERT_OK(bm2);
+  BoundedMeanTestPeer::AddMultipleEntries<int64_t>(kMax, 2, bm2->get());
+  (*bm2)->AddEntry(0);
+  (*bm2)->AddEntry(0);
+  ASSERT_OK((*bm2)->Merge((*bm1)->Serialize()));
+
+  // Four of the seven inputs are kMax, which sum to 2^65 in total.
+  auto result = (*bm2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result), kMax * 4.0 / 7.0);
+}
+
 }  //  namespace
 }  // namespace differential_privacy
@@ -131,6 +131,15 @@ class BoundedStandardDeviation : public Algorithm<T> {
   }
 
   void ResetState() override { variance_->Reset(); }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone, variance_->Clone());
+    std::unique_ptr<BoundedVariance<T>> variance(
+        static_cast<BoundedVariance<T>*>(clone.release()));
+    return std::unique_ptr<Algorithm<T>>(new BoundedStandardDeviation<T>(
+        Algorithm<T>::GetEpsilon(), std::move(variance)));
+  }
+
   std::unique_ptr<BoundedVariance<T>> variance_;
 };
 
@@ -0,0 +1,578 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-algorithm.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "proto/util.h"
+
+namespace differential_privacy {
+
+// Incrementally provides any combination of the differentially private count,
+// sum, mean, variance and standard deviation of values in the range
+// [lower..upper]. Values outside of this range will be clamped so they lie in
+// the range.
+//
+// Unlike running Count, BoundedSum, BoundedMean and BoundedVariance side by
+// side, each entry is clamped or binned and summed once, the state is one
+// ApproxBounds histogram with one set of partial sums and sums of squares, and
+// automatic bounds are found once for all statistics.
+//
+// The algorithm releases a noisy count and, if needed, noisy sums of the
+// values and of their squares, normalized around the midpoints of their ranges
+// as in BoundedMean and BoundedVariance. The privacy budget is split evenly
+// among these. Each requested statistic is computed from them, so the output
+// is as private as any one of the separate algorithms given the whole budget.
+// The output contains one element per requested statistic, ordered as in the
+// Statistic enum: the count as an int64, the sum as a T and the others as
+// doubles.
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class BoundedStatistics : public Algorithm<T> {
+ public:
+  enum class Statistic {
+    kCount,
+    kSum,
+    kMean,
+    kVariance,
+    kStandardDeviation,
+  };
+
+  // Builder for BoundedStatistics algorithm.
+  class Builder
+      : public BoundedAlgorithmBuilder<T, BoundedStatistics<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, BoundedStatistics<T>,
+                                               Builder>;
+    using BoundedBuilder =
+        BoundedAlgorithmBuilder<T, BoundedStatistics<T>, Builder>;
+
+   public:
+    // The statistics to release. Required. Duplicates are ignored.
+    Builder& SetStatistics(const std::vector<Statistic>& statistics) {
+      statistics_ = 0;
+      for (Statistic statistic : statistics) {
+        statistics_ |= Bit(statistic);
+      }
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<BoundedStatistics<T>>>
+    BuildBoundedAlgorithm() override {
+      // We have to check epsilon now, otherwise the split during ApproxBounds
+      // construction might make the error message confusing.
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(
+          AlgorithmBuilder::GetEpsilon(), "Epsilon"));
+      if (statistics_ == 0) {
+        return absl::InvalidArgumentError(
+            "At least one statistic must be requested.");
+      }
+
+      // Ensure that either bounds are manually set or ApproxBounds is made.
+      RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
+
+      const double epsilon = BoundedBuilder::GetRemainingEpsilon().value();
+      const double l0_sensitivity =
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1);
+      const int max_contributions_per_partition =
+          AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1);
+
+      // If manual bounding, check bounds and construct mechanisms so we can
+      // fail on build if sensitivity is inappropriate.
+      std::unique_ptr<NumericalMechanism> sum_mechanism;
+      std::unique_ptr<NumericalMechanism> sos_mechanism;
+      if (BoundedBuilder::BoundsAreSet()) {
+        const T lower = BoundedBuilder::GetLower().value();
+        const T upper = BoundedBuilder::GetUpper().value();
+        RETURN_IF_ERROR(CheckBounds(statistics_, lower, upper));
+        ASSIGN_OR_RETURN(
+            sum_mechanism,
+            BuildSumMechanism(AlgorithmBuilder::GetMechanismBuilderClone(),
+                              epsilon, l0_sensitivity,
+                              max_contributions_per_partition, lower, upper));
+        ASSIGN_OR_RETURN(
+            sos_mechanism,
+            BuildSumOfSquaresMechanism(
+                AlgorithmBuilder::GetMechanismBuilderClone(), epsilon,
+                l0_sensitivity, max_contributions_per_partition, lower,
+                upper));
+      }
+
+      std::unique_ptr<NumericalMechanism> count_mechanism;
+      ASSIGN_OR_RETURN(count_mechanism,
+                       AlgorithmBuilder::GetMechanismBuilderClone()
+                           ->SetEpsilon(epsilon)
+                           .SetL0Sensitivity(l0_sensitivity)
+                           .SetLInfSensitivity(max_contributions_per_partition)
+                           .Build());
+
+      return absl::WrapUnique(new BoundedStatistics(
+          epsilon, statistics_, BoundedBuilder::GetLower().value_or(0),
+          BoundedBuilder::GetUpper().value_or(0), l0_sensitivity,
+          max_contributions_per_partition,
+          AlgorithmBuilder::GetMechanismBuilderClone(),
+          std::move(sum_mechanism), std::move(sos_mechanism),
+          std::move(count_mechanism),
+          BoundedBuilder::MoveApproxBoundsPointer()));
+    }
+
+    int statistics_ = 0;
+  };
+
+  void AddEntry(const T& t) override { AddMultipleEntries(t, 1); }
+
+  // The state is the same as that of BoundedVariance, so is its summary.
+  Summary Serialize() override {
+    BoundedVarianceSummary bv_summary;
+    bv_summary.set_count(raw_count_);
+    for (T x : pos_sum_) {
+      SetValue(bv_summary.add_pos_sum(), x);
+    }
+    for (T x : neg_sum_) {
+      SetValue(bv_summary.add_neg_sum(), x);
+    }
+    for (double x : pos_sum_of_squares_) {
+      bv_summary.add_pos_sum_of_squares(x);
+    }
+    for (double x : neg_sum_of_squares_) {
+      bv_summary.add_neg_sum_of_squares(x);
+    }
+    if (approx_bounds_) {
+      Summary approx_bounds_summary = approx_bounds_->Serialize();
+      approx_bounds_summary.data().UnpackTo(
+          bv_summary.mutable_bounds_summary());
+    }
+
+    Summary summary;
+    summary.mutable_data()->PackFrom(bv_summary);
+    return summary;
+  }
+
+  absl::Status Merge(const Summary& summary) override {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded statistics data.");
+    }
+    BoundedVarianceSummary bv_summary;
+    if (!summary.data().UnpackTo(&bv_summary)) {
+      return absl::InternalError(
+          "Bounded statistics summary unable to be unpacked.");
+    }
+    if ((approx_bounds_ != nullptr) != bv_summary.has_bounds_summary()) {
+      return absl::InternalError(
+          "Merged BoundedStatistics must have the same bounding strategy.");
+    }
+    if (pos_sum_.size() != bv_summary.pos_sum_size() ||
+        neg_sum_.size() != bv_summary.neg_sum_size() ||
+        pos_sum_of_squares_.size() != bv_summary.pos_sum_of_squares_size() ||
+        neg_sum_of_squares_.size() != bv_summary.neg_sum_of_squares_size()) {
+      return absl::InternalError(
+          "Merged BoundedStatistics must have the same amount of partial "
+          "sum or sum of squares values as this BoundedStatistics.");
+    }
+
+    raw_count_ += bv_summary.count();
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetValue<T>(bv_summary.pos_sum(i));
+      pos_sum_of_squares_[i] += bv_summary.pos_sum_of_squares(i);
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetValue<T>(bv_summary.neg_sum(i));
+      neg_sum_of_squares_[i] += bv_summary.neg_sum_of_squares(i);
+    }
+
+    if (approx_bounds_) {
+      Summary approx_bounds_summary;
+      approx_bounds_summary.mutable_data()->PackFrom(
+          bv_summary.bounds_summary());
+      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    }
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    int64_t memory = sizeof(BoundedStatistics<T>) +
+                     sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
+                     sizeof(double) * (pos_sum_of_squares_.capacity() +
+                                       neg_sum_of_squares_.capacity());
+    if (approx_bounds_) {
+      memory += approx_bounds_->MemoryUsed();
+    }
+    if (sum_mechanism_) {
+      memory += sum_mechanism_->MemoryUsed();
+    }
+    if (sos_mechanism_) {
+      memory += sos_mechanism_->MemoryUsed();
+    }
+    if (mechanism_builder_) {
+      memory += sizeof(*mechanism_builder_);
+    }
+    return memory;
+  }
+
+  double GetEpsilon() const override {
+    if (approx_bounds_) {
+      return approx_bounds_->GetEpsilon() + Algorithm<T>::GetEpsilon();
+    }
+    return Algorithm<T>::GetEpsilon();
+  }
+
+  // Returns the epsilon used to calculate approximate bounds. If approximate
+  // bounds are not used, returns 0.
+  double GetBoundingEpsilon() const {
+    if (approx_bounds_) {
+      return approx_bounds_->GetEpsilon();
+    }
+    return 0;
+  }
+
+  // Returns the epsilon used to calculate the statistics. If bounds are
+  // specified explicitly, this will be the total epsilon used by the algorithm.
+  double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
+
+  // Returns whether statistic is part of the output.
+  bool HasStatistic(Statistic statistic) const {
+    return (statistics_ & Bit(statistic)) != 0;
+  }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    double remaining_budget = privacy_budget;
+    Output output;
+    double sum = 0;
+    double sos = 0;  // Sum of squares.
+
+    if (approx_bounds_) {
+      // Get bounds with a fraction of the privacy budget.
+      double bounds_budget = remaining_budget / 2;
+      remaining_budget -= bounds_budget;
+      ASSIGN_OR_RETURN(Output bounds, approx_bounds_->PartialResult(
+                                          bounds_budget, noise_interval_level));
+      lower_ = GetValue<T>(bounds.elements(0).value());
+      upper_ = GetValue<T>(bounds.elements(1).value());
+      RETURN_IF_ERROR(CheckBounds(statistics_, lower_, upper_));
+
+      sum = approx_bounds_->template ComputeFromPartials<T>(
+          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
+          raw_count_);
+      sos = approx_bounds_->template ComputeFromPartials<double>(
+          pos_sum_of_squares_, neg_sum_of_squares_, [](T x) { return x * x; },
+          lower_, upper_, raw_count_);
+
+      *(output.mutable_error_report()->mutable_bounding_report()) =
+          approx_bounds_->GetBoundingReport(lower_, upper_);
+
+      // Clear the mechanisms. The sensitivity might have changed.
+      sum_mechanism_.reset();
+      sos_mechanism_.reset();
+    } else {
+      sum = pos_sum_[0];
+      sos = pos_sum_of_squares_[0];
+    }
+
+    const bool needs_sum = (statistics_ & ~Bit(Statistic::kCount)) != 0;
+    const bool needs_sos = HasStatistic(Statistic::kVariance) ||
+                           HasStatistic(Statistic::kStandardDeviation);
+    if (needs_sum && !sum_mechanism_) {
+      ASSIGN_OR_RETURN(
+          sum_mechanism_,
+          BuildSumMechanism(mechanism_builder_->Clone(),
+                            Algorithm<T>::GetEpsilon(), l0_sensitivity_,
+                            max_contributions_per_partition_, lower_, upper_));
+    }
+    if (needs_sos && !sos_mechanism_) {
+      ASSIGN_OR_RETURN(sos_mechanism_,
+                       BuildSumOfSquaresMechanism(
+                           mechanism_builder_->Clone(),
+                           Algorithm<T>::GetEpsilon(), l0_sensitivity_,
+                           max_contributions_per_partition_, lower_, upper_));
+    }
+
+    // Split the budget evenly among the noisy count, sum and sum of squares.
+    const double noise_budget =
+        remaining_budget / (1 + (needs_sum ? 1 : 0) + (needs_sos ? 1 : 0));
+    const double noised_count =
+        std::max(0.0, count_mechanism_->AddNoise(raw_count_, noise_budget));
+    const double sum_midpoint = lower_ + (upper_ - lower_) / 2.0;
+    const double sos_midpoint = MidpointOfSquares(lower_, upper_);
+    double normalized_sum = 0;
+    double normalized_sos = 0;
+    if (needs_sum) {
+      normalized_sum = sum_mechanism_->AddNoise(
+          sum - static_cast<double>(raw_count_) * sum_midpoint, noise_budget);
+    }
+    if (needs_sos) {
+      normalized_sos = sos_mechanism_->AddNoise(
+          sos - static_cast<double>(raw_count_) * sos_midpoint, noise_budget);
+    }
+
+    // Everything below is post-processing of the three noisy values.
+    const double divisor = std::max(1.0, noised_count);
+    const double mean = normalized_sum / divisor + sum_midpoint;
+    const double variance =
+        Clamp<double>(0.0, IntervalLengthSquared(lower_, upper_) / 4,
+                      normalized_sos / divisor + sos_midpoint - mean * mean);
+
+    if (HasStatistic(Statistic::kCount)) {
+      int64_t count;
+      SafeCastFromDouble(std::round(noised_count), count);
+      AddToOutput<int64_t>(&output, count);
+    }
+    if (HasStatistic(Statistic::kSum)) {
+      double noised_sum = Clamp<double>(noised_count * lower_,
+                                        noised_count * upper_,
+                                        normalized_sum +
+                                            noised_count * sum_midpoint);
+      if (std::is_integral<T>::value) {
+        T value;
+        SafeCastFromDouble<T>(std::round(noised_sum), value);
+        AddToOutput<T>(&output, value);
+      } else {
+        AddToOutput<T>(&output, noised_sum);
+      }
+    }
+    if (HasStatistic(Statistic::kMean)) {
+      AddToOutput<double>(&output, Clamp<double>(lower_, upper_, mean));
+    }
+    if (HasStatistic(Statistic::kVariance)) {
+      AddToOutput<double>(&output, variance);
+    }
+    if (HasStatistic(Statistic::kStandardDeviation)) {
+      AddToOutput<double>(&output, std::sqrt(variance));
+    }
+    return output;
+  }
+
+  void ResetState() override {
+    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
+    std::fill(pos_sum_of_squares_.begin(), pos_sum_of_squares_.end(), 0);
+    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    std::fill(neg_sum_of_squares_.begin(), neg_sum_of_squares_.end(), 0);
+    raw_count_ = 0;
+
+    if (approx_bounds_) {
+      approx_bounds_->Reset();
+      sum_mechanism_ = nullptr;
+      sos_mechanism_ = nullptr;
+    }
+  }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<NumericalMechanism> sum_mechanism;
+    std::unique_ptr<NumericalMechanism> sos_mechanism;
+    std::unique_ptr<ApproxBounds<T>> approx_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone,
+                       approx_bounds_->Clone());
+      approx_bounds.reset(static_cast<ApproxBounds<T>*>(clone.release()));
+    } else {
+      ASSIGN_OR_RETURN(sum_mechanism, sum_mechanism_->Clone());
+      ASSIGN_OR_RETURN(sos_mechanism, sos_mechanism_->Clone());
+    }
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> count_mechanism,
+                     count_mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(new BoundedStatistics<T>(
+        Algorithm<T>::GetEpsilon(), statistics_, approx_bounds ? 0 : lower_,
+        approx_bounds ? 0 : upper_, l0_sensitivity_,
+        max_contributions_per_partition_, mechanism_builder_->Clone(),
+        std::move(sum_mechanism), std::move(sos_mechanism),
+        std::move(count_mechanism), std::move(approx_bounds)));
+  }
+
+ private:
+  BoundedStatistics(
+      double epsilon, int statistics, T lower, T upper, double l0_sensitivity,
+      int max_contributions_per_partition,
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      std::unique_ptr<NumericalMechanism> sum_mechanism,
+      std::unique_ptr<NumericalMechanism> sos_mechanism,
+      std::unique_ptr<NumericalMechanism> count_mechanism,
+      std::unique_ptr<ApproxBounds<T>> approx_bounds)
+      : Algorithm<T>(epsilon),
+        statistics_(statistics),
+        raw_count_(0),
+        lower_(lower),
+        upper_(upper),
+        mechanism_builder_(std::move(mechanism_builder)),
+        l0_sensitivity_(l0_sensitivity),
+        max_contributions_per_partition_(max_contributions_per_partition),
+        sum_mechanism_(std::move(sum_mechanism)),
+        sos_mechanism_(std::move(sos_mechanism)),
+        count_mechanism_(std::move(count_mechanism)),
+        approx_bounds_(std::move(approx_bounds)) {
+    // If automatically determining bounds, we need partial values for each bin
+    // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
+    // store one already-clamped value.
+    if (approx_bounds_) {
+      pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
+      neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
+      pos_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
+      neg_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
+    } else {
+      pos_sum_.push_back(0);
+      pos_sum_of_squares_.push_back(0);
+    }
+  }
+
+  static int Bit(Statistic statistic) {
+    return 1 << static_cast<int>(statistic);
+  }
+
+  // Squares of the bounds only have to fit in T if the variance is released.
+  static absl::Status CheckBounds(int statistics, T lower, T upper) {
+    if (statistics & (Bit(Statistic::kVariance) |
+                      Bit(Statistic::kStandardDeviation))) {
+      return BoundedVariance<T>::Builder::CheckBounds(lower, upper);
+    }
+    return BoundedMean<T>::Builder::CheckBounds(lower, upper);
+  }
+
+  static double IntervalLengthSquared(T lower, T upper) {
+    return std::pow(static_cast<double>(upper - lower), 2);
+  }
+
+  // Returns the midpoint of the range of f(x) = x^2 where the domain of f is
+  // [lower, upper].
+  static double MidpointOfSquares(T lower, T upper) {
+    const double l = lower;
+    const double u = upper;
+    if (0 > l && 0 < u) {
+      return std::max(l * l, u * u) / 2;
+    }
+    return l * l + (u * u - l * l) / 2;
+  }
+
+  // Returns the width of the range of f(x) = x^2 where the domain of f is
+  // [lower, upper].
+  static double RangeOfSquares(T lower, T upper) {
+    const double l = lower;
+    const double u = upper;
+    if (0 > l && 0 < u) {
+      return std::max(l * l, u * u);
+    }
+    return std::abs(u * u - l * l);
+  }
+
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildSumMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      const double epsilon, const double l0_sensitivity,
+      const double max_contributions_per_partition, const T lower,
+      const T upper) {
+    return mechanism_builder->SetEpsilon(epsilon)
+        .SetL0Sensitivity(l0_sensitivity)
+        .SetLInfSensitivity(max_contributions_per_partition *
+                            static_cast<double>(upper - lower) / 2.0)
+        .Build();
+  }
+
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>>
+  BuildSumOfSquaresMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      const double epsilon, const double l0_sensitivity,
+      const double max_contributions_per_partition, const T lower,
+      const T upper) {
+    return mechanism_builder->SetEpsilon(epsilon)
+        .SetL0Sensitivity(l0_sensitivity)
+        .SetLInfSensitivity(max_contributions_per_partition *
+                            (RangeOfSquares(lower, upper) / 2))
+        .Build();
+  }
+
+  void AddMultipleEntries(const T& t, uint64_t num_of_entries) {
+    // Drop value if it is NaN.
+    if (std::isnan(static_cast<double>(t))) {
+      return;
+    }
+
+    // Count is unaffected by clamping.
+    raw_count_ += num_of_entries;
+
+    if (!approx_bounds_) {
+      const T clamped = Clamp<T>(lower_, upper_, t);
+      pos_sum_[0] +=
+          Clamp<T>(std::numeric_limits<T>::lowest(),
+                   std::numeric_limits<T>::max(), clamped * num_of_entries);
+      pos_sum_of_squares_[0] +=
+          static_cast<double>(clamped) * clamped * num_of_entries;
+      return;
+    }
+
+    approx_bounds_->AddMultipleEntries(t, num_of_entries);
+    auto difference_of_squares = [](T val1, T val2) {
+      // Lessen the chance of becoming inf/-inf by calculating it like this.
+      return (static_cast<double>(val1) + val2) *
+             (static_cast<double>(val1) - val2);
+    };
+    if (t >= 0) {
+      approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
+          &pos_sum_, t, num_of_entries);
+      approx_bounds_->template AddMultipleEntriesToPartials<double>(
+          &pos_sum_of_squares_, t, num_of_entries, difference_of_squares);
+    } else {
+      approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
+          &neg_sum_, t, num_of_entries);
+      approx_bounds_->template AddMultipleEntriesToPartials<double>(
+          &neg_sum_of_squares_, t, num_of_entries, difference_of_squares);
+    }
+  }
+
+  // Bit set of the requested statistics, see Bit().
+  const int statistics_;
+
+  // Vectors of partial values stored for automatic clamping.
+  std::vector<T> pos_sum_, neg_sum_;
+  std::vector<double> pos_sum_of_squares_, neg_sum_of_squares_;
+  uint64_t raw_count_;
+  T lower_, upper_;
+
+  // Used to construct mechanisms once bounds are obtained.
+  std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
+  const double l0_sensitivity_;
+  const int max_contributions_per_partition_;
+
+  std::unique_ptr<NumericalMechanism> sum_mechanism_;
+  std::unique_ptr<NumericalMechanism> sos_mechanism_;
+  std::unique_ptr<NumericalMechanism> count_mechanism_;
+
+  // If this is not nullptr, we are automatically determining bounds. Otherwise,
+  // lower and upper contain the manually set bounds.
+  std::unique_ptr<ApproxBounds<T>> approx_bounds_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
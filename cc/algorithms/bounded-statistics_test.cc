@@ -0,0 +1,326 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/bounded-statistics.h"
+
+#include <cmath>
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using test_utils::ZeroNoiseMechanism;
+using ::testing::DoubleNear;
+using ::differential_privacy::base::testing::EqualsProto;
+using ::testing::HasSubstr;
+using ::differential_privacy::base::testing::StatusIs;
+
+template <typename T>
+class BoundedStatisticsTest : public testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(BoundedStatisticsTest, NumericTypes);
+
+template <typename T>
+using Statistic = typename BoundedStatistics<T>::Statistic;
+
+template <typename T>
+std::vector<Statistic<T>> AllStatistics() {
+  return {Statistic<T>::kCount, Statistic<T>::kSum, Statistic<T>::kMean,
+          Statistic<T>::kVariance, Statistic<T>::kStandardDeviation};
+}
+
+TYPED_TEST(BoundedStatisticsTest, BasicTest) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 5};
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics(AllStatistics<TypeParam>())
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(6)
+          .Build();
+  ASSERT_OK(bs);
+  base::StatusOr<Output> result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 5);
+  EXPECT_EQ(GetValue<int64_t>(result->elements(0).value()), 5);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(1).value()), 15);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(2).value()), 3.0);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(3).value()), 2.0);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(4).value()),
+                   std::sqrt(2.0));
+}
+
+TYPED_TEST(BoundedStatisticsTest, OutputsRequestedStatisticsInEnumOrder) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 5};
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics({Statistic<TypeParam>::kVariance,
+                          Statistic<TypeParam>::kCount,
+                          Statistic<TypeParam>::kVariance})
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(6)
+          .Build();
+  ASSERT_OK(bs);
+  EXPECT_TRUE((*bs)->HasStatistic(Statistic<TypeParam>::kCount));
+  EXPECT_FALSE((*bs)->HasStatistic(Statistic<TypeParam>::kSum));
+  base::StatusOr<Output> result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 2);
+  EXPECT_EQ(GetValue<int64_t>(result->elements(0).value()), 5);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(1).value()), 2.0);
+}
+
+TYPED_TEST(BoundedStatisticsTest, ClampInputTest) {
+  std::vector<TypeParam> a = {0, 0, 10, 10};
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics({Statistic<TypeParam>::kSum,
+                          Statistic<TypeParam>::kMean,
+                          Statistic<TypeParam>::kVariance})
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(1)
+          .SetUpper(5)
+          .Build();
+  ASSERT_OK(bs);
+  base::StatusOr<Output> result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(0).value()), 12);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(1).value()), 3.0);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(2).value()), 4.0);
+}
+
+TYPED_TEST(BoundedStatisticsTest, RequiresStatistics) {
+  EXPECT_THAT(typename BoundedStatistics<TypeParam>::Builder()
+                  .SetEpsilon(1.0)
+                  .SetLower(0)
+                  .SetUpper(6)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one statistic")));
+}
+
+TEST(BoundedStatisticsTest, SquaresMustFitOnlyForVariance) {
+  const int64_t upper = std::numeric_limits<int64_t>::max() / 2;
+  EXPECT_OK(BoundedStatistics<int64_t>::Builder()
+                .SetStatistics({Statistic<int64_t>::kMean})
+                .SetEpsilon(1.0)
+                .SetLower(-upper)
+                .SetUpper(upper)
+                .Build());
+  EXPECT_THAT(BoundedStatistics<int64_t>::Builder()
+                  .SetStatistics({Statistic<int64_t>::kStandardDeviation})
+                  .SetEpsilon(1.0)
+                  .SetLower(-upper)
+                  .SetUpper(upper)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(BoundedStatisticsTest, AutomaticBounds) {
+  std::vector<double> a = {-5, 2, 2, 4, 6, 6};
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> bounds =
+      ApproxBounds<double>::Builder()
+          .SetEpsilon(1)
+          .SetNumBins(5)
+          .SetBase(2)
+          .SetScale(1)
+          .SetThreshold(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds);
+  base::StatusOr<std::unique_ptr<BoundedStatistics<double>>> bs =
+      BoundedStatistics<double>::Builder()
+          .SetStatistics(AllStatistics<double>())
+          .SetEpsilon(1)
+          .SetApproxBounds(std::move(*bounds))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntries(a.begin(), a.end());
+
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+
+  // The bounds are [1, 8], so -5 is clamped to 1.
+  double expected_sum = 21;
+  double expected_sos = 97;
+  double expected_variance =
+      (expected_sos - expected_sum * expected_sum / a.size()) / a.size();
+  EXPECT_EQ(GetValue<int64_t>(result->elements(0).value()), 6);
+  EXPECT_THAT(GetValue<double>(result->elements(1).value()),
+              DoubleNear(expected_sum, 1e-9));
+  EXPECT_THAT(GetValue<double>(result->elements(2).value()),
+              DoubleNear(expected_sum / a.size(), 1e-9));
+  EXPECT_THAT(GetValue<double>(result->elements(3).value()),
+              DoubleNear(expected_variance, expected_variance / 10000));
+
+  BoundingReport expected_report;
+  SetValue<double>(expected_report.mutable_lower_bound(), 1);
+  SetValue<double>(expected_report.mutable_upper_bound(), 8);
+  expected_report.set_num_inputs(a.size());
+  expected_report.set_num_outside(1);
+  EXPECT_THAT(result->error_report().bounding_report(),
+              EqualsProto(expected_report));
+}
+
+TYPED_TEST(BoundedStatisticsTest, SplitsEpsilonWithAutomaticBounds) {
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics(AllStatistics<TypeParam>())
+          .SetEpsilon(1.0)
+          .Build();
+  ASSERT_OK(bs);
+  EXPECT_NEAR((*bs)->GetEpsilon(), 1.0, 1e-10);
+  EXPECT_NEAR((*bs)->GetBoundingEpsilon(), 0.5, 1e-10);
+  EXPECT_NEAR((*bs)->GetAggregationEpsilon(), 0.5, 1e-10);
+}
+
+TYPED_TEST(BoundedStatisticsTest, SerializeMergeTest) {
+  typename BoundedStatistics<TypeParam>::Builder builder;
+  builder.SetStatistics(AllStatistics<TypeParam>())
+      .SetEpsilon(0.5)
+      .SetLower(0)
+      .SetUpper(3)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs1 =
+      builder.Build();
+  ASSERT_OK(bs1);
+  (*bs1)->AddEntry(2);
+  Summary summary = (*bs1)->Serialize();
+  (*bs1)->AddEntry(6);
+
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs2 =
+      builder.Build();
+  ASSERT_OK(bs2);
+  (*bs2)->AddEntry(6);
+  EXPECT_OK((*bs2)->Merge(summary));
+
+  base::StatusOr<Output> result1 = (*bs1)->PartialResult();
+  ASSERT_OK(result1);
+  base::StatusOr<Output> result2 = (*bs2)->PartialResult();
+  ASSERT_OK(result2);
+  EXPECT_THAT(*result1, EqualsProto(*result2));
+}
+
+TYPED_TEST(BoundedStatisticsTest, MergeDifferentBoundingStrategy) {
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs1 =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics({Statistic<TypeParam>::kMean})
+          .SetEpsilon(1)
+          .Build();
+  ASSERT_OK(bs1);
+  Summary summary = (*bs1)->Serialize();
+
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs2 =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics({Statistic<TypeParam>::kMean})
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(3)
+          .Build();
+  ASSERT_OK(bs2);
+  EXPECT_THAT((*bs2)->Merge(summary),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("must have the same bounding strategy")));
+}
+
+TYPED_TEST(BoundedStatisticsTest, CloneIsIndependent) {
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics(AllStatistics<TypeParam>())
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(6)
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(1);
+  base::StatusOr<std::unique_ptr<Algorithm<TypeParam>>> clone =
+      (*bs)->Clone();
+  ASSERT_OK(clone);
+  (*clone)->AddEntry(4);
+  (*clone)->AddEntry(2);
+
+  base::StatusOr<Output> result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(result->elements(0).value()), 2);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(1).value()), 6);
+}
+
+TYPED_TEST(BoundedStatisticsTest, Reset) {
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics({Statistic<TypeParam>::kCount,
+                          Statistic<TypeParam>::kSum})
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(6)
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(5);
+  (*bs)->Reset();
+  (*bs)->AddEntry(1);
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(result->elements(0).value()), 1);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(1).value()), 1);
+}
+
+// One BoundedStatistics holds less state than the separate algorithms it
+// replaces, since they each keep their own bounding histogram.
+TYPED_TEST(BoundedStatisticsTest, UsesLessMemoryThanSeparateAlgorithms) {
+  base::StatusOr<std::unique_ptr<BoundedStatistics<TypeParam>>> bs =
+      typename BoundedStatistics<TypeParam>::Builder()
+          .SetStatistics(AllStatistics<TypeParam>())
+          .SetEpsilon(1.0)
+          .Build();
+  ASSERT_OK(bs);
+  base::StatusOr<std::unique_ptr<Count<TypeParam>>> count =
+      typename Count<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(count);
+  base::StatusOr<std::unique_ptr<BoundedSum<TypeParam>>> sum =
+      typename BoundedSum<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(sum);
+  base::StatusOr<std::unique_ptr<BoundedMean<TypeParam>>> mean =
+      typename BoundedMean<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(mean);
+  base::StatusOr<std::unique_ptr<BoundedVariance<TypeParam>>> variance =
+      typename BoundedVariance<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(variance);
+  EXPECT_LT((*bs)->MemoryUsed(),
+            (*count)->MemoryUsed() + (*sum)->MemoryUsed() +
+                (*mean)->MemoryUsed() + (*variance)->MemoryUsed());
+}
+
+}  // namespace
+}  // namespace differential_privacy
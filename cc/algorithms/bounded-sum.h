@@ -22,12 +22,17 @@
 
 #include "google/protobuf/any.pb.h"
 #include "absl/memory/memory.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/fixed-point-sum.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/serialized-summary.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
@@ -57,6 +62,15 @@ class BoundedSum : public Algorithm<T> {
       return absl::OkStatus();
     }
 
+    // Accumulates a floating point sum exactly, in 128-bit fixed point. The
+    // result then does not depend on the order of AddEntry and Merge calls.
+    // Requires manually set bounds. Integral sums with manually set bounds are
+    // always accumulated in 128 bits, so this has no effect on them.
+    Builder& SetExactAccumulation(bool exact_accumulation) {
+      exact_accumulation_ = exact_accumulation;
+      return *this;
+    }
+
    private:
     base::StatusOr<std::unique_ptr<BoundedSum<T>>> BuildBoundedAlgorithm()
         override {
@@ -67,6 +81,10 @@ class BoundedSum : public Algorithm<T> {
 
       // Ensure that either bounds are manually set or ApproxBounds is made.
       RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
+      if (exact_accumulation_ && !BoundedBuilder::BoundsAreSet()) {
+        return absl::InvalidArgumentError(
+            "Exact accumulation requires manually set bounds.");
+      }
 
       // If manual bounding, construct mechanism so we can fail on build if
       // sensitivity is inappropriate.
@@ -93,8 +111,11 @@ class BoundedSum : public Algorithm<T> {
           AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
           AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1),
           std::move(mech_builder), std::move(mechanism),
-          std::move(BoundedBuilder::MoveApproxBoundsPointer())));
+          std::move(BoundedBuilder::MoveApproxBoundsPointer()),
+          exact_accumulation_));
     }
+
+    bool exact_accumulation_ = false;
   };
 
   void AddEntry(const T& t) override {
@@ -106,7 +127,9 @@ class BoundedSum : public Algorithm<T> {
 
     // If manual bounds are set, clamp immediately and store sum. Otherwise,
     // feed inputs into ApproxBounds and store temporary partial sums.
-    if (!approx_bounds_) {
+    if (exact_sum_) {
+      AddToExactSum(Clamp<T>(lower_, upper_, t));
+    } else if (!approx_bounds_) {
       pos_sum_[0] += Clamp<T>(lower_, upper_, t);
     } else {
       approx_bounds_->AddEntry(t);
@@ -120,6 +143,37 @@ class BoundedSum : public Algorithm<T> {
     }
   }
 
+  // Adds multiple inputs to the algorithm. With manual bounds, the inputs are
+  // clamped and summed in one pass without a virtual call per entry.
+  template <typename Iterator>
+  void AddEntries(Iterator begin, Iterator end) {
+    if (approx_bounds_) {
+      for (auto it = begin; it != end; ++it) {
+        BoundedSum::AddEntry(*it);
+      }
+      return;
+    }
+    if (exact_sum_ && std::is_integral<T>::value) {
+      exact_sum_->AddClampedIntegers(begin, end, lower_, upper_);
+      return;
+    }
+    if (exact_sum_) {
+      for (auto it = begin; it != end; ++it) {
+        if (!std::isnan(static_cast<double>(*it))) {
+          exact_sum_->Add(Clamp<T>(lower_, upper_, *it));
+        }
+      }
+      return;
+    }
+    T sum = 0;
+    for (auto it = begin; it != end; ++it) {
+      if (!std::isnan(static_cast<double>(*it))) {
+        sum += Clamp<T>(lower_, upper_, *it);
+      }
+    }
+    pos_sum_[0] += sum;
+  }
+
   // Only return noise confidence interval for manually set bounds, since it is
   // dynamic upon result generation for auto-bounds.
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
@@ -136,10 +190,26 @@ class BoundedSum : public Algorithm<T> {
   T upper() { return upper_; }
 
   Summary Serialize() override {
+    Summary summary;
+    SerializeTo(&summary);
+    return summary;
+  }
+
+  void SerializeTo(Summary* summary) override {
     // Create BoundedSumSummary.
     BoundedSumSummary bs_summary;
-    for (T x : pos_sum_) {
-      SetValue(bs_summary.add_pos_sum(), x);
+    if (exact_sum_) {
+      // Readers that do not know fixed_point_sum get the sum as a plain value.
+      if (std::is_integral<T>::value) {
+        SetValue(bs_summary.add_pos_sum(), exact_sum_->SaturatedInteger());
+      } else {
+        SetValue(bs_summary.add_pos_sum(), exact_sum_->Value());
+      }
+      *bs_summary.mutable_fixed_point_sum() = exact_sum_->Serialize();
+    } else {
+      for (T x : pos_sum_) {
+        SetValue(bs_summary.add_pos_sum(), x);
+      }
     }
     for (T x : neg_sum_) {
       SetValue(bs_summary.add_neg_sum(), x);
@@ -150,40 +220,52 @@ class BoundedSum : public Algorithm<T> {
           bs_summary.mutable_bounds_summary());
     }
 
-    // Create Summary.
-    Summary summary;
-    summary.mutable_data()->PackFrom(bs_summary);
-    return summary;
+    summary->mutable_data()->PackFrom(bs_summary);
   }
 
   absl::Status Merge(const Summary& summary) override {
-    if (!summary.has_data()) {
-      return absl::InternalError(
-          "Cannot merge summary with no bounded sum data.");
-    }
+    BoundedSumSummary bs_summary;
+    return MergeWith(summary, &bs_summary);
+  }
 
-    // Add bounded sum partial values.
+  absl::Status MergeMany(absl::Span<const Summary> summaries) override {
     BoundedSumSummary bs_summary;
-    if (!summary.data().UnpackTo(&bs_summary)) {
-      return absl::InternalError("Bounded sum summary unable to be unpacked.");
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(MergeWith(summary, &bs_summary));
     }
-    if (pos_sum_.size() != bs_summary.pos_sum_size() ||
-        neg_sum_.size() != bs_summary.neg_sum_size()) {
+    return absl::OkStatus();
+  }
+
+  // Same as Merge, but reads the serialized summary in place. The partial sums
+  // and the bin counts of automatically determined bounds are added directly
+  // from the serialized summary.
+  absl::Status MergeSerialized(absl::string_view summary) override {
+    ASSIGN_OR_RETURN(
+        absl::string_view bs_summary,
+        internal::UnpackSerializedSummary<BoundedSumSummary>(summary));
+    // The first pass checks the summary and the number of partial sums, so that
+    // the second one can add them in place.
+    SerializedSummaryFields fields;
+    RETURN_IF_ERROR(ReadSerializedSummary(
+        bs_summary, /*add_partial_sums=*/false, &fields));
+    if (pos_sum_.size() != fields.num_pos_sums ||
+        neg_sum_.size() != fields.num_neg_sums) {
       return absl::InternalError(
           "Merged BoundedSum must have the same amount of partial sum "
           "values as this BoundedSum.");
     }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bs_summary.pos_sum(i));
-    }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bs_summary.neg_sum(i));
+    if (exact_sum_) {
+      if (fields.fixed_point_sum.has_value()) {
+        return exact_sum_->MergeSerialized(*fields.fixed_point_sum);
+      }
+      AddToExactSum(fields.first_pos_sum);
+      return absl::OkStatus();
     }
+    RETURN_IF_ERROR(ReadSerializedSummary(
+        bs_summary, /*add_partial_sums=*/true, &fields));
     if (approx_bounds_) {
-      Summary approx_bounds_summary;
-      approx_bounds_summary.mutable_data()->PackFrom(
-          bs_summary.bounds_summary());
-      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+      RETURN_IF_ERROR(
+          approx_bounds_->MergeSerializedBinCounts(fields.bounds_summary));
     }
     return absl::OkStatus();
   }
@@ -229,7 +311,8 @@ class BoundedSum : public Algorithm<T> {
              const double max_contributions_per_partition,
              std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
              std::unique_ptr<NumericalMechanism> mechanism,
-             std::unique_ptr<ApproxBounds<T>> approx_bounds = nullptr)
+             std::unique_ptr<ApproxBounds<T>> approx_bounds = nullptr,
+             bool exact_accumulation = false)
       : Algorithm<T>(epsilon),
         lower_(lower),
         upper_(upper),
@@ -247,14 +330,113 @@ class BoundedSum : public Algorithm<T> {
     } else {
       pos_sum_.push_back(0);
     }
+    // Integral sums with manual bounds are always accumulated in 128 bits, so
+    // that they cannot overflow before the result saturates.
+    if (!approx_bounds_ && std::is_integral<T>::value) {
+      exact_sum_ = FixedPointSum::ForIntegers();
+    } else if (!approx_bounds_ && exact_accumulation) {
+      exact_sum_.emplace(std::max(std::abs(lower_), std::abs(upper_)));
+    }
   }
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
+    Output output;
+    ASSIGN_OR_RETURN(ValueType sum,
+                     NoisySum(privacy_budget, noise_interval_level, &output));
+    *output.add_elements()->mutable_value() = sum;
+    return output;
+  }
+
+  base::StatusOr<ValueType> GenerateValue(double privacy_budget) override {
+    return NoisySum(privacy_budget, kDefaultConfidenceLevel,
+                    /*output=*/nullptr);
+  }
+
+  void ResetState() override {
+    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
+    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    if (exact_sum_) {
+      exact_sum_->Reset();
+    }
+    if (approx_bounds_) {
+      approx_bounds_->Reset();
+      mechanism_ = nullptr;
+    }
+  }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<NumericalMechanism> mechanism;
+    std::unique_ptr<ApproxBounds<T>> approx_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone,
+                       approx_bounds_->Clone());
+      approx_bounds.reset(static_cast<ApproxBounds<T>*>(clone.release()));
+    } else {
+      ASSIGN_OR_RETURN(mechanism, mechanism_->Clone());
+    }
+    return std::unique_ptr<Algorithm<T>>(new BoundedSum<T>(
+        Algorithm<T>::GetEpsilon(), approx_bounds ? 0 : lower_,
+        approx_bounds ? 0 : upper_, l0_sensitivity_,
+        max_contributions_per_partition_, mechanism_builder_->Clone(),
+        std::move(mechanism), std::move(approx_bounds),
+        exact_sum_.has_value()));
+  }
+
+ private:
+  // Merges summary, unpacking it into bs_summary, which MergeMany reuses
+  // for all summaries.
+  absl::Status MergeWith(const Summary& summary,
+                         BoundedSumSummary* bs_summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded sum data.");
+    }
+
+    // Add bounded sum partial values.
+    if (!summary.data().UnpackTo(bs_summary)) {
+      return absl::InternalError("Bounded sum summary unable to be unpacked.");
+    }
+    if (pos_sum_.size() != bs_summary->pos_sum_size() ||
+        neg_sum_.size() != bs_summary->neg_sum_size()) {
+      return absl::InternalError(
+          "Merged BoundedSum must have the same amount of partial sum "
+          "values as this BoundedSum.");
+    }
+    if (exact_sum_) {
+      // Summaries of sums that were not accumulated exactly only carry the
+      // rounded sum, which is added like any other value.
+      if (bs_summary->has_fixed_point_sum()) {
+        return exact_sum_->Merge(bs_summary->fixed_point_sum());
+      }
+      AddToExactSum(GetValue<T>(bs_summary->pos_sum(0)));
+      return absl::OkStatus();
+    }
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetValue<T>(bs_summary->pos_sum(i));
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetValue<T>(bs_summary->neg_sum(i));
+    }
+    if (approx_bounds_) {
+      Summary approx_bounds_summary;
+      approx_bounds_summary.mutable_data()->PackFrom(
+          bs_summary->bounds_summary());
+      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    }
+    return absl::OkStatus();
+  }
+
+  // Finds the bounds, if they are not set manually, and returns the noisy sum.
+  // If output is not null, adds the bounding report and noise confidence
+  // interval to its error report. Without them, fewer histogram bins of
+  // ApproxBounds have to be noised.
+  base::StatusOr<ValueType> NoisySum(double privacy_budget,
+                                     double noise_interval_level,
+                                     Output* output) {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
 
-    Output output;
     double sum = 0;
     double remaining_budget = privacy_budget;
 
@@ -280,14 +462,16 @@ class BoundedSum : public Algorithm<T> {
           pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_, 0);
 
       // Populate the bounding report with ApproxBounds information.
-      *(output.mutable_error_report()->mutable_bounding_report()) =
-          approx_bounds_->GetBoundingReport(lower_, upper_);
+      if (output != nullptr) {
+        *(output->mutable_error_report()->mutable_bounding_report()) =
+            approx_bounds_->GetBoundingReport(lower_, upper_);
+      }
 
       // Clear the mechanism. The sensitivity might have changed.
       mechanism_.reset();
     } else {
       // Manual bounds were set and clamping was done upon adding entries.
-      sum = pos_sum_[0];
+      sum = exact_sum_ ? exact_sum_->Value() : pos_sum_[0];
     }
 
     // Construct mechanism if needed. Mechanism is already constructed if
@@ -301,11 +485,13 @@ class BoundedSum : public Algorithm<T> {
     }
 
     // Add noise confidence interval to the error report.
-    base::StatusOr<ConfidenceInterval> interval =
-        NoiseConfidenceIntervalImpl(noise_interval_level, remaining_budget);
-    if (interval.ok()) {
-      *(output.mutable_error_report()->mutable_noise_confidence_interval()) =
-          interval.value();
+    if (output != nullptr) {
+      base::StatusOr<ConfidenceInterval> interval =
+          NoiseConfidenceIntervalImpl(noise_interval_level, remaining_budget);
+      if (interval.ok()) {
+        *(output->mutable_error_report()
+              ->mutable_noise_confidence_interval()) = interval.value();
+      }
     }
 
     // Add noise to sum. Use the remaining privacy budget.
@@ -313,23 +499,11 @@ class BoundedSum : public Algorithm<T> {
     if (std::is_integral<T>::value) {
       T value;
       SafeCastFromDouble<T>(std::round(noisy_sum), value);
-      AddToOutput<T>(&output, value);
-    } else {
-      AddToOutput<T>(&output, noisy_sum);
-    }
-    return output;
-  }
-
-  void ResetState() override {
-    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
-    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
-    if (approx_bounds_) {
-      approx_bounds_->Reset();
-      mechanism_ = nullptr;
+      return MakeValueType<T>(value);
     }
+    return MakeValueType<T>(noisy_sum);
   }
 
- private:
   base::StatusOr<ConfidenceInterval> NoiseConfidenceIntervalImpl(
       double confidence_level, double privacy_budget = 1) {
     if (!mechanism_) {
@@ -341,6 +515,75 @@ class BoundedSum : public Algorithm<T> {
                                                privacy_budget);
   }
 
+  // The fields of a serialized BoundedSumSummary that MergeSerialized needs
+  // besides the partial sums, with embedded summaries still serialized.
+  struct SerializedSummaryFields {
+    int num_pos_sums = 0;
+    int num_neg_sums = 0;
+    T first_pos_sum = 0;
+    absl::optional<absl::string_view> fixed_point_sum;
+    absl::string_view bounds_summary;
+  };
+
+  // Reads a serialized BoundedSumSummary in place into fields. If
+  // add_partial_sums is set, also adds its partial sums to pos_sum_ and
+  // neg_sum_, which must be as many as the summary holds.
+  absl::Status ReadSerializedSummary(absl::string_view bs_summary,
+                                     bool add_partial_sums,
+                                     SerializedSummaryFields* fields) {
+    *fields = SerializedSummaryFields();
+    internal::SerializedMessageReader reader(bs_summary);
+    while (reader.NextField()) {
+      absl::string_view field;
+      bool ok;
+      switch (reader.field_number()) {
+        case BoundedSumSummary::kPosSumFieldNumber:
+        case BoundedSumSummary::kNegSumFieldNumber: {
+          const bool positive =
+              reader.field_number() == BoundedSumSummary::kPosSumFieldNumber;
+          int& index = positive ? fields->num_pos_sums : fields->num_neg_sums;
+          T value;
+          ok = reader.ReadLengthDelimited(&field) &&
+               internal::ReadSerializedValue(field, &value);
+          if (ok && positive && index == 0) {
+            fields->first_pos_sum = value;
+          }
+          if (ok && add_partial_sums) {
+            (positive ? pos_sum_ : neg_sum_)[index] += value;
+          }
+          ++index;
+          break;
+        }
+        case BoundedSumSummary::kBoundsSummaryFieldNumber:
+          ok = reader.ReadLengthDelimited(&fields->bounds_summary);
+          break;
+        case BoundedSumSummary::kFixedPointSumFieldNumber:
+          ok = reader.ReadLengthDelimited(&field);
+          fields->fixed_point_sum = field;
+          break;
+        default:
+          ok = reader.SkipField();
+      }
+      if (!ok) {
+        return absl::InternalError(
+            "Bounded sum summary unable to be unpacked.");
+      }
+    }
+    if (!reader.AtEnd()) {
+      return absl::InternalError("Bounded sum summary unable to be unpacked.");
+    }
+    return absl::OkStatus();
+  }
+
+  // Adds an already clamped value to exact_sum_.
+  void AddToExactSum(T clamped) {
+    if (std::is_integral<T>::value) {
+      exact_sum_->AddInteger(clamped);
+    } else {
+      exact_sum_->Add(clamped);
+    }
+  }
+
   static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
       std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
       const double epsilon, const double l0_sensitivity,
@@ -372,6 +615,10 @@ class BoundedSum : public Algorithm<T> {
   // If this is not nullptr, we are automatically determining bounds. Otherwise,
   // lower and upper contain the manually set bounds.
   std::unique_ptr<ApproxBounds<T>> approx_bounds_;
+
+  // Set for exact accumulation and for integral sums with manual bounds, in
+  // which case it holds the clamped sum instead of pos_sum_.
+  absl::optional<FixedPointSum> exact_sum_;
 };
 
 }  // namespace differential_privacy
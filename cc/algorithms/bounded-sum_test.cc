@@ -16,6 +16,10 @@
 
 #include "algorithms/bounded-sum.h"
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -289,6 +293,158 @@ TYPED_TEST(BoundedSumTest, SerializeMergeTest) {
   EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
 }
 
+// MergeMany reuses one BoundedSumSummary, so summaries with partial sums of
+// automatically bounded sums must not leak into each other.
+TYPED_TEST(BoundedSumTest, MergeManyMatchesMerge) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  bounds_builder.SetThreshold(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto build = [&]() {
+    auto bounds = bounds_builder.Build();
+    EXPECT_OK(bounds);
+    return builder.SetApproxBounds(std::move(*bounds)).Build();
+  };
+
+  std::vector<Summary> summaries;
+  for (TypeParam entry : {-10, 4, 6}) {
+    auto bs = build();
+    ASSERT_OK(bs);
+    (*bs)->AddEntry(entry);
+    summaries.push_back((*bs)->Serialize());
+  }
+
+  auto merged_one_by_one = build();
+  ASSERT_OK(merged_one_by_one);
+  for (const Summary& summary : summaries) {
+    EXPECT_OK((*merged_one_by_one)->Merge(summary));
+  }
+  auto merged_at_once = build();
+  ASSERT_OK(merged_at_once);
+  EXPECT_OK((*merged_at_once)->MergeMany(summaries));
+
+  EXPECT_THAT((*merged_at_once)->Serialize(),
+              EqualsProto((*merged_one_by_one)->Serialize()));
+  auto output = (*merged_at_once)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_NEAR(GetValue<TypeParam>(*output), 0, 1e-10);
+}
+
+TYPED_TEST(BoundedSumTest, MergeManyRejectsMismatchedSummary) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLower(0).SetUpper(3).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto bs = builder.Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(2);
+  CountSummary count_summary;
+  Summary count;
+  count.mutable_data()->PackFrom(count_summary);
+  std::vector<Summary> summaries = {(*bs)->Serialize(), count};
+
+  EXPECT_THAT((*bs)->MergeMany(summaries),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("unable to be unpacked")));
+  auto output = (*bs)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 4);
+}
+
+TYPED_TEST(BoundedSumTest, MergeSerializedMatchesMerge) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLower(-3).SetUpper(3).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto other = builder.Build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(2);
+  (*other)->AddEntry(-10);
+  const Summary summary = (*other)->Serialize();
+
+  auto merged = builder.Build();
+  ASSERT_OK(merged);
+  (*merged)->AddEntry(1);
+  EXPECT_OK((*merged)->Merge(summary));
+  auto merged_serialized = builder.Build();
+  ASSERT_OK(merged_serialized);
+  (*merged_serialized)->AddEntry(1);
+  EXPECT_OK((*merged_serialized)->MergeSerialized(summary.SerializeAsString()));
+
+  EXPECT_THAT((*merged_serialized)->Serialize(),
+              EqualsProto((*merged)->Serialize()));
+  auto output = (*merged_serialized)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 0);
+}
+
+TEST(BoundedSumTest, MergeSerializedExactSum) {
+  BoundedSum<double>::Builder builder;
+  builder.SetLower(-1).SetUpper(1).SetExactAccumulation(true)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto other = builder.Build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(.5);
+  (*other)->AddEntry(.25);
+
+  auto sum = builder.Build();
+  ASSERT_OK(sum);
+  (*sum)->AddEntry(-1);
+  EXPECT_OK((*sum)->MergeSerialized((*other)->Serialize().SerializeAsString()));
+  EXPECT_THAT((*sum)->PartialResultValue<double>(), IsOkAndHolds(-.25));
+}
+
+TYPED_TEST(BoundedSumTest, MergeSerializedPartialSums) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  bounds_builder.SetThreshold(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto build = [&]() {
+    auto bounds = bounds_builder.Build();
+    EXPECT_OK(bounds);
+    return builder.SetApproxBounds(std::move(*bounds)).Build();
+  };
+  auto other = build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(-10);
+  (*other)->AddEntry(4);
+  const Summary summary = (*other)->Serialize();
+
+  auto merged = build();
+  ASSERT_OK(merged);
+  (*merged)->AddEntry(6);
+  EXPECT_OK((*merged)->Merge(summary));
+  auto merged_serialized = build();
+  ASSERT_OK(merged_serialized);
+  (*merged_serialized)->AddEntry(6);
+  EXPECT_OK((*merged_serialized)->MergeSerialized(summary.SerializeAsString()));
+
+  EXPECT_THAT((*merged_serialized)->Serialize(),
+              EqualsProto((*merged)->Serialize()));
+}
+
+TYPED_TEST(BoundedSumTest, MergeSerializedRejectsDifferentBounding) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto automatic = builder.Build();
+  ASSERT_OK(automatic);
+  (*automatic)->AddEntry(1);
+  auto manual = builder.SetLower(0).SetUpper(1).Build();
+  ASSERT_OK(manual);
+  const Summary empty = (*manual)->Serialize();
+
+  EXPECT_THAT((*manual)->MergeSerialized(
+                  (*automatic)->Serialize().SerializeAsString()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same amount of partial sum values")));
+  EXPECT_THAT((*manual)->Serialize(), EqualsProto(empty));
+
+  std::string truncated = (*automatic)->Serialize().SerializeAsString();
+  truncated.pop_back();
+  EXPECT_THAT((*automatic)->MergeSerialized(truncated),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("malformed")));
+}
+
 TYPED_TEST(BoundedSumTest, SerializeMergePartialSumsTest) {
   typename ApproxBounds<TypeParam>::Builder bounds_builder;
   typename BoundedSum<TypeParam>::Builder builder;
@@ -344,8 +500,9 @@ TEST(BoundedSumTest, OverflowAddEntryManualBounds) {
 
   base::StatusOr<Output> result = (*bs)->PartialResult();
   ASSERT_OK(result);
-  // Overflowing should result in the running sum wrapping around to zero.
-  EXPECT_EQ(GetValue<int64_t>(result.value()), 0);
+  // The sum is accumulated in 128 bits and only saturates at release.
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::max());
 }
 
 TEST(BoundedSumTest, UnderflowAddEntryManualBounds) {
@@ -365,8 +522,9 @@ TEST(BoundedSumTest, UnderflowAddEntryManualBounds) {
 
   base::StatusOr<Output> result = (*bs)->PartialResult();
   ASSERT_OK(result);
-  // Underflowing should result in the running sum wrapping around to zero.
-  EXPECT_EQ(GetValue<int64_t>(result.value()), 0);
+  // The sum is accumulated in 128 bits and only saturates at release.
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::lowest());
 }
 
 TEST(BoundedSumTest, OverflowMergeManualBoundsTest) {
@@ -392,8 +550,9 @@ TEST(BoundedSumTest, OverflowMergeManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bs2)->PartialResult();
   EXPECT_OK(result);
-  // Overflowing should result in the running sum wrapping around to zero.
-  EXPECT_EQ(GetValue<int64_t>(result.value()), 0);
+  // The sum is accumulated in 128 bits and only saturates at release.
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::max());
 
   // Test post-overflow serialize & merge
   summary = (*bs2)->Serialize();
@@ -401,7 +560,8 @@ TEST(BoundedSumTest, OverflowMergeManualBoundsTest) {
   EXPECT_OK((*bs2)->Merge(summary));
   result = (*bs2)->PartialResult();
   EXPECT_OK(result);
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0);
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::max());
 }
 
 TEST(BoundedSumTest, UnderflowMergeManualBoundsTest) {
@@ -427,8 +587,9 @@ TEST(BoundedSumTest, UnderflowMergeManualBoundsTest) {
 
   base::StatusOr<Output> result = (*bs2)->PartialResult();
   EXPECT_OK(result);
-  // Underflowing should result in the running sum wrapping around to zero.
-  EXPECT_EQ(GetValue<int64_t>(result.value()), 0);
+  // The sum is accumulated in 128 bits and only saturates at release.
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::lowest());
 
   // Test post-overflow serialize & merge
   summary = (*bs2)->Serialize();
@@ -436,7 +597,39 @@ TEST(BoundedSumTest, UnderflowMergeManualBoundsTest) {
   EXPECT_OK((*bs2)->Merge(summary));
   result = (*bs2)->PartialResult();
   EXPECT_OK(result);
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0);
+  EXPECT_EQ(GetValue<int64_t>(result.value()),
+            std::numeric_limits<int64_t>::lowest());
+}
+
+TEST(BoundedSumTest, IntermediateOverflowDoesNotChangeResult) {
+  BoundedSum<int64_t>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .SetLower(-std::numeric_limits<int64_t>::max())
+      .SetUpper(std::numeric_limits<int64_t>::max());
+  auto bs = builder.Build();
+  ASSERT_OK(bs);
+  const std::vector<int64_t> inputs = {std::numeric_limits<int64_t>::max(),
+                                       std::numeric_limits<int64_t>::max(),
+                                       -std::numeric_limits<int64_t>::max(),
+                                       -2};
+  (*bs)->AddEntries(inputs.begin(), inputs.end());
+  Summary summary = (*bs)->Serialize();
+
+  // The wide sum survives serialization, while the plain pos_sum saturates.
+  BoundedSumSummary bs_summary;
+  ASSERT_TRUE(summary.data().UnpackTo(&bs_summary));
+  EXPECT_EQ(GetValue<int64_t>(bs_summary.pos_sum(0)),
+            std::numeric_limits<int64_t>::max() - 2);
+  auto bs2 = builder.Build();
+  ASSERT_OK(bs2);
+  (*bs2)->AddEntry(std::numeric_limits<int64_t>::max());
+  ASSERT_OK((*bs2)->Merge(summary));
+  (*bs2)->AddEntry(-std::numeric_limits<int64_t>::max());
+  (*bs2)->AddEntry(-std::numeric_limits<int64_t>::max());
+
+  base::StatusOr<Output> result = (*bs2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), -2);
 }
 
 TEST(BoundedSumTest, DropNanEntriesManualBounds) {
@@ -660,6 +853,96 @@ TYPED_TEST(BoundedSumTest, Reset) {
   EXPECT_EQ(GetValue<TypeParam>(result->elements(0).value()), 1);
 }
 
+TYPED_TEST(BoundedSumTest, PartialResultValueManualBounds) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 10};
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(5)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntries(a.begin(), a.end());
+  auto result = (*bs)->template PartialResultValue<TypeParam>();
+  ASSERT_OK(result);
+  EXPECT_EQ(*result, 15);
+}
+
+TYPED_TEST(BoundedSumTest, PartialResultValueApproxBounds) {
+  std::vector<TypeParam> a = {-10, 1000, -100, 100, 1};
+  auto bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(3)
+          .SetBase(10)
+          .SetScale(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetThreshold(1)
+          .Build();
+  ASSERT_OK(bounds);
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(std::move(*bounds))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntries(a.begin(), a.end());
+  auto output = (*bs)->PartialResult(0.5);
+  ASSERT_OK(output);
+  auto result = (*bs)->template PartialResultValue<TypeParam>(0.5);
+  ASSERT_OK(result);
+  EXPECT_EQ(*result, GetValue<TypeParam>(output->elements(0).value()));
+}
+
+TYPED_TEST(BoundedSumTest, CloneWithApproxBounds) {
+  auto bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(3)
+          .SetBase(10)
+          .SetScale(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetThreshold(1)
+          .Build();
+  ASSERT_OK(bounds);
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(std::move(*bounds))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  std::vector<TypeParam> a = {-10, 1000};
+  (*bs)->AddEntries(a.begin(), a.end());
+
+  // The clone starts empty but bounds and sums like the original.
+  auto clone = (*bs)->Clone();
+  ASSERT_OK(clone);
+  std::vector<TypeParam> b = {-100, 100, 1};
+  (*clone)->AddEntries(b.begin(), b.end());
+  auto result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(0).value()), 1);
+}
+
+TYPED_TEST(BoundedSumTest, CloneWithManualBounds) {
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  auto clone = (*bs)->Clone();
+  ASSERT_OK(clone);
+  std::vector<TypeParam> a = {1, 1, 5};
+  (*clone)->AddEntries(a.begin(), a.end());
+  auto result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(0).value()), 4);
+}
+
 TYPED_TEST(BoundedSumTest, Memory) {
   auto bounds_small =
       typename ApproxBounds<TypeParam>::Builder().SetNumBins(1).Build();
@@ -697,5 +980,112 @@ TYPED_TEST(BoundedSumTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT((*bs)->GetAggregationEpsilon(), epsilon);
 }
 
+TEST(BoundedSumTest, ExactAccumulationDoesNotDependOnOrder) {
+  std::vector<double> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(std::sin(i) * std::pow(10, i % 7 - 3));
+  }
+  BoundedSum<double>::Builder builder;
+  builder.SetLower(-1000)
+      .SetUpper(1000)
+      .SetExactAccumulation(true)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  auto forward = builder.Build();
+  ASSERT_OK(forward);
+  (*forward)->AddEntries(values.begin(), values.end());
+
+  // Ingest the reversed inputs in three shards, merged in a different order.
+  std::vector<std::unique_ptr<BoundedSum<double>>> shards;
+  for (int i = 0; i < 3; ++i) {
+    auto shard = builder.Build();
+    ASSERT_OK(shard);
+    shards.push_back(std::move(*shard));
+  }
+  for (int i = values.size() - 1; i >= 0; --i) {
+    shards[i % 3]->AddEntry(values[i]);
+  }
+  ASSERT_OK(shards[2]->Merge(shards[0]->Serialize()));
+  ASSERT_OK(shards[2]->Merge(shards[1]->Serialize()));
+
+  auto expected = (*forward)->PartialResult();
+  ASSERT_OK(expected);
+  auto actual = shards[2]->PartialResult();
+  ASSERT_OK(actual);
+  EXPECT_EQ(GetValue<double>(*actual), GetValue<double>(*expected));
+}
+
+TEST(BoundedSumTest, ExactAccumulationClampsAndMergesPlainSummaries) {
+  BoundedSum<double>::Builder builder;
+  builder.SetLower(-1)
+      .SetUpper(1)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto plain = builder.Build();
+  ASSERT_OK(plain);
+  (*plain)->AddEntry(.25);
+  auto exact = builder.SetExactAccumulation(true).Build();
+  ASSERT_OK(exact);
+  (*exact)->AddEntry(5);
+  (*exact)->AddEntry(std::numeric_limits<double>::quiet_NaN());
+
+  // The summary of an exact sum can still be merged into a plain sum.
+  ASSERT_OK((*plain)->Merge((*exact)->Serialize()));
+  ASSERT_OK((*exact)->Merge((*plain)->Serialize()));
+  auto exact_result = (*exact)->PartialResult();
+  ASSERT_OK(exact_result);
+  EXPECT_EQ(GetValue<double>(*exact_result), 2.25);
+}
+
+TEST(BoundedSumTest, ExactAccumulationRejectsDifferentBounds) {
+  auto sum1 = BoundedSum<double>::Builder()
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .SetExactAccumulation(true)
+                  .Build();
+  ASSERT_OK(sum1);
+  auto sum2 = BoundedSum<double>::Builder()
+                  .SetLower(0)
+                  .SetUpper(100)
+                  .SetExactAccumulation(true)
+                  .Build();
+  ASSERT_OK(sum2);
+  EXPECT_THAT((*sum1)->Merge((*sum2)->Serialize()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same exponent")));
+}
+
+TEST(BoundedSumTest, ExactAccumulationRequiresManualBounds) {
+  EXPECT_THAT(BoundedSum<double>::Builder().SetExactAccumulation(true).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires manually set bounds")));
+}
+
+TEST(BoundedSumTest, ExactAccumulationResetAndClone) {
+  auto sum = BoundedSum<double>::Builder()
+                 .SetLower(0)
+                 .SetUpper(1)
+                 .SetExactAccumulation(true)
+                 .SetLaplaceMechanism(
+                     absl::make_unique<ZeroNoiseMechanism::Builder>())
+                 .Build();
+  ASSERT_OK(sum);
+  (*sum)->AddEntry(.5);
+  (*sum)->Reset();
+  (*sum)->AddEntry(.25);
+  auto clone = (*sum)->Clone();
+  ASSERT_OK(clone);
+  (*clone)->AddEntry(.125);
+  Summary summary = (*clone)->Serialize();
+  BoundedSumSummary bs_summary;
+  ASSERT_TRUE(summary.data().UnpackTo(&bs_summary));
+  EXPECT_TRUE(bs_summary.has_fixed_point_sum());
+  auto sum_result = (*sum)->PartialResult();
+  ASSERT_OK(sum_result);
+  EXPECT_EQ(GetValue<double>(*sum_result), .25);
+  auto clone_result = (*clone)->PartialResult();
+  ASSERT_OK(clone_result);
+  EXPECT_EQ(GetValue<double>(*clone_result), .125);
+}
+
 }  //  namespace
 }  // namespace differential_privacy
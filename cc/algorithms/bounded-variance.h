@@ -23,10 +23,13 @@
 #include "google/protobuf/any.pb.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/fixed-point-sum.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
@@ -158,11 +161,23 @@ class BoundedVariance : public Algorithm<T> {
   void AddEntry(const T& t) override { AddMultipleEntries(t, 1); }
 
   Summary Serialize() override {
+    Summary summary;
+    SerializeTo(&summary);
+    return summary;
+  }
+
+  void SerializeTo(Summary* summary) override {
     // Create BoundedVarianceSummary.
     BoundedVarianceSummary bv_summary;
     bv_summary.set_count(raw_count_);
-    for (T x : pos_sum_) {
-      SetValue(bv_summary.add_pos_sum(), x);
+    if (exact_sum_) {
+      // Readers that do not know fixed_point_sum get the saturated sum.
+      SetValue(bv_summary.add_pos_sum(), exact_sum_->SaturatedInteger());
+      *bv_summary.mutable_fixed_point_sum() = exact_sum_->Serialize();
+    } else {
+      for (T x : pos_sum_) {
+        SetValue(bv_summary.add_pos_sum(), x);
+      }
     }
     for (T x : neg_sum_) {
       SetValue(bv_summary.add_neg_sum(), x);
@@ -179,56 +194,19 @@ class BoundedVariance : public Algorithm<T> {
           bv_summary.mutable_bounds_summary());
     }
 
-    // Create Summary.
-    Summary summary;
-    summary.mutable_data()->PackFrom(bv_summary);
-    return summary;
+    summary->mutable_data()->PackFrom(bv_summary);
   }
 
   absl::Status Merge(const Summary& summary) override {
-    if (!summary.has_data()) {
-      return absl::InternalError(
-          "Cannot merge summary with no bounded variance data.");
-    }
-
-    // Unpack bounded variance summary.
     BoundedVarianceSummary bv_summary;
-    if (!summary.data().UnpackTo(&bv_summary)) {
-      return absl::InternalError(
-          "Bounded variance summary unable to be unpacked.");
-    }
-    if ((approx_bounds_ != nullptr) != bv_summary.has_bounds_summary()) {
-      return absl::InternalError(
-          "Merged BoundedVariance must have the same bounding strategy.");
-    }
-    if (pos_sum_.size() != bv_summary.pos_sum_size() ||
-        neg_sum_.size() != bv_summary.neg_sum_size() ||
-        pos_sum_of_squares_.size() != bv_summary.pos_sum_of_squares_size() ||
-        neg_sum_of_squares_.size() != bv_summary.neg_sum_of_squares_size()) {
-      return absl::InternalError(
-          "Merged BoundedVariance must have the same amount of partial "
-          "sum or sum of squares values as this BoundedVariance.");
-    }
-
-    // Add count and partial values to current ones.
-    raw_count_ += bv_summary.count();
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bv_summary.pos_sum(i));
-      pos_sum_of_squares_[i] += bv_summary.pos_sum_of_squares(i);
-    }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bv_summary.neg_sum(i));
-      neg_sum_of_squares_[i] += bv_summary.neg_sum_of_squares(i);
-    }
+    return MergeWith(summary, &bv_summary);
+  }
 
-    // Merge approx bounds if auto-clamping.
-    if (approx_bounds_) {
-      Summary approx_bounds_summary;
-      approx_bounds_summary.mutable_data()->PackFrom(
-          bv_summary.bounds_summary());
-      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+  absl::Status MergeMany(absl::Span<const Summary> summaries) override {
+    BoundedVarianceSummary bv_summary;
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(MergeWith(summary, &bv_summary));
     }
-
     return absl::OkStatus();
   }
 
@@ -270,6 +248,64 @@ class BoundedVariance : public Algorithm<T> {
   double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
 
  private:
+  // Merges summary, unpacking it into bv_summary, which MergeMany reuses
+  // for all summaries.
+  absl::Status MergeWith(const Summary& summary,
+                         BoundedVarianceSummary* bv_summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded variance data.");
+    }
+
+    // Unpack bounded variance summary.
+    if (!summary.data().UnpackTo(bv_summary)) {
+      return absl::InternalError(
+          "Bounded variance summary unable to be unpacked.");
+    }
+    if ((approx_bounds_ != nullptr) != bv_summary->has_bounds_summary()) {
+      return absl::InternalError(
+          "Merged BoundedVariance must have the same bounding strategy.");
+    }
+    if (pos_sum_.size() != bv_summary->pos_sum_size() ||
+        neg_sum_.size() != bv_summary->neg_sum_size() ||
+        pos_sum_of_squares_.size() != bv_summary->pos_sum_of_squares_size() ||
+        neg_sum_of_squares_.size() != bv_summary->neg_sum_of_squares_size()) {
+      return absl::InternalError(
+          "Merged BoundedVariance must have the same amount of partial "
+          "sum or sum of squares values as this BoundedVariance.");
+    }
+
+    // Add count and partial values to current ones.
+    raw_count_ += bv_summary->count();
+    if (exact_sum_) {
+      if (bv_summary->has_fixed_point_sum()) {
+        RETURN_IF_ERROR(exact_sum_->Merge(bv_summary->fixed_point_sum()));
+      } else {
+        exact_sum_->AddInteger(GetValue<T>(bv_summary->pos_sum(0)));
+      }
+    }
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      if (!exact_sum_) {
+        pos_sum_[i] += GetValue<T>(bv_summary->pos_sum(i));
+      }
+      pos_sum_of_squares_[i] += bv_summary->pos_sum_of_squares(i);
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetValue<T>(bv_summary->neg_sum(i));
+      neg_sum_of_squares_[i] += bv_summary->neg_sum_of_squares(i);
+    }
+
+    // Merge approx bounds if auto-clamping.
+    if (approx_bounds_) {
+      Summary approx_bounds_summary;
+      approx_bounds_summary.mutable_data()->PackFrom(
+          bv_summary->bounds_summary());
+      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    }
+
+    return absl::OkStatus();
+  }
+
   BoundedVariance(const double epsilon, const T lower, const T upper,
                   const double l0_sensitivity,
                   const double max_contributions_per_partition,
@@ -301,6 +337,11 @@ class BoundedVariance : public Algorithm<T> {
       pos_sum_.push_back(0);
       pos_sum_of_squares_.push_back(0);
     }
+    // Integral sums with manual bounds are accumulated in 128 bits, so that
+    // they cannot overflow before the result saturates.
+    if (!approx_bounds_ && std::is_integral<T>::value) {
+      exact_sum_ = FixedPointSum::ForIntegers();
+    }
   }
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
@@ -345,7 +386,7 @@ class BoundedVariance : public Algorithm<T> {
     } else {
       // In this case, lower and upper were manually set. The clamped partial
       // values are stored and do not need processing.
-      sum = pos_sum_[0];
+      sum = exact_sum_ ? exact_sum_->Value() : pos_sum_[0];
       sos = pos_sum_of_squares_[0];
     }
 
@@ -414,6 +455,9 @@ class BoundedVariance : public Algorithm<T> {
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
     std::fill(neg_sum_of_squares_.begin(), neg_sum_of_squares_.end(), 0);
     raw_count_ = 0;
+    if (exact_sum_) {
+      exact_sum_->Reset();
+    }
 
     if (approx_bounds_) {
       approx_bounds_->Reset();
@@ -422,6 +466,28 @@ class BoundedVariance : public Algorithm<T> {
     }
   }
 
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<NumericalMechanism> sum_mechanism;
+    std::unique_ptr<NumericalMechanism> sos_mechanism;
+    std::unique_ptr<ApproxBounds<T>> approx_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<T>> clone,
+                       approx_bounds_->Clone());
+      approx_bounds.reset(static_cast<ApproxBounds<T>*>(clone.release()));
+    } else {
+      ASSIGN_OR_RETURN(sum_mechanism, sum_mechanism_->Clone());
+      ASSIGN_OR_RETURN(sos_mechanism, sos_mechanism_->Clone());
+    }
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> count_mechanism,
+                     count_mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(new BoundedVariance<T>(
+        Algorithm<T>::GetEpsilon(), approx_bounds ? 0 : lower_,
+        approx_bounds ? 0 : upper_, l0_sensitivity_,
+        max_contributions_per_partition_, mechanism_builder_->Clone(),
+        std::move(sum_mechanism), std::move(sos_mechanism),
+        std::move(count_mechanism), std::move(approx_bounds)));
+  }
+
   static double IntervalLengthSquared(T lower, T upper) {
     return std::pow(static_cast<double>(upper - lower), 2);
   }
@@ -516,8 +582,13 @@ class BoundedVariance : public Algorithm<T> {
           "AddManualBoundsEntry() can only be used when bounds were set "
           "manually.");
     }
-    pos_sum_[0] += Clamp<T>(std::numeric_limits<T>::lowest(),
-                            std::numeric_limits<T>::max(), t * num_of_entries);
+    if (exact_sum_) {
+      exact_sum_->AddInteger(t, num_of_entries);
+    } else {
+      pos_sum_[0] +=
+          Clamp<T>(std::numeric_limits<T>::lowest(),
+                   std::numeric_limits<T>::max(), t * num_of_entries);
+    }
     pos_sum_of_squares_[0] += pow(t, 2) * num_of_entries;
     return absl::OkStatus();
   }
@@ -547,6 +618,10 @@ class BoundedVariance : public Algorithm<T> {
   // If this is not nullptr, we are automatically determining bounds. Otherwise,
   // lower and upper contain the manually set bounds.
   std::unique_ptr<ApproxBounds<T>> approx_bounds_;
+
+  // Set for integral types with manual bounds, in which case it holds the
+  // clamped sum instead of pos_sum_.
+  absl::optional<FixedPointSum> exact_sum_;
 };
 
 }  // namespace differential_privacy
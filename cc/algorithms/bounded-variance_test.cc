@@ -406,7 +406,6 @@ TEST(BoundedVarianceTest, OverflowAddEntryManualBounds) {
           .SetUpper(1)
           .Build()
           .ValueOrDie();
-  // Try to overflow so far that it would result in an running sum of almost 0.
   BoundedVarianceTestPeer::AddMultipleEntries<int64_t>(
       1, std::numeric_limits<int64_t>::max(), bv.get());
   BoundedVarianceTestPeer::AddMultipleEntries<int64_t>(
@@ -414,8 +413,9 @@ TEST(BoundedVarianceTest, OverflowAddEntryManualBounds) {
 
   auto result = bv->PartialResult();
   EXPECT_OK(result.status());
-  // Overflow should result in a variance of 1.0.
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 1.0);
+  // The sum is accumulated in 128 bits and does not overflow, so the
+  // variance of the identical entries is 0.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
 }
 
 TEST(BoundedVarianceTest, UnderflowAddEntryManualBounds) {
@@ -435,8 +435,9 @@ TEST(BoundedVarianceTest, UnderflowAddEntryManualBounds) {
 
   auto result = bv->PartialResult();
   EXPECT_OK(result.status());
-  // Overflow should result in a variance of 1.0
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 1.0);
+  // The sum is accumulated in 128 bits and does not overflow, so the
+  // variance of the identical entries is 0.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
 }
 
 TEST(BoundedVarianceTest, OverflowRawCountMergeManualBoundsTest) {
@@ -492,8 +493,9 @@ TEST(BoundedVarianceTest, OverflowMergeManualBoundsTest) {
 
   auto result = bv2->PartialResult();
   EXPECT_OK(result.status());
-  // Overflow should result in a variance of 1.0
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 1.0);
+  // The sum is accumulated in 128 bits and does not overflow, so the
+  // variance of the identical entries is 0.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
 }
 
 TEST(BoundedVarianceTest, UnderflowMergeManualBoundsTest) {
@@ -518,8 +520,9 @@ TEST(BoundedVarianceTest, UnderflowMergeManualBoundsTest) {
 
   auto result = bv2->PartialResult();
   EXPECT_OK(result.status());
-  // Underflow should result in a variance of 1.0
-  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 1.0);
+  // The sum is accumulated in 128 bits and does not overflow, so the
+  // variance of the identical entries is 0.
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 0.0);
 }
 
 TEST(BoundedVarianceTest, SensitivityOverflow) {
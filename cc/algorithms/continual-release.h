@@ -0,0 +1,389 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/bounded-algorithm.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Continual-release algorithms publish a running total after every time step
+// of a stream, e.g. once a minute, instead of a single result. Every call to
+// PartialResult() closes the current time step and releases the noisy total of
+// all entries added so far. The noise of a release is the sum of O(log T)
+// samples, where T is the maximum number of releases set in the builder,
+// rather than growing linearly as with repeated PartialResult(budget) calls on
+// Count or BoundedSum.
+//
+// The whole privacy budget covers all T releases and is consumed by the first
+// one, so results must be obtained with PartialResult() and not with an
+// explicit fraction of the budget. After T releases the algorithm returns
+// FailedPrecondition until it is Reset. Summaries cannot be merged into a
+// continual-release algorithm, since the noise already released would not
+// account for them.
+namespace internal {
+
+// The binary tree (hierarchical) mechanism of "Private and Continual Release
+// of Statistics" (Chan, Shi, Song). Time step t is covered by the tree nodes
+// for the set bits of t, one per level, each holding the noisy sum of its
+// steps. Only the open node of every level is stored, so the state is
+// O(log T), and every release samples noise once and updates the noisy total
+// in amortized O(1).
+template <typename S>
+class BinaryTreeAggregator {
+ public:
+  // Returns the number of tree levels needed for max_releases releases, which
+  // is the number of nodes each entry contributes to.
+  static int NumLevels(int64_t max_releases) {
+    int levels = 1;
+    while (levels < 63 && (int64_t{1} << levels) <= max_releases) {
+      ++levels;
+    }
+    return levels;
+  }
+
+  // Builds the mechanism used to noise each node. An entry changes one node
+  // per level, so each node gets an equal share of epsilon and delta.
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      int64_t max_releases, double epsilon, absl::optional<double> delta,
+      double l0_sensitivity, double linf_sensitivity) {
+    const int levels = NumLevels(max_releases);
+    mechanism_builder->SetEpsilon(epsilon / levels);
+    if (delta.has_value()) {
+      mechanism_builder->SetDelta(delta.value() / levels);
+    }
+    return mechanism_builder->SetL0Sensitivity(l0_sensitivity)
+        .SetLInfSensitivity(linf_sensitivity)
+        .Build();
+  }
+
+  BinaryTreeAggregator(int64_t max_releases,
+                       std::unique_ptr<NumericalMechanism> mechanism)
+      : max_releases_(max_releases),
+        partial_sums_(NumLevels(max_releases), 0),
+        noisy_partial_sums_(NumLevels(max_releases), 0),
+        mechanism_(std::move(mechanism)) {}
+
+  // Adds value to the current time step.
+  void Add(S value) { step_sum_ += value; }
+
+  // Closes the current time step and returns the noisy total of all steps.
+  base::StatusOr<double> Release() {
+    if (num_releases_ >= max_releases_) {
+      return absl::FailedPreconditionError(
+          absl::StrCat("All ", max_releases_,
+                       " releases have been made. Reset the algorithm to "
+                       "start a new stream."));
+    }
+    ++num_releases_;
+
+    // The node for this step sits at the level of the lowest set bit of the
+    // step number. It covers all the nodes below it, which were all open and
+    // now drop out of the noisy total.
+    int level = 0;
+    S node_sum = step_sum_;
+    while (((num_releases_ >> level) & 1) == 0) {
+      node_sum += partial_sums_[level];
+      noisy_total_ -= noisy_partial_sums_[level];
+      partial_sums_[level] = 0;
+      noisy_partial_sums_[level] = 0;
+      ++level;
+    }
+    partial_sums_[level] = node_sum;
+    noisy_partial_sums_[level] =
+        mechanism_->AddNoise(static_cast<double>(node_sum), 1.0);
+    noisy_total_ += noisy_partial_sums_[level];
+    step_sum_ = 0;
+    return noisy_total_;
+  }
+
+  void Reset() {
+    std::fill(partial_sums_.begin(), partial_sums_.end(), 0);
+    std::fill(noisy_partial_sums_.begin(), noisy_partial_sums_.end(), 0);
+    step_sum_ = 0;
+    noisy_total_ = 0;
+    num_releases_ = 0;
+  }
+
+  int64_t MemoryUsed() const {
+    return sizeof(BinaryTreeAggregator<S>) +
+           sizeof(S) * partial_sums_.capacity() +
+           sizeof(double) * noisy_partial_sums_.capacity() +
+           mechanism_->MemoryUsed();
+  }
+
+  int64_t max_releases() const { return max_releases_; }
+  int64_t num_releases() const { return num_releases_; }
+  NumericalMechanism* mechanism() const { return mechanism_.get(); }
+
+ private:
+  const int64_t max_releases_;
+  int64_t num_releases_ = 0;
+
+  // Sum of the entries added since the last release.
+  S step_sum_ = 0;
+
+  // Exact and noisy sums of the open node of each level. The noisy total is
+  // the sum of the noisy partial sums.
+  std::vector<S> partial_sums_;
+  std::vector<double> noisy_partial_sums_;
+  double noisy_total_ = 0;
+
+  std::unique_ptr<NumericalMechanism> mechanism_;
+};
+
+// The whole budget must have been consumed by the time of the first release.
+inline absl::Status CheckContinualReleaseBudget(double remaining_budget) {
+  if (remaining_budget > 0) {
+    return absl::FailedPreconditionError(
+        "Continual release algorithms consume the whole privacy budget at "
+        "the first release. Use PartialResult() without a privacy budget.");
+  }
+  return absl::OkStatus();
+}
+
+inline absl::Status ValidateMaxReleases(absl::optional<int64_t> max_releases) {
+  RETURN_IF_ERROR(ValidateIsSet(max_releases, "Maximum number of releases"));
+  return ValidateIsPositive(max_releases, "Maximum number of releases");
+}
+
+}  // namespace internal
+
+// Continually releases the number of elements added so far, with
+// differentially private noise. See above.
+template <typename T>
+class ContinualCount : public Algorithm<T> {
+ public:
+  class Builder : public AlgorithmBuilder<T, ContinualCount<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, ContinualCount<T>, Builder>;
+
+   public:
+    // The number of results that will be released. Required.
+    Builder& SetMaxReleases(int64_t max_releases) {
+      max_releases_ = max_releases;
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<ContinualCount<T>>> BuildAlgorithm()
+        override {
+      RETURN_IF_ERROR(internal::ValidateMaxReleases(max_releases_));
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> mechanism,
+          internal::BinaryTreeAggregator<int64_t>::BuildMechanism(
+              AlgorithmBuilder::GetMechanismBuilderClone(),
+              max_releases_.value(), AlgorithmBuilder::GetEpsilon().value(),
+              AlgorithmBuilder::GetDelta(),
+              AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+              AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
+                  1)));
+      return absl::WrapUnique(
+          new ContinualCount<T>(AlgorithmBuilder::GetEpsilon().value(),
+                                max_releases_.value(), std::move(mechanism)));
+    }
+
+    absl::optional<int64_t> max_releases_;
+  };
+
+  void AddEntry(const T& v) override { tree_.Add(1); }
+
+  // Only the number of inputs matters, so this does not touch the individual
+  // entries.
+  template <typename Iterator>
+  void AddEntries(Iterator begin, Iterator end) {
+    tree_.Add(std::distance(begin, end));
+  }
+
+  Summary Serialize() override { return Summary(); }
+
+  absl::Status Merge(const Summary& summary) override {
+    return absl::UnimplementedError(
+        "Merge() unsupported for continual release algorithms");
+  }
+
+  int64_t MemoryUsed() override {
+    return sizeof(ContinualCount<T>) - sizeof(tree_) + tree_.MemoryUsed();
+  }
+
+  // Returns the number of results released since the last Reset.
+  int64_t NumReleases() const { return tree_.num_releases(); }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(internal::CheckContinualReleaseBudget(
+        Algorithm<T>::RemainingPrivacyBudget()));
+    ASSIGN_OR_RETURN(double noisy_count, tree_.Release());
+    int64_t count;
+    SafeCastFromDouble(std::round(noisy_count), count);
+    Output output;
+    AddToOutput<int64_t>(&output, count);
+    return output;
+  }
+
+  void ResetState() override { tree_.Reset(); }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> mechanism,
+                     tree_.mechanism()->Clone());
+    return std::unique_ptr<Algorithm<T>>(
+        new ContinualCount<T>(Algorithm<T>::GetEpsilon(),
+                              tree_.max_releases(), std::move(mechanism)));
+  }
+
+ private:
+  ContinualCount(double epsilon, int64_t max_releases,
+                 std::unique_ptr<NumericalMechanism> mechanism)
+      : Algorithm<T>(epsilon), tree_(max_releases, std::move(mechanism)) {}
+
+  internal::BinaryTreeAggregator<int64_t> tree_;
+};
+
+// Continually releases the sum of the elements added so far, clamped between
+// manually set lower and upper bounds, with differentially private noise.
+// Bounds cannot be inferred, since they would have to be known before the
+// first release. See above.
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class ContinualBoundedSum : public Algorithm<T> {
+ public:
+  class Builder
+      : public BoundedAlgorithmBuilder<T, ContinualBoundedSum<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, ContinualBoundedSum<T>,
+                                               Builder>;
+    using BoundedBuilder =
+        BoundedAlgorithmBuilder<T, ContinualBoundedSum<T>, Builder>;
+
+   public:
+    // The number of results that will be released. Required.
+    Builder& SetMaxReleases(int64_t max_releases) {
+      max_releases_ = max_releases;
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<ContinualBoundedSum<T>>>
+    BuildBoundedAlgorithm() override {
+      if (!BoundedBuilder::BoundsAreSet()) {
+        return absl::InvalidArgumentError(
+            "Continual release requires manually set bounds.");
+      }
+      RETURN_IF_ERROR(internal::ValidateMaxReleases(max_releases_));
+      const T lower = BoundedBuilder::GetLower().value();
+      const T upper = BoundedBuilder::GetUpper().value();
+      RETURN_IF_ERROR(BoundedSum<T>::Builder::CheckLowerBound(lower));
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> mechanism,
+          internal::BinaryTreeAggregator<T>::BuildMechanism(
+              AlgorithmBuilder::GetMechanismBuilderClone(),
+              max_releases_.value(), AlgorithmBuilder::GetEpsilon().value(),
+              AlgorithmBuilder::GetDelta(),
+              AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+              AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1) *
+                  std::max(std::abs(lower), std::abs(upper))));
+      return absl::WrapUnique(new ContinualBoundedSum<T>(
+          AlgorithmBuilder::GetEpsilon().value(), lower, upper,
+          max_releases_.value(), std::move(mechanism)));
+    }
+
+    absl::optional<int64_t> max_releases_;
+  };
+
+  void AddEntry(const T& t) override {
+    if (std::isnan(static_cast<double>(t))) {
+      return;
+    }
+    tree_.Add(Clamp<T>(lower_, upper_, t));
+  }
+
+  Summary Serialize() override { return Summary(); }
+
+  absl::Status Merge(const Summary& summary) override {
+    return absl::UnimplementedError(
+        "Merge() unsupported for continual release algorithms");
+  }
+
+  int64_t MemoryUsed() override {
+    return sizeof(ContinualBoundedSum<T>) - sizeof(tree_) + tree_.MemoryUsed();
+  }
+
+  // Returns the number of results released since the last Reset.
+  int64_t NumReleases() const { return tree_.num_releases(); }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(internal::CheckContinualReleaseBudget(
+        Algorithm<T>::RemainingPrivacyBudget()));
+    ASSIGN_OR_RETURN(double noisy_sum, tree_.Release());
+    Output output;
+    if (std::is_integral<T>::value) {
+      T value;
+      SafeCastFromDouble<T>(std::round(noisy_sum), value);
+      AddToOutput<T>(&output, value);
+    } else {
+      AddToOutput<T>(&output, noisy_sum);
+    }
+    return output;
+  }
+
+  void ResetState() override { tree_.Reset(); }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> mechanism,
+                     tree_.mechanism()->Clone());
+    return std::unique_ptr<Algorithm<T>>(new ContinualBoundedSum<T>(
+        Algorithm<T>::GetEpsilon(), lower_, upper_, tree_.max_releases(),
+        std::move(mechanism)));
+  }
+
+ private:
+  ContinualBoundedSum(double epsilon, T lower, T upper, int64_t max_releases,
+                      std::unique_ptr<NumericalMechanism> mechanism)
+      : Algorithm<T>(epsilon),
+        lower_(lower),
+        upper_(upper),
+        tree_(max_releases, std::move(mechanism)) {}
+
+  const T lower_;
+  const T upper_;
+  internal::BinaryTreeAggregator<T> tree_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
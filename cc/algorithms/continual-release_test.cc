@@ -0,0 +1,278 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/continual-release.h"
+
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+// Adds exactly 1 to every value and counts how often noise was requested, so
+// that a release shows how many tree nodes it is made of.
+class UnitNoiseMechanism : public ZeroNoiseMechanism {
+ public:
+  class Builder : public ZeroNoiseMechanism::Builder {
+   public:
+    explicit Builder(int* num_calls) : num_calls_(num_calls) {}
+
+    base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() override {
+      return base::StatusOr<std::unique_ptr<LaplaceMechanism>>(
+          absl::make_unique<UnitNoiseMechanism>(num_calls_));
+    }
+
+    std::unique_ptr<NumericalMechanismBuilder> Clone() const override {
+      return absl::make_unique<Builder>(*this);
+    }
+
+   private:
+    int* num_calls_;
+  };
+
+  explicit UnitNoiseMechanism(int* num_calls)
+      : ZeroNoiseMechanism(1, 1), num_calls_(num_calls) {}
+
+  double AddNoise(double result, double privacy_budget) override {
+    ++*num_calls_;
+    return result + 1;
+  }
+
+ private:
+  int* num_calls_;
+};
+
+int NumSetBits(int64_t n) {
+  int bits = 0;
+  for (; n > 0; n >>= 1) {
+    bits += n & 1;
+  }
+  return bits;
+}
+
+TEST(BinaryTreeAggregatorTest, NumLevels) {
+  EXPECT_EQ(internal::BinaryTreeAggregator<int64_t>::NumLevels(1), 1);
+  EXPECT_EQ(internal::BinaryTreeAggregator<int64_t>::NumLevels(2), 2);
+  EXPECT_EQ(internal::BinaryTreeAggregator<int64_t>::NumLevels(3), 2);
+  EXPECT_EQ(internal::BinaryTreeAggregator<int64_t>::NumLevels(4), 3);
+  EXPECT_EQ(internal::BinaryTreeAggregator<int64_t>::NumLevels(1440), 11);
+}
+
+TEST(ContinualCountTest, ReleasesRunningCount) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder()
+          .SetMaxReleases(8)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  int64_t expected = 0;
+  for (int step = 1; step <= 8; ++step) {
+    for (int i = 0; i < step; ++i) {
+      (*count)->AddEntry(i);
+    }
+    expected += step;
+    base::StatusOr<Output> result = (*count)->PartialResult();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<int64_t>(*result), expected);
+  }
+  EXPECT_EQ((*count)->NumReleases(), 8);
+}
+
+// Release t is the sum of one noisy node per set bit of t, and each release
+// samples noise exactly once.
+TEST(ContinualCountTest, SumsOneNodePerSetBit) {
+  int num_calls = 0;
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder()
+          .SetMaxReleases(100)
+          .SetLaplaceMechanism(
+              absl::make_unique<UnitNoiseMechanism::Builder>(&num_calls))
+          .Build();
+  ASSERT_OK(count);
+  for (int step = 1; step <= 100; ++step) {
+    (*count)->AddEntry(0);
+    base::StatusOr<Output> result = (*count)->PartialResult();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<int64_t>(*result), step + NumSetBits(step));
+    EXPECT_EQ(num_calls, step);
+  }
+}
+
+TEST(ContinualCountTest, FailsAfterMaxReleases) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder().SetMaxReleases(2).Build();
+  ASSERT_OK(count);
+  EXPECT_OK((*count)->PartialResult());
+  EXPECT_OK((*count)->PartialResult());
+  EXPECT_THAT((*count)->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("All 2 releases have been made")));
+
+  (*count)->Reset();
+  EXPECT_EQ((*count)->NumReleases(), 0);
+  EXPECT_OK((*count)->PartialResult());
+}
+
+TEST(ContinualCountTest, RequiresWholeBudgetAtFirstRelease) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder()
+          .SetMaxReleases(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  EXPECT_THAT((*count)->PartialResult(0.5),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("whole privacy budget")));
+  EXPECT_EQ((*count)->NumReleases(), 0);
+  EXPECT_OK((*count)->PartialResult());
+}
+
+TEST(ContinualCountTest, RequiresMaxReleases) {
+  EXPECT_THAT(ContinualCount<int>::Builder().Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of releases")));
+  EXPECT_THAT(ContinualCount<int>::Builder().SetMaxReleases(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of releases")));
+}
+
+TEST(ContinualCountTest, CannotMerge) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder().SetMaxReleases(2).Build();
+  ASSERT_OK(count);
+  EXPECT_THAT((*count)->Merge((*count)->Serialize()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST(ContinualCountTest, CloneStartsNewStream) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> count =
+      ContinualCount<int>::Builder()
+          .SetMaxReleases(4)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntry(1);
+  ASSERT_OK((*count)->PartialResult());
+
+  base::StatusOr<std::unique_ptr<Algorithm<int>>> clone = (*count)->Clone();
+  ASSERT_OK(clone);
+  (*clone)->AddEntry(1);
+  (*clone)->AddEntry(1);
+  base::StatusOr<Output> result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 2);
+}
+
+TEST(ContinualCountTest, MemoryIsLogarithmicInMaxReleases) {
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> small =
+      ContinualCount<int>::Builder().SetMaxReleases(2).Build();
+  ASSERT_OK(small);
+  base::StatusOr<std::unique_ptr<ContinualCount<int>>> large =
+      ContinualCount<int>::Builder().SetMaxReleases(1 << 20).Build();
+  ASSERT_OK(large);
+  EXPECT_LE((*large)->MemoryUsed() - (*small)->MemoryUsed(),
+            19 * (sizeof(int64_t) + sizeof(double)));
+}
+
+template <typename T>
+class ContinualBoundedSumTest : public testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(ContinualBoundedSumTest, NumericTypes);
+
+TYPED_TEST(ContinualBoundedSumTest, ReleasesRunningClampedSum) {
+  base::StatusOr<std::unique_ptr<ContinualBoundedSum<TypeParam>>> sum =
+      typename ContinualBoundedSum<TypeParam>::Builder()
+          .SetMaxReleases(3)
+          .SetLower(-1)
+          .SetUpper(5)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(sum);
+  (*sum)->AddEntry(2);
+  (*sum)->AddEntry(10);
+  base::StatusOr<Output> result = (*sum)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 7);
+
+  result = (*sum)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 7);
+
+  (*sum)->AddEntry(-3);
+  result = (*sum)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 6);
+}
+
+TYPED_TEST(ContinualBoundedSumTest, SumsOneNodePerSetBit) {
+  int num_calls = 0;
+  base::StatusOr<std::unique_ptr<ContinualBoundedSum<TypeParam>>> sum =
+      typename ContinualBoundedSum<TypeParam>::Builder()
+          .SetMaxReleases(64)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(
+              absl::make_unique<UnitNoiseMechanism::Builder>(&num_calls))
+          .Build();
+  ASSERT_OK(sum);
+  for (int step = 1; step <= 64; ++step) {
+    (*sum)->AddEntry(3);
+    base::StatusOr<Output> result = (*sum)->PartialResult();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<TypeParam>(*result), 3 * step + NumSetBits(step));
+  }
+  EXPECT_EQ(num_calls, 64);
+}
+
+TYPED_TEST(ContinualBoundedSumTest, RequiresManualBounds) {
+  EXPECT_THAT(typename ContinualBoundedSum<TypeParam>::Builder()
+                  .SetMaxReleases(3)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires manually set bounds")));
+}
+
+TYPED_TEST(ContinualBoundedSumTest, CloneKeepsBounds) {
+  base::StatusOr<std::unique_ptr<ContinualBoundedSum<TypeParam>>> sum =
+      typename ContinualBoundedSum<TypeParam>::Builder()
+          .SetMaxReleases(3)
+          .SetLower(0)
+          .SetUpper(5)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(sum);
+  base::StatusOr<std::unique_ptr<Algorithm<TypeParam>>> clone =
+      (*sum)->Clone();
+  ASSERT_OK(clone);
+  (*clone)->AddEntry(100);
+  base::StatusOr<Output> result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 5);
+}
+
+}  // namespace
+}  // namespace differential_privacy
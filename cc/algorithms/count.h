@@ -19,9 +19,12 @@
 
 #include "google/protobuf/any.pb.h"
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/serialized-summary.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
@@ -37,6 +40,13 @@ class Count : public Algorithm<T> {
 
   void AddEntry(const T& v) override { AddMultipleEntries(v, 1); }
 
+  // Adds multiple inputs to the algorithm. Only the number of inputs matters,
+  // so this does not touch the individual entries.
+  template <typename Iterator>
+  void AddEntries(Iterator begin, Iterator end) {
+    count_ += std::distance(begin, end);
+  }
+
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
       double confidence_level, double privacy_budget = 1) override {
     return mechanism_->NoiseConfidenceInterval(confidence_level,
@@ -45,29 +55,50 @@ class Count : public Algorithm<T> {
 
   // Create and return summary containing the count.
   Summary Serialize() override {
-    // Create CountSummary.
-    CountSummary count_summ;
-    count_summ.set_count(count_);
-
-    // Create Summary.
     Summary summary;
-    summary.mutable_data()->PackFrom(count_summ);
+    SerializeTo(&summary);
     return summary;
   }
 
+  void SerializeTo(Summary* summary) override {
+    CountSummary count_summ;
+    count_summ.set_count(count_);
+    summary->mutable_data()->PackFrom(count_summ);
+  }
+
   // Add count from serialized data.
   absl::Status Merge(const Summary& summary) override {
-    if (!summary.has_data()) {
-      return absl::InternalError("Cannot merge summary with no count data.");
-    }
+    CountSummary count_summary;
+    return MergeWith(summary, &count_summary);
+  }
 
-    // Add counts.
+  absl::Status MergeMany(absl::Span<const Summary> summaries) override {
     CountSummary count_summary;
-    if (!summary.data().UnpackTo(&count_summary)) {
-      return absl::InternalError("Count summary unable to be unpacked.");
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(MergeWith(summary, &count_summary));
     }
-    count_ += count_summary.count();
+    return absl::OkStatus();
+  }
 
+  // Same as Merge, but reads the serialized summary in place.
+  absl::Status MergeSerialized(absl::string_view summary) override {
+    ASSIGN_OR_RETURN(
+        absl::string_view count_summary,
+        internal::UnpackSerializedSummary<CountSummary>(summary));
+    uint64_t count = 0;
+    internal::SerializedMessageReader reader(count_summary);
+    while (reader.NextField()) {
+      const bool ok = reader.field_number() == CountSummary::kCountFieldNumber
+                          ? reader.ReadVarint(&count)
+                          : reader.SkipField();
+      if (!ok) {
+        return absl::InternalError("Count summary unable to be unpacked.");
+      }
+    }
+    if (!reader.AtEnd()) {
+      return absl::InternalError("Count summary unable to be unpacked.");
+    }
+    count_ += count;
     return absl::OkStatus();
   }
 
@@ -86,10 +117,7 @@ class Count : public Algorithm<T> {
                                        absl::StatusCode::kFailedPrecondition));
 
     Output output;
-    int64_t countWithNoise;
-    SafeCastFromDouble(std::round(mechanism_->AddNoise(count_, privacy_budget)),
-                       countWithNoise);
-    AddToOutput<int64_t>(&output, countWithNoise);
+    AddToOutput<int64_t>(&output, NoisyCount(privacy_budget));
 
     base::StatusOr<ConfidenceInterval> interval =
         NoiseConfidenceInterval(noise_interval_level, privacy_budget);
@@ -100,8 +128,21 @@ class Count : public Algorithm<T> {
     return output;
   }
 
+  base::StatusOr<ValueType> GenerateValue(double privacy_budget) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+    return MakeValueType<int64_t>(NoisyCount(privacy_budget));
+  }
+
   void ResetState() override { count_ = 0; }
 
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> mechanism,
+                     mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(
+        new Count<T>(Algorithm<T>::GetEpsilon(), std::move(mechanism)));
+  }
+
   uint64_t GetCount() const { return count_; }
 
   // The constructor and count_ are non-private for testing.
@@ -109,10 +150,33 @@ class Count : public Algorithm<T> {
       : Algorithm<T>(epsilon), count_(0), mechanism_(std::move(mechanism)) {}
 
  private:
+  int64_t NoisyCount(double privacy_budget) {
+    int64_t count_with_noise;
+    SafeCastFromDouble(std::round(mechanism_->AddNoise(count_, privacy_budget)),
+                       count_with_noise);
+    return count_with_noise;
+  }
+
   void AddMultipleEntries(const T& v, uint64_t num_of_entries) {
     count_ += num_of_entries;
   }
 
+  // Merges summary, unpacking it into count_summary, which MergeMany reuses
+  // for all summaries.
+  absl::Status MergeWith(const Summary& summary, CountSummary* count_summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError("Cannot merge summary with no count data.");
+    }
+
+    // Add counts.
+    if (!summary.data().UnpackTo(count_summary)) {
+      return absl::InternalError("Count summary unable to be unpacked.");
+    }
+    count_ += count_summary->count();
+
+    return absl::OkStatus();
+  }
+
   // Friend class for testing only
   friend class CountTestPeer;
 
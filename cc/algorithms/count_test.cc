@@ -17,8 +17,10 @@
 #include "algorithms/count.h"
 
 #include <memory>
+#include <vector>
 
 #include "google/protobuf/any.pb.h"
+#include "google/protobuf/arena.h"
 #include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -67,6 +69,20 @@ TYPED_TEST(CountTest, BasicTest) {
   EXPECT_EQ(GetValue<int64_t>(*result), 6);
 }
 
+TYPED_TEST(CountTest, AddEntriesTest) {
+  std::vector<TypeParam> c = {1, 2, 3, 4, 2, 3};
+  auto count =
+      typename Count<TypeParam>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntries(c.begin(), c.end());
+  (*count)->AddEntry(5);
+  auto result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 7);
+}
+
 TYPED_TEST(CountTest, RepeatedResultTest) {
   std::vector<TypeParam> c = {1, 2, 3, 4, 2, 3};
   auto count =
@@ -176,6 +192,87 @@ TEST(CountTest, MergeTest) {
   EXPECT_EQ(GetValue<int64_t>(*result), 3);
 }
 
+TEST(CountTest, SerializeToArena) {
+  auto count =
+      Count<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntry(0);
+  (*count)->AddEntry(0);
+
+  google::protobuf::Arena arena;
+  Summary* summary = google::protobuf::Arena::CreateMessage<Summary>(&arena);
+  (*count)->SerializeTo(summary);
+  EXPECT_EQ(summary->GetArena(), &arena);
+  EXPECT_THAT(*summary, EqualsProto((*count)->Serialize()));
+}
+
+TEST(CountTest, MergeManyTest) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  std::vector<Summary> summaries;
+  for (int i = 1; i <= 3; ++i) {
+    base::StatusOr<std::unique_ptr<Count<double>>> count = builder.Build();
+    ASSERT_OK(count);
+    for (int j = 0; j < i; ++j) {
+      (*count)->AddEntry(j);
+    }
+    summaries.push_back((*count)->Serialize());
+  }
+
+  base::StatusOr<std::unique_ptr<Count<double>>> count = builder.Build();
+  ASSERT_OK(count);
+  (*count)->AddEntry(0);
+  EXPECT_OK((*count)->MergeMany(summaries));
+  EXPECT_THAT((*count)->PartialResultValue<int64_t>(), IsOkAndHolds(7));
+}
+
+TEST(CountTest, MergeManyStopsAtInvalidSummary) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<Count<double>>> other = builder.Build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(0);
+  std::vector<Summary> summaries = {(*other)->Serialize(), Summary(),
+                                    (*other)->Serialize()};
+
+  base::StatusOr<std::unique_ptr<Count<double>>> count = builder.Build();
+  ASSERT_OK(count);
+  EXPECT_THAT((*count)->MergeMany(summaries),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("no count data")));
+  EXPECT_THAT((*count)->PartialResultValue<int64_t>(), IsOkAndHolds(1));
+}
+
+TEST(CountTest, MergeSerializedTest) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<Count<double>>> other = builder.Build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(0);
+  (*other)->AddEntry(0);
+
+  base::StatusOr<std::unique_ptr<Count<double>>> count = builder.Build();
+  ASSERT_OK(count);
+  (*count)->AddEntry(0);
+  EXPECT_OK(
+      (*count)->MergeSerialized((*other)->Serialize().SerializeAsString()));
+  EXPECT_THAT((*count)->PartialResultValue<int64_t>(), IsOkAndHolds(3));
+}
+
+TEST(CountTest, MergeSerializedRejectsOtherSummaries) {
+  auto count = Count<double>::Builder().Build();
+  ASSERT_OK(count);
+  Summary summary;
+  summary.mutable_data()->PackFrom(BoundedSumSummary());
+  EXPECT_THAT((*count)->MergeSerialized(summary.SerializeAsString()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("does not hold a")));
+  EXPECT_THAT((*count)->MergeSerialized("\x12"),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("malformed")));
+}
+
 TEST(CountTest, SerializeAndMergeOverflowTest) {
   Count<uint64_t>::Builder builder;
   builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
@@ -203,6 +300,39 @@ TEST(CountTest, SerializeAndMergeOverflowTest) {
   EXPECT_DOUBLE_EQ(GetValue<int64_t>(result.value()), 0);
 }
 
+TYPED_TEST(CountTest, PartialResultValue) {
+  std::vector<TypeParam> c = {1, 2, 3, 4, 2, 3};
+  auto count =
+      typename Count<TypeParam>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntries(c.begin(), c.end());
+  auto result = (*count)->template PartialResultValue<double>();
+  ASSERT_OK(result);
+  EXPECT_EQ(*result, 6);
+  EXPECT_EQ((*count)->RemainingPrivacyBudget(), 0);
+}
+
+TEST(CountTest, CloneIsEmptyWithSameParameters) {
+  std::vector<int> c = {1, 2, 3};
+  auto count =
+      Count<int>::Builder()
+          .SetEpsilon(0.5)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntries(c.begin(), c.end());
+
+  auto clone = (*count)->Clone();
+  ASSERT_OK(clone);
+  EXPECT_EQ((*clone)->GetEpsilon(), 0.5);
+  (*clone)->AddEntry(1);
+  auto result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 1);
+}
+
 TEST(CountTest, MemoryUsed) {
   auto count = Count<double>::Builder().Build();
   ASSERT_OK(count);
@@ -54,7 +54,9 @@ double ApproximateBinomialProbability(double sqrt_n, int64_t m) {
 
 }  // namespace
 
-GaussianDistribution::GaussianDistribution(double stddev) : stddev_(stddev) {
+GaussianDistribution::GaussianDistribution(double stddev, RandomSource* random)
+    : stddev_(stddev),
+      random_(random ? random : &SecureURBG::GetSingleton()) {
   DCHECK_GE(stddev, 0.0);
 }
 
@@ -89,13 +91,15 @@ double GaussianDistribution::cdf(double stddev, double x) {
   return (1 + std::erf(x / (stddev * sqrt(2)))) / 2;
 }
 
-GeometricDistribution::GeometricDistribution(double lambda) : lambda_(lambda) {
+GeometricDistribution::GeometricDistribution(double lambda,
+                                             RandomSource* random)
+    : lambda_(lambda), random_(random ? random : &SecureURBG::GetSingleton()) {
   DCHECK_GE(lambda, 0);
 }
 
 double GaussianDistribution::SampleGeometric() {
   int geom_sample = 0;
-  while (absl::Bernoulli(SecureURBG::GetSingleton(), 0.5)) ++geom_sample;
+  while (absl::Bernoulli(*random_, 0.5)) ++geom_sample;
   return geom_sample;
 }
 
@@ -110,7 +114,7 @@ double GaussianDistribution::SampleGeometric() {
 double GaussianDistribution::SampleBinomial(double sqrt_n) {
   long long step_size = static_cast<long long>(round(sqrt(2.0) * sqrt_n + 1));
 
-  SecureURBG& random = SecureURBG::GetSingleton();
+  RandomSource& random = *random_;
   while (true) {
     int geom_sample = SampleGeometric();
     int two_sided_geom =
@@ -119,7 +123,7 @@ double GaussianDistribution::SampleBinomial(double sqrt_n) {
     int64_t result = step_size * two_sided_geom + uniform_sample;
 
     double result_prob = ApproximateBinomialProbability(sqrt_n, result);
-    double reject_prob = UniformDouble();
+    double reject_prob = UniformDouble(random);
 
     if (result_prob > 0 && reject_prob > 0 &&
         reject_prob < result_prob * step_size * pow(2.0, geom_sample - 2)) {
@@ -128,7 +132,9 @@ double GaussianDistribution::SampleBinomial(double sqrt_n) {
   }
 }
 
-double GeometricDistribution::GetUniformDouble() { return UniformDouble(); }
+double GeometricDistribution::GetUniformDouble() {
+  return UniformDouble(*random_);
+}
 
 int64_t GeometricDistribution::Sample() { return Sample(1.0); }
 
@@ -190,9 +196,11 @@ base::StatusOr<double> CalculateGranularity(double epsilon,
   return gran;
 }
 
-LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
+LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity,
+                                         RandomSource* random) {
   epsilon_ = epsilon;
   sensitivity_ = sensitivity;
+  random_ = random ? random : &SecureURBG::GetSingleton();
 
   base::StatusOr<double> granularity =
       CalculateGranularity(epsilon_, sensitivity_);
@@ -205,13 +213,15 @@ LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
   } else {
     lambda = granularity_ * epsilon_ / (sensitivity_ + granularity_);
   }
-  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda);
+  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda, random_);
 }
 
-double LaplaceDistribution::GetUniformDouble() { return UniformDouble(); }
+double LaplaceDistribution::GetUniformDouble() {
+  return UniformDouble(*random_);
+}
 
 bool LaplaceDistribution::GetBoolean() {
-  return absl::Bernoulli(SecureURBG::GetSingleton(), 0.5);
+  return absl::Bernoulli(*random_, 0.5);
 }
 double LaplaceDistribution::Sample() { return Sample(1.0); }
 
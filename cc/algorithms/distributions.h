@@ -22,6 +22,7 @@
 #include <cstdint>
 #include "absl/status/status.h"
 #include "base/statusor.h"
+#include "algorithms/rand.h"
 
 namespace differential_privacy {
 namespace internal {
@@ -35,8 +36,9 @@ namespace internal {
 // of floating point arithmetic.
 class GaussianDistribution {
  public:
-  // Constructor for Gaussian with specified stddev.
-  explicit GaussianDistribution(double stddev);
+  // Constructor for Gaussian with specified stddev. Random bits are drawn from
+  // random, or from SecureURBG if it is null. random must outlive this object.
+  explicit GaussianDistribution(double stddev, RandomSource* random = nullptr);
 
   virtual ~GaussianDistribution() {}
 
@@ -64,6 +66,7 @@ class GaussianDistribution {
   double SampleBinomial(double sqrt_n);
 
   double stddev_;
+  RandomSource* random_;
 };
 
 // Returns a sample drawn from the geometric distribution of probability
@@ -74,7 +77,10 @@ class GaussianDistribution {
 // of their distribution.
 class GeometricDistribution {
  public:
-  explicit GeometricDistribution(double lambda);
+  // Random bits are drawn from random, or from SecureURBG if it is null.
+  // random must outlive this object.
+  explicit GeometricDistribution(double lambda,
+                                 RandomSource* random = nullptr);
 
   virtual ~GeometricDistribution() {}
 
@@ -88,6 +94,7 @@ class GeometricDistribution {
 
  private:
   double lambda_;
+  RandomSource* random_;
 };
 
 // Calculates 'r' from the secure noise paper (see
@@ -105,7 +112,10 @@ base::StatusOr<double> CalculateGranularity(double epsilon, double sensitivity);
 // http://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.366.5957&rep=rep1&type=pdf
 class LaplaceDistribution {
  public:
-  explicit LaplaceDistribution(double epsilon, double sensitivity);
+  // Random bits are drawn from random, or from SecureURBG if it is null.
+  // random must outlive this object.
+  explicit LaplaceDistribution(double epsilon, double sensitivity,
+                               RandomSource* random = nullptr);
 
   virtual ~LaplaceDistribution() = default;
 
@@ -132,6 +142,7 @@ class LaplaceDistribution {
   double epsilon_;
   double sensitivity_;
   double granularity_;
+  RandomSource* random_;
 
  protected:
   std::unique_ptr<GeometricDistribution> geometric_distro_;
@@ -103,6 +103,28 @@ TEST(LaplaceDistributionTest, Cdf) {
   EXPECT_EQ(LaplaceDistribution::cdf(1, 1), 1 - .5 * exp(-1));
 }
 
+TEST(LaplaceDistributionTest, SeededRandomSourceIsReproducible) {
+  test_utils::SeededRandomSource random(42);
+  test_utils::SeededRandomSource same_seed(42);
+  LaplaceDistribution dist(1.0, 1.0, &random);
+  LaplaceDistribution same_seed_dist(1.0, 1.0, &same_seed);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(dist.Sample(), same_seed_dist.Sample());
+  }
+}
+
+TEST(LaplaceDistributionTest, CheckStatisticsWithSeededRandomSource) {
+  test_utils::SeededRandomSource random(1);
+  LaplaceDistribution dist(1.0, 1.0, &random);
+  std::vector<double> samples(kNumGeometricSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist]() { return dist.Sample(1.0); });
+  double mean = Mean(samples);
+  double var = Variance(samples);
+  EXPECT_NEAR(0.0, mean, 0.01);
+  EXPECT_NEAR(2.0, var, 0.1);
+}
+
 TEST(GaussDistributionTest, CheckStatisticsForUnitValues) {
   GaussianDistribution dist(1.0);
   std::vector<double> samples(kGaussianSamples);
@@ -133,6 +155,26 @@ TEST(GaussDistributionTest, CheckStatisticsForSpecificScaledDistribution) {
   EXPECT_NEAR(stddev * stddev * scale * scale, Variance(samples), 0.1 * scale);
 }
 
+TEST(GaussDistributionTest, SeededRandomSourceIsReproducible) {
+  test_utils::SeededRandomSource random(42);
+  test_utils::SeededRandomSource same_seed(42);
+  GaussianDistribution dist(1.0, &random);
+  GaussianDistribution same_seed_dist(1.0, &same_seed);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(dist.Sample(), same_seed_dist.Sample());
+  }
+}
+
+TEST(GaussDistributionTest, CheckStatisticsWithSeededRandomSource) {
+  test_utils::SeededRandomSource random(1);
+  GaussianDistribution dist(1.0, &random);
+  std::vector<double> samples(kGaussianSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist]() { return dist.Sample(); });
+  EXPECT_NEAR(0.0, Mean(samples), 0.01);
+  EXPECT_NEAR(1.0, Variance(samples), 0.1);
+}
+
 TEST(GaussDistributionTest, StandardDeviationGetter) {
   double stddev = kOneOverLog2;
   GaussianDistribution dist(stddev);
@@ -0,0 +1,202 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_FIXED_POINT_SUM_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_FIXED_POINT_SUM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "algorithms/serialized-summary.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+
+// Sums floating point values exactly in a 128-bit fixed point representation.
+// Every value is scaled by 2^exponent and rounded to an integer once, when it
+// is added. All later additions and merges are integer additions, so the sum
+// does not depend on the order in which values are added or sums are merged.
+//
+// The exponent is chosen from the largest magnitude of the values to add, such
+// that each scaled value fits into 63 bits. The 128-bit sum therefore cannot
+// overflow for fewer than 2^64 values. Values are rounded to a multiple of
+// 2^-exponent, which is at most 2^-62 times that largest magnitude unless it is
+// below 2^-961.
+//
+// Integers are summed with exponent 0, i.e., unscaled, which makes this a plain
+// 128-bit integer accumulator that cannot overflow for any int64_t inputs.
+class FixedPointSum {
+ public:
+  // Creates an empty sum of values with magnitude at most max_magnitude.
+  explicit FixedPointSum(double max_magnitude)
+      : exponent_(ExponentForMagnitude(max_magnitude)),
+        scale_(std::ldexp(1.0, exponent_)) {}
+
+  // Creates an empty sum of integers, to be added with AddInteger() and
+  // AddClampedIntegers().
+  static FixedPointSum ForIntegers() {
+    return FixedPointSum(/*max_magnitude=*/0);
+  }
+
+  // Adds x, which must not be larger in magnitude than the max_magnitude the
+  // sum was created with.
+  void Add(double x) { sum_ += std::llround(x * scale_); }
+
+  // Adds num_of_entries copies of x to a sum created with ForIntegers(). The
+  // product is computed in 128 bits and cannot overflow.
+  void AddInteger(int64_t x, uint64_t num_of_entries = 1) {
+    sum_ += absl::int128(x) * num_of_entries;
+  }
+
+  // Clamps the integers in [begin, end) to [lower, upper], adds them to a sum
+  // created with ForIntegers() and returns how many were added. The inputs are
+  // summed into int64_t chunks that are short enough not to overflow, so the
+  // inner loop needs neither overflow checks nor 128-bit arithmetic.
+  template <typename Iterator>
+  uint64_t AddClampedIntegers(Iterator begin, Iterator end, int64_t lower,
+                              int64_t upper) {
+    const uint64_t max_magnitude =
+        std::max(lower < 0 ? 0 - static_cast<uint64_t>(lower) : 0,
+                 upper > 0 ? static_cast<uint64_t>(upper) : 0);
+    const uint64_t chunk_size =
+        max_magnitude == 0
+            ? std::numeric_limits<uint64_t>::max()
+            : std::max<uint64_t>(
+                  1, std::numeric_limits<int64_t>::max() / max_magnitude);
+    uint64_t count = 0;
+    while (begin != end) {
+      int64_t chunk_sum = 0;
+      uint64_t i = 0;
+      for (; i < chunk_size && begin != end; ++i, ++begin) {
+        chunk_sum += std::min<int64_t>(std::max<int64_t>(*begin, lower), upper);
+      }
+      sum_ += chunk_sum;
+      count += i;
+    }
+    return count;
+  }
+
+  // Adds another sum that was created with the same max_magnitude.
+  void Add(const FixedPointSum& other) { sum_ += other.sum_; }
+
+  // Returns the sum, rounded to the nearest double.
+  double Value() const {
+    return std::ldexp(static_cast<double>(sum_), -exponent_);
+  }
+
+  // Returns the sum of a sum created with ForIntegers(), saturated to the range
+  // of int64_t.
+  int64_t SaturatedInteger() const {
+    if (sum_ > std::numeric_limits<int64_t>::max()) {
+      return std::numeric_limits<int64_t>::max();
+    }
+    if (sum_ < std::numeric_limits<int64_t>::lowest()) {
+      return std::numeric_limits<int64_t>::lowest();
+    }
+    return static_cast<int64_t>(sum_);
+  }
+
+  void Reset() { sum_ = 0; }
+
+  int exponent() const { return exponent_; }
+
+  FixedPointSumSummary Serialize() const {
+    FixedPointSumSummary summary;
+    summary.set_high(absl::Int128High64(sum_));
+    summary.set_low(absl::Int128Low64(sum_));
+    summary.set_exponent(exponent_);
+    return summary;
+  }
+
+  // Adds a serialized sum. Fails if it was scaled differently, i.e., the
+  // values it summed were bounded by a different power of two.
+  absl::Status Merge(const FixedPointSumSummary& summary) {
+    return MergeParts(summary.high(), summary.low(), summary.exponent());
+  }
+
+  // Same as above, but reads the FixedPointSumSummary serialized, in place.
+  absl::Status MergeSerialized(absl::string_view summary) {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    uint64_t exponent = 0;
+    internal::SerializedMessageReader reader(summary);
+    while (reader.NextField()) {
+      bool ok;
+      switch (reader.field_number()) {
+        case FixedPointSumSummary::kHighFieldNumber:
+          ok = reader.ReadVarint(&high);
+          break;
+        case FixedPointSumSummary::kLowFieldNumber:
+          ok = reader.ReadVarint(&low);
+          break;
+        case FixedPointSumSummary::kExponentFieldNumber:
+          ok = reader.ReadVarint(&exponent);
+          break;
+        default:
+          ok = reader.SkipField();
+      }
+      if (!ok) {
+        return absl::InternalError(
+            "Fixed point sum summary unable to be unpacked.");
+      }
+    }
+    if (!reader.AtEnd()) {
+      return absl::InternalError(
+          "Fixed point sum summary unable to be unpacked.");
+    }
+    return MergeParts(static_cast<int64_t>(high), low,
+                      static_cast<int32_t>(exponent));
+  }
+
+ private:
+  absl::Status MergeParts(int64_t high, uint64_t low, int exponent) {
+    if (exponent != exponent_) {
+      return absl::InternalError(absl::StrCat(
+          "Merged fixed point sum must have the same exponent as this sum. "
+          "Expected ",
+          exponent_, " but got ", exponent, "."));
+    }
+    sum_ += absl::MakeInt128(high, low);
+    return absl::OkStatus();
+  }
+
+  static int ExponentForMagnitude(double max_magnitude) {
+    // Also the exponent for integers, which ForIntegers() passes as 0.
+    if (!(max_magnitude > 0) || std::isinf(max_magnitude)) {
+      return 0;
+    }
+    // max_magnitude < 2^magnitude_exponent. The exponent is capped so that
+    // the scale 2^exponent stays finite for tiny magnitudes.
+    int magnitude_exponent;
+    std::frexp(max_magnitude, &magnitude_exponent);
+    return std::min(62 - magnitude_exponent,
+                    std::numeric_limits<double>::max_exponent - 1);
+  }
+
+  int exponent_;
+  double scale_;
+  absl::int128 sum_ = 0;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_FIXED_POINT_SUM_H_
@@ -0,0 +1,174 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/fixed-point-sum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
+
+std::vector<double> MixedMagnitudes() {
+  std::vector<double> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(std::sin(i) * std::pow(10, i % 7 - 3));
+  }
+  return values;
+}
+
+TEST(FixedPointSumTest, SumsSmallIntegersExactly) {
+  FixedPointSum sum(10);
+  for (int i = -10; i <= 10; ++i) {
+    sum.Add(i);
+  }
+  sum.Add(.5);
+  EXPECT_EQ(sum.Value(), .5);
+}
+
+TEST(FixedPointSumTest, CancelsWithoutLosingSmallValues) {
+  FixedPointSum sum(1e6);
+  sum.Add(1e6);
+  sum.Add(1e-6);
+  sum.Add(-1e6);
+  EXPECT_NEAR(sum.Value(), 1e-6, 1e-12);
+}
+
+TEST(FixedPointSumTest, DoesNotDependOnOrder) {
+  std::vector<double> values = MixedMagnitudes();
+  FixedPointSum forward(1000);
+  for (double x : values) {
+    forward.Add(x);
+  }
+  std::reverse(values.begin(), values.end());
+  FixedPointSum backward(1000);
+  for (double x : values) {
+    backward.Add(x);
+  }
+  EXPECT_EQ(forward.Value(), backward.Value());
+}
+
+TEST(FixedPointSumTest, MergesInAnyOrder) {
+  std::vector<double> values = MixedMagnitudes();
+  std::vector<FixedPointSum> shards(3, FixedPointSum(1000));
+  for (int i = 0; i < values.size(); ++i) {
+    shards[i % 3].Add(values[i]);
+  }
+  FixedPointSum sequential(1000);
+  for (double x : values) {
+    sequential.Add(x);
+  }
+
+  FixedPointSum merged(1000);
+  ASSERT_OK(merged.Merge(shards[2].Serialize()));
+  merged.Add(shards[0]);
+  ASSERT_OK(merged.Merge(shards[1].Serialize()));
+  EXPECT_EQ(merged.Value(), sequential.Value());
+}
+
+TEST(FixedPointSumTest, SerializesNegativeSums) {
+  FixedPointSum sum(1);
+  sum.Add(-.75);
+  FixedPointSum copy(1);
+  ASSERT_OK(copy.Merge(sum.Serialize()));
+  EXPECT_EQ(copy.Value(), -.75);
+}
+
+TEST(FixedPointSumTest, MergesSerializedSums) {
+  FixedPointSum sum(1);
+  sum.Add(-.75);
+  FixedPointSum copy(1);
+  copy.Add(.5);
+  ASSERT_OK(copy.MergeSerialized(sum.Serialize().SerializeAsString()));
+  EXPECT_EQ(copy.Value(), -.25);
+
+  EXPECT_THAT(
+      copy.MergeSerialized(FixedPointSum(100).Serialize().SerializeAsString()),
+      StatusIs(absl::StatusCode::kInternal, HasSubstr("same exponent")));
+  EXPECT_THAT(copy.MergeSerialized("\x08"),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("unable to be unpacked")));
+  EXPECT_EQ(copy.Value(), -.25);
+}
+
+TEST(FixedPointSumTest, ExtremeMagnitudes) {
+  FixedPointSum large(std::numeric_limits<double>::max());
+  large.Add(std::numeric_limits<double>::max());
+  large.Add(-std::numeric_limits<double>::max() / 2);
+  EXPECT_EQ(large.Value(), std::numeric_limits<double>::max() / 2);
+
+  FixedPointSum small(1e-300);
+  small.Add(1e-300);
+  EXPECT_NEAR(small.Value(), 1e-300, 1e-307);
+}
+
+TEST(FixedPointSumTest, MergeRejectsDifferentExponent) {
+  FixedPointSum sum(1);
+  EXPECT_THAT(sum.Merge(FixedPointSum(100).Serialize()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same exponent")));
+}
+
+TEST(FixedPointSumTest, SumsIntegersBeyondInt64) {
+  constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+  FixedPointSum sum = FixedPointSum::ForIntegers();
+  EXPECT_EQ(sum.exponent(), 0);
+  sum.AddInteger(kMax, 4);
+  EXPECT_EQ(sum.SaturatedInteger(), kMax);
+  sum.AddInteger(-kMax, 3);
+  sum.AddInteger(-1);
+  EXPECT_EQ(sum.SaturatedInteger(), kMax - 1);
+
+  FixedPointSum negative = FixedPointSum::ForIntegers();
+  negative.AddInteger(-kMax, 2);
+  EXPECT_EQ(negative.SaturatedInteger(),
+            std::numeric_limits<int64_t>::lowest());
+  ASSERT_OK(negative.Merge(sum.Serialize()));
+  EXPECT_EQ(negative.SaturatedInteger(), -kMax - 1);
+}
+
+TEST(FixedPointSumTest, AddsClampedIntegersInChunks) {
+  constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+  const std::vector<int64_t> values = {kMax, kMax, 5, kMax, -kMax, -kMax};
+  FixedPointSum sum = FixedPointSum::ForIntegers();
+  sum.AddClampedIntegers(values.begin(), values.end(), -kMax / 2, kMax / 2);
+  // Three clamped maxima, two clamped minima and 5.
+  EXPECT_EQ(sum.SaturatedInteger(), kMax / 2 + 5);
+
+  FixedPointSum zero = FixedPointSum::ForIntegers();
+  zero.AddClampedIntegers(values.begin(), values.end(), 0, 0);
+  EXPECT_EQ(zero.SaturatedInteger(), 0);
+}
+
+TEST(FixedPointSumTest, Reset) {
+  FixedPointSum sum(1);
+  sum.Add(1);
+  sum.Reset();
+  EXPECT_EQ(sum.Value(), 0);
+}
+
+}  // namespace
+}  // namespace differential_privacy
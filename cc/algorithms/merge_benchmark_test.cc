@@ -0,0 +1,80 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares merging serialized summaries by parsing them into Summary protos and
+// calling Merge with reading them in place through MergeSerialized.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+
+namespace differential_privacy {
+namespace {
+
+// Builds a count (0), a bounded sum with manual bounds (1) or a bounded sum
+// with automatically determined bounds (2).
+std::unique_ptr<Algorithm<int64_t>> MakeAlgorithm(int64_t kind) {
+  switch (kind) {
+    case 0:
+      return Count<int64_t>::Builder().SetEpsilon(1).Build().ValueOrDie();
+    case 1:
+      return BoundedSum<int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .Build()
+          .ValueOrDie();
+    default:
+      return BoundedSum<int64_t>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  }
+}
+
+// Returns the serialized summary of an algorithm of the given kind with some
+// entries.
+std::string MakeSerializedSummary(int64_t kind) {
+  std::unique_ptr<Algorithm<int64_t>> algorithm = MakeAlgorithm(kind);
+  for (int64_t i = -100; i < 100; ++i) {
+    algorithm->AddEntry(i * 1000);
+  }
+  return algorithm->Serialize().SerializeAsString();
+}
+
+void BM_ParseAndMerge(benchmark::State& state) {
+  std::unique_ptr<Algorithm<int64_t>> algorithm = MakeAlgorithm(state.range(0));
+  const std::string serialized = MakeSerializedSummary(state.range(0));
+  for (auto _ : state) {
+    Summary summary;
+    summary.ParseFromString(serialized);
+    benchmark::DoNotOptimize(algorithm->Merge(summary));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseAndMerge)->ArgName("count_sum_auto")->DenseRange(0, 2);
+
+void BM_MergeSerialized(benchmark::State& state) {
+  std::unique_ptr<Algorithm<int64_t>> algorithm = MakeAlgorithm(state.range(0));
+  const std::string serialized = MakeSerializedSummary(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(algorithm->MergeSerialized(serialized));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MergeSerialized)->ArgName("count_sum_auto")->DenseRange(0, 2);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -24,6 +24,7 @@
 #include "base/statusor.h"
 #include "algorithms/distributions.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/rand.h"
 #include "proto/confidence-interval.pb.h"
 
 namespace differential_privacy {
@@ -66,6 +67,32 @@ class ZeroNoiseMechanism : public LaplaceMechanism {
   }
 
   int64_t MemoryUsed() override { return sizeof(ZeroNoiseMechanism); }
+
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() override {
+    std::unique_ptr<NumericalMechanism> clone =
+        absl::make_unique<ZeroNoiseMechanism>(GetEpsilon(), GetSensitivity());
+    return clone;
+  }
+};
+
+// A fast counter-based generator whose n-th output is the SplitMix64 mix of
+// seed + n * 0x9e3779b97f4a7c15. It is cheap, stateless apart from the counter
+// and fully reproducible, which makes it suitable for running statistical
+// tests quickly and repeatably. Use only for testing. Not cryptographically
+// secure, so it does not provide differential privacy.
+class SeededRandomSource : public RandomSource {
+ public:
+  explicit SeededRandomSource(uint64_t seed) : counter_(seed) {}
+
+  result_type operator()() override {
+    uint64_t z = (counter_ += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+ private:
+  uint64_t counter_;
 };
 
 class SeededGeometricDistribution : public internal::GeometricDistribution {
@@ -165,7 +192,20 @@ class SeededLaplaceMechanism : public LaplaceMechanism {
                                   std::mt19937* rand_gen)
       : LaplaceMechanism(epsilon, sensitivity,
                          absl::make_unique<SeededLaplaceDistribution>(
-                             epsilon, sensitivity, rand_gen)) {}
+                             epsilon, sensitivity, rand_gen)),
+        rand_gen_(rand_gen) {}
+
+  // The clone shares rand_gen if one was given, and is seeded on its own
+  // otherwise.
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() override {
+    std::unique_ptr<NumericalMechanism> clone =
+        absl::make_unique<SeededLaplaceMechanism>(GetEpsilon(),
+                                                  GetSensitivity(), rand_gen_);
+    return clone;
+  }
+
+ private:
+  std::mt19937* rand_gen_ = nullptr;
 };
 
 // A mock Laplace mechanism using gmock. Can be set to return any value.
@@ -200,6 +240,11 @@ class MockLaplaceMechanism : public LaplaceMechanism {
                  base::StatusOr<ConfidenceInterval>(double confidence_level,
                                                     double privacy_budget));
   MOCK_METHOD0_T(MemoryUsed, int64_t());
+
+  // Expectations set on the mock cannot be carried over to a clone.
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() override {
+    return absl::UnimplementedError("Cannot clone a mock mechanism");
+  }
 };
 
 }  // namespace test_utils
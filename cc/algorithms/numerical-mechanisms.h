@@ -61,7 +61,11 @@ static const double kGaussianSigmaAccuracy = 1e-3;
 // can add noise to data and track the remaining privacy budget.
 class NumericalMechanism {
  public:
-  NumericalMechanism(double epsilon) : epsilon_(epsilon) {}
+  // Random bits are drawn from random, or from SecureURBG if it is null.
+  // random must outlive the mechanism.
+  NumericalMechanism(double epsilon, RandomSource* random = nullptr)
+      : epsilon_(epsilon),
+        random_(random ? random : &SecureURBG::GetSingleton()) {}
 
   virtual ~NumericalMechanism() = default;
 
@@ -82,6 +86,13 @@ class NumericalMechanism {
 
   virtual int64_t MemoryUsed() = 0;
 
+  // Returns a new mechanism with the same parameters and random source, for
+  // use by a new algorithm instance. Subclasses that change how noise is drawn
+  // must override this. By default, cloning is unsupported.
+  virtual base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() {
+    return absl::UnimplementedError("Clone() unsupported for this mechanism");
+  }
+
   virtual base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
       double confidence_level, double privacy_budget, double noised_result) = 0;
 
@@ -91,6 +102,8 @@ class NumericalMechanism {
   double GetEpsilon() { return epsilon_; }
 
  protected:
+  RandomSource* GetRandomSource() { return random_; }
+
   absl::Status CheckConfidenceLevel(double confidence_level) {
     RETURN_IF_ERROR(ValidateIsInExclusiveInterval(confidence_level, 0, 1,
                                                   "Confidence level"));
@@ -119,6 +132,7 @@ class NumericalMechanism {
 
  private:
   double epsilon_;
+  RandomSource* random_;
 };
 
 // Provides a common abstraction for Builders for NumericalMechanism.
@@ -146,6 +160,15 @@ class NumericalMechanismBuilder {
     return *this;
   }
 
+  // Overrides the source of random bits, which defaults to SecureURBG. The
+  // source is not owned and must outlive all mechanisms built from this
+  // builder and its clones. Only use this for testing; a seeded source does
+  // not provide differential privacy.
+  NumericalMechanismBuilder& SetRandomSource(RandomSource* random) {
+    random_ = random;
+    return *this;
+  }
+
   virtual base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() = 0;
 
   virtual std::unique_ptr<NumericalMechanismBuilder> Clone() const = 0;
@@ -164,12 +187,14 @@ class NumericalMechanismBuilder {
   absl::optional<double> GetLInfSensitivity() const {
     return linf_sensitivity_;
   }
+  RandomSource* GetRandomSource() const { return random_; }
 
  private:
   absl::optional<double> epsilon_;
   absl::optional<double> delta_;
   absl::optional<double> l0_sensitivity_;
   absl::optional<double> linf_sensitivity_;
+  RandomSource* random_ = nullptr;
 };
 
 // Provides differential privacy by adding Laplace noise. This class also
@@ -209,7 +234,7 @@ class LaplaceMechanism : public NumericalMechanism {
       if (!gran_or_status.ok()) return gran_or_status.status();
 
       std::unique_ptr<NumericalMechanism> result =
-          absl::make_unique<LaplaceMechanism>(epsilon, L1);
+          absl::make_unique<LaplaceMechanism>(epsilon, L1, GetRandomSource());
       return result;
     }
 
@@ -258,11 +283,15 @@ class LaplaceMechanism : public NumericalMechanism {
   };
 
   explicit LaplaceMechanism(double epsilon, double sensitivity = 1.0)
-      : NumericalMechanism(epsilon),
+      : LaplaceMechanism(epsilon, sensitivity,
+                         static_cast<RandomSource*>(nullptr)) {}
+
+  LaplaceMechanism(double epsilon, double sensitivity, RandomSource* random)
+      : NumericalMechanism(epsilon, random),
         sensitivity_(sensitivity),
         diversity_(sensitivity / epsilon),
         distro_(absl::make_unique<internal::LaplaceDistribution>(
-            GetEpsilon(), sensitivity_)) {}
+            GetEpsilon(), sensitivity_, GetRandomSource())) {}
 
   LaplaceMechanism(double epsilon, double sensitivity,
                    std::unique_ptr<internal::LaplaceDistribution> distro)
@@ -288,12 +317,19 @@ class LaplaceMechanism : public NumericalMechanism {
 
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
-    return UniformDouble() >
+    return UniformDouble(*GetRandomSource()) >
            internal::LaplaceDistribution::cdf(diversity_, threshold - result);
   }
 
   virtual double GetUniformDouble() { return distro_->GetUniformDouble(); }
 
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() override {
+    std::unique_ptr<NumericalMechanism> clone =
+        absl::make_unique<LaplaceMechanism>(GetEpsilon(), sensitivity_,
+                                            GetRandomSource());
+    return clone;
+  }
+
   // Returns the confidence interval of the specified confidence level of the
   // noise that AddNoise() would add with the specified privacy budget.
   // If the returned value is <x,y>, then the noise added has a confidence_level
@@ -353,8 +389,8 @@ class GaussianMechanism : public NumericalMechanism {
       RETURN_IF_ERROR(DeltaIsSetAndValid());
       ASSIGN_OR_RETURN(double l2, CalculateL2Sensitivity());
       std::unique_ptr<NumericalMechanism> result =
-          absl::make_unique<GaussianMechanism>(epsilon.value(),
-                                               GetDelta().value(), l2);
+          absl::make_unique<GaussianMechanism>(
+              epsilon.value(), GetDelta().value(), l2, GetRandomSource());
       return result;
     }
 
@@ -404,11 +440,13 @@ class GaussianMechanism : public NumericalMechanism {
   };
 
   explicit GaussianMechanism(double epsilon, double delta,
-                             double l2_sensitivity)
-      : NumericalMechanism(epsilon),
+                             double l2_sensitivity,
+                             RandomSource* random = nullptr)
+      : NumericalMechanism(epsilon, random),
         delta_(delta),
         l2_sensitivity_(l2_sensitivity),
-        distro_(absl::make_unique<internal::GaussianDistribution>(1)) {}
+        distro_(absl::make_unique<internal::GaussianDistribution>(
+            1, GetRandomSource())) {}
 
   virtual ~GaussianMechanism() = default;
 
@@ -434,8 +472,9 @@ class GaussianMechanism : public NumericalMechanism {
 
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
-    return UniformDouble() > internal::GaussianDistribution::cdf(
-                                 distro_->Stddev(), threshold - result);
+    return UniformDouble(*GetRandomSource()) >
+           internal::GaussianDistribution::cdf(distro_->Stddev(),
+                                               threshold - result);
   }
 
   virtual int64_t MemoryUsed() {
@@ -515,6 +554,13 @@ class GaussianMechanism : public NumericalMechanism {
     return upper_bound;
   }
 
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> Clone() override {
+    std::unique_ptr<NumericalMechanism> clone =
+        absl::make_unique<GaussianMechanism>(
+            GetEpsilon(), delta_, l2_sensitivity_, GetRandomSource());
+    return clone;
+  }
+
   double GetDelta() const { return delta_; }
 
   double GetL2Sensitivity() const { return l2_sensitivity_; }
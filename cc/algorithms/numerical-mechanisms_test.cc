@@ -23,6 +23,7 @@
 #include "gtest/gtest.h"
 #include "base/statusor.h"
 #include "algorithms/distributions.h"
+#include "algorithms/numerical-mechanisms-testing.h"
 
 namespace differential_privacy {
 namespace {
@@ -719,6 +720,36 @@ TEST(NumericalMechanismsTest, GaussianBuilderClone) {
       1.2);
 }
 
+TEST(NumericalMechanismsTest, LaplaceBuilderSetsRandomSource) {
+  test_utils::SeededRandomSource random(7);
+  test_utils::SeededRandomSource same_seed(7);
+  LaplaceMechanism::Builder builder;
+  builder.SetL1Sensitivity(1.0).SetEpsilon(1.0);
+  std::unique_ptr<NumericalMechanism> mechanism =
+      builder.SetRandomSource(&random).Build().ValueOrDie();
+  std::unique_ptr<NumericalMechanism> same_seed_mechanism =
+      builder.SetRandomSource(&same_seed).Build().ValueOrDie();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(mechanism->AddNoise(0.0), same_seed_mechanism->AddNoise(0.0));
+    EXPECT_EQ(mechanism->NoisedValueAboveThreshold(0.0, 0.0),
+              same_seed_mechanism->NoisedValueAboveThreshold(0.0, 0.0));
+  }
+}
+
+TEST(NumericalMechanismsTest, GaussianBuilderSetsRandomSource) {
+  test_utils::SeededRandomSource random(7);
+  test_utils::SeededRandomSource same_seed(7);
+  GaussianMechanism::Builder builder;
+  builder.SetL2Sensitivity(1.0).SetEpsilon(1.0).SetDelta(1e-5);
+  std::unique_ptr<NumericalMechanism> mechanism =
+      builder.SetRandomSource(&random).Clone()->Build().ValueOrDie();
+  std::unique_ptr<NumericalMechanism> same_seed_mechanism =
+      builder.SetRandomSource(&same_seed).Clone()->Build().ValueOrDie();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(mechanism->AddNoise(0.0), same_seed_mechanism->AddNoise(0.0));
+  }
+}
+
 TEST(NumericalMechanismsTest, Stddev) {
   GaussianMechanism mechanism(log(3), 0.00001, 1.0);
 
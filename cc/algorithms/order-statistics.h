@@ -17,6 +17,11 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_ORDER_STATISTICS_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_ORDER_STATISTICS_H_
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "base/percentile.h"
 #include "absl/status/status.h"
 #include "base/statusor.h"
@@ -24,6 +29,7 @@
 #include "algorithms/binary-search.h"
 #include "algorithms/bounded-algorithm.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/rand.h"
 #include "base/canonical_errors.h"
 
 namespace differential_privacy {
@@ -96,6 +102,17 @@ class Max : public BinarySearch<T> {
     }
   };
 
+ protected:
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<LaplaceMechanism> mechanism;
+    std::unique_ptr<base::Percentile<T>> quantiles;
+    RETURN_IF_ERROR(
+        BinarySearch<T>::CloneDependencies(&mechanism, &quantiles));
+    return std::unique_ptr<Algorithm<T>>(
+        new Max(Algorithm<T>::GetEpsilon(), this->GetLower(), this->GetUpper(),
+                std::move(mechanism), std::move(quantiles)));
+  }
+
  private:
   Max(double epsilon, T lower, T upper,
       std::unique_ptr<LaplaceMechanism> mechanism,
@@ -124,6 +141,17 @@ class Min : public BinarySearch<T> {
     }
   };
 
+ protected:
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<LaplaceMechanism> mechanism;
+    std::unique_ptr<base::Percentile<T>> quantiles;
+    RETURN_IF_ERROR(
+        BinarySearch<T>::CloneDependencies(&mechanism, &quantiles));
+    return std::unique_ptr<Algorithm<T>>(
+        new Min(Algorithm<T>::GetEpsilon(), this->GetLower(), this->GetUpper(),
+                std::move(mechanism), std::move(quantiles)));
+  }
+
  private:
   Min(double epsilon, T lower, T upper,
       std::unique_ptr<LaplaceMechanism> mechanism,
@@ -153,6 +181,18 @@ class Median : public BinarySearch<T> {
     }
   };
 
+ protected:
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<LaplaceMechanism> mechanism;
+    std::unique_ptr<base::Percentile<T>> quantiles;
+    RETURN_IF_ERROR(
+        BinarySearch<T>::CloneDependencies(&mechanism, &quantiles));
+    return std::unique_ptr<Algorithm<T>>(
+        new Median(Algorithm<T>::GetEpsilon(), this->GetLower(),
+                   this->GetUpper(), std::move(mechanism),
+                   std::move(quantiles)));
+  }
+
  private:
   Median(double epsilon, T lower, T upper,
          std::unique_ptr<LaplaceMechanism> mechanism,
@@ -195,6 +235,17 @@ class Percentile : public BinarySearch<T> {
 
   double GetPercentile() const { return percentile_; }
 
+ protected:
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    std::unique_ptr<LaplaceMechanism> mechanism;
+    std::unique_ptr<base::Percentile<T>> quantiles;
+    RETURN_IF_ERROR(
+        BinarySearch<T>::CloneDependencies(&mechanism, &quantiles));
+    return std::unique_ptr<Algorithm<T>>(new Percentile(
+        percentile_, Algorithm<T>::GetEpsilon(), this->GetLower(),
+        this->GetUpper(), std::move(mechanism), std::move(quantiles)));
+  }
+
  private:
   Percentile(double percentile, double epsilon, T lower, T upper,
              std::unique_ptr<LaplaceMechanism> mechanism,
@@ -206,6 +257,267 @@ class Percentile : public BinarySearch<T> {
   const double percentile_;
 };
 
+// Finds several quantiles of an input set at once, e.g. {.1, .5, .9, .99}.
+// Unlike one Percentile per quantile, the inputs are stored once and the
+// quantiles are found jointly, with the recursive exponential mechanism of
+// "Differentially Private Approximate Quantiles" (Kaplan, Schnapp, Stemmer):
+// the middle quantile is found first, and splits the inputs and the search
+// range for the quantiles below and above it. Each input takes part in one
+// search per level of this recursion, so the privacy budget is split between
+// the O(log(number of quantiles)) levels rather than between the quantiles.
+//
+// The output contains one element per requested quantile, in the order in
+// which they were requested. Bounds default to the numeric limits of T, as for
+// the other order statistics. The noise does not come from a
+// NumericalMechanism, so SetLaplaceMechanism has no effect.
+template <typename T>
+class Quantiles : public Algorithm<T> {
+ public:
+  class Builder : public BoundedAlgorithmBuilder<T, Quantiles<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, Quantiles<T>, Builder>;
+    using BoundedBuilder = BoundedAlgorithmBuilder<T, Quantiles<T>, Builder>;
+
+   public:
+    Builder() : BoundedBuilder() {
+      // Default search bounds are numeric limits.
+      BoundedBuilder::SetLower(std::numeric_limits<T>::lowest());
+      BoundedBuilder::SetUpper(std::numeric_limits<T>::max());
+    }
+
+    // The quantiles to find, each in [0, 1]. Required.
+    Builder& SetQuantiles(const std::vector<double>& quantiles) {
+      quantiles_ = quantiles;
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<Quantiles<T>>> BuildBoundedAlgorithm()
+        override {
+      if (quantiles_.empty()) {
+        return absl::InvalidArgumentError(
+            "At least one quantile must be requested.");
+      }
+      for (double quantile : quantiles_) {
+        RETURN_IF_ERROR(
+            ValidateIsInInclusiveInterval(quantile, 0, 1, "Quantile"));
+      }
+      return absl::WrapUnique(new Quantiles(
+          AlgorithmBuilder::GetEpsilon().value(),
+          BoundedBuilder::GetLower().value(),
+          BoundedBuilder::GetUpper().value(),
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1) *
+              AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1),
+          quantiles_));
+    }
+
+    std::vector<double> quantiles_;
+  };
+
+  void AddEntry(const T& t) override { inputs_.Add(t); }
+
+  // The state is the same as that of BinarySearch, so is its summary.
+  Summary Serialize() override {
+    BinarySearchSummary bs_summary;
+    inputs_.SerializeToProto(bs_summary.mutable_input());
+    Summary summary;
+    summary.mutable_data()->PackFrom(bs_summary);
+    return summary;
+  }
+
+  absl::Status Merge(const Summary& summary) override {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no quantiles data.");
+    }
+    BinarySearchSummary bs_summary;
+    if (!summary.data().UnpackTo(&bs_summary)) {
+      return absl::InternalError("Quantiles summary unable to be unpacked.");
+    }
+    inputs_.MergeFromProto(bs_summary.input());
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    return sizeof(Quantiles<T>) - sizeof(inputs_) + inputs_.Memory() +
+           sizeof(double) * quantiles_.capacity();
+  }
+
+  const std::vector<double>& GetQuantiles() const { return quantiles_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    // Search the distinct quantiles in ascending order.
+    std::vector<double> sorted_quantiles = quantiles_;
+    std::sort(sorted_quantiles.begin(), sorted_quantiles.end());
+    sorted_quantiles.erase(
+        std::unique(sorted_quantiles.begin(), sorted_quantiles.end()),
+        sorted_quantiles.end());
+    int levels = 0;
+    while ((size_t{1} << levels) - 1 < sorted_quantiles.size()) {
+      ++levels;
+    }
+
+    const std::vector<T>& inputs = inputs_.GetSortedInputs();
+    std::vector<double> results(sorted_quantiles.size());
+    const double level_epsilon =
+        Algorithm<T>::GetEpsilon() * privacy_budget / levels;
+    JointSearch(inputs, 0, inputs.size(), lower_, upper_, sorted_quantiles, 0,
+                sorted_quantiles.size(), 0, 1,
+                [&](size_t begin, size_t end, double lower, double upper,
+                    double rank) {
+                  return SampleQuantile(inputs, begin, end, lower, upper, rank,
+                                        level_epsilon);
+                },
+                &results);
+
+    Output output;
+    for (double quantile : quantiles_) {
+      double result =
+          results[std::lower_bound(sorted_quantiles.begin(),
+                                   sorted_quantiles.end(), quantile) -
+                  sorted_quantiles.begin()];
+      // Round the result instead of truncation.
+      if (std::is_integral<T>::value) {
+        result = Clamp<double>(std::numeric_limits<T>::lowest(),
+                               std::numeric_limits<T>::max(),
+                               std::round(result));
+      }
+      AddToOutput<T>(&output, result);
+    }
+    return output;
+  }
+
+  void ResetState() override { inputs_.Reset(); }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    return std::unique_ptr<Algorithm<T>>(
+        new Quantiles(Algorithm<T>::GetEpsilon(), lower_, upper_,
+                      sensitivity_, quantiles_));
+  }
+
+ private:
+  Quantiles(double epsilon, T lower, T upper, double sensitivity,
+            const std::vector<double>& quantiles)
+      : Algorithm<T>(epsilon),
+        lower_(lower),
+        upper_(upper),
+        sensitivity_(sensitivity),
+        quantiles_(quantiles) {}
+
+  // Finds the quantiles [q_begin, q_end) of sorted_quantiles among the inputs
+  // [begin, end), which all lie in [lower, upper] and between the results for
+  // the quantiles q_lo and q_hi of the enclosing search (0 and 1 at the top).
+  // sample(begin, end, lower, upper, rank) finds a single quantile.
+  //
+  // The target rank is rescaled to the range, i.e., the range is treated as a
+  // dataset of its own whose quantiles are rescaled from [q_lo, q_hi] to
+  // [0, 1] (Kaplan, Schnapp and Stemmer, 2022). It then does not depend on the
+  // inputs outside the range, so the searches of a level run on disjoint data
+  // and share their epsilon by parallel composition.
+  template <typename Sampler>
+  static void JointSearch(const std::vector<T>& inputs, size_t begin,
+                          size_t end, double lower, double upper,
+                          const std::vector<double>& sorted_quantiles,
+                          size_t q_begin, size_t q_end, double q_lo,
+                          double q_hi, const Sampler& sample,
+                          std::vector<double>* results) {
+    if (q_begin >= q_end) {
+      return;
+    }
+    const size_t q_mid = q_begin + (q_end - q_begin) / 2;
+    const double quantile = sorted_quantiles[q_mid];
+    const double rank = (quantile - q_lo) / (q_hi - q_lo) *
+                        static_cast<double>(end - begin);
+    const double result = sample(begin, end, lower, upper, rank);
+    (*results)[q_mid] = result;
+
+    const size_t split =
+        std::lower_bound(inputs.begin() + begin, inputs.begin() + end, result,
+                         [](const T& input, double value) {
+                           return static_cast<double>(input) < value;
+                         }) -
+        inputs.begin();
+    JointSearch(inputs, begin, split, lower, result, sorted_quantiles, q_begin,
+                q_mid, q_lo, quantile, sample, results);
+    JointSearch(inputs, split, end, result, upper, sorted_quantiles, q_mid + 1,
+                q_end, quantile, q_hi, sample, results);
+  }
+
+  // Exponential mechanism over the gaps between consecutive inputs of the
+  // range [begin, end), clamped to [lower, upper]. Gap i, between the i-th and
+  // (i+1)-th input, has utility -|i - rank| and is picked with probability
+  // proportional to its width times exp(epsilon * utility / 2). The result is
+  // uniform within the picked gap.
+  double SampleQuantile(const std::vector<T>& inputs, size_t begin, size_t end,
+                        double lower, double upper, double rank,
+                        double epsilon) {
+    auto gap_start = [&](size_t i) {
+      return i == 0 ? lower
+                    : Clamp<double>(lower, upper, inputs[begin + i - 1]);
+    };
+    auto gap_end = [&](size_t i) {
+      return begin + i == end ? upper
+                              : Clamp<double>(lower, upper, inputs[begin + i]);
+    };
+
+    const size_t num_gaps = end - begin + 1;
+    const double scale = epsilon / (2 * sensitivity_);
+    // Holds the log of the weight of each gap until they are normalized below.
+    std::vector<double> weights(num_gaps);
+    double max_log_weight = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < num_gaps; ++i) {
+      // Halve the width so that it does not overflow for numeric limit bounds.
+      const double half_width = gap_end(i) / 2 - gap_start(i) / 2;
+      weights[i] =
+          half_width > 0 ? std::log(half_width) -
+                               scale * std::abs(static_cast<double>(i) - rank)
+                         : -std::numeric_limits<double>::infinity();
+      max_log_weight = std::max(max_log_weight, weights[i]);
+    }
+    if (max_log_weight == -std::numeric_limits<double>::infinity()) {
+      // All gaps are empty, so lower == upper.
+      return lower;
+    }
+
+    double total_weight = 0;
+    for (double& weight : weights) {
+      weight = std::exp(weight - max_log_weight);
+      total_weight += weight;
+    }
+    double threshold = UniformDouble() * total_weight;
+    size_t picked = 0;
+    for (; picked + 1 < num_gaps; ++picked) {
+      if (weights[picked] > 0 && threshold < weights[picked]) {
+        break;
+      }
+      threshold -= weights[picked];
+    }
+    // Rounding may leave the threshold past the last gap with any weight.
+    while (weights[picked] == 0) {
+      --picked;
+    }
+
+    const double t = UniformDouble();
+    return (1 - t) * gap_start(picked) + t * gap_end(picked);
+  }
+
+  // Friend class for testing only.
+  friend class QuantilesTestPeer;
+
+  const T lower_;
+  const T upper_;
+  // The largest change to the rank of a value that one user can cause.
+  const double sensitivity_;
+  const std::vector<double> quantiles_;
+
+  base::Percentile<T> inputs_;
+};
+
 }  // namespace continuous
 }  // namespace differential_privacy
 
@@ -16,6 +16,9 @@
 
 #include "algorithms/order-statistics.h"
 
+#include <numeric>
+#include <vector>
+
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -25,9 +28,27 @@
 
 namespace differential_privacy {
 namespace continuous {
+
+class QuantilesTestPeer {
+ public:
+  // Runs the joint search of Quantiles<T> over sorted inputs, finding each
+  // quantile with sample instead of the exponential mechanism.
+  template <typename T, typename Sampler>
+  static std::vector<double> JointSearch(
+      const std::vector<T>& inputs, double lower, double upper,
+      const std::vector<double>& sorted_quantiles, const Sampler& sample) {
+    std::vector<double> results(sorted_quantiles.size());
+    Quantiles<T>::JointSearch(inputs, 0, inputs.size(), lower, upper,
+                              sorted_quantiles, 0, sorted_quantiles.size(), 0,
+                              1, sample, &results);
+    return results;
+  }
+};
+
 namespace {
 
 using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::differential_privacy::base::testing::StatusIs;
 
@@ -139,6 +160,28 @@ TEST(OrderStatisticsTest, Percentile) {
   EXPECT_EQ(GetValue<int64_t>(*result), 90);
 }
 
+TEST(OrderStatisticsTest, ClonePercentile) {
+  base::StatusOr<std::unique_ptr<Percentile<int64_t>>> search =
+      Percentile<int64_t>::Builder()
+          .SetPercentile(.45)
+          .SetEpsilon(std::log(3))
+          .SetLower(0)
+          .SetUpper(2048)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(search);
+  (*search)->AddEntry(1000);
+  base::StatusOr<std::unique_ptr<Algorithm<int64_t>>> clone =
+      (*search)->Clone();
+  ASSERT_OK(clone);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*clone)->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  base::StatusOr<Output> result = (*clone)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 90);
+}
+
 TEST(OrderStatisticsTest, PercentileGetter) {
   double epsilon = std::log(3), expectedPercentile = 0.9;
   int64_t lower = 0, upper = 2048;
@@ -188,6 +231,179 @@ TEST(OrderStatisticsTest, Median_DefaultBounds) {
   EXPECT_EQ(GetValue<int64_t>(*result), 100);
 }
 
+TEST(OrderStatisticsTest, Quantiles) {
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles =
+      Quantiles<int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(kDataSize)
+          .SetQuantiles({.9, .1, .5, .99})
+          .Build();
+  ASSERT_OK(quantiles);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*quantiles)->AddEntry(i);
+  }
+  base::StatusOr<Output> result = (*quantiles)->PartialResult();
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 4);
+  // The results follow the order of the request.
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(0).value()), 9000, 100);
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(1).value()), 1000, 100);
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(2).value()), 5000, 100);
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(3).value()), 9900, 100);
+}
+
+TEST(OrderStatisticsTest, QuantilesAreOrdered) {
+  std::vector<double> requested = {.01, .05, .1, .25, .5, .75, .9, .95, .99};
+  base::StatusOr<std::unique_ptr<Quantiles<double>>> quantiles =
+      Quantiles<double>::Builder()
+          .SetEpsilon(.1)
+          .SetLower(-1)
+          .SetUpper(1)
+          .SetQuantiles(requested)
+          .Build();
+  ASSERT_OK(quantiles);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*quantiles)->AddEntry(std::sin(i));
+  }
+  base::StatusOr<Output> result = (*quantiles)->PartialResult();
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), requested.size());
+  // Each quantile is searched between the ones around it, so the results are
+  // monotonic.
+  for (int i = 1; i < requested.size(); ++i) {
+    EXPECT_LE(GetValue<double>(result->elements(i - 1).value()),
+              GetValue<double>(result->elements(i).value()));
+  }
+}
+
+TEST(OrderStatisticsTest, QuantilesRescaleRanksOfSubSearches) {
+  std::vector<int64_t> inputs(100);
+  std::iota(inputs.begin(), inputs.end(), 0);
+  struct Search {
+    size_t begin;
+    size_t end;
+    double rank;
+  };
+  std::vector<Search> searches;
+  // The median is found far too low, at 20, and the other quantiles at their
+  // target rank within the range searched for them.
+  auto sample = [&](size_t begin, size_t end, double lower, double upper,
+                    double rank) -> double {
+    searches.push_back({begin, end, rank});
+    return searches.size() == 1 ? 20 : begin + rank;
+  };
+  std::vector<double> results = QuantilesTestPeer::JointSearch<int64_t>(
+      inputs, 0, 100, {.25, .5, .75}, sample);
+
+  ASSERT_EQ(searches.size(), 3);
+  EXPECT_EQ(searches[0].begin, 0);
+  EXPECT_EQ(searches[0].end, 100);
+  EXPECT_EQ(searches[0].rank, 50);
+  // The first quarter of all inputs is the first half of those below the
+  // median, and the last quarter the second half of those above it.
+  EXPECT_EQ(searches[1].begin, 0);
+  EXPECT_EQ(searches[1].end, 20);
+  EXPECT_EQ(searches[1].rank, 10);
+  EXPECT_EQ(searches[2].begin, 20);
+  EXPECT_EQ(searches[2].end, 100);
+  EXPECT_EQ(searches[2].rank, 40);
+  EXPECT_THAT(results, ElementsAre(10, 20, 60));
+}
+
+TEST(OrderStatisticsTest, QuantilesDefaultBounds) {
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles =
+      Quantiles<int64_t>::Builder().SetEpsilon(1).SetQuantiles({.5}).Build();
+  ASSERT_OK(quantiles);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*quantiles)->AddEntry(i);
+  }
+  base::StatusOr<Output> result = (*quantiles)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<int64_t>(*result), 5000, 200);
+}
+
+TEST(OrderStatisticsTest, QuantilesEqualBounds) {
+  base::StatusOr<std::unique_ptr<Quantiles<double>>> quantiles =
+      Quantiles<double>::Builder()
+          .SetLower(3)
+          .SetUpper(3)
+          .SetQuantiles({.2, .8})
+          .Build();
+  ASSERT_OK(quantiles);
+  (*quantiles)->AddEntry(1);
+  base::StatusOr<Output> result = (*quantiles)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<double>(result->elements(0).value()), 3);
+  EXPECT_EQ(GetValue<double>(result->elements(1).value()), 3);
+}
+
+TEST(OrderStatisticsTest, QuantilesSerializeMerge) {
+  Quantiles<int64_t>::Builder builder;
+  builder.SetEpsilon(1).SetLower(0).SetUpper(kDataSize).SetQuantiles({.5});
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles1 =
+      builder.Build();
+  ASSERT_OK(quantiles1);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*quantiles1)->AddEntry(i);
+  }
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles2 =
+      builder.Build();
+  ASSERT_OK(quantiles2);
+  EXPECT_OK((*quantiles2)->Merge((*quantiles1)->Serialize()));
+
+  base::StatusOr<Output> result = (*quantiles2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<int64_t>(*result), 5000, 100);
+}
+
+TEST(OrderStatisticsTest, CloneQuantiles) {
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles =
+      Quantiles<int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(kDataSize)
+          .SetQuantiles({.25, .75})
+          .Build();
+  ASSERT_OK(quantiles);
+  (*quantiles)->AddEntry(1);
+  base::StatusOr<std::unique_ptr<Algorithm<int64_t>>> clone =
+      (*quantiles)->Clone();
+  ASSERT_OK(clone);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*clone)->AddEntry(i);
+  }
+  base::StatusOr<Output> result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 2);
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(0).value()), 2500, 100);
+  EXPECT_NEAR(GetValue<int64_t>(result->elements(1).value()), 7500, 100);
+}
+
+TEST(OrderStatisticsTest, QuantilesInvalidParameters) {
+  EXPECT_THAT(Quantiles<double>::Builder().Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one quantile")));
+  EXPECT_THAT(Quantiles<double>::Builder().SetQuantiles({.5, 1.5}).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Quantile")));
+}
+
+// Quantiles stores the inputs once however many quantiles are requested.
+TEST(OrderStatisticsTest, QuantilesMemoryDoesNotGrowWithQuantiles) {
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> quantiles =
+      Quantiles<int64_t>::Builder().SetQuantiles({.1, .5, .9, .99}).Build();
+  ASSERT_OK(quantiles);
+  base::StatusOr<std::unique_ptr<Percentile<int64_t>>> percentile =
+      Percentile<int64_t>::Builder().SetPercentile(.5).Build();
+  ASSERT_OK(percentile);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*quantiles)->AddEntry(i);
+    (*percentile)->AddEntry(i);
+  }
+  EXPECT_LT((*quantiles)->MemoryUsed(), 2 * (*percentile)->MemoryUsed());
+}
+
 }  // namespace
 }  // namespace continuous
 }  // namespace differential_privacy
@@ -0,0 +1,172 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/privacy-accountant.h"
+
+#include <cmath>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "base/statusor.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr uint64_t kFieldMask = 0xffffffffull;
+
+// Costs within this many units above a unit boundary are charged as lying on
+// it, so that budgets given as decimal fractions of the total (e.g. 0.2) are
+// charged exactly despite their binary representation.
+constexpr double kRoundingSlack = 1e-3;
+
+uint64_t Low(uint64_t packed) { return packed & kFieldMask; }
+uint64_t High(uint64_t packed) { return packed >> 32; }
+
+}  // namespace
+
+PrivacyAccountant::Reservation& PrivacyAccountant::Reservation::operator=(
+    Reservation&& other) {
+  if (this != &other) {
+    if (accountant_ != nullptr) {
+      accountant_->Release(cost_);
+    }
+    accountant_ = other.accountant_;
+    cost_ = other.cost_;
+    other.accountant_ = nullptr;
+  }
+  return *this;
+}
+
+PrivacyAccountant::Reservation::~Reservation() {
+  if (accountant_ != nullptr) {
+    accountant_->Release(cost_);
+  }
+}
+
+base::StatusOr<std::unique_ptr<PrivacyAccountant>>
+PrivacyAccountant::Builder::Build() {
+  RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon_, "Epsilon"));
+  if (composition_ == Composition::kAdvanced) {
+    RETURN_IF_ERROR(ValidateIsInExclusiveInterval(
+        delta_, 0, 1, "Delta for advanced composition"));
+  } else {
+    RETURN_IF_ERROR(ValidateIsInInclusiveInterval(delta_, 0, 1, "Delta"));
+  }
+  return absl::WrapUnique(
+      new PrivacyAccountant(epsilon_.value(), delta_, composition_));
+}
+
+PrivacyAccountant::PrivacyAccountant(double epsilon, double delta,
+                                     Composition composition)
+    : epsilon_(epsilon), delta_(delta), composition_(composition) {}
+
+absl::Status PrivacyAccountant::Consume(double epsilon, double delta) {
+  ASSIGN_OR_RETURN(uint64_t cost, Cost(epsilon, delta));
+  return Acquire(cost);
+}
+
+base::StatusOr<PrivacyAccountant::Reservation> PrivacyAccountant::Reserve(
+    double epsilon, double delta) {
+  ASSIGN_OR_RETURN(uint64_t cost, Cost(epsilon, delta));
+  RETURN_IF_ERROR(Acquire(cost));
+  return Reservation(this, cost);
+}
+
+double PrivacyAccountant::RemainingEpsilon() const {
+  const uint64_t spent = spent_.load(std::memory_order_acquire);
+  if (composition_ == Composition::kBasic) {
+    return epsilon_ * (kScale - std::min<double>(kScale, Low(spent))) / kScale;
+  }
+  // The cost of a release grows with its epsilon, so search for the largest
+  // epsilon that still fits.
+  double lower = 0;
+  double upper = epsilon_;
+  for (int i = 0; i < 64; ++i) {
+    const double mid = (lower + upper) / 2;
+    base::StatusOr<uint64_t> cost = Cost(mid, 0);
+    if (cost.ok() && Fits(spent + cost.ValueOrDie())) {
+      lower = mid;
+    } else {
+      upper = mid;
+    }
+  }
+  return lower;
+}
+
+base::StatusOr<uint64_t> PrivacyAccountant::Cost(double epsilon,
+                                                 double delta) const {
+  RETURN_IF_ERROR(ValidateIsFiniteAndNonNegative(epsilon, "Epsilon"));
+  RETURN_IF_ERROR(ValidateIsInInclusiveInterval(delta, 0, 1, "Delta"));
+  double low;
+  double high;
+  if (composition_ == Composition::kBasic) {
+    if (delta > 0 && delta_ == 0) {
+      return absl::InvalidArgumentError("Not enough privacy budget.");
+    }
+    low = epsilon / epsilon_;
+    high = delta > 0 ? delta / delta_ : 0;
+  } else {
+    if (delta > 0) {
+      return absl::InvalidArgumentError(
+          "Advanced composition only supports pure epsilon-DP releases.");
+    }
+    low = epsilon * std::expm1(epsilon) / epsilon_;
+    high = 2 * std::log(1 / delta_) * (epsilon / epsilon_) *
+           (epsilon / epsilon_);
+  }
+  // A single release costing more than the total can never be afforded. This
+  // also keeps each field of a cost below 2^31.
+  if (!(low <= 1 + kRoundingSlack / kScale) ||
+      !(high <= 1 + kRoundingSlack / kScale)) {
+    return absl::InvalidArgumentError("Not enough privacy budget.");
+  }
+  const uint64_t low_units =
+      static_cast<uint64_t>(std::max(0.0, std::ceil(low * kScale -
+                                                    kRoundingSlack)));
+  const uint64_t high_units =
+      static_cast<uint64_t>(std::max(0.0, std::ceil(high * kScale -
+                                                    kRoundingSlack)));
+  return (high_units << 32) | low_units;
+}
+
+bool PrivacyAccountant::Fits(uint64_t spent) const {
+  const double low = Low(spent);
+  const double high = High(spent);
+  if (composition_ == Composition::kBasic) {
+    return low <= kScale && high <= kScale;
+  }
+  return low + std::sqrt(high * kScale) <= kScale;
+}
+
+absl::Status PrivacyAccountant::Acquire(uint64_t cost) {
+  uint64_t spent = spent_.load(std::memory_order_relaxed);
+  do {
+    if (!Fits(spent + cost)) {
+      return absl::InvalidArgumentError("Not enough privacy budget.");
+    }
+  } while (!spent_.compare_exchange_weak(spent, spent + cost,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_relaxed));
+  return absl::OkStatus();
+}
+
+void PrivacyAccountant::Release(uint64_t cost) {
+  spent_.fetch_sub(cost, std::memory_order_acq_rel);
+}
+
+}  // namespace differential_privacy
@@ -0,0 +1,163 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_ACCOUNTANT_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_ACCOUNTANT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "base/statusor.h"
+
+namespace differential_privacy {
+
+// A ledger of the (epsilon, delta) budget spent on one dataset, shared by any
+// number of algorithms and threads. Consuming budget never blocks: the spent
+// budget is held in a single atomic word that is updated with a
+// compare-and-swap loop.
+//
+// e.g. auto accountant = PrivacyAccountant::Builder().SetEpsilon(1).Build();
+//      if (accountant.ValueOrDie()->Consume(0.1).ok()) { ...release result... }
+//
+// The spent budget is stored as two fixed-point fractions of the total, each
+// with a resolution of 1e-9. Costs are rounded up to that resolution, so the
+// ledger never undercounts by more than rounding error of the inputs.
+class PrivacyAccountant {
+ public:
+  // How the costs of individual releases add up.
+  enum class Composition {
+    // Epsilons and deltas are summed. Supports (epsilon, delta)-DP releases.
+    kBasic,
+    // Advanced composition for heterogeneous epsilons (Dwork, Rothblum and
+    // Vadhan, "Boosting and Differential Privacy", 2010): k epsilon_i-DP
+    // releases together are (eps, delta)-DP for
+    //   eps = sqrt(2 ln(1/delta) sum epsilon_i^2) +
+    //         sum epsilon_i (exp(epsilon_i) - 1),
+    // where delta is the accountant's delta. Only pure epsilon-DP releases can
+    // be charged. This allows many more small releases than kBasic, but fewer
+    // large ones.
+    kAdvanced,
+  };
+
+  // Holds budget taken from the accountant until it is committed. Budget that
+  // is never committed is returned to the accountant on destruction. The
+  // accountant must outlive its reservations.
+  class Reservation {
+   public:
+    Reservation(Reservation&& other)
+        : accountant_(other.accountant_), cost_(other.cost_) {
+      other.accountant_ = nullptr;
+    }
+    Reservation& operator=(Reservation&& other);
+    ~Reservation();
+
+    // Makes the reserved budget permanently spent.
+    void Commit() { accountant_ = nullptr; }
+
+   private:
+    friend class PrivacyAccountant;
+
+    Reservation(PrivacyAccountant* accountant, uint64_t cost)
+        : accountant_(accountant), cost_(cost) {}
+
+    PrivacyAccountant* accountant_;
+    uint64_t cost_;
+  };
+
+  class Builder {
+   public:
+    // Total epsilon that may be spent. Required.
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    // Total delta that may be spent. For kAdvanced composition this is the
+    // delta of the composition theorem and must be positive. Defaults to 0.
+    Builder& SetDelta(double delta) {
+      delta_ = delta;
+      return *this;
+    }
+
+    Builder& SetComposition(Composition composition) {
+      composition_ = composition;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<PrivacyAccountant>> Build();
+
+   private:
+    absl::optional<double> epsilon_;
+    double delta_ = 0;
+    Composition composition_ = Composition::kBasic;
+  };
+
+  PrivacyAccountant(const PrivacyAccountant&) = delete;
+  PrivacyAccountant& operator=(const PrivacyAccountant&) = delete;
+
+  // Spends epsilon and delta. Returns an InvalidArgument error and spends
+  // nothing if the remaining budget does not cover them.
+  absl::Status Consume(double epsilon, double delta = 0);
+
+  // Same as Consume, but the budget can still be handed back by dropping the
+  // reservation without committing it. Use this to hold budget for work that
+  // may fail before anything data-dependent has been released.
+  base::StatusOr<Reservation> Reserve(double epsilon, double delta = 0);
+
+  // Returns the largest epsilon a single pure epsilon-DP release could still
+  // consume. For kBasic composition this is the total epsilon minus the sum of
+  // epsilons spent so far.
+  double RemainingEpsilon() const;
+
+  double GetEpsilon() const { return epsilon_; }
+  double GetDelta() const { return delta_; }
+  Composition GetComposition() const { return composition_; }
+
+ private:
+  // One unit of a fixed-point field is this fraction of the total.
+  static constexpr double kScale = 1e9;
+
+  PrivacyAccountant(double epsilon, double delta, Composition composition);
+
+  // Returns the packed fixed-point cost of a release, or an error if it can
+  // never be afforded.
+  base::StatusOr<uint64_t> Cost(double epsilon, double delta) const;
+
+  // Whether the packed spent budget lies within the total.
+  bool Fits(uint64_t spent) const;
+
+  absl::Status Acquire(uint64_t cost);
+  void Release(uint64_t cost);
+
+  const double epsilon_;
+  const double delta_;
+  const Composition composition_;
+
+  // Low 32 bits: spent epsilon (kBasic) or sum epsilon_i (exp(epsilon_i) - 1)
+  // (kAdvanced). High 32 bits: spent delta (kBasic) or
+  // 2 ln(1/delta) sum epsilon_i^2 / epsilon^2 (kAdvanced), where epsilon and
+  // delta are the totals. Both are in units of 1 / kScale and never exceed
+  // kScale once committed, so a field plus any affordable cost stays below
+  // 2^32 and adding packed costs never carries between fields.
+  std::atomic<uint64_t> spent_{0};
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_ACCOUNTANT_H_
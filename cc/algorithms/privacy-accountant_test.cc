@@ -0,0 +1,200 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/privacy-accountant.h"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::HasSubstr;
+using ::differential_privacy::base::testing::StatusIs;
+
+constexpr double kTolerance = 1e-9;
+
+std::unique_ptr<PrivacyAccountant> BasicAccountant(double epsilon,
+                                                   double delta = 0) {
+  return PrivacyAccountant::Builder()
+      .SetEpsilon(epsilon)
+      .SetDelta(delta)
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(PrivacyAccountantTest, InvalidParametersFailBuild) {
+  EXPECT_THAT(PrivacyAccountant::Builder().Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon must be set")));
+  EXPECT_THAT(PrivacyAccountant::Builder().SetEpsilon(-1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon must be finite and positive")));
+  EXPECT_THAT(PrivacyAccountant::Builder().SetEpsilon(1).SetDelta(2).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Delta must be in the inclusive interval")));
+  EXPECT_THAT(PrivacyAccountant::Builder()
+                  .SetEpsilon(1)
+                  .SetComposition(PrivacyAccountant::Composition::kAdvanced)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Delta for advanced composition")));
+}
+
+TEST(PrivacyAccountantTest, BasicCompositionSumsEpsilons) {
+  auto accountant = BasicAccountant(1);
+  EXPECT_EQ(accountant->RemainingEpsilon(), 1);
+  EXPECT_OK(accountant->Consume(.2));
+  EXPECT_EQ(accountant->RemainingEpsilon(), .8);
+  EXPECT_OK(accountant->Consume(.8));
+  EXPECT_EQ(accountant->RemainingEpsilon(), 0);
+  EXPECT_THAT(accountant->Consume(1e-6),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Not enough privacy budget")));
+}
+
+TEST(PrivacyAccountantTest, FailedConsumeSpendsNothing) {
+  auto accountant = BasicAccountant(2);
+  EXPECT_OK(accountant->Consume(1.5));
+  EXPECT_FALSE(accountant->Consume(1).ok());
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.5, kTolerance));
+  EXPECT_OK(accountant->Consume(.5));
+}
+
+TEST(PrivacyAccountantTest, InvalidCostIsRejected) {
+  auto accountant = BasicAccountant(1);
+  EXPECT_FALSE(accountant->Consume(-1).ok());
+  EXPECT_FALSE(accountant->Consume(std::nan("")).ok());
+  EXPECT_FALSE(accountant->Consume(.1, 2).ok());
+  EXPECT_EQ(accountant->RemainingEpsilon(), 1);
+}
+
+TEST(PrivacyAccountantTest, BasicCompositionSumsDeltas) {
+  auto pure = BasicAccountant(1);
+  EXPECT_FALSE(pure->Consume(.1, 1e-10).ok());
+
+  auto approximate = BasicAccountant(1, 1e-6);
+  EXPECT_OK(approximate->Consume(.1, 6e-7));
+  EXPECT_FALSE(approximate->Consume(.1, 6e-7).ok());
+  EXPECT_OK(approximate->Consume(.1, 4e-7));
+  EXPECT_THAT(approximate->RemainingEpsilon(), DoubleNear(.8, kTolerance));
+}
+
+TEST(PrivacyAccountantTest, ReservationIsReturnedUnlessCommitted) {
+  auto accountant = BasicAccountant(1);
+  {
+    base::StatusOr<PrivacyAccountant::Reservation> reservation =
+        accountant->Reserve(.6);
+    ASSERT_OK(reservation);
+    EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.4, kTolerance));
+    EXPECT_FALSE(accountant->Reserve(.6).ok());
+  }
+  EXPECT_EQ(accountant->RemainingEpsilon(), 1);
+  {
+    base::StatusOr<PrivacyAccountant::Reservation> reservation =
+        accountant->Reserve(.6);
+    ASSERT_OK(reservation);
+    reservation.ValueOrDie().Commit();
+  }
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.4, kTolerance));
+}
+
+TEST(PrivacyAccountantTest, AdvancedCompositionAllowsMoreSmallReleases) {
+  constexpr double kEpsilon = 1;
+  constexpr double kDelta = 1e-6;
+  constexpr double kReleaseEpsilon = .01;
+  auto advanced = PrivacyAccountant::Builder()
+                      .SetEpsilon(kEpsilon)
+                      .SetDelta(kDelta)
+                      .SetComposition(PrivacyAccountant::Composition::kAdvanced)
+                      .Build()
+                      .ValueOrDie();
+  int releases = 0;
+  while (advanced->Consume(kReleaseEpsilon).ok()) {
+    ++releases;
+  }
+  // The largest k with
+  // sqrt(2 ln(1/delta) k) e + k e (exp(e) - 1) <= epsilon.
+  int expected = 0;
+  while (std::sqrt(2 * std::log(1 / kDelta) * (expected + 1)) *
+                 kReleaseEpsilon +
+             (expected + 1) * kReleaseEpsilon * std::expm1(kReleaseEpsilon) <=
+         kEpsilon) {
+    ++expected;
+  }
+  EXPECT_EQ(releases, expected);
+  EXPECT_GT(releases, kEpsilon / kReleaseEpsilon);
+}
+
+TEST(PrivacyAccountantTest, AdvancedCompositionRejectsApproximateReleases) {
+  auto advanced = PrivacyAccountant::Builder()
+                      .SetEpsilon(1)
+                      .SetDelta(1e-6)
+                      .SetComposition(PrivacyAccountant::Composition::kAdvanced)
+                      .Build()
+                      .ValueOrDie();
+  EXPECT_THAT(advanced->Consume(.1, 1e-9),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("pure epsilon-DP")));
+}
+
+TEST(PrivacyAccountantTest, AdvancedCompositionRemainingEpsilon) {
+  auto advanced = PrivacyAccountant::Builder()
+                      .SetEpsilon(1)
+                      .SetDelta(1e-6)
+                      .SetComposition(PrivacyAccountant::Composition::kAdvanced)
+                      .Build()
+                      .ValueOrDie();
+  const double remaining = advanced->RemainingEpsilon();
+  EXPECT_GT(remaining, 0);
+  EXPECT_LT(remaining, 1);
+  EXPECT_OK(advanced->Consume(remaining * (1 - 1e-6)));
+  EXPECT_LT(advanced->RemainingEpsilon(), 1e-3);
+}
+
+TEST(PrivacyAccountantTest, ConcurrentConsumeNeverOverspends) {
+  constexpr int kNumThreads = 8;
+  constexpr int kAttemptsPerThread = 1000;
+  // Room for exactly 2500 releases of 0.0004.
+  auto accountant = BasicAccountant(1);
+  std::atomic<int> successes(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kAttemptsPerThread; ++j) {
+        if (accountant->Consume(.0004).ok()) {
+          ++successes;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(successes, 2500);
+  EXPECT_EQ(accountant->RemainingEpsilon(), 0);
+}
+
+}  // namespace
+}  // namespace differential_privacy
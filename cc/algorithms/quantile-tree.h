@@ -0,0 +1,351 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/bounded-algorithm.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// The default shape of the tree: 16^4 = 65536 leaves.
+constexpr int kDefaultTreeHeight = 4;
+constexpr int kDefaultBranchingFactor = 16;
+
+// Trees with more leaves than this are rejected by the builder.
+constexpr int64_t kMaxQuantileTreeLeaves = int64_t{1} << 24;
+
+// Finds quantiles of the input with a hierarchical histogram over
+// [lower, upper], an alternative to the order statistics that does not store
+// the inputs. The range is split into branching_factor^tree_height equal
+// leaves, and every node of the tree counts the inputs in its subrange.
+// Adding an input increments one counter per level, so memory and summaries
+// have a fixed size that does not depend on the number of inputs.
+//
+// A result walks down the tree once per requested quantile, choosing at every
+// level the child that contains the quantile according to the noisy counts of
+// the children, and interpolates within the final leaf. The nodes are noised
+// when first read and reused for the other quantiles, so each node is noised
+// at most once per result and all quantiles come from the same noisy tree.
+// Bounds must be set manually. The output contains one element per requested
+// quantile, in the order in which they were requested.
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class QuantileTree : public Algorithm<T> {
+ public:
+  class Builder : public BoundedAlgorithmBuilder<T, QuantileTree<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, QuantileTree<T>, Builder>;
+    using BoundedBuilder =
+        BoundedAlgorithmBuilder<T, QuantileTree<T>, Builder>;
+
+   public:
+    // The quantiles to find, each in [0, 1]. Required.
+    Builder& SetQuantiles(const std::vector<double>& quantiles) {
+      quantiles_ = quantiles;
+      return *this;
+    }
+
+    // The number of levels below the root. Higher trees are more precise but
+    // split the privacy budget between more levels.
+    Builder& SetTreeHeight(int tree_height) {
+      tree_height_ = tree_height;
+      return *this;
+    }
+
+    // The number of children of every inner node.
+    Builder& SetBranchingFactor(int branching_factor) {
+      branching_factor_ = branching_factor;
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<QuantileTree<T>>> BuildBoundedAlgorithm()
+        override {
+      if (!BoundedBuilder::BoundsAreSet()) {
+        return absl::InvalidArgumentError(
+            "Quantile tree requires manually set bounds.");
+      }
+      if (quantiles_.empty()) {
+        return absl::InvalidArgumentError(
+            "At least one quantile must be requested.");
+      }
+      for (double quantile : quantiles_) {
+        RETURN_IF_ERROR(
+            ValidateIsInInclusiveInterval(quantile, 0, 1, "Quantile"));
+      }
+      RETURN_IF_ERROR(ValidateIsPositive(tree_height_, "Tree height"));
+      RETURN_IF_ERROR(ValidateIsGreaterThanOrEqualTo(
+          branching_factor_, 2, "Branching factor"));
+      if (std::pow(static_cast<double>(branching_factor_), tree_height_) >
+          kMaxQuantileTreeLeaves) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Quantile tree cannot have more than ", kMaxQuantileTreeLeaves,
+            " leaves. Decrease the tree height or the branching factor."));
+      }
+
+      // An input changes one node per level, so each node gets an equal share
+      // of epsilon and delta.
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder =
+          AlgorithmBuilder::GetMechanismBuilderClone();
+      mechanism_builder->SetEpsilon(AlgorithmBuilder::GetEpsilon().value() /
+                                    tree_height_);
+      if (AlgorithmBuilder::GetDelta().has_value()) {
+        mechanism_builder->SetDelta(AlgorithmBuilder::GetDelta().value() /
+                                    tree_height_);
+      }
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> mechanism,
+          mechanism_builder
+              ->SetL0Sensitivity(
+                  AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1))
+              .SetLInfSensitivity(
+                  AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
+                      1))
+              .Build());
+
+      return absl::WrapUnique(new QuantileTree<T>(
+          AlgorithmBuilder::GetEpsilon().value(),
+          BoundedBuilder::GetLower().value(),
+          BoundedBuilder::GetUpper().value(), tree_height_, branching_factor_,
+          quantiles_, std::move(mechanism)));
+    }
+
+    std::vector<double> quantiles_;
+    int tree_height_ = kDefaultTreeHeight;
+    int branching_factor_ = kDefaultBranchingFactor;
+  };
+
+  void AddEntry(const T& t) override {
+    // Drop value if it is NaN.
+    if (std::isnan(static_cast<double>(t))) {
+      return;
+    }
+    int64_t node = LeafIndex(t);
+    for (int level = tree_height_; level > 0; --level) {
+      ++tree_[level_offsets_[level - 1] + node];
+      node /= branching_factor_;
+    }
+  }
+
+  Summary Serialize() override {
+    QuantileTreeSummary qt_summary;
+    qt_summary.mutable_tree()->Add(tree_.begin(), tree_.end());
+    qt_summary.set_tree_height(tree_height_);
+    qt_summary.set_branching_factor(branching_factor_);
+    Summary summary;
+    summary.mutable_data()->PackFrom(qt_summary);
+    return summary;
+  }
+
+  absl::Status Merge(const Summary& summary) override {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no quantile tree data.");
+    }
+    QuantileTreeSummary qt_summary;
+    if (!summary.data().UnpackTo(&qt_summary)) {
+      return absl::InternalError(
+          "Quantile tree summary unable to be unpacked.");
+    }
+    if (qt_summary.tree_height() != tree_height_ ||
+        qt_summary.branching_factor() != branching_factor_ ||
+        qt_summary.tree_size() != tree_.size()) {
+      return absl::InternalError(
+          "Merged QuantileTree must have the same tree height and branching "
+          "factor as this QuantileTree.");
+    }
+    for (int i = 0; i < tree_.size(); ++i) {
+      tree_[i] += qt_summary.tree(i);
+    }
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    return sizeof(QuantileTree<T>) + sizeof(int64_t) * tree_.capacity() +
+           sizeof(int64_t) * level_offsets_.capacity() +
+           sizeof(double) * quantiles_.capacity() + mechanism_->MemoryUsed();
+  }
+
+  const std::vector<double>& GetQuantiles() const { return quantiles_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    // Nodes noised so far, by index into tree_.
+    absl::flat_hash_map<int64_t, double> noisy_nodes;
+    auto noisy_count = [&](int level, int64_t node) {
+      const int64_t index = level_offsets_[level - 1] + node;
+      auto it = noisy_nodes.find(index);
+      if (it == noisy_nodes.end()) {
+        // Negative counts are post-processed to zero.
+        it = noisy_nodes
+                 .emplace(index, std::max(0.0, mechanism_->AddNoise(
+                                                   tree_[index],
+                                                   privacy_budget)))
+                 .first;
+      }
+      return it->second;
+    };
+
+    Output output;
+    for (double quantile : quantiles_) {
+      double result = Quantile(quantile, noisy_count);
+      // Round the result instead of truncation.
+      if (std::is_integral<T>::value) {
+        result = std::round(result);
+      }
+      AddToOutput<T>(&output, result);
+    }
+    return output;
+  }
+
+  void ResetState() override { std::fill(tree_.begin(), tree_.end(), 0); }
+
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> CloneAlgorithm() override {
+    ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> mechanism,
+                     mechanism_->Clone());
+    return std::unique_ptr<Algorithm<T>>(new QuantileTree<T>(
+        Algorithm<T>::GetEpsilon(), lower_, upper_, tree_height_,
+        branching_factor_, quantiles_, std::move(mechanism)));
+  }
+
+ private:
+  QuantileTree(double epsilon, T lower, T upper, int tree_height,
+               int branching_factor, const std::vector<double>& quantiles,
+               std::unique_ptr<NumericalMechanism> mechanism)
+      : Algorithm<T>(epsilon),
+        lower_(lower),
+        upper_(upper),
+        tree_height_(tree_height),
+        branching_factor_(branching_factor),
+        quantiles_(quantiles),
+        mechanism_(std::move(mechanism)) {
+    // Level l, for l in [1, tree_height], has branching_factor^l nodes and
+    // starts right after level l - 1.
+    int64_t level_size = 1;
+    int64_t offset = 0;
+    for (int level = 1; level <= tree_height_; ++level) {
+      level_offsets_.push_back(offset);
+      level_size *= branching_factor_;
+      offset += level_size;
+    }
+    num_leaves_ = level_size;
+    tree_.resize(offset, 0);
+  }
+
+  // Returns the index within the last level of the leaf containing t, after
+  // clamping.
+  int64_t LeafIndex(T t) const {
+    const double range = static_cast<double>(upper_) - lower_;
+    if (range <= 0) {
+      return 0;
+    }
+    const double position =
+        (static_cast<double>(Clamp<T>(lower_, upper_, t)) - lower_) / range;
+    return std::min(num_leaves_ - 1,
+                    static_cast<int64_t>(position * num_leaves_));
+  }
+
+  // Walks down the noisy tree to the leaf containing the quantile, keeping
+  // track of the quantile within the current node, and interpolates within
+  // that leaf. noisy_count(level, node) returns the noisy count of a node.
+  template <typename NoisyCount>
+  double Quantile(double quantile, NoisyCount& noisy_count) const {
+    int64_t node = 0;
+    for (int level = 1; level <= tree_height_; ++level) {
+      const int64_t first_child = node * branching_factor_;
+      double total = 0;
+      for (int i = 0; i < branching_factor_; ++i) {
+        total += noisy_count(level, first_child + i);
+      }
+      if (total == 0) {
+        // Nothing is known below this node, so spread the quantile over it
+        // uniformly.
+        const int64_t leaves_below = LeavesPerNode(level - 1);
+        return LeafStart((node + quantile) * leaves_below);
+      }
+
+      // Find the child in which the quantile lies.
+      double rank = quantile * total;
+      int child = 0;
+      for (; child < branching_factor_ - 1; ++child) {
+        const double count = noisy_count(level, first_child + child);
+        if (rank <= count && count > 0) {
+          break;
+        }
+        rank -= count;
+      }
+      const double count = noisy_count(level, first_child + child);
+      quantile = count > 0 ? Clamp(0.0, 1.0, rank / count) : 0.5;
+      node = first_child + child;
+    }
+    return LeafStart(node + quantile);
+  }
+
+  // Returns the number of leaves below a node of the given level; the root is
+  // at level 0.
+  int64_t LeavesPerNode(int level) const {
+    int64_t leaves = 1;
+    for (int l = level; l < tree_height_; ++l) {
+      leaves *= branching_factor_;
+    }
+    return leaves;
+  }
+
+  // Returns the value at a fractional leaf index in [0, num_leaves].
+  double LeafStart(double leaf) const {
+    const double range = static_cast<double>(upper_) - lower_;
+    return Clamp<double>(lower_, upper_, lower_ + leaf / num_leaves_ * range);
+  }
+
+  const T lower_;
+  const T upper_;
+  const int tree_height_;
+  const int branching_factor_;
+  const std::vector<double> quantiles_;
+  std::unique_ptr<NumericalMechanism> mechanism_;
+
+  // Node counts, level by level, without the root. See QuantileTreeSummary.
+  std::vector<int64_t> tree_;
+  std::vector<int64_t> level_offsets_;
+  int64_t num_leaves_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
@@ -0,0 +1,232 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/quantile-tree.h"
+
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+constexpr int64_t kDataSize = 10000;
+
+template <typename T>
+class QuantileTreeTest : public testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(QuantileTreeTest, NumericTypes);
+
+TYPED_TEST(QuantileTreeTest, FindsQuantilesWithoutNoise) {
+  base::StatusOr<std::unique_ptr<QuantileTree<TypeParam>>> tree =
+      typename QuantileTree<TypeParam>::Builder()
+          .SetQuantiles({.9, .1, .5})
+          .SetLower(0)
+          .SetUpper(kDataSize)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(tree);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*tree)->AddEntry(i);
+  }
+  base::StatusOr<Output> result = (*tree)->PartialResult();
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 3);
+  // The results follow the order of the request and are as precise as the
+  // leaves, which are kDataSize / 16^4 wide.
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(0).value()), 9000, 1);
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(1).value()), 1000, 1);
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(2).value()), 5000, 1);
+}
+
+TYPED_TEST(QuantileTreeTest, FindsQuantilesWithNoise) {
+  base::StatusOr<std::unique_ptr<QuantileTree<TypeParam>>> tree =
+      typename QuantileTree<TypeParam>::Builder()
+          .SetQuantiles({.25, .5, .75})
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(kDataSize)
+          .Build();
+  ASSERT_OK(tree);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*tree)->AddEntry(i);
+  }
+  base::StatusOr<Output> result = (*tree)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(0).value()), 2500, 500);
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(1).value()), 5000, 500);
+  EXPECT_NEAR(GetValue<TypeParam>(result->elements(2).value()), 7500, 500);
+}
+
+TEST(QuantileTreeTest, ClampsInputsAndResults) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({0, 1})
+          .SetTreeHeight(2)
+          .SetBranchingFactor(10)
+          .SetLower(-1)
+          .SetUpper(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(tree);
+  (*tree)->AddEntry(-5);
+  (*tree)->AddEntry(5);
+  base::StatusOr<Output> result = (*tree)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<double>(result->elements(0).value()), -1, .02);
+  EXPECT_NEAR(GetValue<double>(result->elements(1).value()), 1, .02);
+}
+
+TEST(QuantileTreeTest, EmptyTreeSpreadsQuantilesUniformly) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({.25, .5})
+          .SetLower(0)
+          .SetUpper(8)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(tree);
+  base::StatusOr<Output> result = (*tree)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(0).value()), 2);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result->elements(1).value()), 4);
+}
+
+TYPED_TEST(QuantileTreeTest, SerializeMergeTest) {
+  typename QuantileTree<TypeParam>::Builder builder;
+  builder.SetQuantiles({.5})
+      .SetLower(0)
+      .SetUpper(kDataSize)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<QuantileTree<TypeParam>>> tree1 =
+      builder.Build();
+  ASSERT_OK(tree1);
+  base::StatusOr<std::unique_ptr<QuantileTree<TypeParam>>> tree2 =
+      builder.Build();
+  ASSERT_OK(tree2);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*(i % 2 == 0 ? tree1 : tree2))->AddEntry(i);
+  }
+  Summary summary = (*tree1)->Serialize();
+  EXPECT_OK((*tree2)->Merge(summary));
+
+  base::StatusOr<Output> result = (*tree2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<TypeParam>(*result), 5000, 1);
+}
+
+TEST(QuantileTreeTest, SummarySizeDoesNotDependOnInputs) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({.5})
+          .SetLower(0)
+          .SetUpper(1)
+          .Build();
+  ASSERT_OK(tree);
+  const size_t empty_summary_size = (*tree)->Serialize().ByteSizeLong();
+  const int64_t empty_memory = (*tree)->MemoryUsed();
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*tree)->AddEntry(.5);
+  }
+  EXPECT_EQ((*tree)->MemoryUsed(), empty_memory);
+  // Only the varint encoding of the counts grows.
+  EXPECT_LE((*tree)->Serialize().ByteSizeLong(), empty_summary_size + 4 * 2);
+}
+
+TEST(QuantileTreeTest, MergeRejectsDifferentShape) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree1 =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({.5})
+          .SetTreeHeight(3)
+          .SetLower(0)
+          .SetUpper(1)
+          .Build();
+  ASSERT_OK(tree1);
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree2 =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({.5})
+          .SetLower(0)
+          .SetUpper(1)
+          .Build();
+  ASSERT_OK(tree2);
+  EXPECT_THAT((*tree2)->Merge((*tree1)->Serialize()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same tree height and branching factor")));
+}
+
+TEST(QuantileTreeTest, CloneIsEmpty) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree =
+      QuantileTree<double>::Builder()
+          .SetQuantiles({.5})
+          .SetLower(0)
+          .SetUpper(8)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(tree);
+  (*tree)->AddEntry(1);
+  base::StatusOr<std::unique_ptr<Algorithm<double>>> clone = (*tree)->Clone();
+  ASSERT_OK(clone);
+  (*clone)->AddEntry(7);
+  base::StatusOr<Output> result = (*clone)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<double>(*result), 7, .01);
+}
+
+TEST(QuantileTreeTest, InvalidParameters) {
+  EXPECT_THAT(QuantileTree<double>::Builder().SetQuantiles({.5}).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires manually set bounds")));
+  EXPECT_THAT(
+      QuantileTree<double>::Builder().SetLower(0).SetUpper(1).Build(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("At least one quantile")));
+  EXPECT_THAT(QuantileTree<double>::Builder()
+                  .SetQuantiles({-.5})
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Quantile")));
+  EXPECT_THAT(QuantileTree<double>::Builder()
+                  .SetQuantiles({.5})
+                  .SetBranchingFactor(1)
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Branching factor")));
+  EXPECT_THAT(QuantileTree<double>::Builder()
+                  .SetQuantiles({.5})
+                  .SetTreeHeight(10)
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("leaves")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
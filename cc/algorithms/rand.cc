@@ -49,8 +49,10 @@ const constexpr int kMantDigits = DBL_MANT_DIG - 1;
 const constexpr uint64_t kMantissaMask = (uint64_t{1} << kMantDigits) - 1ULL;
 }  // namespace
 
-double UniformDouble() {
-  uint64_t uint_64_number = SecureURBG::GetSingleton()();
+double UniformDouble() { return UniformDouble(SecureURBG::GetSingleton()); }
+
+double UniformDouble(RandomSource& random) {
+  uint64_t uint_64_number = random();
   // A random integer of Uniform[0, 2^kMantDigits).
   uint64_t i = uint_64_number & kMantissaMask;
 
@@ -63,7 +65,7 @@ double UniformDouble() {
 
   // Extra geometric sampling is needed only when the leading 11 bits are all 0.
   if (j == 0) {
-    exponent += Geometric() - 1;
+    exponent += Geometric(random) - 1;
   }
 
   j = (uint64_t{1023} - exponent) << kMantDigits;
@@ -79,11 +81,13 @@ double UniformDouble() {
   return r == 0 ? 1.0 : r;
 }
 
-uint64_t Geometric() {
+uint64_t Geometric() { return Geometric(SecureURBG::GetSingleton()); }
+
+uint64_t Geometric(RandomSource& random) {
   uint64_t result = 1;
   uint64_t r = 0;
   while (r == 0 && result < 1023) {
-    r = SecureURBG::GetSingleton()();
+    r = random();
     result += CountLeadingZeros64Slow(r);
   }
   return result;
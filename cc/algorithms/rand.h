@@ -22,34 +22,53 @@
 #include <memory>
 
 #include <cstdint>
+#include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 
 namespace differential_privacy {
 
+// A uniform random bit generator producing 64-bit values, from which all noise
+// is sampled. Distributions and mechanisms default to SecureURBG; other
+// implementations can be injected through their builders, e.g. to make tests
+// reproducible.
+class RandomSource {
+ public:
+  using result_type = uint64_t;
+  static constexpr result_type(min)() {
+    return (std::numeric_limits<result_type>::min)();
+  }
+  static constexpr result_type(max)() {
+    return (std::numeric_limits<result_type>::max)();
+  }
+
+  virtual ~RandomSource() = default;
+
+  virtual result_type operator()() = 0;
+};
+
 // Generates a double-valued random number of Uniform[0, 1). This has the same
 // distribution as generating a uniform real r in (0, 1) and then returning the
 // largest double value less than or equal to r.
 double UniformDouble();
 
+// Same as above, but draws the random bits from random.
+double UniformDouble(RandomSource& random);
+
 // geometric returns a number randomly picked from a geometric distribution of
 // parameter 0.5. Will not exceed 1025.
 uint64_t Geometric();
 
+// Same as above, but draws the random bits from random.
+uint64_t Geometric(RandomSource& random);
+
 // Exposed for testing
-class SecureURBG {
+class SecureURBG : public RandomSource {
  public:
   static SecureURBG& GetSingleton() {
     static auto* kInstance = new SecureURBG;
     return *kInstance;
   }
-  using result_type = uint64_t;
-  static constexpr result_type(min)() {
-    return (std::numeric_limits<result_type>::min)();
-  }
-  static constexpr result_type(max)() {
-    return (std::numeric_limits<result_type>::max)();
-  }
-  result_type operator()() ABSL_LOCKS_EXCLUDED(mutex_);
+  result_type operator()() ABSL_LOCKS_EXCLUDED(mutex_) override;
 
  private:
   SecureURBG() { buffer_ = new uint8_t[kBufferSize]; }
@@ -0,0 +1,73 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares the results per second of PartialResult, which builds an Output
+// proto, with PartialResultValue, which returns just the value.
+
+#include "benchmark/benchmark.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+
+namespace differential_privacy {
+namespace {
+
+// Builds a count (0), bounded sum (1) or bounded mean (2) with manual bounds.
+std::unique_ptr<Algorithm<double>> MakeAlgorithm(int64_t kind) {
+  switch (kind) {
+    case 0:
+      return Count<double>::Builder().SetEpsilon(1).Build().ValueOrDie();
+    case 1:
+      return BoundedSum<double>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .Build()
+          .ValueOrDie();
+    default:
+      return BoundedMean<double>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .Build()
+          .ValueOrDie();
+  }
+}
+
+void BM_PartialResult(benchmark::State& state) {
+  std::unique_ptr<Algorithm<double>> algorithm = MakeAlgorithm(state.range(0));
+  for (auto _ : state) {
+    algorithm->Reset();
+    algorithm->AddEntry(5);
+    benchmark::DoNotOptimize(algorithm->PartialResult());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PartialResult)->ArgName("count_sum_mean")->DenseRange(0, 2);
+
+void BM_PartialResultValue(benchmark::State& state) {
+  std::unique_ptr<Algorithm<double>> algorithm = MakeAlgorithm(state.range(0));
+  for (auto _ : state) {
+    algorithm->Reset();
+    algorithm->AddEntry(5);
+    benchmark::DoNotOptimize(algorithm->PartialResultValue<double>());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PartialResultValue)->ArgName("count_sum_mean")->DenseRange(0, 2);
+
+}  // namespace
+}  // namespace differential_privacy
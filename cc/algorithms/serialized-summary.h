@@ -0,0 +1,259 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SERIALIZED_SUMMARY_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SERIALIZED_SUMMARY_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/statusor.h"
+#include "proto/data.pb.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace internal {
+
+// Reads the fields of a serialized proto message one at a time, so that
+// algorithms can merge serialized summaries without parsing them into protos.
+// Length-delimited fields are returned as views into the message.
+//
+// Usage:
+//   SerializedMessageReader reader(message);
+//   while (reader.NextField()) {
+//     // Read or skip the field, and stop if that fails.
+//   }
+//   if (!reader.AtEnd()) { /* The message is malformed. */ }
+class SerializedMessageReader {
+ public:
+  explicit SerializedMessageReader(absl::string_view message)
+      : message_(message),
+        input_(reinterpret_cast<const uint8_t*>(message.data()),
+               static_cast<int>(message.size())) {}
+
+  SerializedMessageReader(const SerializedMessageReader&) = delete;
+  SerializedMessageReader& operator=(const SerializedMessageReader&) = delete;
+
+  // Moves to the next field. Returns false at the end of the message or if the
+  // next tag is malformed, which AtEnd() tells apart.
+  bool NextField() {
+    tag_ = input_.ReadTag();
+    return tag_ != 0;
+  }
+
+  // Returns whether the whole message has been read.
+  bool AtEnd() const {
+    return static_cast<size_t>(input_.CurrentPosition()) == message_.size();
+  }
+
+  int field_number() const { return WireFormatLite::GetTagFieldNumber(tag_); }
+
+  // The Read methods read the value of the current field. They return false if
+  // the field does not have the wire type of the requested value or if the
+  // value is malformed.
+  bool ReadVarint(uint64_t* value) {
+    return wire_type() == WireFormatLite::WIRETYPE_VARINT &&
+           input_.ReadVarint64(value);
+  }
+
+  bool ReadDouble(double* value) {
+    uint64_t bits;
+    if (wire_type() != WireFormatLite::WIRETYPE_FIXED64 ||
+        !input_.ReadLittleEndian64(&bits)) {
+      return false;
+    }
+    *value = WireFormatLite::DecodeDouble(bits);
+    return true;
+  }
+
+  bool ReadLengthDelimited(absl::string_view* value) {
+    uint32_t length;
+    if (wire_type() != WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+        !input_.ReadVarint32(&length)) {
+      return false;
+    }
+    const int position = input_.CurrentPosition();
+    if (!input_.Skip(length)) {
+      return false;
+    }
+    *value = message_.substr(position, length);
+    return true;
+  }
+
+  // Reads the current field of a repeated integer field, which holds a single
+  // value if it is unpacked or any number of values if it is packed, and calls
+  // f with each value.
+  template <typename F>
+  bool ReadRepeatedInt64(F f) {
+    uint64_t value;
+    if (wire_type() == WireFormatLite::WIRETYPE_VARINT) {
+      if (!input_.ReadVarint64(&value)) {
+        return false;
+      }
+      f(static_cast<int64_t>(value));
+      return true;
+    }
+    absl::string_view packed;
+    if (!ReadLengthDelimited(&packed)) {
+      return false;
+    }
+    google::protobuf::io::CodedInputStream packed_input(
+        reinterpret_cast<const uint8_t*>(packed.data()),
+        static_cast<int>(packed.size()));
+    while (static_cast<size_t>(packed_input.CurrentPosition()) <
+           packed.size()) {
+      if (!packed_input.ReadVarint64(&value)) {
+        return false;
+      }
+      f(static_cast<int64_t>(value));
+    }
+    return true;
+  }
+
+  bool SkipField() { return WireFormatLite::SkipField(&input_, tag_); }
+
+ private:
+  using WireFormatLite = google::protobuf::internal::WireFormatLite;
+
+  WireFormatLite::WireType wire_type() const {
+    return WireFormatLite::GetTagWireType(tag_);
+  }
+
+  absl::string_view message_;
+  google::protobuf::io::CodedInputStream input_;
+  uint32_t tag_ = 0;
+};
+
+// Reads a serialized numeric ValueType the way GetValue<T> reads a ValueType.
+// Returns false if it is malformed.
+template <typename T>
+bool ReadSerializedValue(absl::string_view value_type, T* value) {
+  static_assert(std::is_arithmetic<T>::value, "Value must be numeric.");
+  // The members of the oneof replace each other, and unset ones read as 0.
+  int64_t int_value = 0;
+  double float_value = 0;
+  SerializedMessageReader reader(value_type);
+  while (reader.NextField()) {
+    bool ok;
+    switch (reader.field_number()) {
+      case ValueType::kIntValueFieldNumber: {
+        uint64_t bits = 0;
+        ok = reader.ReadVarint(&bits);
+        int_value = static_cast<int64_t>(bits);
+        float_value = 0;
+        break;
+      }
+      case ValueType::kFloatValueFieldNumber:
+        ok = reader.ReadDouble(&float_value);
+        int_value = 0;
+        break;
+      case ValueType::kStringValueFieldNumber:
+        ok = reader.SkipField();
+        int_value = 0;
+        float_value = 0;
+        break;
+      default:
+        ok = reader.SkipField();
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  if (!reader.AtEnd()) {
+    return false;
+  }
+  *value = std::is_integral<T>::value ? static_cast<T>(int_value)
+                                      : static_cast<T>(float_value);
+  return true;
+}
+
+// Returns the algorithm summary that a serialized Summary packs into its data
+// field, still serialized, as a view into summary. Fails if summary is
+// malformed, has no data or packs a type other than SummaryType. Summaries
+// written by Serialize() hold their data once; a summary with more than one
+// data field, which a proto parser would merge, is rejected.
+template <typename SummaryType>
+base::StatusOr<absl::string_view> UnpackSerializedSummary(
+    absl::string_view summary) {
+  const absl::Status malformed =
+      absl::InternalError("Serialized summary is malformed.");
+  bool has_data = false;
+  absl::string_view data;
+  SerializedMessageReader summary_reader(summary);
+  while (summary_reader.NextField()) {
+    if (summary_reader.field_number() != Summary::kDataFieldNumber) {
+      if (!summary_reader.SkipField()) {
+        return malformed;
+      }
+      continue;
+    }
+    if (has_data || !summary_reader.ReadLengthDelimited(&data)) {
+      return malformed;
+    }
+    has_data = true;
+  }
+  if (!summary_reader.AtEnd()) {
+    return malformed;
+  }
+  if (!has_data) {
+    return absl::InternalError("Cannot merge serialized summary with no data.");
+  }
+
+  // The data is a google.protobuf.Any, i.e., a type URL and the serialized
+  // summary of that type.
+  absl::string_view type_url;
+  absl::string_view value;
+  SerializedMessageReader any_reader(data);
+  while (any_reader.NextField()) {
+    bool ok;
+    switch (any_reader.field_number()) {
+      case google::protobuf::Any::kTypeUrlFieldNumber:
+        ok = any_reader.ReadLengthDelimited(&type_url);
+        break;
+      case google::protobuf::Any::kValueFieldNumber:
+        ok = any_reader.ReadLengthDelimited(&value);
+        break;
+      default:
+        ok = any_reader.SkipField();
+    }
+    if (!ok) {
+      return malformed;
+    }
+  }
+  if (!any_reader.AtEnd()) {
+    return malformed;
+  }
+  const std::string type_name = SummaryType::default_instance().GetTypeName();
+  if (type_url.size() <= type_name.size() ||
+      type_url[type_url.size() - type_name.size() - 1] != '/' ||
+      type_url.substr(type_url.size() - type_name.size()) != type_name) {
+    return absl::InternalError(
+        absl::StrCat("Serialized summary does not hold a ", type_name, "."));
+  }
+  return value;
+}
+
+}  // namespace internal
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SERIALIZED_SUMMARY_H_
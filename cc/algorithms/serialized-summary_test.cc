@@ -0,0 +1,166 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/serialized-summary.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "proto/data.pb.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace internal {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Reads all values of the repeated int64 field with the given number.
+std::vector<int64_t> ReadRepeatedField(const std::string& message,
+                                       int field_number) {
+  std::vector<int64_t> values;
+  SerializedMessageReader reader(message);
+  while (reader.NextField()) {
+    const bool ok =
+        reader.field_number() == field_number
+            ? reader.ReadRepeatedInt64(
+                  [&](int64_t value) { values.push_back(value); })
+            : reader.SkipField();
+    EXPECT_TRUE(ok);
+  }
+  EXPECT_TRUE(reader.AtEnd());
+  return values;
+}
+
+TEST(SerializedMessageReaderTest, ReadsUnpackedRepeatedField) {
+  ApproxBoundsSummary summary;
+  summary.add_pos_bin_count(3);
+  summary.add_neg_bin_count(5);
+  summary.add_pos_bin_count(-1);
+  const std::string serialized = summary.SerializeAsString();
+  EXPECT_THAT(ReadRepeatedField(serialized,
+                                ApproxBoundsSummary::kPosBinCountFieldNumber),
+              ElementsAre(3, -1));
+  EXPECT_THAT(ReadRepeatedField(serialized,
+                                ApproxBoundsSummary::kNegBinCountFieldNumber),
+              ElementsAre(5));
+}
+
+TEST(SerializedMessageReaderTest, ReadsPackedRepeatedField) {
+  QuantileTreeSummary summary;
+  summary.add_tree(1);
+  summary.add_tree(std::numeric_limits<int64_t>::max());
+  summary.add_tree(-7);
+  summary.set_tree_height(4);
+  EXPECT_THAT(ReadRepeatedField(summary.SerializeAsString(),
+                                QuantileTreeSummary::kTreeFieldNumber),
+              ElementsAre(1, std::numeric_limits<int64_t>::max(), -7));
+}
+
+TEST(SerializedMessageReaderTest, RejectsWrongWireType) {
+  CountSummary summary;
+  summary.set_epsilon(1);
+  const std::string serialized = summary.SerializeAsString();
+  SerializedMessageReader reader(serialized);
+  ASSERT_TRUE(reader.NextField());
+  EXPECT_EQ(reader.field_number(), CountSummary::kEpsilonFieldNumber);
+  uint64_t value;
+  EXPECT_FALSE(reader.ReadVarint(&value));
+}
+
+TEST(SerializedMessageReaderTest, DetectsTruncatedMessage) {
+  BoundedSumSummary summary;
+  summary.add_pos_sum()->set_float_value(1.5);
+  std::string serialized = summary.SerializeAsString();
+  serialized.pop_back();
+  SerializedMessageReader reader(serialized);
+  ASSERT_TRUE(reader.NextField());
+  absl::string_view pos_sum;
+  EXPECT_FALSE(reader.ReadLengthDelimited(&pos_sum));
+}
+
+TEST(ReadSerializedValueTest, ReadsLikeGetValue) {
+  ValueType value_type;
+  int64_t int_value = 1;
+  double float_value = 1;
+  EXPECT_TRUE(
+      ReadSerializedValue(value_type.SerializeAsString(), &int_value));
+  EXPECT_EQ(int_value, 0);
+
+  value_type.set_int_value(-42);
+  EXPECT_TRUE(
+      ReadSerializedValue(value_type.SerializeAsString(), &int_value));
+  EXPECT_EQ(int_value, -42);
+  EXPECT_TRUE(
+      ReadSerializedValue(value_type.SerializeAsString(), &float_value));
+  EXPECT_EQ(float_value, 0);
+
+  value_type.set_float_value(2.5);
+  EXPECT_TRUE(
+      ReadSerializedValue(value_type.SerializeAsString(), &float_value));
+  EXPECT_EQ(float_value, 2.5);
+  EXPECT_TRUE(
+      ReadSerializedValue(value_type.SerializeAsString(), &int_value));
+  EXPECT_EQ(int_value, 0);
+
+  EXPECT_FALSE(ReadSerializedValue("\x08", &int_value));
+}
+
+TEST(UnpackSerializedSummaryTest, ReturnsViewOfPackedSummary) {
+  CountSummary count_summary;
+  count_summary.set_count(12);
+  Summary summary;
+  summary.mutable_data()->PackFrom(count_summary);
+  const std::string serialized = summary.SerializeAsString();
+
+  base::StatusOr<absl::string_view> unpacked =
+      UnpackSerializedSummary<CountSummary>(serialized);
+  ASSERT_OK(unpacked);
+  EXPECT_EQ(*unpacked, count_summary.SerializeAsString());
+  EXPECT_GE(unpacked->data(), serialized.data());
+  EXPECT_LE(unpacked->data() + unpacked->size(),
+            serialized.data() + serialized.size());
+}
+
+TEST(UnpackSerializedSummaryTest, RejectsInvalidSummaries) {
+  EXPECT_THAT(UnpackSerializedSummary<CountSummary>(""),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("no data")));
+
+  Summary summary;
+  summary.mutable_data()->PackFrom(BoundedSumSummary());
+  EXPECT_THAT(
+      UnpackSerializedSummary<CountSummary>(summary.SerializeAsString()),
+      StatusIs(absl::StatusCode::kInternal,
+               HasSubstr("does not hold a differential_privacy.CountSummary")));
+
+  summary.mutable_data()->PackFrom(CountSummary());
+  std::string truncated = summary.SerializeAsString();
+  truncated.pop_back();
+  EXPECT_THAT(UnpackSerializedSummary<CountSummary>(truncated),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("malformed")));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace differential_privacy
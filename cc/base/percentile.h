@@ -90,11 +90,7 @@ class Percentile {
       return std::make_pair(0, 1);
     }
 
-    // If something has been added since the last sort, sort again.
-    if (!sorted_) {
-      std::sort(inputs_.begin(), inputs_.end());
-      sorted_ = true;
-    }
+    SortIfNeeded();
     auto lb = std::lower_bound(inputs_.begin(), inputs_.end(), t);
     auto ub = std::upper_bound(lb, inputs_.end(), t);
     double num_lt = std::distance(inputs_.begin(), lb);
@@ -102,7 +98,22 @@ class Percentile {
     return std::make_pair(num_lt / num_values(), num_le / num_values());
   }
 
+  // Returns the inputs in ascending order. The reference is invalidated by the
+  // next call to Add, MergeFromProto or Reset.
+  const std::vector<T>& GetSortedInputs() {
+    SortIfNeeded();
+    return inputs_;
+  }
+
  private:
+  // If something has been added since the last sort, sort again.
+  void SortIfNeeded() {
+    if (!sorted_) {
+      std::sort(inputs_.begin(), inputs_.end());
+      sorted_ = true;
+    }
+  }
+
   std::vector<T> inputs_;
   bool sorted_ = true;
 };
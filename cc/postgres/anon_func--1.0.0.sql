@@ -16,6 +16,23 @@ limitations under the License.
 
 \echo Use "CREATE EXTENSION anon_func" to load this file. \quit
 
+/* Transition states are allocated in the aggregate memory context. SSPACE
+ * gives the planner an estimate of each state's size, so that it avoids hash
+ * aggregation, which keeps the states of all groups until the end, when they
+ * would not fit in work_mem.
+ *
+ * Each SSPACE and MSSPACE is sizeof() of the DpFunc state, which includes its
+ * batch of DpFunc::kBatchSize doubles (512 bytes), plus MemoryUsed() of the
+ * algorithm it owns, rounded up to a whole KiB. Recompute them when either
+ * changes. On x86-64 the states take 540-580 bytes and the algorithms:
+ *   Count: 184, plus 64 for partition selection
+ *   BoundedSum / BoundedMean: 66256 / 66272 with automatic bounds, whose
+ *     logarithmic histogram dominates, and 416 / 432 with bounds
+ *   BoundedVariance / BoundedStandardDeviation: 99072 / 99128 with automatic
+ *     bounds, and 488 / 544 with bounds
+ *   Percentile: 240 plus 8 per input, estimated for 1000 inputs per group
+ */
+
 /* Create the aggregates:
  *
  * ANON_COUNT(column, epsilon)
@@ -41,10 +58,33 @@ CREATE FUNCTION anon_count_extract(internal) RETURNS bigint AS
   'anon_func','anon_count_extract'
 LANGUAGE C IMMUTABLE;
 
+-- Inverse accum for moving aggregation, with epsilon.
+CREATE FUNCTION anon_count_inv(internal, anyelement, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_count_inv'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for moving aggregation, no epsilon.
+CREATE FUNCTION anon_count_inv(internal, anyelement)
+RETURNS internal AS
+  'anon_func','anon_count_inv'
+LANGUAGE C IMMUTABLE;
+
+-- Extract for moving aggregation.
+CREATE FUNCTION anon_count_mextract(internal) RETURNS bigint AS
+  'anon_func','anon_count_mextract'
+LANGUAGE C IMMUTABLE;
+
 -- Aggregate for with epsilon.
 CREATE AGGREGATE anon_count(anyelement, epsilon double precision) (
   SFUNC = anon_count_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_count_accum,
+  MINVFUNC = anon_count_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_count_mextract,
   FINALFUNC = anon_count_extract
 );
 
@@ -52,10 +92,77 @@ CREATE AGGREGATE anon_count(anyelement, epsilon double precision) (
 CREATE AGGREGATE anon_count(anyelement) (
   SFUNC = anon_count_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_count_accum,
+  MINVFUNC = anon_count_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_count_mextract,
   FINALFUNC = anon_count_extract
 );
 
 
+/* Create the aggregates:
+ *
+ * ANON_COUNT_WITH_SELECTION(column, delta, max_partitions, epsilon)
+ * ANON_COUNT_WITH_SELECTION(column, delta, epsilon)
+ * ANON_COUNT_WITH_SELECTION(column, delta)
+ *
+ * where column is of any type. Returns NULL for partitions dropped by
+ * partition selection.
+ */
+
+-- Accum for with max partitions and epsilon.
+CREATE FUNCTION anon_count_with_selection_accum(internal, anyelement, delta double precision,
+  max_partitions bigint, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_count_with_selection_accum'
+LANGUAGE C IMMUTABLE;
+
+-- Accum for with epsilon.
+CREATE FUNCTION anon_count_with_selection_accum(internal, anyelement, delta double precision,
+  epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_count_with_selection_accum'
+LANGUAGE C IMMUTABLE;
+
+-- Accum for no epsilon.
+CREATE FUNCTION anon_count_with_selection_accum(internal, anyelement, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_count_with_selection_accum'
+LANGUAGE C IMMUTABLE;
+
+-- Extract.
+CREATE FUNCTION anon_count_with_selection_extract(internal) RETURNS bigint AS
+  'anon_func','anon_count_with_selection_extract'
+LANGUAGE C IMMUTABLE;
+
+-- Aggregate for with max partitions and epsilon.
+CREATE AGGREGATE anon_count_with_selection(anyelement, delta double precision,
+    max_partitions bigint, epsilon double precision) (
+  SFUNC = anon_count_with_selection_accum,
+  STYPE = internal,
+  SSPACE = 1024,
+  FINALFUNC = anon_count_with_selection_extract
+);
+
+-- Aggregate for with epsilon.
+CREATE AGGREGATE anon_count_with_selection(anyelement, delta double precision,
+    epsilon double precision) (
+  SFUNC = anon_count_with_selection_accum,
+  STYPE = internal,
+  SSPACE = 1024,
+  FINALFUNC = anon_count_with_selection_extract
+);
+
+-- Aggregate for no epsilon.
+CREATE AGGREGATE anon_count_with_selection(anyelement, delta double precision) (
+  SFUNC = anon_count_with_selection_accum,
+  STYPE = internal,
+  SSPACE = 1024,
+  FINALFUNC = anon_count_with_selection_extract
+);
+
 /* Create the aggregates:
  *
  * ANON_SUM(column, epsilon)
@@ -180,10 +287,77 @@ CREATE FUNCTION anon_sum_extract_int(internal) RETURNS bigint AS
   'anon_func','anon_sum_extract_int'
 LANGUAGE C IMMUTABLE;
 
+-- Inverse accum for double type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_double'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for double type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry double precision, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_double'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for bigint type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry bigint, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for bigint type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry bigint, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for integer type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry integer, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for integer type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry integer, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for smallint type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry smallint, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Inverse accum for smallint type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_inv(internal, entry smallint, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_inv_int'
+LANGUAGE C IMMUTABLE;
+
+-- Extract for double type, moving aggregation.
+CREATE FUNCTION anon_sum_mextract_double(internal) RETURNS double precision AS
+  'anon_func','anon_sum_mextract_double'
+LANGUAGE C IMMUTABLE;
+
+-- Extract for int type, moving aggregation.
+CREATE FUNCTION anon_sum_mextract_int(internal) RETURNS bigint AS
+  'anon_func','anon_sum_mextract_int'
+LANGUAGE C IMMUTABLE;
+
 -- Aggregate for double type, auto bounding, with epsilon.
 CREATE AGGREGATE anon_sum(entry double precision, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_double
 );
 
@@ -191,6 +365,7 @@ CREATE AGGREGATE anon_sum(entry double precision, epsilon double precision) (
 CREATE AGGREGATE anon_sum(entry double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_double
 );
 
@@ -198,6 +373,7 @@ CREATE AGGREGATE anon_sum(entry double precision) (
 CREATE AGGREGATE anon_sum(entry bigint, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -205,6 +381,7 @@ CREATE AGGREGATE anon_sum(entry bigint, epsilon double precision) (
 CREATE AGGREGATE anon_sum(entry bigint) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -212,6 +389,7 @@ CREATE AGGREGATE anon_sum(entry bigint) (
 CREATE AGGREGATE anon_sum(entry integer, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -219,6 +397,7 @@ CREATE AGGREGATE anon_sum(entry integer, epsilon double precision) (
 CREATE AGGREGATE anon_sum(entry integer) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -226,6 +405,7 @@ CREATE AGGREGATE anon_sum(entry integer) (
 CREATE AGGREGATE anon_sum(entry smallint, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -233,6 +413,7 @@ CREATE AGGREGATE anon_sum(entry smallint, epsilon double precision) (
 CREATE AGGREGATE anon_sum(entry smallint) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -241,6 +422,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub doub
   epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -248,6 +435,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub doub
 CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -256,6 +449,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_double,
   FINALFUNC = anon_sum_extract_double
 );
 
@@ -264,6 +463,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_double,
   FINALFUNC = anon_sum_extract_double
 );
 
@@ -272,6 +477,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub dou
     epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -279,6 +490,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub dou
 CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -288,6 +505,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub do
     epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -295,6 +518,12 @@ CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub do
 CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_inv,
+  MSTYPE = internal,
+  MSSPACE = 1024,
+  MFINALFUNC = anon_sum_mextract_int,
   FINALFUNC = anon_sum_extract_int
 );
 
@@ -344,6 +573,7 @@ LANGUAGE C IMMUTABLE;
 CREATE AGGREGATE anon_avg(entry double precision, epsilon double precision) (
   SFUNC = anon_avg_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_avg_extract
 );
 
@@ -351,6 +581,7 @@ CREATE AGGREGATE anon_avg(entry double precision, epsilon double precision) (
 CREATE AGGREGATE anon_avg(entry double precision) (
   SFUNC = anon_avg_accum,
   STYPE = internal,
+  SSPACE = 67584,
   FINALFUNC = anon_avg_extract
 );
 
@@ -359,6 +590,7 @@ CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_avg_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
   FINALFUNC = anon_avg_extract
 );
 
@@ -367,6 +599,7 @@ CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_avg_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 1024,
   FINALFUNC = anon_avg_extract
 );
 
@@ -416,6 +649,7 @@ LANGUAGE C IMMUTABLE;
 CREATE AGGREGATE anon_var(entry double precision, epsilon double precision) (
   SFUNC = anon_var_accum,
   STYPE = internal,
+  SSPACE = 100352,
   FINALFUNC = anon_var_extract
 );
 
@@ -423,6 +657,7 @@ CREATE AGGREGATE anon_var(entry double precision, epsilon double precision) (
 CREATE AGGREGATE anon_var(entry double precision) (
   SFUNC = anon_var_accum,
   STYPE = internal,
+  SSPACE = 100352,
   FINALFUNC = anon_var_extract
 );
 
@@ -431,6 +666,7 @@ CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_var_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 2048,
   FINALFUNC = anon_var_extract
 );
 
@@ -439,6 +675,7 @@ CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_var_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 2048,
   FINALFUNC = anon_var_extract
 );
 
@@ -488,6 +725,7 @@ LANGUAGE C IMMUTABLE;
 CREATE AGGREGATE anon_stddev(entry double precision, epsilon double precision) (
   SFUNC = anon_stddev_accum,
   STYPE = internal,
+  SSPACE = 100352,
   FINALFUNC = anon_stddev_extract
 );
 
@@ -495,6 +733,7 @@ CREATE AGGREGATE anon_stddev(entry double precision, epsilon double precision) (
 CREATE AGGREGATE anon_stddev(entry double precision) (
   SFUNC = anon_stddev_accum,
   STYPE = internal,
+  SSPACE = 100352,
   FINALFUNC = anon_stddev_extract
 );
 
@@ -503,6 +742,7 @@ CREATE AGGREGATE anon_stddev_with_bounds(entry double precision, lb double preci
     ub double precision, epsilon double precision) (
   SFUNC = anon_stddev_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 2048,
   FINALFUNC = anon_stddev_extract
 );
 
@@ -511,6 +751,7 @@ CREATE AGGREGATE anon_stddev_with_bounds(entry double precision, lb double preci
     ub double precision) (
   SFUNC = anon_stddev_with_bounds_accum,
   STYPE = internal,
+  SSPACE = 2048,
   FINALFUNC = anon_stddev_extract
 );
 
@@ -594,6 +835,7 @@ CREATE AGGREGATE anon_ntile(entry double precision, percentile double precision,
     lb double precision, ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_double
 );
 
@@ -602,6 +844,7 @@ CREATE AGGREGATE anon_ntile(entry double precision, percentile double precision,
   lb double precision, ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_double
 );
 
@@ -610,6 +853,7 @@ CREATE AGGREGATE anon_ntile(entry bigint, percentile double precision, lb double
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
 
@@ -618,6 +862,7 @@ CREATE AGGREGATE anon_ntile(entry bigint, percentile double precision, lb double
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
 
@@ -626,6 +871,7 @@ CREATE AGGREGATE anon_ntile(entry integer, percentile double precision,  lb doub
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
 
@@ -634,6 +880,7 @@ CREATE AGGREGATE anon_ntile(entry integer, percentile double precision,  lb doub
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
 
@@ -642,6 +889,7 @@ CREATE AGGREGATE anon_ntile(entry smallint, percentile double precision,  lb dou
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
 
@@ -650,5 +898,6 @@ CREATE AGGREGATE anon_ntile(entry smallint, percentile double precision,  lb dou
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
+  SSPACE = 9216,
   FINALFUNC = anon_ntile_extract_int
 );
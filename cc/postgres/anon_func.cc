@@ -18,10 +18,15 @@ extern "C" {
 
 #include "postgres.h"
 #include "fmgr.h"
+#include "nodes/execnodes.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
 
 PG_MODULE_MAGIC;
 
+void _PG_init(void);
+
 #define CHECK_AGG_CONTEXT(fcinfo)                                 \
   if (!AggCheckCallContext(fcinfo, NULL)) {                       \
     elog(ERROR, "Anon function called in non-aggregate context"); \
@@ -34,6 +39,12 @@ PG_MODULE_MAGIC;
 // ANON_COUNT
 PG_FUNCTION_INFO_V1(anon_count_accum);
 PG_FUNCTION_INFO_V1(anon_count_extract);
+PG_FUNCTION_INFO_V1(anon_count_inv);
+PG_FUNCTION_INFO_V1(anon_count_mextract);
+
+// ANON_COUNT_WITH_SELECTION
+PG_FUNCTION_INFO_V1(anon_count_with_selection_accum);
+PG_FUNCTION_INFO_V1(anon_count_with_selection_extract);
 
 // ANON_SUM
 PG_FUNCTION_INFO_V1(anon_sum_accum_double);
@@ -42,6 +53,10 @@ PG_FUNCTION_INFO_V1(anon_sum_with_bounds_accum_double);
 PG_FUNCTION_INFO_V1(anon_sum_with_bounds_accum_int);
 PG_FUNCTION_INFO_V1(anon_sum_extract_double);
 PG_FUNCTION_INFO_V1(anon_sum_extract_int);
+PG_FUNCTION_INFO_V1(anon_sum_with_bounds_inv_double);
+PG_FUNCTION_INFO_V1(anon_sum_with_bounds_inv_int);
+PG_FUNCTION_INFO_V1(anon_sum_mextract_double);
+PG_FUNCTION_INFO_V1(anon_sum_mextract_int);
 
 // ANON_AVG
 PG_FUNCTION_INFO_V1(anon_avg_accum);
@@ -65,12 +80,56 @@ PG_FUNCTION_INFO_V1(anon_ntile_extract_double);
 PG_FUNCTION_INFO_V1(anon_ntile_extract_int);
 }
 
+#include <new>
+#include <utility>
+
 #include "dp_func.h"
 
+/*
+ * Configuration.
+ */
+
+// Number of window frames between which a moving aggregate splits its privacy
+// budget. Set with anon_func.max_window_frames.
+static int max_window_frames = 1;
+
+void _PG_init(void) {
+  DefineCustomIntVariable(
+      "anon_func.max_window_frames",
+      "Number of window frames an anonymous moving aggregate may release.",
+      "The privacy budget of each moving aggregate is split evenly between "
+      "this many frames of its window partition; further frames return NULL.",
+      &max_window_frames, 1, 1, INT_MAX, PGC_USERSET, 0, NULL, NULL, NULL);
+}
+
 /*
  * Helper functions.
  */
 
+// Reset callback destroying a DpFunc that lives in an aggregate memory context.
+void dp_func_cleanup(void* arg) { reinterpret_cast<DpFunc*>(arg)->~DpFunc(); }
+
+// Construct a DpFunction in the aggregate memory context. The function is
+// destroyed when the context is reset or deleted, even if the final function
+// errors out or is never called. That is after each group for sorted
+// aggregation, but only at the end of hash aggregation.
+template <typename DpFunction, typename... Args>
+DpFunction* new_agg_state(PG_FUNCTION_ARGS, Args&&... args) {
+  MemoryContext aggcontext;
+  if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+    elog(ERROR, "Anon function called in non-aggregate context");
+  }
+  MemoryContextCallback* callback =
+      reinterpret_cast<MemoryContextCallback*>(MemoryContextAlloc(
+          aggcontext, sizeof(MemoryContextCallback)));
+  void* mem = MemoryContextAlloc(aggcontext, sizeof(DpFunction));
+  DpFunction* func = new (mem) DpFunction(std::forward<Args>(args)...);
+  callback->func = dp_func_cleanup;
+  callback->arg = static_cast<DpFunc*>(func);
+  MemoryContextRegisterResetCallback(aggcontext, callback);
+  return func;
+}
+
 template <typename DpFunction>
 void add_arg_entry(PG_FUNCTION_ARGS, DpFunction* func, bool is_integral) {
   bool entry_added;
@@ -118,8 +177,8 @@ Datum bounded_accum(PG_FUNCTION_ARGS, bool with_bounds, bool is_integral) {
 
     // Construct the DP function.
     std::string err;
-    arg0 = new DpFunction(&err, !with_epsilon, epsilon,
-                          !with_bounds, lower, upper);
+    arg0 = new_agg_state<DpFunction>(fcinfo, &err, !with_epsilon, epsilon,
+                                     !with_bounds, lower, upper);
     if (!err.empty()) {
       ereport(ERROR,
               (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -147,7 +206,6 @@ Datum int_extract(PG_FUNCTION_ARGS){
     ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
     PG_RETURN_NULL();
   }
-  delete arg;
   PG_RETURN_INT64(result);
 }
 
@@ -165,7 +223,108 @@ Datum double_extract(PG_FUNCTION_ARGS){
     ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
     PG_RETURN_NULL();
   }
-  delete arg;
+  PG_RETURN_FLOAT8(result);
+}
+
+// Common inverse transition code for moving aggregates. Returning null tells
+// Postgres that the entry cannot be removed, so that it restarts the
+// aggregation for the window frame with a new state.
+template <typename DpFunction>
+Datum inverse_accum(PG_FUNCTION_ARGS, bool is_integral) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpFunction* arg0 = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  bool entry_removed;
+  if (is_integral) {
+    entry_removed = arg0->RemoveEntry(PG_GETARG_INT64(1));
+  } else {
+    // Double type.
+    entry_removed = arg0->RemoveEntry(PG_GETARG_FLOAT8(1));
+  }
+  if (!entry_removed) {
+    PG_RETURN_NULL();
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+// The frame budget of a moving aggregate in the current window partition.
+// Postgres may replace the transition state between frames, so it is kept in
+// the fn_extra of the aggregate's final function, which lives for the whole
+// query, and reset when the partition's memory context is reset.
+struct PartitionFrameBudget {
+  WindowFrameBudget budget;
+  MemoryContextCallback reset_callback;
+  bool reset_registered;
+};
+
+void reset_frame_budget(void* arg) {
+  PartitionFrameBudget* frames = static_cast<PartitionFrameBudget*>(arg);
+  frames->budget.Reset();
+  frames->reset_registered = false;
+}
+
+// Returns the fraction of epsilon that the current window frame may use.
+double next_window_frame_budget(PG_FUNCTION_ARGS) {
+  if (fcinfo->context == NULL || !IsA(fcinfo->context, WindowAggState)) {
+    elog(ERROR, "Anon moving aggregate called outside of a window");
+  }
+  WindowAggState* winstate =
+      reinterpret_cast<WindowAggState*>(fcinfo->context);
+  PartitionFrameBudget* frames =
+      static_cast<PartitionFrameBudget*>(fcinfo->flinfo->fn_extra);
+  if (frames == NULL) {
+    void* mem = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+                                       sizeof(PartitionFrameBudget));
+    frames = new (mem) PartitionFrameBudget();
+    fcinfo->flinfo->fn_extra = frames;
+  }
+  if (!frames->reset_registered) {
+    frames->reset_callback.func = reset_frame_budget;
+    frames->reset_callback.arg = frames;
+    MemoryContextRegisterResetCallback(winstate->partcontext,
+                                       &frames->reset_callback);
+    frames->reset_registered = true;
+  }
+  return frames->budget.NextFrame(max_window_frames);
+}
+
+// Common moving-aggregate extract code for returning integer values. The final
+// function runs once per window frame, and the frames of a window partition
+// share the privacy budget. Return null if error.
+template <typename DpFunction>
+Datum int_window_extract(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  std::string err;
+  int64_t result =
+      arg->WindowResultRounded(next_window_frame_budget(fcinfo), &err);
+  if (!err.empty()) {
+    ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
+    PG_RETURN_NULL();
+  }
+  PG_RETURN_INT64(result);
+}
+
+// Common moving-aggregate extract code for returning double values. Return
+// null if error.
+template <typename DpFunction>
+Datum double_window_extract(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  std::string err;
+  double result = arg->WindowResult(next_window_frame_budget(fcinfo), &err);
+  if (!err.empty()) {
+    ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
+    PG_RETURN_NULL();
+  }
   PG_RETURN_FLOAT8(result);
 }
 
@@ -181,9 +340,10 @@ Datum anon_count_accum(PG_FUNCTION_ARGS) {
     std::string err;
     if (PG_NARGS() > 2) {
       float8 epsilon = PG_GETARG_FLOAT8(2);
-      arg0 = new DpCount(&err, /*default_epsilon=*/false, epsilon);
+      arg0 = new_agg_state<DpCount>(fcinfo, &err, /*default_epsilon=*/false,
+                                    epsilon);
     } else {
-      arg0 = new DpCount(&err);
+      arg0 = new_agg_state<DpCount>(fcinfo, &err);
     }
     if (!err.empty()) {
       ereport(ERROR,
@@ -207,6 +367,100 @@ Datum anon_count_extract(PG_FUNCTION_ARGS) {
   return int_extract<DpCount>(fcinfo);
 }
 
+Datum anon_count_inv(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpCount* arg0 = reinterpret_cast<DpCount*>(PG_GETARG_POINTER(0));
+  if (!arg0->RemoveEntry(1)) {
+    PG_RETURN_NULL();
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+Datum anon_count_mextract(PG_FUNCTION_ARGS) {
+  return int_window_extract<DpCount>(fcinfo);
+}
+
+
+/*
+ * ANON_COUNT_WITH_SELECTION functions.
+ */
+
+// A window would extract the state once per row, and every extraction would
+// consume privacy budget again, so selection is only allowed as an aggregate.
+void check_not_window_context(PG_FUNCTION_ARGS) {
+  if (AggCheckCallContext(fcinfo, NULL) == AGG_CONTEXT_WINDOW) {
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+            errmsg("anon_count_with_selection cannot be used as a window "
+                   "function.")));
+  }
+}
+
+Datum anon_count_with_selection_accum(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  check_not_window_context(fcinfo);
+  DpCountWithPartitionSelection* arg0;
+  if (PG_ARGISNULL(0)) {
+    std::string err;
+    float8 delta = PG_GETARG_FLOAT8(2);
+    if (PG_NARGS() > 4) {
+      int64 max_partitions = PG_GETARG_INT64(3);
+      if (max_partitions < 1 || max_partitions > INT_MAX) {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("max_partitions must be between 1 and %d, but is "
+                       INT64_FORMAT ".", INT_MAX, max_partitions)));
+      }
+      float8 epsilon = PG_GETARG_FLOAT8(4);
+      arg0 = new_agg_state<DpCountWithPartitionSelection>(
+          fcinfo, &err, delta, max_partitions, /*default_epsilon=*/false,
+          epsilon);
+    } else if (PG_NARGS() > 3) {
+      float8 epsilon = PG_GETARG_FLOAT8(3);
+      arg0 = new_agg_state<DpCountWithPartitionSelection>(
+          fcinfo, &err, delta, /*max_partitions_contributed=*/1,
+          /*default_epsilon=*/false, epsilon);
+    } else {
+      arg0 = new_agg_state<DpCountWithPartitionSelection>(fcinfo, &err, delta);
+    }
+    if (!err.empty()) {
+      ereport(ERROR,
+              (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+              errmsg("%s", err.c_str())));
+    }
+  } else {
+    arg0 = reinterpret_cast<DpCountWithPartitionSelection*>(
+        PG_GETARG_POINTER(0));
+  }
+
+  // Add a dummy entry for each user counted.
+  if (!arg0->AddEntry(1)) {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("Adding entry to dp function failed.")));
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+// Suppressed partitions return null, so the whole query is a single pass when
+// filtered with "HAVING ANON_COUNT_WITH_SELECTION(...) IS NOT NULL".
+Datum anon_count_with_selection_extract(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  check_not_window_context(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpCountWithPartitionSelection* arg =
+      reinterpret_cast<DpCountWithPartitionSelection*>(PG_GETARG_POINTER(0));
+  if (!arg->KeepPartition()) {
+    PG_RETURN_NULL();
+  }
+  return int_extract<DpCountWithPartitionSelection>(fcinfo);
+}
+
 
 /*
  * ANON_SUM functions.
@@ -237,6 +491,22 @@ Datum anon_sum_extract_int(PG_FUNCTION_ARGS) {
   return int_extract<DpSum>(fcinfo);
 }
 
+Datum anon_sum_with_bounds_inv_double(PG_FUNCTION_ARGS) {
+  return inverse_accum<DpSum>(fcinfo, false);
+}
+
+Datum anon_sum_with_bounds_inv_int(PG_FUNCTION_ARGS) {
+  return inverse_accum<DpSum>(fcinfo, true);
+}
+
+Datum anon_sum_mextract_double(PG_FUNCTION_ARGS) {
+  return double_window_extract<DpSum>(fcinfo);
+}
+
+Datum anon_sum_mextract_int(PG_FUNCTION_ARGS) {
+  return int_window_extract<DpSum>(fcinfo);
+}
+
 
 /*
  * ANON_AVG functions.
@@ -309,10 +579,10 @@ Datum ntile_accum(PG_FUNCTION_ARGS, bool is_integral) {
     std::string err;
     if (PG_NARGS() > 5) {
       float8 epsilon = PG_GETARG_FLOAT8(5);
-      arg0 = new DpNtile(&err, percentile, lower, upper,
-                         /*default_epsilon=*/false, epsilon);
+      arg0 = new_agg_state<DpNtile>(fcinfo, &err, percentile, lower, upper,
+                                    /*default_epsilon=*/false, epsilon);
     } else {
-      arg0 = new DpNtile(&err, percentile, lower, upper);
+      arg0 = new_agg_state<DpNtile>(fcinfo, &err, percentile, lower, upper);
     }
     if (!err.empty()) {
       ereport(ERROR,
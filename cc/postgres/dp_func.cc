@@ -16,6 +16,9 @@
 
 #include "dp_func.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "algorithms/algorithm.h"
 #include "algorithms/bounded-mean.h"
 #include "algorithms/bounded-standard-deviation.h"
@@ -23,16 +26,25 @@
 #include "algorithms/bounded-variance.h"
 #include "algorithms/count.h"
 #include "algorithms/order-statistics.h"
+#include "algorithms/partition-selection.h"
 #include "algorithms/util.h"
+#include "proto/summary.pb.h"
 
 using differential_privacy::Algorithm;
 using differential_privacy::BoundedMean;
 using differential_privacy::BoundedStandardDeviation;
 using differential_privacy::BoundedSum;
+using differential_privacy::BoundedSumSummary;
 using differential_privacy::BoundedVariance;
+using differential_privacy::Clamp;
 using differential_privacy::Count;
+using differential_privacy::CountSummary;
 using differential_privacy::DefaultEpsilon;
 using differential_privacy::GetValue;
+using differential_privacy::PartitionSelectionStrategy;
+using differential_privacy::PreaggPartitionSelection;
+using differential_privacy::SetValue;
+using differential_privacy::Summary;
 using differential_privacy::continuous::Percentile;
 
 // Construct and return a bounded algorithm. Populate error if unsuccessful.
@@ -62,25 +74,27 @@ void DeleteAlgorithm(Alg* alg) {
   }
 }
 
-// Add an entry to the algorithm. Return true if the algorithm exists.
-bool AlgorithmAddEntry(Algorithm<double>* alg, double entry) {
+// Add entries to the algorithm through its bulk ingestion path, if the
+// algorithm exists.
+template <typename Alg>
+void AlgorithmAddEntries(Alg* alg, const double* begin, const double* end) {
   if (alg) {
-    alg->AddEntry(entry);
-    return true;
+    alg->AddEntries(begin, end);
   }
-  return false;
 }
 
-// Return the result of return_type from the algorithm, populating error if
-// unsuccessful.
+// Return the result of return_type from the algorithm, consuming at most
+// privacy_budget out of its remaining budget. Populate error if unsuccessful.
 template <typename return_type>
-double AlgorithmResult(Algorithm<double>* alg, std::string* err) {
+double AlgorithmResult(Algorithm<double>* alg, std::string* err,
+                       double privacy_budget = 1.0) {
   double default_return = 0.0;
   if (!alg) {
     *err = "Underlying algorithm was never constructed.";
     return default_return;
   }
-  auto result_statusor = alg->PartialResult();
+  auto result_statusor = alg->PartialResult(
+      std::min(privacy_budget, alg->RemainingPrivacyBudget()));
   if (result_statusor.ok()) {
     return static_cast<double>(
         GetValue<return_type>(result_statusor.ValueOrDie()));
@@ -90,6 +104,17 @@ double AlgorithmResult(Algorithm<double>* alg, std::string* err) {
   return default_return;
 }
 
+// Merge a summary into the algorithm, populating error if unsuccessful.
+bool AlgorithmMerge(Algorithm<double>* alg, const Summary& summary,
+                    std::string* err) {
+  absl::Status status = alg->Merge(summary);
+  if (!status.ok()) {
+    *err = std::string(status.message());
+    return false;
+  }
+  return true;
+}
+
 // DP count.
 DpCount::DpCount(std::string* err, bool default_epsilon, double epsilon) {
   if (default_epsilon) {
@@ -98,39 +123,163 @@ DpCount::DpCount(std::string* err, bool default_epsilon, double epsilon) {
   auto count_statusor = Count<double>::Builder().SetEpsilon(epsilon).Build();
   if (count_statusor.ok()) {
     count_ = count_statusor.ValueOrDie().release();
+    has_algorithm_ = true;
   } else {
     *err = std::string(count_statusor.status().message());
   }
 }
 DpCount::~DpCount() { DeleteAlgorithm<Count<double>>(count_); }
-bool DpCount::AddEntry(double entry) {
-  return AlgorithmAddEntry(count_, entry);
+void DpCount::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(count_, begin, end);
+}
+bool DpCount::RemoveEntry(double entry) {
+  if (!count_) {
+    return false;
+  }
+  ++removed_;
+  return true;
+}
+bool DpCount::ApplyRemovals(std::string* err) {
+  if (!count_ || removed_ == 0) {
+    return true;
+  }
+  CountSummary count_summary;
+  count_summary.set_count(-removed_);
+  Summary summary;
+  summary.mutable_data()->PackFrom(count_summary);
+  removed_ = 0;
+  return AlgorithmMerge(count_, summary, err);
+}
+double DpCount::GenerateResult(std::string* err) {
+  if (!ApplyRemovals(err)) {
+    return 0.0;
+  }
+  return AlgorithmResult<int64_t>(count_, err);
+}
+double DpCount::GenerateWindowResult(double privacy_budget, std::string* err) {
+  if (!ApplyRemovals(err)) {
+    return 0.0;
+  }
+  return AlgorithmResult<int64_t>(count_, err, privacy_budget);
+}
+
+// DP count with partition selection.
+DpCountWithPartitionSelection::DpCountWithPartitionSelection(
+    std::string* err, double delta, int64_t max_partitions_contributed,
+    bool default_epsilon, double epsilon) {
+  if (default_epsilon) {
+    epsilon = DefaultEpsilon();
+  }
+  auto selection_statusor = PreaggPartitionSelection::Builder()
+                                .SetEpsilon(epsilon / 2)
+                                .SetDelta(delta)
+                                .SetMaxPartitionsContributed(
+                                    max_partitions_contributed)
+                                .Build();
+  if (!selection_statusor.ok()) {
+    *err = std::string(selection_statusor.status().message());
+    return;
+  }
+  auto count_statusor =
+      Count<double>::Builder()
+          .SetEpsilon(epsilon / 2)
+          .SetMaxPartitionsContributed(max_partitions_contributed)
+          .Build();
+  if (!count_statusor.ok()) {
+    *err = std::string(count_statusor.status().message());
+    return;
+  }
+  selection_ = selection_statusor.ValueOrDie().release();
+  count_ = count_statusor.ValueOrDie().release();
+  has_algorithm_ = true;
 }
-double DpCount::Result(std::string* err) {
+DpCountWithPartitionSelection::~DpCountWithPartitionSelection() {
+  DeleteAlgorithm<PartitionSelectionStrategy>(selection_);
+  DeleteAlgorithm<Count<double>>(count_);
+}
+void DpCountWithPartitionSelection::AddEntries(const double* begin,
+                                               const double* end) {
+  num_users_ += end - begin;
+  AlgorithmAddEntries(count_, begin, end);
+}
+bool DpCountWithPartitionSelection::KeepPartition() {
+  if (keep_decided_) {
+    return keep_;
+  }
+  Flush();
+  if (selection_) {
+    keep_ = selection_->ShouldKeep(static_cast<int>(std::min<int64_t>(
+        num_users_, std::numeric_limits<int>::max())));
+  }
+  keep_decided_ = true;
+  return keep_;
+}
+double DpCountWithPartitionSelection::GenerateResult(std::string* err) {
   return AlgorithmResult<int64_t>(count_, err);
 }
 
 // DP sum.
 DpSum::DpSum(std::string* err, bool default_epsilon, double epsilon,
-             bool auto_bounds, double lower, double upper) {
+             bool auto_bounds, double lower, double upper)
+    : auto_bounds_(auto_bounds),
+      lower_(lower),
+      upper_(upper) {
   sum_ = BoundedAlgorithm<BoundedSum<double, nullptr>>(
       err, default_epsilon, epsilon, auto_bounds, lower, upper);
+  has_algorithm_ = sum_ != nullptr;
 }
 DpSum::~DpSum() { DeleteAlgorithm<BoundedSum<double, nullptr>>(sum_); }
-bool DpSum::AddEntry(double entry) { return AlgorithmAddEntry(sum_, entry); }
-double DpSum::Result(std::string* err) {
+void DpSum::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(sum_, begin, end);
+}
+bool DpSum::RemoveEntry(double entry) {
+  if (!sum_ || auto_bounds_) {
+    return false;
+  }
+  if (!std::isnan(entry)) {
+    removed_ += Clamp<double>(lower_, upper_, entry);
+  }
+  return true;
+}
+bool DpSum::ApplyRemovals(std::string* err) {
+  if (!sum_ || removed_ == 0) {
+    return true;
+  }
+  BoundedSumSummary bs_summary;
+  SetValue(bs_summary.add_pos_sum(), -removed_);
+  Summary summary;
+  summary.mutable_data()->PackFrom(bs_summary);
+  removed_ = 0;
+  return AlgorithmMerge(sum_, summary, err);
+}
+double DpSum::GenerateResult(std::string* err) {
+  if (!ApplyRemovals(err)) {
+    return 0.0;
+  }
   return AlgorithmResult<double>(sum_, err);
 }
+double DpSum::GenerateWindowResult(double privacy_budget, std::string* err) {
+  if (auto_bounds_) {
+    return DpFunc::GenerateWindowResult(privacy_budget, err);
+  }
+  if (!ApplyRemovals(err)) {
+    return 0.0;
+  }
+  return AlgorithmResult<double>(sum_, err, privacy_budget);
+}
 
 // DP mean.
 DpMean::DpMean(std::string* err, bool default_epsilon, double epsilon,
                bool auto_bounds, double lower, double upper) {
   mean_ = BoundedAlgorithm<BoundedMean<double, nullptr>>(
       err, default_epsilon, epsilon, auto_bounds, lower, upper);
+  has_algorithm_ = mean_ != nullptr;
 }
 DpMean::~DpMean() { DeleteAlgorithm<BoundedMean<double, nullptr>>(mean_); }
-bool DpMean::AddEntry(double entry) { return AlgorithmAddEntry(mean_, entry); }
-double DpMean::Result(std::string* err) {
+void DpMean::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(mean_, begin, end);
+}
+double DpMean::GenerateResult(std::string* err) {
   return AlgorithmResult<double>(mean_, err);
 }
 
@@ -139,14 +288,15 @@ DpVariance::DpVariance(std::string* err, bool default_epsilon, double epsilon,
                        bool auto_bounds, double lower, double upper) {
   var_ = BoundedAlgorithm<BoundedVariance<double, nullptr>>(
       err, default_epsilon, epsilon, auto_bounds, lower, upper);
+  has_algorithm_ = var_ != nullptr;
 }
 DpVariance::~DpVariance() {
   DeleteAlgorithm<BoundedVariance<double, nullptr>>(var_);
 }
-bool DpVariance::AddEntry(double entry) {
-  return AlgorithmAddEntry(var_, entry);
+void DpVariance::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(var_, begin, end);
 }
-double DpVariance::Result(std::string* err) {
+double DpVariance::GenerateResult(std::string* err) {
   return AlgorithmResult<double>(var_, err);
 }
 
@@ -156,14 +306,15 @@ DpStandardDeviation::DpStandardDeviation(std::string* err, bool default_epsilon,
                                          double lower, double upper) {
   sd_ = BoundedAlgorithm<BoundedStandardDeviation<double, nullptr>>(
       err, default_epsilon, epsilon, auto_bounds, lower, upper);
+  has_algorithm_ = sd_ != nullptr;
 }
 DpStandardDeviation::~DpStandardDeviation() {
   DeleteAlgorithm<BoundedStandardDeviation<double, nullptr>>(sd_);
 }
-bool DpStandardDeviation::AddEntry(double entry) {
-  return AlgorithmAddEntry(sd_, entry);
+void DpStandardDeviation::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(sd_, begin, end);
 }
-double DpStandardDeviation::Result(std::string* err) {
+double DpStandardDeviation::GenerateResult(std::string* err) {
   return AlgorithmResult<double>(sd_, err);
 }
 
@@ -181,12 +332,15 @@ DpNtile::DpNtile(std::string* err, double percentile, double lower,
                             .Build();
   if (build_statusor.ok()) {
     perc_ = build_statusor.ValueOrDie().release();
+    has_algorithm_ = true;
   } else {
     *err = std::string(build_statusor.status().message());
   }
 }
 DpNtile::~DpNtile() { DeleteAlgorithm<Percentile<double>>(perc_); }
-bool DpNtile::AddEntry(double entry) { return AlgorithmAddEntry(perc_, entry); }
-double DpNtile::Result(std::string* err) {
+void DpNtile::AddEntries(const double* begin, const double* end) {
+  AlgorithmAddEntries(perc_, begin, end);
+}
+double DpNtile::GenerateResult(std::string* err) {
   return AlgorithmResult<double>(perc_, err);
 }
@@ -42,6 +42,8 @@ class BoundedVariance;
 template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>*>
 class BoundedStandardDeviation;
 
+class PartitionSelectionStrategy;
+
 namespace continuous {
 
 template <typename T>
@@ -52,32 +54,176 @@ class Percentile;
 
 // DP functions. Owns an underlying DP algorithm. This wrapping layer is
 // neccesary so that C++ dependencies don't conflict with postgres dependencies.
+//
+// Entries are buffered in a fixed-size batch and handed to the algorithm in
+// bulk, so that adding a single row costs no virtual call.
 class DpFunc {
  public:
+  // Number of entries buffered before they are added to the algorithm.
+  static constexpr int kBatchSize = 64;
+
   virtual ~DpFunc() = default;
 
   // Returns true if adding the entry is successful.
-  virtual bool AddEntry(double entry) = 0;
-  bool AddEntry(int64_t entry) { return AddEntry(static_cast<double>(entry)); }
+  bool AddEntry(double entry) {
+    if (!has_algorithm_) {
+      return false;
+    }
+    batch_[batch_size_++] = entry;
+    if (batch_size_ == kBatchSize) {
+      Flush();
+    }
+    return true;
+  }
+  template <typename T,
+            std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+  bool AddEntry(T entry) {
+    return AddEntry(static_cast<double>(entry));
+  }
+
+  // Removes an entry that was previously added. Returns false if the function
+  // cannot be inverted, in which case the state is unchanged.
+  virtual bool RemoveEntry(double entry) { return false; }
+  template <typename T,
+            std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+  bool RemoveEntry(T entry) {
+    return RemoveEntry(static_cast<double>(entry));
+  }
 
   // Result can only be called once per function. Iff grabbing the result fails,
   // the error std::string is populated and we return 0.
-  virtual double Result(std::string* err) = 0;
+  double Result(std::string* err) {
+    Flush();
+    return GenerateResult(err);
+  }
 
   // Same as result, but the result is rounded to be an integer. Only Result or
   // ResultRounded may be called per function.
   int64_t ResultRounded(std::string* err) { return std::round(Result(err)); }
+
+  // Returns a result for the current entries of a moving aggregate, consuming
+  // privacy_budget out of the budget of this function, which keeps accepting
+  // and removing entries for the next window frame. privacy_budget comes from
+  // the WindowFrameBudget of the window partition. Only Result or WindowResult
+  // may be used per function. Iff grabbing the result fails, the error
+  // std::string is populated and we return 0.
+  double WindowResult(double privacy_budget, std::string* err) {
+    if (privacy_budget <= 0) {
+      *err = "Privacy budget for window frames is spent.";
+      return 0;
+    }
+    Flush();
+    return GenerateWindowResult(privacy_budget, err);
+  }
+
+  // Same as WindowResult, but the result is rounded to be an integer.
+  int64_t WindowResultRounded(double privacy_budget, std::string* err) {
+    return std::round(WindowResult(privacy_budget, err));
+  }
+
+ protected:
+  // Adds the entries in [begin, end) to the underlying algorithm.
+  virtual void AddEntries(const double* begin, const double* end) = 0;
+
+  // Returns the result of the underlying algorithm.
+  virtual double GenerateResult(std::string* err) = 0;
+
+  // Returns the result of the underlying algorithm, consuming privacy_budget
+  // out of its remaining budget.
+  virtual double GenerateWindowResult(double privacy_budget,
+                                      std::string* err) {
+    *err = "Function does not support moving aggregation.";
+    return 0;
+  }
+
+  // Adds all buffered entries to the underlying algorithm.
+  void Flush() {
+    if (batch_size_ > 0) {
+      AddEntries(batch_, batch_ + batch_size_);
+      batch_size_ = 0;
+    }
+  }
+
+  // Set by child classes once the underlying algorithm is constructed.
+  bool has_algorithm_ = false;
+
+ private:
+  double batch_[kBatchSize];
+  int batch_size_ = 0;
+};
+
+// Splits the privacy budget of a moving aggregate evenly between the first
+// max_frames window frames of a window partition. Postgres may start the
+// aggregate over with a new state for any frame, e.g. for frames that do not
+// overlap the rows aggregated so far, so frames are counted per partition
+// rather than in the state.
+class WindowFrameBudget {
+ public:
+  // Returns the fraction of epsilon that the next frame of the partition may
+  // use, or 0 once max_frames frames have been released.
+  double NextFrame(int max_frames) {
+    if (frames_released_ >= max_frames) {
+      return 0;
+    }
+    ++frames_released_;
+    return 1.0 / max_frames;
+  }
+
+  // Starts counting the frames of a new window partition.
+  void Reset() { frames_released_ = 0; }
+
+ private:
+  int frames_released_ = 0;
 };
 
 class DpCount : public DpFunc {
  public:
   DpCount(std::string* err, bool default_epsilon = true, double epsilon = 0);
   ~DpCount() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+  bool RemoveEntry(double entry) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
+  double GenerateWindowResult(double privacy_budget,
+                              std::string* err) override;
+
+ private:
+  // Merges the removed entries into the count.
+  bool ApplyRemovals(std::string* err);
+
+  differential_privacy::Count<double>* count_ = nullptr;
+  int64_t removed_ = 0;
+};
+
+// DP count of a partition that is released only if the partition survives
+// differentially private partition selection. Each entry is expected to come
+// from a distinct user. Half of epsilon is spent selecting the partition and
+// half on the count, so no threshold has to be guessed in a separate HAVING
+// clause and suppressed partitions never leak their existence.
+class DpCountWithPartitionSelection : public DpFunc {
+ public:
+  DpCountWithPartitionSelection(std::string* err, double delta,
+                                int64_t max_partitions_contributed = 1,
+                                bool default_epsilon = true,
+                                double epsilon = 0);
+  ~DpCountWithPartitionSelection() override;
+
+  // Returns true if the partition should be released. The decision is drawn on
+  // the first call, from the entries added so far, and returned unchanged by
+  // later calls, so that calling it again cannot resample it.
+  bool KeepPartition();
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
 
  private:
   differential_privacy::Count<double>* count_ = nullptr;
+  differential_privacy::PartitionSelectionStrategy* selection_ = nullptr;
+  int64_t num_users_ = 0;
+  bool keep_decided_ = false;
+  bool keep_ = false;
 };
 
 class DpSum : public DpFunc {
@@ -85,11 +231,25 @@ class DpSum : public DpFunc {
   DpSum(std::string* err, bool default_epsilon = true, double epsilon = 0,
         bool auto_bounds = true, double lower = 0, double upper = 0);
   ~DpSum() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+
+  // Only supported with manual bounds, where removing an entry subtracts its
+  // clamped value.
+  bool RemoveEntry(double entry) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
+  double GenerateWindowResult(double privacy_budget,
+                              std::string* err) override;
 
  private:
+  // Merges the clamped sum of the removed entries into the sum.
+  bool ApplyRemovals(std::string* err);
+
   differential_privacy::BoundedSum<double, nullptr>* sum_ = nullptr;
+  bool auto_bounds_;
+  double lower_, upper_;
+  double removed_ = 0;
 };
 
 class DpMean : public DpFunc {
@@ -97,8 +257,10 @@ class DpMean : public DpFunc {
   DpMean(std::string* err, bool default_epsilon = true, double epsilon = 0,
          bool auto_bounds = true, double lower = 0, double upper = 0);
   ~DpMean() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
 
  private:
   differential_privacy::BoundedMean<double, nullptr>* mean_ = nullptr;
@@ -109,8 +271,10 @@ class DpVariance : public DpFunc {
   DpVariance(std::string* err, bool default_epsilon = true, double epsilon = 0,
              bool auto_bounds = true, double lower = 0, double upper = 0);
   ~DpVariance() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
 
  private:
   differential_privacy::BoundedVariance<double, nullptr>* var_ = nullptr;
@@ -122,8 +286,10 @@ class DpStandardDeviation : public DpFunc {
                       double epsilon = 0, bool auto_bounds = true,
                       double lower = 0, double upper = 0);
   ~DpStandardDeviation() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
 
  private:
   differential_privacy::BoundedStandardDeviation<double, nullptr>* sd_ =
@@ -137,8 +303,10 @@ class DpNtile : public DpFunc {
   DpNtile(std::string* err, double percentile, double lower, double upper,
           bool default_epsilon = true, double epsilon = 0);
   ~DpNtile() override;
-  bool AddEntry(double entry) override;
-  double Result(std::string* err) override;
+
+ protected:
+  void AddEntries(const double* begin, const double* end) override;
+  double GenerateResult(std::string* err) override;
 
  private:
   differential_privacy::continuous::Percentile<double>* perc_ = nullptr;
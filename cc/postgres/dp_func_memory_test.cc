@@ -0,0 +1,131 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Regression test for the memory of the extension under sorted aggregation.
+// Each DpFunc lives in the aggregate memory context, but the algorithm it owns
+// is on the C++ heap and is only freed by the reset callback destroying the
+// DpFunc. This test replays that lifecycle for many groups and checks that the
+// heap does not grow with the number of groups.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "postgres/dp_func.h"
+
+namespace {
+
+// Bytes currently allocated through operator new, and their high-water mark.
+std::atomic<int64_t> live_bytes(0);
+std::atomic<int64_t> peak_bytes(0);
+
+// Allocations are prefixed with their size so that unsized deletes can
+// account for them.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void* CountedAlloc(size_t size) {
+  char* mem = static_cast<char*>(std::malloc(size + kHeaderSize));
+  if (mem == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>(mem) = size;
+  int64_t live = live_bytes += size;
+  int64_t peak = peak_bytes.load();
+  while (live > peak && !peak_bytes.compare_exchange_weak(peak, live)) {
+  }
+  return mem + kHeaderSize;
+}
+
+void CountedFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  char* mem = static_cast<char*>(ptr) - kHeaderSize;
+  live_bytes -= *reinterpret_cast<size_t*>(mem);
+  std::free(mem);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { CountedFree(ptr); }
+
+namespace {
+
+// Runs one group the way sorted aggregation does: the transition function
+// constructs the state in the aggregate context, the final function extracts
+// it, and resetting the context for the next group destroys it. The reset
+// happens even if the final function fails, e.g. because ten entries are too
+// few to find automatic bounds. Returns false if the state failed to build.
+template <typename DpFunction, typename... Args>
+bool RunGroup(void* aggcontext, Args... args) {
+  std::string err;
+  DpFunction* func = new (aggcontext) DpFunction(&err, args...);
+  bool built = err.empty();
+  for (int i = 0; i < 10; ++i) {
+    func->AddEntry(i);
+  }
+  static_cast<void>(func->Result(&err));
+  static_cast<DpFunc*>(func)->~DpFunc();
+  return built;
+}
+
+// Runs num_groups groups after a warm-up, and expects live heap memory not to
+// grow and its peak to stay within max_peak_growth of the warm-up.
+template <typename DpFunction, typename... Args>
+void ExpectFlatMemory(int num_groups, int64_t max_peak_growth,
+                      Args... args) {
+  alignas(DpFunction) char aggcontext[sizeof(DpFunction)];
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(RunGroup<DpFunction>(aggcontext, args...));
+  }
+  int64_t baseline = live_bytes;
+  peak_bytes = baseline;
+  for (int i = 0; i < num_groups; ++i) {
+    RunGroup<DpFunction>(aggcontext, args...);
+  }
+  EXPECT_EQ(live_bytes - baseline, 0);
+  EXPECT_LE(peak_bytes - baseline, max_peak_growth);
+}
+
+TEST(DpFuncMemoryTest, CountOverMillionGroupsIsFlat) {
+  // The peak is a single group's Count algorithm.
+  ExpectFlatMemory<DpCount>(1000000, 4096, /*default_epsilon=*/false,
+                            /*epsilon=*/1.0);
+}
+
+TEST(DpFuncMemoryTest, AutoBoundedSumIsFlat) {
+  // Automatic bounds keep a histogram of about 64 KiB per group, so a leak
+  // would exceed the bound after a few of the groups. These functions are slow
+  // to build, hence the smaller number of groups.
+  ExpectFlatMemory<DpSum>(200, 256 * 1024, /*default_epsilon=*/false,
+                          /*epsilon=*/1.0);
+}
+
+TEST(DpFuncMemoryTest, BoundedSumOverMillionGroupsIsFlat) {
+  ExpectFlatMemory<DpSum>(1000000, 4096, /*default_epsilon=*/false,
+                          /*epsilon=*/1.0, /*auto_bounds=*/false,
+                          /*lower=*/0.0, /*upper=*/10.0);
+}
+
+}  // namespace
@@ -16,6 +16,8 @@
 
 #include "postgres/dp_func.h"
 
+#include <new>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -56,6 +58,136 @@ TEST(DpCount, BasicTest) {
   EXPECT_TRUE(err.empty());
 }
 
+TEST(DpCount, BatchedEntries) {
+  std::string err;
+  auto func = DpCount(&err, false, 1e9);
+  for (int i = 0; i < 3 * DpFunc::kBatchSize + 1; ++i) {
+    EXPECT_TRUE(func.AddEntry(1));
+  }
+  EXPECT_EQ(func.ResultRounded(&err), 3 * DpFunc::kBatchSize + 1);
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpCount, RemoveEntry) {
+  std::string err;
+  auto func = DpCount(&err, false, 1e9);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(func.AddEntry(1));
+  }
+  EXPECT_TRUE(func.RemoveEntry(1));
+  EXPECT_TRUE(func.RemoveEntry(1));
+  EXPECT_EQ(func.ResultRounded(&err), 8);
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpCount, WindowResultIsRepeatable) {
+  std::string err;
+  auto func = DpCount(&err, false, 1e9);
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_EQ(func.WindowResultRounded(.5, &err), 2);
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_TRUE(func.RemoveEntry(1));
+  EXPECT_TRUE(func.RemoveEntry(1));
+  EXPECT_EQ(func.WindowResultRounded(.5, &err), 1);
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(WindowFrameBudget, SplitsBudgetBetweenFrames) {
+  WindowFrameBudget budget;
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), .25);
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), .25);
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), .25);
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), .25);
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), 0);
+  budget.Reset();
+  EXPECT_EQ(budget.NextFrame(/*max_frames=*/4), .25);
+}
+
+// Frames such as ROWS BETWEEN CURRENT ROW AND CURRENT ROW do not overlap, so
+// Postgres aggregates each of them in a new state. The partition's budget still
+// limits the frames released.
+TEST(WindowFrameBudget, LimitsDisjointFrames) {
+  WindowFrameBudget budget;
+  for (int frame = 0; frame < 5; ++frame) {
+    std::string err;
+    DpCount func(&err, false, 1e9);
+    EXPECT_TRUE(func.AddEntry(1));
+    const int64_t result =
+        func.WindowResultRounded(budget.NextFrame(/*max_frames=*/3), &err);
+    if (frame < 3) {
+      EXPECT_EQ(result, 1);
+      EXPECT_TRUE(err.empty());
+    } else {
+      EXPECT_EQ(err, "Privacy budget for window frames is spent.");
+    }
+  }
+}
+
+TEST(DpSum, RemoveEntryClampsWithManualBounds) {
+  std::string err;
+  auto func = DpSum(&err, false, 1e9, false, 0, 5);
+  EXPECT_TRUE(func.AddEntry(2));
+  EXPECT_TRUE(func.AddEntry(10));
+  EXPECT_TRUE(func.AddEntry(3));
+  EXPECT_TRUE(func.RemoveEntry(10));
+  EXPECT_NEAR(func.WindowResult(.5, &err), 5, 1e-3);
+  EXPECT_TRUE(func.RemoveEntry(2));
+  EXPECT_NEAR(func.WindowResult(.5, &err), 3, 1e-3);
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpSum, RemoveEntryUnsupportedWithAutoBounds) {
+  std::string err;
+  auto func = DpSum(&err);
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_FALSE(func.RemoveEntry(1));
+  static_cast<void>(func.WindowResult(1, &err));
+  EXPECT_EQ(err, "Function does not support moving aggregation.");
+}
+
+TEST(DpCountWithPartitionSelection, BadDelta) {
+  std::string err;
+  auto func = DpCountWithPartitionSelection(&err, 2);
+  EXPECT_EQ(err, "Delta must be in the inclusive interval [0,1], but is 2.");
+  EXPECT_FALSE(func.AddEntry(1));
+}
+
+TEST(DpCountWithPartitionSelection, KeepsLargePartition) {
+  std::string err;
+  auto func = DpCountWithPartitionSelection(&err, 1e-5, 1, false, 10);
+  EXPECT_TRUE(err.empty());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(func.AddEntry(1));
+  }
+  EXPECT_TRUE(func.KeepPartition());
+  static_cast<void>(func.Result(&err));
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpCountWithPartitionSelection, DropsSmallPartition) {
+  std::string err;
+  auto func = DpCountWithPartitionSelection(&err, 1e-10, 1, false, 1);
+  EXPECT_TRUE(err.empty());
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_FALSE(func.KeepPartition());
+}
+
+// A partition with a few users is kept with a probability far from 0 and 1,
+// so resampling the decision would disagree with the first draw.
+TEST(DpCountWithPartitionSelection, KeepPartitionIsDecidedOnce) {
+  std::string err;
+  auto func = DpCountWithPartitionSelection(&err, 0.1, 1, false, 1);
+  EXPECT_TRUE(err.empty());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(func.AddEntry(1));
+  }
+  bool keep = func.KeepPartition();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(func.KeepPartition(), keep);
+  }
+}
+
 TYPED_TEST(BoundedDpFuncTest, BasicTest) {
   std::string err;
   auto func = TypeParam(&err, true, 0, false, 0, 5);
@@ -65,6 +197,17 @@ TYPED_TEST(BoundedDpFuncTest, BasicTest) {
   EXPECT_TRUE(err.empty());
 }
 
+// The extension constructs functions in place inside Postgres memory contexts
+// and destroys them through a DpFunc pointer from a reset callback.
+TYPED_TEST(BoundedDpFuncTest, ConstructInPlace) {
+  alignas(TypeParam) char buffer[sizeof(TypeParam)];
+  std::string err;
+  TypeParam* func = new (buffer) TypeParam(&err, true, 0, false, 0, 5);
+  EXPECT_TRUE(err.empty());
+  EXPECT_TRUE(func->AddEntry(1));
+  static_cast<DpFunc*>(func)->~DpFunc();
+}
+
 TEST(DpNtile, BadPercentile) {
   std::string err;
   auto func = DpNtile(&err, -1, 0, 10);
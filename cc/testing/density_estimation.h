@@ -17,13 +17,17 @@
 #ifndef DIFFERENTIAL_PRIVACY_TESTING_DENSITY_ESTIMATION_H_
 #define DIFFERENTIAL_PRIVACY_TESTING_DENSITY_ESTIMATION_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <numeric>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "base/canonical_errors.h"
 #include "base/status.h"
 
@@ -46,30 +50,74 @@ constexpr char kNewLine[] = "\n";
 //   hist.Add(3);
 //   hist.BinCount(1).ValueOrDie() == 1 // true
 //   hist.BinCount(2).ValueOrDie() == 1 // true
+//
+// Bin indices are computed by multiplying with the reciprocal of the width, so
+// elements within rounding error of a bin boundary may land in either bin.
 template <typename T>
 class Histogram {
  public:
   Histogram(T lowest, double width, int num_bins)
       : lowest_(lowest),
         width_(width),
-        bin_counts_(std::vector<int>(num_bins, 0)) {}
+        inverse_width_(1.0 / width),
+        bin_counts_(std::vector<int64_t>(num_bins, 0)) {}
 
   // Increment the count of the bin into which t falls.
   absl::Status Add(T element) {
-    double index = (element - lowest_) / width_;
-    if (index < 0) {
+    double index = ScaledOffset(element);
+    if (!(index >= 0)) {
       return base::InvalidArgumentError("The element is out of bounds.");
     }
-    if (index >= NumBins() - 1) {
-      ++bin_counts_[NumBins() - 1];
-    } else {
-      ++bin_counts_[static_cast<int>(index)];
+    ++bin_counts_[BinIndex(index)];
+    return absl::OkStatus();
+  }
+
+  // Increments the bin counts for all elements. Returns an error without
+  // adding anything if any element is out of bounds. Elements are processed
+  // in blocks so that the bin indices of a block are computed in a tight loop
+  // the compiler can vectorize, separately from the increments.
+  absl::Status AddAll(absl::Span<const T> elements) {
+    int32_t indices[kBlockSize];
+    for (size_t begin = 0; begin < elements.size(); begin += kBlockSize) {
+      const size_t size = std::min(kBlockSize, elements.size() - begin);
+      const T* block = elements.data() + begin;
+      int32_t num_out_of_bounds = 0;
+      for (size_t i = 0; i < size; ++i) {
+        const double index = ScaledOffset(block[i]);
+        num_out_of_bounds += !(index >= 0);
+        indices[i] = BinIndex(index);
+      }
+      if (num_out_of_bounds > 0) {
+        // Undo the blocks that were already added.
+        for (size_t i = 0; i < begin; ++i) {
+          --bin_counts_[BinIndex(ScaledOffset(elements[i]))];
+        }
+        return base::InvalidArgumentError("An element is out of bounds.");
+      }
+      for (size_t i = 0; i < size; ++i) {
+        ++bin_counts_[indices[i]];
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Adds the counts of other, which must have the same bins, to this
+  // histogram. Allows histograms of disjoint samples to be built on separate
+  // threads and combined afterwards.
+  absl::Status Merge(const Histogram<T>& other) {
+    if (other.lowest_ != lowest_ || other.width_ != width_ ||
+        other.NumBins() != NumBins()) {
+      return base::InvalidArgumentError(
+          "Histograms with different bins cannot be merged.");
+    }
+    for (int i = 0; i < NumBins(); ++i) {
+      bin_counts_[i] += other.bin_counts_[i];
     }
     return absl::OkStatus();
   }
 
   // Number of elements in bin index.
-  base::StatusOr<int> BinCount(int index) const {
+  base::StatusOr<int64_t> BinCount(int index) const {
     if (index < 0 || index >= NumBins()) {
       return base::InvalidArgumentError("Index is out of bounds.");
     }
@@ -80,12 +128,12 @@ class Histogram {
   int NumBins() const { return bin_counts_.size(); }
 
   // Total number of elements in histogram.
-  int Total() const {
-    return std::accumulate(bin_counts_.begin(), bin_counts_.end(), 0);
+  int64_t Total() const {
+    return std::accumulate(bin_counts_.begin(), bin_counts_.end(), int64_t{0});
   }
 
   // Maximum count in any bin.
-  int MaxBinCount() const {
+  int64_t MaxBinCount() const {
     return *std::max_element(bin_counts_.begin(), bin_counts_.end());
   }
 
@@ -102,7 +150,7 @@ class Histogram {
   // Multi-line pretty print of the histogram displaying non-zero bins.
   std::string ToString() const {
     std::string out;
-    int max_count = MaxBinCount();
+    int64_t max_count = MaxBinCount();
     int max_count_len = absl::StrCat(max_count).size();
     int total_length = kPadding + 2 * kBoundSpace + max_count_len +
                        kPercentageSpace + kMaxBinBar;
@@ -133,14 +181,32 @@ class Histogram {
   }
 
  private:
+  // Number of elements whose bin indices AddAll computes at a time.
+  static constexpr size_t kBlockSize = 256;
+
+  // Distance of element from the lowest boundary, in units of the bin width.
+  double ScaledOffset(T element) const {
+    return static_cast<double>(element - lowest_) * inverse_width_;
+  }
+
+  // Index of the bin for a non-negative scaled offset. Offsets past the last
+  // boundary are clamped before the conversion so that it cannot overflow.
+  int32_t BinIndex(double scaled_offset) const {
+    return static_cast<int32_t>(std::max(
+        0.0, std::min(scaled_offset, static_cast<double>(NumBins() - 1))));
+  }
+
   // The lowest bin boundary.
   const T lowest_;
 
   // The width of each bin.
   const double width_;
 
+  // The reciprocal of the width, used to compute bin indices.
+  const double inverse_width_;
+
   // The count in each bin.
-  std::vector<int> bin_counts_;
+  std::vector<int64_t> bin_counts_;
 
   // Convert the ith bin boundary into std::string with the right format.
   std::string BoundToString(int i) const {
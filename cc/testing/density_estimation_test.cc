@@ -17,6 +17,7 @@
 #include "testing/density_estimation.h"
 
 #include <limits>
+#include <vector>
 
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -76,6 +77,67 @@ TYPED_TEST(HistogramTest, SmallInputSet) {
   EXPECT_EQ(hist.MaxBinCount(), 2);
 }
 
+TYPED_TEST(HistogramTest, AddAllMatchesAdd) {
+  std::vector<TypeParam> elements;
+  for (int i = 0; i < 1000; ++i) {
+    elements.push_back(static_cast<TypeParam>(i % 37) - 2);
+  }
+  Histogram<TypeParam> expected(-2, .5, 8);
+  for (const TypeParam& e : elements) {
+    ASSERT_OK(expected.Add(e));
+  }
+  Histogram<TypeParam> hist(-2, .5, 8);
+  ASSERT_OK(hist.AddAll(elements));
+  for (int i = 0; i < hist.NumBins(); ++i) {
+    EXPECT_EQ(hist.BinCount(i).ValueOrDie(),
+              expected.BinCount(i).ValueOrDie());
+  }
+  EXPECT_EQ(hist.Total(), 1000);
+}
+
+TYPED_TEST(HistogramTest, AddAllOutOfBoundsAddsNothing) {
+  Histogram<TypeParam> hist(-2, .5, 8);
+  std::vector<TypeParam> elements = {0, 1, -3, 2};
+  EXPECT_EQ(hist.AddAll(elements).code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(hist.Total(), 0);
+}
+
+TYPED_TEST(HistogramTest, Merge) {
+  Histogram<TypeParam> hist(-2, 2, 3);
+  Histogram<TypeParam> other(-2, 2, 3);
+  EXPECT_OK(hist.Add(-1));
+  EXPECT_OK(hist.Add(0));
+  EXPECT_OK(other.Add(0));
+  EXPECT_OK(other.Add(100));
+  EXPECT_OK(hist.Merge(other));
+  EXPECT_EQ(hist.BinCount(0).ValueOrDie(), 1);
+  EXPECT_EQ(hist.BinCount(1).ValueOrDie(), 2);
+  EXPECT_EQ(hist.BinCount(2).ValueOrDie(), 1);
+  EXPECT_EQ(other.Total(), 2);
+}
+
+TYPED_TEST(HistogramTest, MergeDifferentBins) {
+  Histogram<TypeParam> hist(-2, 2, 3);
+  EXPECT_EQ(hist.Merge(Histogram<TypeParam>(-2, 2, 4)).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(hist.Merge(Histogram<TypeParam>(-2, 1, 3)).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(hist.Merge(Histogram<TypeParam>(0, 2, 3)).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(HistogramTest, AddNan) {
+  Histogram<double> hist(0, 1, 3);
+  EXPECT_EQ(hist.Add(std::numeric_limits<double>::quiet_NaN()).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(HistogramTest, AddInfinity) {
+  Histogram<double> hist(0, 1, 3);
+  EXPECT_OK(hist.Add(std::numeric_limits<double>::infinity()));
+  EXPECT_EQ(hist.BinCount(2).ValueOrDie(), 1);
+}
+
 TEST(HistogramTest, ToStringEmpty) {
   Histogram<double> hist(0, 1.0 / 3.0, 2);
   const std::string expected = absl::StrCat(
@@ -0,0 +1,295 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Defines the caches used by StochasticTester to store the algorithm output
+// samples generated for each subset of a dataset.
+#ifndef DIFFERENTIAL_PRIVACY_TESTING_SAMPLE_CACHE_H_
+#define DIFFERENTIAL_PRIVACY_TESTING_SAMPLE_CACHE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "base/logging.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "base/status.h"
+#include "base/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+
+namespace differential_privacy {
+namespace testing {
+
+template <typename OutputT>
+using AlgorithmResultSamples = std::vector<OutputT>;
+
+using SelectionVector = std::vector<bool>;
+using SelectionVectorAndSizePair = std::pair<SelectionVector, size_t>;
+
+struct SelectionVectorHash {
+  size_t operator()(const SelectionVector& v) const {
+    const std::string serialized_v = absl::StrJoin(v, ".");
+    return absl::Hash<std::string>()(serialized_v);
+  }
+};
+
+// 64-bit FNV-1a hash. Unlike absl::Hash, the result is stable across
+// processes and builds, so it can be used to name persistent cache entries.
+inline uint64_t StableFingerprint(absl::string_view data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : data) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Stores the output samples generated for each subset of a dataset, where a
+// subset is identified by its SelectionVector. Samples are shared rather than
+// copied so that a cache may keep them in memory or drop them as soon as the
+// caller is done with them.
+template <typename OutputT>
+class SampleCache {
+ public:
+  using Samples = AlgorithmResultSamples<base::StatusOr<OutputT>>;
+
+  virtual ~SampleCache() = default;
+
+  // Called before the subsets of a new dataset are searched. dataset_key
+  // identifies the dataset and the tester parameters that affect the samples.
+  virtual void StartDataset(const std::string& dataset_key) = 0;
+
+  // Returns the samples stored for selector, or nullptr if there are none.
+  virtual std::shared_ptr<const Samples> Get(
+      const SelectionVector& selector) = 0;
+
+  // Stores samples for selector and returns a handle to them.
+  virtual std::shared_ptr<const Samples> Put(const SelectionVector& selector,
+                                             Samples samples) = 0;
+};
+
+// Keeps the samples of the current dataset in memory. Memory grows with the
+// number of subsets searched and is released when the next dataset starts.
+template <typename OutputT>
+class InMemorySampleCache : public SampleCache<OutputT> {
+ public:
+  using typename SampleCache<OutputT>::Samples;
+
+  void StartDataset(const std::string& /*dataset_key*/) override {
+    samples_.clear();
+  }
+
+  std::shared_ptr<const Samples> Get(const SelectionVector& selector) override {
+    auto it = samples_.find(selector);
+    return it == samples_.end() ? nullptr : it->second;
+  }
+
+  std::shared_ptr<const Samples> Put(const SelectionVector& selector,
+                                     Samples samples) override {
+    auto shared = std::make_shared<const Samples>(std::move(samples));
+    samples_[selector] = shared;
+    return shared;
+  }
+
+ private:
+  absl::flat_hash_map<SelectionVector, std::shared_ptr<const Samples>,
+                      SelectionVectorHash>
+      samples_;
+};
+
+// Persists samples to one file per subset under a directory, so that repeated
+// runs over the same datasets skip sample generation. Nothing is retained in
+// memory beyond the handles held by the caller. Files are named after
+// algorithm_id, which must describe the algorithm and its parameters (e.g.
+// "bounded_sum_eps1.1_lower-0.5_upper0.5"), the dataset key and the selector.
+// Entries are read through a read-only memory mapping. Unreadable or corrupt
+// entries are treated as missing and regenerated.
+template <typename OutputT>
+class FileSampleCache : public SampleCache<OutputT> {
+ public:
+  using typename SampleCache<OutputT>::Samples;
+
+  FileSampleCache(std::string directory, std::string algorithm_id)
+      : directory_(std::move(directory)),
+        algorithm_id_(std::move(algorithm_id)) {}
+
+  void StartDataset(const std::string& dataset_key) override {
+    dataset_key_ = dataset_key;
+  }
+
+  std::shared_ptr<const Samples> Get(const SelectionVector& selector) override {
+    const std::string path = Path(selector);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+    const size_t size = file_stat.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      return nullptr;
+    }
+    auto samples = std::make_shared<Samples>();
+    bool ok = Decode(
+        absl::string_view(static_cast<const char*>(mapped), size),
+        samples.get());
+    munmap(mapped, size);
+    if (!ok) {
+      LOG(WARNING) << "Ignoring corrupt sample cache entry " << path;
+      return nullptr;
+    }
+    return samples;
+  }
+
+  std::shared_ptr<const Samples> Put(const SelectionVector& selector,
+                                     Samples samples) override {
+    const std::string path = Path(selector);
+    // Write to a temporary file first so that an interrupted run never leaves
+    // a truncated entry behind.
+    const std::string tmp_path = absl::StrCat(path, ".tmp");
+    {
+      std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+      const std::string encoded = Encode(samples);
+      out.write(encoded.data(), encoded.size());
+      if (!out) {
+        LOG(WARNING) << "Failed to write sample cache entry " << path;
+      }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      std::remove(tmp_path.c_str());
+    }
+    return std::make_shared<const Samples>(std::move(samples));
+  }
+
+ private:
+  static_assert(std::is_arithmetic<OutputT>::value,
+                "FileSampleCache only supports arithmetic outputs.");
+
+  static constexpr uint32_t kMagic = 0x43535044;  // "DPSC"
+
+  std::string Path(const SelectionVector& selector) const {
+    std::string bits;
+    bits.reserve(selector.size());
+    for (const bool b : selector) {
+      bits.push_back(b ? '1' : '0');
+    }
+    return absl::StrCat(directory_, "/", algorithm_id_, "-", dataset_key_, "-",
+                        bits, ".samples");
+  }
+
+  template <typename V>
+  static void Append(const V& value, std::string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(V));
+  }
+
+  template <typename V>
+  static bool Consume(absl::string_view* in, V* value) {
+    if (in->size() < sizeof(V)) {
+      return false;
+    }
+    std::memcpy(value, in->data(), sizeof(V));
+    in->remove_prefix(sizeof(V));
+    return true;
+  }
+
+  // Layout: magic, sample count, then per sample a status code followed by
+  // either the value or the error message length and bytes.
+  static std::string Encode(const Samples& samples) {
+    std::string out;
+    out.reserve(sizeof(kMagic) + sizeof(uint64_t) +
+                samples.size() * (sizeof(int32_t) + sizeof(OutputT)));
+    Append(kMagic, &out);
+    Append(static_cast<uint64_t>(samples.size()), &out);
+    for (const base::StatusOr<OutputT>& sample : samples) {
+      Append(static_cast<int32_t>(sample.status().code()), &out);
+      if (sample.ok()) {
+        Append(sample.ValueOrDie(), &out);
+      } else {
+        const absl::string_view message = sample.status().message();
+        Append(static_cast<uint32_t>(message.size()), &out);
+        out.append(message.data(), message.size());
+      }
+    }
+    return out;
+  }
+
+  static bool Decode(absl::string_view in, Samples* samples) {
+    uint32_t magic;
+    uint64_t num_samples;
+    if (!Consume(&in, &magic) || magic != kMagic ||
+        !Consume(&in, &num_samples)) {
+      return false;
+    }
+    // Every sample takes at least its status code and either its value or its
+    // message length, so a corrupt count cannot reserve more samples than the
+    // entry can hold.
+    constexpr size_t kMinSampleSize =
+        sizeof(int32_t) + std::min(sizeof(OutputT), sizeof(uint32_t));
+    if (num_samples > in.size() / kMinSampleSize) {
+      return false;
+    }
+    samples->reserve(num_samples);
+    for (uint64_t i = 0; i < num_samples; ++i) {
+      int32_t code;
+      if (!Consume(&in, &code)) {
+        return false;
+      }
+      if (code == static_cast<int32_t>(base::StatusCode::kOk)) {
+        OutputT value;
+        if (!Consume(&in, &value)) {
+          return false;
+        }
+        samples->push_back(value);
+      } else {
+        uint32_t length;
+        if (!Consume(&in, &length) || in.size() < length) {
+          return false;
+        }
+        samples->push_back(base::Status(static_cast<base::StatusCode>(code),
+                                        in.substr(0, length)));
+        in.remove_prefix(length);
+      }
+    }
+    return in.empty();
+  }
+
+  std::string directory_;
+  std::string algorithm_id_;
+  std::string dataset_key_;
+};
+
+}  // namespace testing
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_TESTING_SAMPLE_CACHE_H_
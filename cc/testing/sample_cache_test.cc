@@ -0,0 +1,148 @@
+//
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "testing/sample_cache.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "base/status.h"
+#include "base/statusor.h"
+#include "absl/strings/str_cat.h"
+
+namespace differential_privacy {
+namespace testing {
+namespace {
+
+template <typename T>
+class SampleCacheTest : public ::testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(SampleCacheTest, NumericTypes);
+
+template <typename T>
+std::string TypeSuffix() {
+  return std::is_integral<T>::value ? "_int" : "_double";
+}
+
+template <typename T>
+AlgorithmResultSamples<base::StatusOr<T>> TestSamples() {
+  AlgorithmResultSamples<base::StatusOr<T>> samples;
+  samples.push_back(T(1));
+  samples.push_back(base::InvalidArgumentError("bad input"));
+  samples.push_back(T(-3));
+  return samples;
+}
+
+template <typename T>
+void ExpectTestSamples(
+    const AlgorithmResultSamples<base::StatusOr<T>>& samples) {
+  ASSERT_EQ(samples.size(), 3);
+  EXPECT_EQ(samples[0].ValueOrDie(), 1);
+  EXPECT_EQ(samples[1].status().code(), base::StatusCode::kInvalidArgument);
+  EXPECT_EQ(samples[1].status().message(), "bad input");
+  EXPECT_EQ(samples[2].ValueOrDie(), -3);
+}
+
+TYPED_TEST(SampleCacheTest, InMemoryGetAndPut) {
+  InMemorySampleCache<TypeParam> cache;
+  SelectionVector selector = {true, false, true};
+  cache.StartDataset("dataset");
+  EXPECT_EQ(cache.Get(selector), nullptr);
+  cache.Put(selector, TestSamples<TypeParam>());
+  ExpectTestSamples<TypeParam>(*cache.Get(selector));
+  EXPECT_EQ(cache.Get({true, true, true}), nullptr);
+
+  // Samples are dropped when the next dataset starts.
+  cache.StartDataset("other_dataset");
+  EXPECT_EQ(cache.Get(selector), nullptr);
+}
+
+TYPED_TEST(SampleCacheTest, FilePersistsAcrossInstances) {
+  SelectionVector selector = {true, false, true};
+  const std::string algorithm_id =
+      absl::StrCat("persist", TypeSuffix<TypeParam>());
+  {
+    FileSampleCache<TypeParam> cache(::testing::TempDir(), algorithm_id);
+    cache.StartDataset("dataset");
+    ExpectTestSamples<TypeParam>(
+        *cache.Put(selector, TestSamples<TypeParam>()));
+  }
+  FileSampleCache<TypeParam> cache(::testing::TempDir(), algorithm_id);
+  cache.StartDataset("dataset");
+  ExpectTestSamples<TypeParam>(*cache.Get(selector));
+  EXPECT_EQ(cache.Get({true, true, true}), nullptr);
+
+  // Entries are keyed by the dataset and the algorithm.
+  cache.StartDataset("other_dataset");
+  EXPECT_EQ(cache.Get(selector), nullptr);
+  FileSampleCache<TypeParam> other_algorithm(::testing::TempDir(),
+                                             algorithm_id + "_other");
+  other_algorithm.StartDataset("dataset");
+  EXPECT_EQ(other_algorithm.Get(selector), nullptr);
+}
+
+TYPED_TEST(SampleCacheTest, FileIgnoresCorruptEntries) {
+  SelectionVector selector = {true};
+  const std::string algorithm_id =
+      absl::StrCat("corrupt", TypeSuffix<TypeParam>());
+  FileSampleCache<TypeParam> cache(::testing::TempDir(), algorithm_id);
+  cache.StartDataset("dataset");
+  {
+    std::ofstream out(absl::StrCat(::testing::TempDir(), "/", algorithm_id,
+                                   "-dataset-1.samples"),
+                      std::ios::binary | std::ios::trunc);
+    out << "not a sample file";
+  }
+  EXPECT_EQ(cache.Get(selector), nullptr);
+}
+
+TYPED_TEST(SampleCacheTest, FileIgnoresCorruptSampleCount) {
+  SelectionVector selector = {true};
+  const std::string algorithm_id =
+      absl::StrCat("corrupt_count", TypeSuffix<TypeParam>());
+  FileSampleCache<TypeParam> cache(::testing::TempDir(), algorithm_id);
+  cache.StartDataset("dataset");
+  {
+    std::ofstream out(absl::StrCat(::testing::TempDir(), "/", algorithm_id,
+                                   "-dataset-1.samples"),
+                      std::ios::binary | std::ios::trunc);
+    const uint32_t magic = 0x43535044;
+    const uint64_t num_samples = uint64_t{1} << 60;
+    const int32_t code = 0;
+    const TypeParam value = 1;
+    out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    out.write(reinterpret_cast<const char*>(&num_samples), sizeof(num_samples));
+    out.write(reinterpret_cast<const char*>(&code), sizeof(code));
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  EXPECT_EQ(cache.Get(selector), nullptr);
+}
+
+TEST(SampleCacheTest, StableFingerprint) {
+  EXPECT_EQ(StableFingerprint(""), 14695981039346656037ull);
+  EXPECT_EQ(StableFingerprint("a"), 0xaf63dc4c8601ec8cull);
+  EXPECT_NE(StableFingerprint("ab"), StableFingerprint("ba"));
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace differential_privacy
@@ -18,12 +18,14 @@
 #define DIFFERENTIAL_PRIVACY_TESTING_SEQUENCE_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "base/logging.h"
 #include "absl/memory/memory.h"
 #include "absl/random/distributions.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
 namespace testing {
@@ -36,6 +38,16 @@ class Sequence {
  public:
   virtual std::vector<T> GetSample() = 0;
 
+  // Returns the next `n` samples.
+  virtual std::vector<std::vector<T>> GetSamples(int64_t n) {
+    std::vector<std::vector<T>> samples;
+    samples.reserve(n);
+    for (int64_t i = 0; i < n; ++i) {
+      samples.push_back(GetSample());
+    }
+    return samples;
+  }
+
   // Returns the dimensions of the next `n` samples.
   virtual std::vector<int64_t> NextNDimensions(int n) = 0;
 
@@ -125,10 +137,16 @@ static const std::vector<int>& GetFirstPrimes() {
 }
 
 // Halton sequence generator using only one of the first 12 primes.
+//
+// Values can be computed independently with Get(i), or in order with Next(),
+// which keeps the base 'base_' digits of the current index and advances them
+// with a carry instead of recomputing them by division. Both return exactly
+// the same values.
 class Halton {
  public:
   explicit Halton(const int base) : base_(base) {
     CHECK(std::count(GetFirstPrimes().begin(), GetFirstPrimes().end(), base));
+    Seek(1);
   }
 
   // Returns the i'th value in the Halton sequence. Time complexity is
@@ -137,17 +155,85 @@ class Halton {
     CHECK_GT(i, 0);
     const double ib = 1.0 / base_;  // ib = inverted base
     double cdb = ib;                // cdb = current digit base = ib ^ position
-    double h = 0;
-    // Iterate through the base 'base_' digits of 'i'.
+    // Collect the base 'base_' digits of 'i' and their weights. An int has at
+    // most 31 binary digits.
+    int digits[32];
+    double weights[32];
+    int num_digits = 0;
     for (; i > 0; i /= base_) {
-      h += (i % base_) * cdb;
+      digits[num_digits] = i % base_;
+      weights[num_digits++] = cdb;
       cdb *= ib;
     }
+    // Sum the smallest terms first, which is also the order Next() uses.
+    double h = 0;
+    for (int k = num_digits - 1; k >= 0; --k) {
+      h += digits[k] * weights[k];
+    }
+    return h;
+  }
+
+  // Positions the generator so that the next call to Next() returns Get(i).
+  void Seek(int64_t i) {
+    CHECK_GT(i, 0);
+    digits_.clear();
+    for (; i > 0; i /= base_) {
+      digits_.push_back(i % base_);
+    }
+    while (weights_.size() < digits_.size()) {
+      AddWeight();
+    }
+    UpdateHighSum();
+  }
+
+  // Returns the value at the current index and advances to the next index.
+  // Only every base_'th call carries into the higher digits, so on average a
+  // call costs O(1).
+  double Next() {
+    const double h = high_sum_ + digits_[0] * weights_[0];
+    if (digits_[0] < base_ - 1) {
+      ++digits_[0];
+      return h;
+    }
+    int k = 0;
+    for (; k < digits_.size() && digits_[k] == base_ - 1; ++k) {
+      digits_[k] = 0;
+    }
+    if (k == digits_.size()) {
+      digits_.push_back(0);
+      AddWeight();
+    }
+    ++digits_[k];
+    UpdateHighSum();
     return h;
   }
 
  private:
+  // Appends the weight of the next digit position, computed as in Get().
+  void AddWeight() {
+    const double ib = 1.0 / base_;
+    weights_.push_back(weights_.empty() ? ib : weights_.back() * ib);
+  }
+
+  // Sums the terms of all but the lowest digit, in the same order and with
+  // the same weights as Get(), so that Next() and Get() agree exactly.
+  void UpdateHighSum() {
+    high_sum_ = 0;
+    for (int k = digits_.size() - 1; k >= 1; --k) {
+      high_sum_ += digits_[k] * weights_[k];
+    }
+  }
+
   int base_;
+
+  // The sum of the terms of all digits of the current index but the lowest.
+  double high_sum_ = 0;
+
+  // The base 'base_' digits of the current index, least significant first.
+  std::vector<int> digits_;
+
+  // weights_[k] is the value of a one in the k'th digit of the inverse.
+  std::vector<double> weights_;
 };
 
 // Low-discrepancy sequence: generates a determinisitic sequence of uniform
@@ -190,30 +276,59 @@ class HaltonSequence : public HypercubeSequence<T> {
   }
   std::vector<T> GetSample() override {
     std::vector<T> result(HypercubeSequence<T>::dimension_);
+    GetSample(absl::MakeSpan(result));
+    return result;
+  }
+
+  // Writes the next sample into the caller-provided sample, which must have
+  // one element per dimension. Does not allocate.
+  void GetSample(absl::Span<T> sample) {
+    CHECK_EQ(sample.size(), HypercubeSequence<T>::dimension_);
     do {
       for (int i = 0; i < HypercubeSequence<T>::dimension_; ++i) {
-        result[i] = HypercubeSequence<T>::scale_ *
-                        halton_generators_[i]->Get(current_index_) +
-                    HypercubeSequence<T>::shift_;
+        sample[i] =
+            HypercubeSequence<T>::scale_ * halton_generators_[i].Next() +
+            HypercubeSequence<T>::shift_;
       }
       ++current_index_;
-    } while (sorted_only_ && !std::is_sorted(result.begin(), result.end()));
-    return result;
+    } while (sorted_only_ && !std::is_sorted(sample.begin(), sample.end()));
+  }
+
+  std::vector<std::vector<T>> GetSamples(int64_t n) override {
+    std::vector<std::vector<T>> samples(
+        n, std::vector<T>(HypercubeSequence<T>::dimension_));
+    for (std::vector<T>& sample : samples) {
+      GetSample(absl::MakeSpan(sample));
+    }
+    return samples;
+  }
+
+  // Writes the next samples into the caller-provided buffer, one after the
+  // other. The size of samples must be a multiple of the dimension.
+  void GetSamples(absl::Span<T> samples) {
+    const int64_t dimension = HypercubeSequence<T>::dimension_;
+    CHECK_EQ(samples.size() % dimension, 0);
+    for (int64_t begin = 0; begin < samples.size(); begin += dimension) {
+      GetSample(samples.subspan(begin, dimension));
+    }
   }
 
   HaltonSequence() = delete;
   ~HaltonSequence() override = default;
 
  private:
-  std::vector<std::unique_ptr<Halton>> halton_generators_;
+  // Each generator is positioned at current_index_.
+  std::vector<Halton> halton_generators_;
   int64_t current_index_;
   bool sorted_only_;
 
   void InitializeHaltonGenerators(const std::vector<int>& bases) {
     CHECK(HypercubeSequence<T>::dimension_ == bases.size());
-    halton_generators_.resize(bases.size());
-    std::transform(bases.begin(), bases.end(), halton_generators_.begin(),
-                   [](int b) { return absl::make_unique<Halton>(b); });
+    halton_generators_.reserve(bases.size());
+    for (int b : bases) {
+      halton_generators_.emplace_back(b);
+      halton_generators_.back().Seek(current_index_);
+    }
   }
 };
 
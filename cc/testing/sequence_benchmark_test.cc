@@ -0,0 +1,71 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmark/benchmark.h"
+#include "testing/sequence.h"
+
+namespace differential_privacy {
+namespace testing {
+namespace {
+
+constexpr int64_t kNumSamples = 10000;
+
+// Generates samples by computing every coordinate independently with
+// Halton::Get, as HaltonSequence used to.
+void BM_HaltonGet(benchmark::State& state) {
+  const int64_t dimension = state.range(0);
+  std::vector<Halton> generators;
+  for (int64_t i = 0; i < dimension; ++i) {
+    generators.emplace_back(GetFirstPrimes()[i]);
+  }
+  std::vector<double> sample(dimension);
+  for (auto _ : state) {
+    for (int64_t index = 1; index <= kNumSamples; ++index) {
+      for (int64_t i = 0; i < dimension; ++i) {
+        sample[i] = generators[i].Get(index);
+      }
+      benchmark::DoNotOptimize(sample.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_HaltonGet)->Arg(1)->Arg(6)->Arg(12);
+
+void BM_HaltonSequenceGetSample(benchmark::State& state) {
+  for (auto _ : state) {
+    HaltonSequence<double> sequence(state.range(0));
+    for (int64_t i = 0; i < kNumSamples; ++i) {
+      benchmark::DoNotOptimize(sequence.GetSample());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_HaltonSequenceGetSample)->Arg(1)->Arg(6)->Arg(12);
+
+void BM_HaltonSequenceGetSamplesIntoBuffer(benchmark::State& state) {
+  std::vector<double> samples(state.range(0) * kNumSamples);
+  for (auto _ : state) {
+    HaltonSequence<double> sequence(state.range(0));
+    sequence.GetSamples(absl::MakeSpan(samples));
+    benchmark::DoNotOptimize(samples.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_HaltonSequenceGetSamplesIntoBuffer)->Arg(1)->Arg(6)->Arg(12);
+
+}  // namespace
+}  // namespace testing
+}  // namespace differential_privacy
@@ -127,6 +127,65 @@ TEST(HaltonTest, Base2) {
   }
 }
 
+TEST(HaltonTest, NextMatchesGet) {
+  for (int base : GetFirstPrimes()) {
+    Halton h(base);
+    for (int i = 1; i < 10000; ++i) {
+      ASSERT_EQ(h.Next(), h.Get(i)) << "base " << base << ", index " << i;
+    }
+  }
+}
+
+TEST(HaltonTest, SeekRepositionsNext) {
+  Halton h(3);
+  h.Seek(12345);
+  EXPECT_EQ(h.Next(), h.Get(12345));
+  EXPECT_EQ(h.Next(), h.Get(12346));
+  h.Seek(1);
+  EXPECT_EQ(h.Next(), h.Get(1));
+}
+
+TEST(HaltonSequenceTest, GetSampleIntoBufferMatchesGetSample) {
+  HaltonSequence<double> expected_sequence(kDimensions);
+  HaltonSequence<double> sequence(kDimensions);
+  std::vector<double> sample(kDimensions);
+  for (int i = 0; i < 100; ++i) {
+    sequence.GetSample(absl::MakeSpan(sample));
+    EXPECT_EQ(sample, expected_sequence.GetSample());
+  }
+}
+
+TEST(HaltonSequenceTest, GetSamplesMatchesGetSample) {
+  HaltonSequence<double> expected_sequence(3, /*sorted_only=*/true);
+  HaltonSequence<double> sequence(3, /*sorted_only=*/true);
+  const std::vector<std::vector<double>> samples = sequence.GetSamples(20);
+  ASSERT_EQ(samples.size(), 20);
+  for (const std::vector<double>& sample : samples) {
+    EXPECT_TRUE(std::is_sorted(sample.begin(), sample.end()));
+    EXPECT_EQ(sample, expected_sequence.GetSample());
+  }
+}
+
+TEST(HaltonSequenceTest, GetSamplesIntoBufferMatchesGetSample) {
+  HaltonSequence<int64_t> expected_sequence(3, /*sorted_only=*/false,
+                                            /*scale=*/100, /*shift=*/-50);
+  HaltonSequence<int64_t> sequence(3, /*sorted_only=*/false, /*scale=*/100,
+                                   /*shift=*/-50);
+  std::vector<int64_t> samples(3 * 50);
+  sequence.GetSamples(absl::MakeSpan(samples));
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(std::vector<int64_t>(samples.begin() + 3 * i,
+                                   samples.begin() + 3 * (i + 1)),
+              expected_sequence.GetSample());
+  }
+}
+
+TEST(StoredSequenceTest, GetSamples) {
+  StoredSequence<double> sequence({{1.0}, {1.0, 2.0}});
+  const std::vector<std::vector<double>> expected = {{1.0}, {1.0, 2.0}, {1.0}};
+  EXPECT_EQ(sequence.GetSamples(3), expected);
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace differential_privacy
@@ -18,20 +18,32 @@
 #ifndef DIFFERENTIAL_PRIVACY_TESTING_STOCHASTIC_TESTER_H_
 #define DIFFERENTIAL_PRIVACY_TESTING_STOCHASTIC_TESTER_H_
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iomanip>
+#include <iterator>
+#include <memory>
+#include <numeric>
 #include <stack>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "base/logging.h"
-#include "absl/container/flat_hash_map.h"
-#include "absl/hash/hash.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "testing/density_estimation.h"
+#include "testing/sample_cache.h"
 #include "testing/sequence.h"
 
 namespace differential_privacy {
@@ -53,11 +65,101 @@ constexpr double MinimumIntegralBinWidth() { return 1.0; }
 constexpr int MinimumBinCountCombined() { return 2; }
 constexpr int MinimumBinCountSingle() { return 1; }
 
-template <typename OutputT>
-using AlgorithmResultSamples = std::vector<OutputT>;
+// Configures sequential testing, in which the samples for each pair of
+// neighbouring datasets are generated in stages of growing size instead of all
+// at once. After each stage the histograms are compared, and the comparison
+// stops early once the confidence bounds show that the pair violates the DP
+// predicate, or that it would satisfy the predicate with the full number of
+// samples. Pairs that are not decided early are compared on the full number of
+// samples exactly as without sequential testing, so an algorithm that is tight
+// against its epsilon is still tested with the same power.
+struct SequentialTestingOptions {
+  // Number of samples per histogram in the first stage. Sequential testing is
+  // disabled if this is 0 or not smaller than the full number of samples.
+  int64_t initial_num_samples = 0;
+
+  // Factor by which the number of samples grows from one stage to the next.
+  // The last stage always uses the full number of samples.
+  double growth_factor = 4.0;
+};
+
+// A fixed set of threads that runs a task for workers 1 to num_threads, with
+// worker 0 being the calling thread. The threads are created once and wait for
+// tasks between runs, so running a task does not create or join threads.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads) {
+    for (int worker = 1; worker <= num_threads; ++worker) {
+      threads_.emplace_back([this, worker]() { Work(worker); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      absl::MutexLock lock(&mutex_);
+      shutdown_ = true;
+    }
+    task_ready_.SignalAll();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Calls task(worker) once for every worker, and returns when all calls have
+  // finished.
+  void Run(const std::function<void(int)>& task) {
+    {
+      absl::MutexLock lock(&mutex_);
+      task_ = &task;
+      ++generation_;
+      num_running_ = threads_.size();
+    }
+    task_ready_.SignalAll();
+    task(0);
+    absl::MutexLock lock(&mutex_);
+    while (num_running_ > 0) {
+      task_done_.Wait(&mutex_);
+    }
+    task_ = nullptr;
+  }
+
+ private:
+  void Work(int worker) {
+    uint64_t last_generation = 0;
+    while (true) {
+      const std::function<void(int)>* task;
+      {
+        absl::MutexLock lock(&mutex_);
+        while (!shutdown_ && generation_ == last_generation) {
+          task_ready_.Wait(&mutex_);
+        }
+        if (shutdown_) {
+          return;
+        }
+        last_generation = generation_;
+        task = task_;
+      }
+      (*task)(worker);
+      absl::MutexLock lock(&mutex_);
+      if (--num_running_ == 0) {
+        task_done_.Signal();
+      }
+    }
+  }
 
-using SelectionVector = std::vector<bool>;
-using SelectionVectorAndSizePair = std::pair<SelectionVector, size_t>;
+  std::vector<std::thread> threads_;
+  absl::Mutex mutex_;
+  absl::CondVar task_ready_;
+  absl::CondVar task_done_;
+  // The task of the current run, which is numbered by generation_.
+  const std::function<void(int)>* task_ = nullptr;
+  uint64_t generation_ = 0;
+  int num_running_ = 0;
+  bool shutdown_ = false;
+};
 
 // A test framework that tries to prove that an algorithm is not differentially
 // private on a number of datasets. The general approach is to generate datasets
@@ -79,21 +181,67 @@ class StochasticTester;
 template <typename T, typename OutputT>
 class StochasticTester<T, OutputT> {
  public:
+  // Creates a new algorithm instance to be owned by a single worker thread.
+  using AlgorithmFactory = std::function<std::unique_ptr<Algorithm<T>>()>;
+
   StochasticTester(
       std::unique_ptr<Algorithm<T>> algorithm,
       std::unique_ptr<Sequence<T>> sequence,
       int64_t num_datasets = DefaultNumDatasetsToTest(),
       int64_t num_samples_per_histogram = DefaultNumSamplesPerHistogram(),
-      bool disable_search_branching = false)
-      : algorithm_(std::move(algorithm)),
-        sequence_(std::move(sequence)),
+      bool disable_search_branching = false,
+      SequentialTestingOptions sequential_options = SequentialTestingOptions())
+      : sequence_(std::move(sequence)),
         num_datasets_(num_datasets),
         num_samples_per_histogram_(num_samples_per_histogram),
+        stage_num_samples_(
+            StageNumSamples(num_samples_per_histogram, sequential_options)),
         disable_search_branching_(disable_search_branching),
-        max_violation_pct_(0.0) {}
+        max_violation_pct_(0.0),
+        sample_cache_(absl::make_unique<InMemorySampleCache<OutputT>>()) {
+    algorithms_.push_back(std::move(algorithm));
+    sample_buffers_.resize(1);
+  }
+
+  // Generates samples and compares histograms on num_threads threads. The
+  // threads are created once, with the tester, and each owns one algorithm
+  // instance from algorithm_factory and one sample buffer, which are reused for
+  // every run. Instances are created up front in thread order and every thread
+  // is always handed the same range of sample indices, so the output is
+  // reproducible whenever the factory produces deterministically seeded
+  // algorithms.
+  StochasticTester(
+      AlgorithmFactory algorithm_factory, std::unique_ptr<Sequence<T>> sequence,
+      int64_t num_datasets = DefaultNumDatasetsToTest(),
+      int64_t num_samples_per_histogram = DefaultNumSamplesPerHistogram(),
+      bool disable_search_branching = false, int num_threads = 1,
+      SequentialTestingOptions sequential_options = SequentialTestingOptions())
+      : sequence_(std::move(sequence)),
+        num_datasets_(num_datasets),
+        num_samples_per_histogram_(num_samples_per_histogram),
+        stage_num_samples_(
+            StageNumSamples(num_samples_per_histogram, sequential_options)),
+        disable_search_branching_(disable_search_branching),
+        max_violation_pct_(0.0),
+        sample_cache_(absl::make_unique<InMemorySampleCache<OutputT>>()) {
+    for (int i = 0; i < std::max(num_threads, 1); ++i) {
+      algorithms_.push_back(algorithm_factory());
+    }
+    sample_buffers_.resize(algorithms_.size());
+    if (num_threads > 1) {
+      worker_pool_ = absl::make_unique<WorkerPool>(num_threads - 1);
+    }
+  }
+
+  // Replaces the default in-memory cache of generated samples, e.g. with a
+  // FileSampleCache to bound memory usage and reuse samples across runs.
+  void SetSampleCache(std::unique_ptr<SampleCache<OutputT>> sample_cache) {
+    sample_cache_ = std::move(sample_cache);
+  }
 
   bool Run() {
     Reset();
+    const absl::Time start = absl::Now();
 
     // For each dataset, check each member of its powerset for whether it
     // satisfies the dp predicate and record it in class variables. If too
@@ -106,25 +254,39 @@ class StochasticTester<T, OutputT> {
         LOG(INFO)
             << "More than " << kHistogramPaddingAlpha
             << " of comparisons failed so the algorithm is likely not DP.";
+        LogWallTime(start);
         return false;
       }
     }
 
     LOG(INFO) << "Across all datasets, proportion of comparisons failed: "
               << num_comparison_failures_ << " / " << num_comparison_;
+    if (stage_num_samples_.size() > 1) {
+      LOG(INFO) << absl::StrCat(
+          "Sequential testing decided ", num_early_decisions_,
+          " comparison(s) early and generated ", num_samples_generated_,
+          " sample(s).");
+    }
     LOG(INFO) << absl::StrCat(
         "Tested DP over ", num_datasets_,
         " dataset(s). (Maximum violation %: ", max_violation_pct_ * 100, ")");
+    LogWallTime(start);
     return true;
   }
 
+  // Number of samples generated by the last call to Run(), not counting
+  // samples that were found in the sample cache. With sequential testing this
+  // is less than the number needed to compare every pair on the full number
+  // of samples.
+  int64_t NumSamplesGenerated() const { return num_samples_generated_; }
+
+  // Number of comparisons in the last call to Run() that sequential testing
+  // decided before reaching the full number of samples.
+  int64_t NumEarlyDecisions() const { return num_early_decisions_; }
+
  private:
-  struct SelectionVectorHash {
-    size_t operator()(const SelectionVector& v) const {
-      const std::string serialized_v = absl::StrJoin(v, ".");
-      return absl::Hash<std::string>()(serialized_v);
-    }
-  };
+  // Outcome of comparing the histograms of two sets of samples.
+  enum class PredicateOutcome { kPass, kFail, kUndecided };
 
   struct HistogramOptions {
     OutputT lowest;
@@ -161,10 +323,16 @@ class StochasticTester<T, OutputT> {
   // Checks both directions of the DP predicate. This generates histograms based
   // on the samples passed in and compares them based on the DP predicate.
   // We allow for some amount of error that arises from the histogram
-  // approximation, thus this still returns true in cases where the predicate
+  // approximation, thus this still passes in cases where the predicate
   // is violated within error bounds.
-  bool CheckDpPredicate(const std::vector<base::StatusOr<OutputT>>& dx_samples,
-                        const std::vector<base::StatusOr<OutputT>>& dy_samples);
+  // The confidence level is divided between the stages of sequential testing.
+  // In the final stage, or without sequential testing, the outcome is either
+  // kPass or kFail. In earlier stages it is kUndecided unless the pair fails or
+  // the bounds show that the histograms on the full number of samples would
+  // pass.
+  PredicateOutcome CheckDpPredicate(
+      absl::Span<const base::StatusOr<OutputT>> dx_samples,
+      absl::Span<const base::StatusOr<OutputT>> dy_samples, bool final_stage);
 
   // We need to check that all combinations of the input dataset of size 1 to N
   // obey the differential privacy predicate with all datasets that are a
@@ -187,30 +355,70 @@ class StochasticTester<T, OutputT> {
   std::vector<SelectionVectorAndSizePair> GenerateSuccessors(
       const SelectionVector& selector, size_t succ_selector_size) const;
 
-  // Runs the DP algorithm over a dataset. In our case, the containers are
-  // based on itertools iterators which do not necessarily have size functions,
-  // so we provide that interface here.
+  // Runs the DP algorithm num_samples times over a dataset. Each worker fills
+  // its own buffer, which keeps its capacity between calls, and the buffers
+  // are then moved into the result in worker order.
   template <typename Container>
   std::vector<base::StatusOr<OutputT>> GenerateSamples(Container* c,
-                                                       size_t size) {
-    std::vector<base::StatusOr<OutputT>> samples(num_samples_per_histogram_);
-    for (int i = 0; i < num_samples_per_histogram_; ++i) {
-      base::StatusOr<Output> output = algorithm_->Result(c->begin(), c->end());
-
-      // Algorithms such as ApproxBounds may return an error status rather than
-      // a value for some datasets on some occasions. In this case we wish to
-      // keep testing the dataset instead of throwing it out, treating the error
-      // status as a regular value, to be substituted during histogram
-      // generation.
-      if (output.ok()) {
-        samples[i] = GetValue<OutputT>(output.ValueOrDie());
-      } else {
-        samples[i] = output.status();
-      }
+                                                       int64_t num_samples) {
+    ParallelFor(num_samples,
+                [&](int worker, int64_t begin, int64_t end) {
+                  Algorithm<T>* algorithm = algorithms_[worker].get();
+                  std::vector<base::StatusOr<OutputT>>& buffer =
+                      sample_buffers_[worker];
+                  for (int64_t i = begin; i < end; ++i) {
+                    base::StatusOr<Output> output =
+                        algorithm->Result(c->begin(), c->end());
+
+                    // Algorithms such as ApproxBounds may return an error
+                    // status rather than a value for some datasets on some
+                    // occasions. In this case we wish to keep testing the
+                    // dataset instead of throwing it out, treating the error
+                    // status as a regular value, to be substituted during
+                    // histogram generation.
+                    if (output.ok()) {
+                      buffer.push_back(GetValue<OutputT>(output.ValueOrDie()));
+                    } else {
+                      buffer.push_back(output.status());
+                    }
+                  }
+                });
+    std::vector<base::StatusOr<OutputT>> samples;
+    samples.reserve(num_samples);
+    for (std::vector<base::StatusOr<OutputT>>& buffer : sample_buffers_) {
+      std::move(buffer.begin(), buffer.end(), std::back_inserter(samples));
+      buffer.clear();
     }
     return samples;
   }
 
+  // Splits [0, n) into one contiguous range per worker and calls
+  // fn(worker, begin, end) for each non-empty range. Worker 0 runs on the
+  // calling thread, the others on the threads of the worker pool.
+  template <typename Fn>
+  void ParallelFor(int64_t n, const Fn& fn) {
+    const int num_workers = algorithms_.size();
+    const int64_t chunk = (n + num_workers - 1) / num_workers;
+    auto run_range = [&](int worker) {
+      const int64_t begin = std::min(n, worker * chunk);
+      const int64_t end = std::min(n, begin + chunk);
+      if (begin < end) {
+        fn(worker, begin, end);
+      }
+    };
+    if (worker_pool_ == nullptr) {
+      run_range(0);
+    } else {
+      worker_pool_->Run(run_range);
+    }
+  }
+
+  void LogWallTime(absl::Time start) const {
+    LOG(INFO) << absl::StrCat("Wall time: ",
+                              absl::FormatDuration(absl::Now() - start),
+                              " on ", algorithms_.size(), " thread(s).");
+  }
+
   std::vector<T> GenerateDataset() { return sequence_->GetSample(); }
 
   // Utility function to check a value's relation to boundary_min and
@@ -232,15 +440,34 @@ class StochasticTester<T, OutputT> {
     }
     double absolute_violation = value - boundary_min;
     double boundary_size = boundary_max - boundary_min;
+    absl::MutexLock lock(&mutex_);
     max_violation_pct_ =
         std::max(max_violation_pct_, absolute_violation / boundary_size);
     return value > boundary_max;
   }
 
+  // Returns the number of samples per histogram in each stage of sequential
+  // testing, ending with the full number of samples.
+  static std::vector<int64_t> StageNumSamples(
+      int64_t num_samples_per_histogram,
+      const SequentialTestingOptions& options) {
+    std::vector<int64_t> stages;
+    double num_samples = options.initial_num_samples;
+    while (num_samples >= 1 && num_samples < num_samples_per_histogram &&
+           (stages.empty() || num_samples > stages.back())) {
+      stages.push_back(static_cast<int64_t>(num_samples));
+      num_samples *= options.growth_factor;
+    }
+    stages.push_back(num_samples_per_histogram);
+    return stages;
+  }
+
   void Reset() {
     max_violation_pct_ = 0.0;
     num_comparison_failures_ = 0;
     num_comparison_ = 0;
+    num_samples_generated_ = 0;
+    num_early_decisions_ = 0;
     for (const int64_t d : sequence_->NextNDimensions(num_datasets_)) {
       // Without search branching, each subsequence only has 1 child.
       //
@@ -256,17 +483,28 @@ class StochasticTester<T, OutputT> {
   // Replace all samples that were output error to this error value. Populate
   // the value_samples vectors with replaced values.
   void ReplaceErrorWithValue(
-      const std::vector<base::StatusOr<OutputT>>& dx_samples,
-      const std::vector<base::StatusOr<OutputT>>& dy_samples,
+      absl::Span<const base::StatusOr<OutputT>> dx_samples,
+      absl::Span<const base::StatusOr<OutputT>> dy_samples,
       std::vector<OutputT>* dx_value_samples,
       std::vector<OutputT>* dy_value_samples);
 
-  std::unique_ptr<Algorithm<T>> algorithm_;
+  // One algorithm instance per worker thread.
+  std::vector<std::unique_ptr<Algorithm<T>>> algorithms_;
+  // One buffer of generated samples per worker, reused by GenerateSamples.
+  std::vector<std::vector<base::StatusOr<OutputT>>> sample_buffers_;
+  // Runs workers 1 and up when there is more than one. Declared after the
+  // algorithms so that its threads are joined before the algorithms are
+  // destroyed.
+  std::unique_ptr<WorkerPool> worker_pool_;
   std::unique_ptr<Sequence<T>> sequence_;
 
   int64_t num_datasets_;
   int64_t num_samples_per_histogram_;
 
+  // Number of samples per histogram in each stage of sequential testing. Holds
+  // only num_samples_per_histogram_ when sequential testing is disabled.
+  std::vector<int64_t> stage_num_samples_;
+
   // This allows control on the amount of the search space to explore by
   // restricting the number of successors generated to 1.
   // It is mainly used to test algorithms that do not depend on the values of
@@ -279,6 +517,13 @@ class StochasticTester<T, OutputT> {
   // allowed to exceed the requirement by our error bounds.
   double max_violation_pct_;
 
+  // Stores the samples generated for each subset of the dataset under test.
+  std::unique_ptr<SampleCache<OutputT>> sample_cache_;
+
+  // Guards max_violation_pct_ and keeps violation logs from interleaving when
+  // histogram comparisons run concurrently.
+  absl::Mutex mutex_;
+
   // From Wasserman's All of Nonparametric Statistics, p.130.
   // This is the maximum probability that we get a false negative in any given
   // histograms comparison. 0.05 is chosen arbitrarily.
@@ -289,6 +534,10 @@ class StochasticTester<T, OutputT> {
   // fail.
   int64_t num_comparison_ = 0;
   int64_t num_comparison_failures_ = 0;
+
+  // Reported by NumSamplesGenerated() and NumEarlyDecisions().
+  int64_t num_samples_generated_ = 0;
+  int64_t num_early_decisions_ = 0;
 };
 
 template <typename T, typename OutputT>
@@ -363,8 +612,8 @@ StochasticTester<T, OutputT>::ComputeCombinedHistogramOptions(
 
 template <typename T, typename OutputT>
 void StochasticTester<T, OutputT>::ReplaceErrorWithValue(
-    const std::vector<base::StatusOr<OutputT>>& dx_samples,
-    const std::vector<base::StatusOr<OutputT>>& dy_samples,
+    absl::Span<const base::StatusOr<OutputT>> dx_samples,
+    absl::Span<const base::StatusOr<OutputT>> dy_samples,
     std::vector<OutputT>* dx_value_samples,
     std::vector<OutputT>* dy_value_samples) {
   // Find the minimum and bin width without error outputs to heuristically chose
@@ -409,10 +658,11 @@ void StochasticTester<T, OutputT>::ReplaceErrorWithValue(
 }
 
 template <typename T, typename OutputT>
-bool StochasticTester<T, OutputT>::CheckDpPredicate(
-    const std::vector<base::StatusOr<OutputT>>& dx_samples,
-    const std::vector<base::StatusOr<OutputT>>& dy_samples) {
-  double epsilon = algorithm_->GetEpsilon();
+typename StochasticTester<T, OutputT>::PredicateOutcome
+StochasticTester<T, OutputT>::CheckDpPredicate(
+    absl::Span<const base::StatusOr<OutputT>> dx_samples,
+    absl::Span<const base::StatusOr<OutputT>> dy_samples, bool final_stage) {
+  double epsilon = algorithms_[0]->GetEpsilon();
 
   // Handle error outputs by replacing them with a default error value. We must
   // replace error values first and include them in the analysis to create the
@@ -425,22 +675,16 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
   const HistogramOptions options =
       ComputeCombinedHistogramOptions(dx_value_samples, dy_value_samples);
 
-  // Note that the Histogram class expects double types to be passed into the
-  // Add function.  We allow implicit casting here from the templated type
-  // where the only non floating point type is an integral type.  The only
-  // concern here is if the integral type is large, then the cast to double
-  // will lose precision.  In our use cases, the numbers will generally be
-  // small and far from this point.
+  // Note that the Histogram class computes bin indices in double precision.
+  // The only non floating point type is an integral type, and if it is large,
+  // then the cast to double will lose precision.  In our use cases, the
+  // numbers will generally be small and far from this point.
   Histogram<OutputT> dx_hist(options.lowest, options.bin_width,
                              options.num_bins);
-  for (const OutputT& e : dx_value_samples) {
-    CHECK(dx_hist.Add(e).ok());
-  }
+  CHECK(dx_hist.AddAll(dx_value_samples).ok());
   Histogram<OutputT> dy_hist(options.lowest, options.bin_width,
                              options.num_bins);
-  for (const OutputT& e : dy_value_samples) {
-    CHECK(dy_hist.Add(e).ok());
-  }
+  CHECK(dy_hist.AddAll(dy_value_samples).ok());
 
   // The total number of actual buckets within the bounds is 1 fewer,
   // because there is an extra bucket on the upper extreme to consider values
@@ -453,7 +697,9 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
   // confidence interval bounds.
   // c = z_{\alpha/(2m)} * \sqrt{m / n} / 2, where m is the number of bins and
   // n is the number of samples. We choose a 95% confidence interval here,
-  // therefore alpha is set to 0.05.
+  // therefore alpha is set to 0.05. All stages of sequential testing, the
+  // final one included, share this alpha equally, so that the bounds of every
+  // stage hold with 95% confidence together.
   // This is used to generate an upper bound for each of the histograms.
   // Note that although these intervals are implicitly identical because the
   // number of samples for each set of samples is enforced to be the same in
@@ -461,8 +707,9 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
   // therefore compute an interval for each.
   double dx_size = static_cast<double>(dx_samples.size());
   double dy_size = static_cast<double>(dy_samples.size());
+  const double alpha = kHistogramPaddingAlpha / stage_num_samples_.size();
   double critical_value =
-      Qnorm(1 - (kHistogramPaddingAlpha / 2 / actual_num_buckets), /*mu=*/0.0,
+      Qnorm(1 - (alpha / 2 / actual_num_buckets), /*mu=*/0.0,
             /*sigma=*/1.0)
           .ValueOrDie();
   double dx_error_interval =
@@ -509,7 +756,9 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
     // We only report that the predicate is not satisfied if it also exceeds
     // the confidence bounds.
     if (bound_exceeded) {
+      absl::MutexLock lock(&mutex_);
       LOG(INFO) << "Violation found on histograms ============================";
+      LOG(INFO) << absl::StrCat("Samples per histogram: ", dx_samples.size());
       LOG(INFO) << dx_hist.ToString();
       LOG(INFO) << dy_hist.ToString();
       LOG(INFO) << absl::StrCat(
@@ -548,21 +797,94 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
       LOG(INFO) << absl::StrCat("Bounds exceeded by (>100%): ",
                                 max_violation_pct_);
       LOG(INFO) << " ";
-      return false;
+      return PredicateOutcome::kFail;
     }
   }
-  return true;
+  if (final_stage) {
+    return PredicateOutcome::kPass;
+  }
+
+  // The full comparison fails on a bin only if, in terms of the square roots
+  // of the bin functions f used by the error intervals above,
+  // \sqrt{f_x} - e^{\epsilon / 2} \sqrt{f_y} exceeds
+  // c_N (1 + e^{\epsilon / 2}), where c_N is the error interval for the full
+  // number of samples, which the final stage computes with the same critical
+  // value. We decide that the pair passes if the upper confidence bound of this
+  // difference in the current stage is below that margin for every bin and both
+  // directions.
+  const double exp_half_epsilon = exp(epsilon / 2);
+  const double full_margin =
+      critical_value *
+      sqrt(actual_num_buckets /
+           static_cast<double>(num_samples_per_histogram_)) /
+      2 * (1 + exp_half_epsilon);
+  for (int i = 0; i < options.num_bins; ++i) {
+    double sqrt_fx =
+        sqrt(dx_hist.BinCount(i).ValueOrDie() / dx_size * actual_num_buckets);
+    double sqrt_fy =
+        sqrt(dy_hist.BinCount(i).ValueOrDie() / dy_size * actual_num_buckets);
+    double x_over_y_upper_bound =
+        sqrt_fx + dx_error_interval -
+        exp_half_epsilon * std::max(0.0, sqrt_fy - dy_error_interval);
+    double y_over_x_upper_bound =
+        sqrt_fy + dy_error_interval -
+        exp_half_epsilon * std::max(0.0, sqrt_fx - dx_error_interval);
+    if (x_over_y_upper_bound > full_margin ||
+        y_over_x_upper_bound > full_margin) {
+      return PredicateOutcome::kUndecided;
+    }
+  }
+  return PredicateOutcome::kPass;
 }
 
 template <typename T, typename OutputT>
 void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
     const std::vector<T>& dataset) {
-  absl::flat_hash_map<SelectionVector,
-                      AlgorithmResultSamples<base::StatusOr<OutputT>>,
-                      SelectionVectorHash>
-      sample_cache;
+  using Samples = typename SampleCache<OutputT>::Samples;
+
+  // The cache key covers everything the samples depend on besides the
+  // algorithm itself, which the cache is responsible for identifying.
+  sample_cache_->StartDataset(absl::StrCat(
+      absl::Hex(StableFingerprint(absl::string_view(
+          reinterpret_cast<const char*>(dataset.data()),
+          dataset.size() * sizeof(T)))),
+      "-n", num_samples_per_histogram_));
+
+  // Subsets already expanded in the search, independent of what the cache
+  // holds from previous runs.
+  absl::flat_hash_set<SelectionVector, SelectionVectorHash> visited;
+
+  // Reused across subsets to avoid reallocating for every one of them.
+  std::vector<T> subset;
+  subset.reserve(dataset.size());
+  // Returns at least num_samples samples for the subset, generating only those
+  // that are not cached yet. Samples are always extended, never replaced, so
+  // every stage of sequential testing compares prefixes of the same samples.
+  auto get_or_generate_samples = [&](const SelectionVector& selector,
+                                     int64_t num_samples) {
+    std::shared_ptr<const Samples> samples = sample_cache_->Get(selector);
+    const int64_t num_cached = samples == nullptr ? 0 : samples->size();
+    if (num_cached < num_samples) {
+      subset.clear();
+      for (int i = 0; i < selector.size(); ++i) {
+        if (selector[i]) {
+          subset.push_back(dataset[i]);
+        }
+      }
+      Samples new_samples = GenerateSamples(&subset, num_samples - num_cached);
+      num_samples_generated_ += new_samples.size();
+      if (samples != nullptr) {
+        new_samples.insert(new_samples.begin(), samples->begin(),
+                           samples->end());
+      }
+      samples = sample_cache_->Put(selector, std::move(new_samples));
+    }
+    return samples;
+  };
+
   SelectionVector full_set_selector(dataset.size(), true);
-  sample_cache[full_set_selector] = GenerateSamples(&dataset, dataset.size());
+  visited.insert(full_set_selector);
+  get_or_generate_samples(full_set_selector, stage_num_samples_.front());
 
   std::stack<SelectionVectorAndSizePair> dfs;
   dfs.push(std::make_pair(full_set_selector, dataset.size()));
@@ -573,23 +895,67 @@ void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
 
     std::vector<SelectionVectorAndSizePair> successors =
         GenerateSuccessors(current_selector, current_size - 1);
-    for (const auto& succ_pair : successors) {
-      const SelectionVector& succ_selector = succ_pair.first;
-      size_t succ_size = succ_pair.second;
-      bool is_new_succ = !sample_cache.contains(succ_selector);
-
-      // Generate successor samples if they don't exist.
-      if (is_new_succ) {
-        std::vector<T> subset;
-        for (int i = 0; i < succ_selector.size(); ++i) {
-          if (succ_selector[i]) {
-            subset.push_back(dataset[i]);
-          }
+    if (successors.empty()) {
+      continue;
+    }
+
+    std::vector<bool> is_new_succ(successors.size());
+    for (int s = 0; s < successors.size(); ++s) {
+      is_new_succ[s] = visited.insert(successors[s].first).second;
+    }
+
+    // Compare the current subset with each successor in stages of growing
+    // sample counts until every comparison is decided. Without sequential
+    // testing there is a single stage with the full number of samples.
+    // In each stage, samples for all undecided successors are fetched or
+    // generated first, so that the histogram comparisons can run concurrently.
+    // The handles are released after the comparisons, so caches that do not
+    // retain samples keep only one search node in memory at a time.
+    std::vector<char> passed(successors.size());
+    std::vector<int> undecided(successors.size());
+    std::iota(undecided.begin(), undecided.end(), 0);
+    std::vector<std::shared_ptr<const Samples>> succ_samples(
+        successors.size());
+    for (int stage = 0; stage < stage_num_samples_.size() && !undecided.empty();
+         ++stage) {
+      const int64_t num_samples = stage_num_samples_[stage];
+      const bool final_stage = stage + 1 == stage_num_samples_.size();
+      for (const int s : undecided) {
+        succ_samples[s] =
+            get_or_generate_samples(successors[s].first, num_samples);
+      }
+      std::shared_ptr<const Samples> current_samples =
+          get_or_generate_samples(current_selector, num_samples);
+
+      std::vector<PredicateOutcome> outcomes(undecided.size());
+      ParallelFor(undecided.size(), [&](int, int64_t begin, int64_t end) {
+        for (int64_t u = begin; u < end; ++u) {
+          outcomes[u] = CheckDpPredicate(
+              absl::MakeConstSpan(*current_samples).first(num_samples),
+              absl::MakeConstSpan(*succ_samples[undecided[u]])
+                  .first(num_samples),
+              final_stage);
+        }
+      });
+
+      std::vector<int> still_undecided;
+      for (int u = 0; u < undecided.size(); ++u) {
+        if (outcomes[u] == PredicateOutcome::kUndecided) {
+          still_undecided.push_back(undecided[u]);
+          continue;
+        }
+        passed[undecided[u]] = outcomes[u] == PredicateOutcome::kPass;
+        succ_samples[undecided[u]] = nullptr;
+        if (!final_stage) {
+          ++num_early_decisions_;
         }
-        sample_cache[succ_selector] = GenerateSamples(&subset, succ_size);
       }
-      if (!CheckDpPredicate(sample_cache[current_selector],
-                            sample_cache[succ_selector])) {
+      undecided.swap(still_undecided);
+    }
+
+    for (int s = 0; s < successors.size(); ++s) {
+      const SelectionVector& succ_selector = successors[s].first;
+      if (!passed[s]) {
         LOG(INFO) << "Fails DP on: ";
         std::vector<T> c_current = VectorFilter(dataset, current_selector);
         LOG(INFO) << std::setprecision(16) << VectorToString(c_current);
@@ -600,8 +966,8 @@ void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
 
       // Only include successors with non-empty subsets and have not been
       // visited.
-      if (current_size > 0 && is_new_succ) {
-        dfs.push(succ_pair);
+      if (current_size > 0 && is_new_succ[s]) {
+        dfs.push(successors[s]);
       }
     }
   }
@@ -16,11 +16,19 @@
 
 #include "testing/stochastic_tester.h"
 
+#include <dirent.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <string>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/random/distributions.h"
+#include "absl/strings/str_cat.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/bounded-sum.h"
@@ -34,6 +42,28 @@ namespace differential_privacy {
 namespace testing {
 namespace {
 
+// Owns the seeded random sources that the algorithms of a test draw their
+// noise from, so that the tests are fast and reproducible. Each algorithm gets
+// its own source, since the tester samples its algorithms on separate threads.
+// Must outlive the algorithms.
+class SeededRandomSources {
+ public:
+  RandomSource* Next() {
+    sources_.push_back(
+        absl::make_unique<test_utils::SeededRandomSource>(sources_.size()));
+    return sources_.back().get();
+  }
+
+  std::unique_ptr<LaplaceMechanism::Builder> LaplaceBuilder() {
+    auto builder = absl::make_unique<LaplaceMechanism::Builder>();
+    builder->SetRandomSource(Next());
+    return builder;
+  }
+
+ private:
+  std::vector<std::unique_ptr<test_utils::SeededRandomSource>> sources_;
+};
+
 // Trivial non-DP sum that returns the exact value determinisitically.
 template <typename T,
           typename std::enable_if<std::is_integral<T>::value ||
@@ -100,6 +130,21 @@ class BoundedSumWithInsufficientNoise : public BoundedSum<T> {
   double GetEpsilon() const override { return Algorithm<T>::GetEpsilon() / 2; }
 };
 
+// A version of Count where Epsilon() is overridden to report four times the
+// actual epsilon value, so we have an algorithm that provides considerably
+// stronger privacy guarantees than it claims.
+template <typename T>
+class CountWithExcessNoise : public Count<T> {
+ public:
+  CountWithExcessNoise(double epsilon, RandomSource* random)
+      : Count<T>(epsilon, LaplaceMechanism::Builder()
+                              .SetEpsilon(epsilon)
+                              .SetRandomSource(random)
+                              .Build()
+                              .ValueOrDie()) {}
+  double GetEpsilon() const override { return Algorithm<T>::GetEpsilon() * 4; }
+};
+
 // BoundedSum but it returns a error status with a fixed probability.
 template <typename T,
           typename std::enable_if<std::is_integral<T>::value ||
@@ -112,7 +157,7 @@ class BoundedSumWithError : public BoundedSum<T> {
       : BoundedSum<T>(epsilon, lower, upper, 1, 1, builder->Clone(), nullptr,
                       nullptr),
         mechanism_(absl::WrapUnique(dynamic_cast<LaplaceMechanism*>(
-            builder->Build().ValueOrDie().release()))) {}
+            builder->SetEpsilon(epsilon).Build().ValueOrDie().release()))) {}
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
@@ -172,13 +217,13 @@ class AlwaysError : public Algorithm<T> {
 };
 
 TEST(StochasticTesterTest, SingleDatasetBoundedSumTest) {
+  SeededRandomSources sources;
   auto sequence = absl::make_unique<HaltonSequence<double>>(
       DefaultDatasetSize(), true /* sorted_only */, DefaultDataScale(),
       DefaultDataOffset());
   auto algorithm =
       BoundedSum<double>::Builder()
-          .SetLaplaceMechanism(
-              absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+          .SetLaplaceMechanism(sources.LaplaceBuilder())
           .SetEpsilon(std::log(3))
           .SetLower(sequence->RangeMin())
           .SetUpper(sequence->RangeMax())
@@ -202,12 +247,12 @@ TEST(StochasticTesterTest, SingleDatasetNonDpSumTest) {
 }
 
 TEST(StochasticTesterTest, SingleDatasetCountTest) {
+  SeededRandomSources sources;
   std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
   auto sequence = absl::make_unique<StoredSequence<double>>(datasets);
   std::unique_ptr<Count<double>> algorithm =
       Count<double>::Builder()
-          .SetLaplaceMechanism(
-              absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+          .SetLaplaceMechanism(sources.LaplaceBuilder())
           .SetEpsilon(std::log(3))
           .Build()
           .ValueOrDie();
@@ -228,12 +273,12 @@ TEST(StochasticTesterTest, SingleDatasetNonDpCountTest) {
 }
 
 TEST(StochasticTesterTest, SingleDatasetCountNoBranchingTest) {
+  SeededRandomSources sources;
   std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
   auto sequence = absl::make_unique<StoredSequence<double>>(datasets);
   std::unique_ptr<Count<double>> algorithm =
       Count<double>::Builder()
-          .SetLaplaceMechanism(
-              absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+          .SetLaplaceMechanism(sources.LaplaceBuilder())
           .SetEpsilon(std::log(3))
           .Build()
           .ValueOrDie();
@@ -256,13 +301,13 @@ TEST(StochasticTesterTest, SingleDatasetNonDpCountNoBranchingTest) {
 }
 
 TEST(StochasticTesterTest, MultipleDatasetBoundedSumTest) {
+  SeededRandomSources sources;
   auto sequence = absl::make_unique<HaltonSequence<double>>(
       DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
       DefaultDataOffset());
   auto algorithm =
       BoundedSum<double>::Builder()
-          .SetLaplaceMechanism(
-              absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+          .SetLaplaceMechanism(sources.LaplaceBuilder())
           .SetEpsilon(std::log(3))
           .SetLower(sequence->RangeMin())
           .SetUpper(sequence->RangeMax())
@@ -274,23 +319,25 @@ TEST(StochasticTesterTest, MultipleDatasetBoundedSumTest) {
 }
 
 TEST(StochasticTesterTest, MultipleDatasetBoundedSumWithInsufficientNoiseTest) {
+  SeededRandomSources sources;
   auto sequence = absl::make_unique<HaltonSequence<double>>(
       DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
       DefaultDataOffset());
   auto algorithm = absl::make_unique<BoundedSumWithInsufficientNoise<double>>(
       std::log(3), sequence->RangeMin(), sequence->RangeMax(),
-      absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>());
+      sources.LaplaceBuilder());
   StochasticTester<double> tester(std::move(algorithm), std::move(sequence));
   EXPECT_FALSE(tester.Run());
 }
 
 TEST(StochasticTesterTest, ReplaceErrorWithValue) {
+  SeededRandomSources sources;
   auto sequence = absl::make_unique<HaltonSequence<double>>(
       DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
       DefaultDataOffset());
   auto algorithm = absl::make_unique<BoundedSumWithError<double>>(
       std::log(3), sequence->RangeMin(), sequence->RangeMax(),
-      absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>());
+      sources.LaplaceBuilder());
   StochasticTester<double> tester(std::move(algorithm), std::move(sequence));
   EXPECT_TRUE(tester.Run());
 }
@@ -315,6 +362,181 @@ TEST(StochasticTesterTest, AllError) {
   EXPECT_TRUE(tester.Run());
 }
 
+TEST(StochasticTesterTest, MultipleThreadsCountTest) {
+  SeededRandomSources sources;
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  auto sequence = absl::make_unique<StoredSequence<double>>(datasets);
+  auto factory = [&sources]() -> std::unique_ptr<Algorithm<double>> {
+    return Count<double>::Builder()
+        .SetLaplaceMechanism(sources.LaplaceBuilder())
+        .SetEpsilon(std::log(3))
+        .Build()
+        .ValueOrDie();
+  };
+  StochasticTester<double, int64_t> tester(
+      factory, std::move(sequence), /*num_datasets=*/1,
+      DefaultNumSamplesPerHistogram(), /*disable_search_branching=*/false,
+      /*num_threads=*/4);
+  EXPECT_TRUE(tester.Run());
+  // Later runs reuse the worker threads and their sample buffers.
+  EXPECT_TRUE(tester.Run());
+}
+
+TEST(StochasticTesterTest, MultipleThreadsNonDpSumTest) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  auto factory = []() -> std::unique_ptr<Algorithm<double>> {
+    return absl::make_unique<NonDpSum<double>>();
+  };
+  StochasticTester<double> tester(factory, std::move(sequence),
+                                  /*num_datasets=*/1,
+                                  DefaultNumSamplesPerHistogram(),
+                                  /*disable_search_branching=*/false,
+                                  /*num_threads=*/4);
+  EXPECT_FALSE(tester.Run());
+}
+
+TEST(StochasticTesterTest, FileSampleCacheReusesSamples) {
+  SeededRandomSources sources;
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  auto make_count = [&sources]() {
+    return Count<double>::Builder()
+        .SetLaplaceMechanism(sources.LaplaceBuilder())
+        .SetEpsilon(std::log(3))
+        .Build()
+        .ValueOrDie();
+  };
+  StochasticTester<double, int64_t> tester(
+      make_count(), absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram());
+  tester.SetSampleCache(absl::make_unique<FileSampleCache<int64_t>>(
+      ::testing::TempDir(), "count_eps_log3"));
+  EXPECT_TRUE(tester.Run());
+
+  // The second run reads every subset's samples from disk, so an algorithm
+  // that is not DP still passes.
+  StochasticTester<double, int64_t> cached_tester(
+      absl::make_unique<NonDpCount<double>>(),
+      absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram());
+  cached_tester.SetSampleCache(absl::make_unique<FileSampleCache<int64_t>>(
+      ::testing::TempDir(), "count_eps_log3"));
+  EXPECT_TRUE(cached_tester.Run());
+}
+
+// Calls fn with the path of every cache entry of the algorithm in the test's
+// temporary directory, and returns the number of entries.
+int ForEachCacheEntry(const std::string& algorithm_id,
+                      const std::function<void(const std::string&)>& fn) {
+  DIR* dir = opendir(::testing::TempDir().c_str());
+  if (dir == nullptr) {
+    return 0;
+  }
+  int num_entries = 0;
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.rfind(algorithm_id + "-", 0) == 0) {
+      fn(absl::StrCat(::testing::TempDir(), "/", name));
+      ++num_entries;
+    }
+  }
+  closedir(dir);
+  return num_entries;
+}
+
+// Overwrites the sample count in the header of a cache entry with one that is
+// far larger than the entry.
+void CorruptSampleCount(const std::string& path) {
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  const uint64_t num_samples = uint64_t{1} << 60;
+  file.seekp(sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(&num_samples), sizeof(num_samples));
+  EXPECT_TRUE(file.good()) << path;
+}
+
+TEST(StochasticTesterTest, FileSampleCacheRegeneratesCorruptEntries) {
+  SeededRandomSources sources;
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  // Entries left by earlier runs hold the samples of the algorithm that is not
+  // DP.
+  ForEachCacheEntry("count_corrupt_header", [](const std::string& path) {
+    std::remove(path.c_str());
+  });
+  StochasticTester<double, int64_t> tester(
+      absl::make_unique<CountWithExcessNoise<double>>(std::log(3),
+                                                      sources.Next()),
+      absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram());
+  tester.SetSampleCache(absl::make_unique<FileSampleCache<int64_t>>(
+      ::testing::TempDir(), "count_corrupt_header"));
+  EXPECT_TRUE(tester.Run());
+  EXPECT_GT(ForEachCacheEntry("count_corrupt_header", CorruptSampleCount), 0);
+
+  // Corrupt entries are treated as missing, so the samples of all 8 subsets
+  // are generated again, and the algorithm that is not DP is caught.
+  StochasticTester<double, int64_t> regenerating_tester(
+      absl::make_unique<NonDpCount<double>>(),
+      absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram());
+  regenerating_tester.SetSampleCache(
+      absl::make_unique<FileSampleCache<int64_t>>(::testing::TempDir(),
+                                                  "count_corrupt_header"));
+  EXPECT_FALSE(regenerating_tester.Run());
+  EXPECT_GT(regenerating_tester.NumSamplesGenerated(), 0);
+}
+
+TEST(StochasticTesterTest, SequentialTestingPassesEarly) {
+  SeededRandomSources sources;
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  SequentialTestingOptions sequential_options;
+  sequential_options.initial_num_samples = DefaultNumSamplesPerHistogram() / 16;
+  StochasticTester<double, int64_t> tester(
+      absl::make_unique<CountWithExcessNoise<double>>(std::log(3),
+                                                      sources.Next()),
+      absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram(),
+      /*disable_search_branching=*/false, sequential_options);
+  EXPECT_TRUE(tester.Run());
+  EXPECT_GT(tester.NumEarlyDecisions(), 0);
+  // Without sequential testing, each of the 8 subsets would get the full
+  // number of samples.
+  EXPECT_LT(tester.NumSamplesGenerated(), 8 * DefaultNumSamplesPerHistogram());
+}
+
+TEST(StochasticTesterTest, SequentialTestingFailsEarly) {
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  SequentialTestingOptions sequential_options;
+  sequential_options.initial_num_samples = DefaultNumSamplesPerHistogram() / 16;
+  StochasticTester<double, int64_t> tester(
+      absl::make_unique<NonDpCount<double>>(),
+      absl::make_unique<StoredSequence<double>>(datasets),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram(),
+      /*disable_search_branching=*/false, sequential_options);
+  EXPECT_FALSE(tester.Run());
+  EXPECT_GT(tester.NumEarlyDecisions(), 0);
+  EXPECT_LT(tester.NumSamplesGenerated(), 8 * DefaultNumSamplesPerHistogram());
+}
+
+TEST(StochasticTesterTest,
+     SequentialTestingMultipleDatasetBoundedSumWithInsufficientNoiseTest) {
+  SeededRandomSources sources;
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  auto algorithm = absl::make_unique<BoundedSumWithInsufficientNoise<double>>(
+      std::log(3), sequence->RangeMin(), sequence->RangeMax(),
+      sources.LaplaceBuilder());
+  SequentialTestingOptions sequential_options;
+  sequential_options.initial_num_samples = DefaultNumSamplesPerHistogram() / 16;
+  StochasticTester<double> tester(std::move(algorithm), std::move(sequence),
+                                  DefaultNumDatasetsToTest(),
+                                  DefaultNumSamplesPerHistogram(),
+                                  /*disable_search_branching=*/false,
+                                  sequential_options);
+  EXPECT_FALSE(tester.Run());
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace differential_privacy
@@ -16,49 +16,177 @@
 
 #include "animals_and_carrots.h"
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "base/logging.h"
 #include "base/statusor.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/numbers.h"
-#include "absl/strings/str_split.h"
+#include "algorithms/algorithm.h"
 #include "algorithms/bounded-mean.h"
 #include "algorithms/bounded-sum.h"
 #include "algorithms/count.h"
 #include "algorithms/order-statistics.h"
+#include "algorithms/util.h"
 
 namespace differential_privacy {
 namespace example {
+namespace {
+
+// Rows are fed to the algorithms in blocks of this size so that each block is
+// still in cache while every query consumes it.
+constexpr int64_t kBlockSize = 4096;
+
+// Splits [0, n) into num_workers contiguous ranges and calls
+// fn(worker, begin, end) for each of them. Worker 0 runs on the calling thread.
+template <typename Fn>
+void ParallelFor(int num_workers, int64_t n, const Fn& fn) {
+  const int64_t chunk = (n + num_workers - 1) / num_workers;
+  std::vector<std::thread> threads;
+  for (int worker = 1; worker < num_workers; ++worker) {
+    const int64_t begin = std::min(n, worker * chunk);
+    const int64_t end = std::min(n, begin + chunk);
+    threads.emplace_back(fn, worker, begin, end);
+  }
+  fn(0, 0, std::min(n, chunk));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
 
-CarrotReporter::CarrotReporter(std::string data_filename, double epsilon)
-    : epsilon_(epsilon) {
-  std::ifstream file(data_filename);
-  CHECK(file.is_open()) << "could not open file " << data_filename;
-  std::string line;
-  while (getline(file, line)) {
-    std::vector<std::string> animal_and_count = absl::StrSplit(line, ',');
-    CHECK_EQ(animal_and_count.size(), 2);
+// Moves begin forward to the first character of a line, unless it already is.
+int64_t AlignToLine(absl::string_view data, int64_t begin) {
+  if (begin == 0 || begin >= static_cast<int64_t>(data.size())) {
+    return std::min<int64_t>(begin, data.size());
+  }
+  if (data[begin - 1] == '\n') {
+    return begin;
+  }
+  const size_t newline = data.find('\n', begin);
+  return newline == absl::string_view::npos ? data.size() : newline + 1;
+}
+
+// Parses the "animal,count" lines in data, appending to animals and carrots.
+void ParseLines(absl::string_view data, std::vector<absl::string_view>* animals,
+                std::vector<int>* carrots) {
+  while (!data.empty()) {
+    size_t newline = data.find('\n');
+    if (newline == absl::string_view::npos) {
+      newline = data.size();
+    }
+    const absl::string_view line = data.substr(0, newline);
+    data.remove_prefix(std::min(newline + 1, data.size()));
+    if (line.empty()) {
+      continue;
+    }
+    const size_t comma = line.find(',');
+    CHECK_NE(comma, absl::string_view::npos) << "malformed line: " << line;
     int count;
-    CHECK(absl::SimpleAtoi(animal_and_count[1], &count));
-    carrots_per_animal_[animal_and_count[0]] = count;
+    CHECK(absl::SimpleAtoi(line.substr(comma + 1), &count))
+        << "malformed line: " << line;
+    animals->push_back(line.substr(0, comma));
+    carrots->push_back(count);
+  }
+}
+
+}  // namespace
+
+CarrotReporter::CarrotReporter(std::string data_filename, double epsilon,
+                               int num_threads)
+    : epsilon_(epsilon),
+      num_threads_(std::max(1, num_threads)),
+      privacy_budget_(PrivacyAccountant::Builder()
+                          .SetEpsilon(epsilon)
+                          .Build()
+                          .ValueOrDie()) {
+  const int fd = open(data_filename.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "could not open file " << data_filename;
+  struct stat file_stat;
+  CHECK_EQ(fstat(fd, &file_stat), 0) << "could not stat file " << data_filename;
+  data_size_ = file_stat.st_size;
+  if (data_size_ > 0) {
+    void* mapped = mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(mapped != MAP_FAILED) << "could not map file " << data_filename;
+    data_ = static_cast<const char*>(mapped);
+  }
+  close(fd);
+
+  // Each worker parses the lines that start in its byte range into its own
+  // columns, which are then concatenated in file order.
+  const absl::string_view data(data_, data_size_);
+  std::vector<std::vector<absl::string_view>> animals(num_threads_);
+  std::vector<std::vector<int>> carrots(num_threads_);
+  ParallelFor(num_threads_, data_size_,
+              [&](int worker, int64_t begin, int64_t end) {
+                begin = AlignToLine(data, begin);
+                end = AlignToLine(data, end);
+                if (begin < end) {
+                  ParseLines(data.substr(begin, end - begin), &animals[worker],
+                             &carrots[worker]);
+                }
+              });
+  size_t num_rows = 0;
+  for (const std::vector<int>& chunk : carrots) {
+    num_rows += chunk.size();
+  }
+  animals_.reserve(num_rows);
+  carrots_.reserve(num_rows);
+  for (int worker = 0; worker < num_threads_; ++worker) {
+    animals_.insert(animals_.end(), animals[worker].begin(),
+                    animals[worker].end());
+    carrots_.insert(carrots_.end(), carrots[worker].begin(),
+                    carrots[worker].end());
+  }
+
+  // Each animal contributes a single count: a later row of an animal replaces
+  // its earlier ones, keeping the position of the first.
+  absl::flat_hash_map<absl::string_view, size_t> row_of_animal;
+  row_of_animal.reserve(animals_.size());
+  size_t num_animals = 0;
+  for (size_t row = 0; row < animals_.size(); ++row) {
+    const auto inserted = row_of_animal.try_emplace(animals_[row], num_animals);
+    if (inserted.second) {
+      animals_[num_animals] = animals_[row];
+      carrots_[num_animals] = carrots_[row];
+      ++num_animals;
+    } else {
+      carrots_[inserted.first->second] = carrots_[row];
+    }
+  }
+  animals_.resize(num_animals);
+  carrots_.resize(num_animals);
+}
+
+CarrotReporter::~CarrotReporter() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), data_size_);
   }
 }
 
 int CarrotReporter::Sum() {
   int sum = 0;
-  for (const auto& pair : carrots_per_animal_) {
-    sum += pair.second;
+  for (const int count : carrots_) {
+    sum += count;
   }
   return sum;
 }
 
 double CarrotReporter::Mean() {
-  return static_cast<double>(Sum()) / carrots_per_animal_.size();
+  return static_cast<double>(Sum()) / carrots_.size();
 }
 
 int CarrotReporter::CountAbove(int limit) {
   int count = 0;
-  for (const auto& pair : carrots_per_animal_) {
-    if (pair.second > limit) {
+  for (const int carrots : carrots_) {
+    if (carrots > limit) {
       ++count;
     }
   }
@@ -67,76 +195,121 @@ int CarrotReporter::CountAbove(int limit) {
 
 int CarrotReporter::Max() {
   int max = 0;
-  for (const auto& pair : carrots_per_animal_) {
-    max = std::max(pair.second, max);
+  for (const int count : carrots_) {
+    max = std::max(count, max);
   }
   return max;
 }
 
-double CarrotReporter::PrivacyBudget() { return privacy_budget_; }
+double CarrotReporter::PrivacyBudget() {
+  return privacy_budget_->RemainingEpsilon() / epsilon_;
+}
 
-base::StatusOr<Output> CarrotReporter::PrivateSum(double privacy_budget) {
-  if (privacy_budget_ < privacy_budget) {
-    return base::InvalidArgumentError("Not enough privacy budget.");
+base::StatusOr<std::vector<Output>> CarrotReporter::PrivateQueries(
+    absl::Span<const CarrotQuery> queries) {
+  // Invalid budgets are rejected before any budget is reserved, so that they
+  // cannot lower the total below what the valid queries spend.
+  double total_budget = 0;
+  for (const CarrotQuery& query : queries) {
+    RETURN_IF_ERROR(ValidateIsPositive(query.privacy_budget, "Privacy budget"));
+    RETURN_IF_ERROR(ValidateIsLesserThanOrEqualTo(query.privacy_budget, 1,
+                                                  "Privacy budget"));
+    total_budget += query.privacy_budget;
   }
-  privacy_budget_ -= privacy_budget;
-  ASSIGN_OR_RETURN(std::unique_ptr<BoundedSum<int>> sum_algorithm,
-                   BoundedSum<int>::Builder()
-                       .SetEpsilon(epsilon_)
-                       .SetLower(0)
-                       .SetUpper(150)
-                       .Build());
-  for (const auto& pair : carrots_per_animal_) {
-    sum_algorithm->AddEntry(pair.second);
+  ASSIGN_OR_RETURN(PrivacyAccountant::Reservation reservation,
+                   privacy_budget_->Reserve(total_budget * epsilon_));
+
+  // Every worker gets its own instance of each query's algorithm. The
+  // instances of worker 0 collect the others' summaries and produce the
+  // results.
+  auto build = [this](const CarrotQuery& query)
+      -> base::StatusOr<std::unique_ptr<Algorithm<int>>> {
+    switch (query.type) {
+      case CarrotQuery::Type::kSum:
+        return BoundedSum<int>::Builder()
+            .SetEpsilon(epsilon_)
+            .SetLower(0)
+            .SetUpper(150)
+            .Build();
+      case CarrotQuery::Type::kMean:
+        return BoundedMean<int>::Builder().SetEpsilon(epsilon_).Build();
+      case CarrotQuery::Type::kCountAbove:
+        return Count<int>::Builder().SetEpsilon(epsilon_).Build();
+      case CarrotQuery::Type::kMax:
+        return continuous::Max<int>::Builder()
+            .SetEpsilon(epsilon_)
+            .SetLower(0)
+            .SetUpper(150)
+            .Build();
+    }
+    return base::InvalidArgumentError("Unknown query type.");
+  };
+  std::vector<std::vector<std::unique_ptr<Algorithm<int>>>> algorithms(
+      num_threads_);
+  for (auto& worker_algorithms : algorithms) {
+    for (const CarrotQuery& query : queries) {
+      ASSIGN_OR_RETURN(std::unique_ptr<Algorithm<int>> algorithm,
+                       build(query));
+      worker_algorithms.push_back(std::move(algorithm));
+    }
+  }
+  reservation.Commit();
+
+  ParallelFor(num_threads_, carrots_.size(),
+              [&](int worker, int64_t begin, int64_t end) {
+                for (int64_t block = begin; block < end; block += kBlockSize) {
+                  const auto first = carrots_.begin() + block;
+                  const auto last =
+                      carrots_.begin() + std::min(end, block + kBlockSize);
+                  for (size_t i = 0; i < queries.size(); ++i) {
+                    Algorithm<int>& algorithm = *algorithms[worker][i];
+                    if (queries[i].type == CarrotQuery::Type::kCountAbove) {
+                      for (auto it = first; it != last; ++it) {
+                        if (*it > queries[i].limit) {
+                          algorithm.AddEntry(*it);
+                        }
+                      }
+                    } else {
+                      algorithm.AddEntries(first, last);
+                    }
+                  }
+                }
+              });
+
+  std::vector<Output> outputs;
+  outputs.reserve(queries.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    for (int worker = 1; worker < num_threads_; ++worker) {
+      RETURN_IF_ERROR(
+          algorithms[0][i]->Merge(algorithms[worker][i]->Serialize()));
+    }
+    ASSIGN_OR_RETURN(Output output, algorithms[0][i]->PartialResult(
+                                        queries[i].privacy_budget));
+    outputs.push_back(std::move(output));
   }
-  return sum_algorithm->PartialResult(privacy_budget);
+  return outputs;
+}
+
+base::StatusOr<Output> CarrotReporter::PrivateQuery(const CarrotQuery& query) {
+  ASSIGN_OR_RETURN(std::vector<Output> outputs, PrivateQueries({query}));
+  return outputs[0];
+}
+
+base::StatusOr<Output> CarrotReporter::PrivateSum(double privacy_budget) {
+  return PrivateQuery({CarrotQuery::Type::kSum, privacy_budget});
 }
 
 base::StatusOr<Output> CarrotReporter::PrivateMean(double privacy_budget) {
-  if (privacy_budget_ < privacy_budget) {
-    return base::InvalidArgumentError("Not enough privacy budget.");
-  }
-  privacy_budget_ -= privacy_budget;
-  ASSIGN_OR_RETURN(std::unique_ptr<BoundedMean<int>> mean_algorithm,
-                   BoundedMean<int>::Builder().SetEpsilon(epsilon_).Build());
-  for (const auto& pair : carrots_per_animal_) {
-    mean_algorithm->AddEntry(pair.second);
-  }
-  return mean_algorithm->PartialResult(privacy_budget);
+  return PrivateQuery({CarrotQuery::Type::kMean, privacy_budget});
 }
 
 base::StatusOr<Output> CarrotReporter::PrivateCountAbove(double privacy_budget,
                                                          int limit) {
-  if (privacy_budget_ < privacy_budget) {
-    return base::InvalidArgumentError("Not enough privacy budget.");
-  }
-  privacy_budget_ -= privacy_budget;
-  ASSIGN_OR_RETURN(std::unique_ptr<Count<std::string>> count_algorithm,
-                   Count<std::string>::Builder().SetEpsilon(epsilon_).Build());
-
-  for (const auto& pair : carrots_per_animal_) {
-    if (pair.second > limit) {
-      count_algorithm->AddEntry(pair.first);
-    }
-  }
-  return count_algorithm->PartialResult(privacy_budget);
+  return PrivateQuery({CarrotQuery::Type::kCountAbove, privacy_budget, limit});
 }
 
 base::StatusOr<Output> CarrotReporter::PrivateMax(double privacy_budget) {
-  if (privacy_budget_ < privacy_budget) {
-    return base::InvalidArgumentError("Not enough privacy budget.");
-  }
-  privacy_budget_ -= privacy_budget;
-  ASSIGN_OR_RETURN(std::unique_ptr<continuous::Max<int>> max_algorithm,
-                   continuous::Max<int>::Builder()
-                       .SetEpsilon(epsilon_)
-                       .SetLower(0)
-                       .SetUpper(150)
-                       .Build());
-  for (const auto& pair : carrots_per_animal_) {
-    max_algorithm->AddEntry(pair.second);
-  }
-  return max_algorithm->PartialResult(privacy_budget);
+  return PrivateQuery({CarrotQuery::Type::kMax, privacy_budget});
 }
 
 }  // namespace example
@@ -17,25 +17,51 @@
 #ifndef DIFFERENTIAL_PRIVACY_EXAMPLE_ANIMALS_AND_CARROTS_H_
 #define DIFFERENTIAL_PRIVACY_EXAMPLE_ANIMALS_AND_CARROTS_H_
 
-#include <map>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "algorithms/privacy-accountant.h"
 #include "proto/data.pb.h"
 
 namespace differential_privacy {
 namespace example {
 
+// A DP statistic over the carrot data, answered with privacy_budget out of the
+// reporter's remaining budget.
+struct CarrotQuery {
+  enum class Type { kSum, kMean, kCountAbove, kMax };
+
+  Type type;
+  double privacy_budget;
+  // Only used by kCountAbove: animals who ate more than limit carrots are
+  // counted.
+  int limit = 0;
+};
+
 // The CarrotReporter class helps the animals report differentially private (DP)
 // aggregate statistics about the number of carrots they have eaten to Farmer
 // Fred.
 class CarrotReporter {
  public:
   // Loads all the animals and carrots data from the file specified by
-  // data_filename into the map carrots_per_animal_. Epsilon is the differential
-  // privacy parameter. Epsilon is shared between all private function calls.
-  // The fraction of epsilon remaining is tracked by privacy_budget_.
-  CarrotReporter(std::string data_filename, double epsilon);
+  // data_filename. The file is memory-mapped and parsed in num_threads chunks
+  // into one column of animal names and one column of carrot counts. Each line
+  // is one animal; if an animal has several lines, its last one counts.
+  // Epsilon is the differential privacy parameter. Epsilon is shared between
+  // all private function calls. The fraction of epsilon remaining is tracked
+  // by privacy_budget_. Queries are evaluated with num_threads threads as
+  // well.
+  CarrotReporter(std::string data_filename, double epsilon,
+                 int num_threads = 1);
+  ~CarrotReporter();
+
+  CarrotReporter(const CarrotReporter&) = delete;
+  CarrotReporter& operator=(const CarrotReporter&) = delete;
 
   // True sum of all the carrots eaten.
   int Sum();
@@ -53,6 +79,15 @@ class CarrotReporter {
   // they should answer any more of Farmer Fred's questions.
   double PrivacyBudget();
 
+  // Answers all queries with a single pass over the data and returns one
+  // output per query, in order. Each query's budget must be in (0, 1]. The sum
+  // of the queries' budgets is reserved from the privacy budget up front; if a
+  // budget is invalid or the sum exceeds the remaining budget, no query is
+  // answered and no budget is spent. The reservation is given back if
+  // the algorithms cannot be built, and spent once the data is read.
+  base::StatusOr<std::vector<Output>> PrivateQueries(
+      absl::Span<const CarrotQuery> queries);
+
   // DP sum of all the carrots eaten.
   base::StatusOr<Output> PrivateSum(double privacy_budget);
 
@@ -66,17 +101,28 @@ class CarrotReporter {
   base::StatusOr<Output> PrivateMax(double privacy_budget);
 
  private:
-  // Map from the animal name to the number of carrots eaten by that animal.
-  std::map<std::string, int> carrots_per_animal_;
+  base::StatusOr<Output> PrivateQuery(const CarrotQuery& query);
+
+  // Read-only mapping of the data file. animals_ points into it.
+  const char* data_ = nullptr;
+  size_t data_size_ = 0;
+
+  // Column of distinct animal names and column of the number of carrots eaten
+  // by the animal in the same row.
+  std::vector<absl::string_view> animals_;
+  std::vector<int> carrots_;
 
   // Differential privacy parameter epsilon. A larger epsilon corresponds to
   // less privacy and more accuracy.
   double epsilon_;
 
+  int num_threads_;
+
   // The privacy budget given to Farmer Fred at the beginning of the day. If
   // this budget depletes, Farmer Fred cannot ask anymore questions about the
-  // carrot data. Privacy budget is represented as a fraction on [0, 1].
-  double privacy_budget_ = 1;
+  // carrot data. It holds epsilon_ in total; a query using a fraction f of the
+  // privacy budget spends f * epsilon_.
+  std::unique_ptr<PrivacyAccountant> privacy_budget_;
 };
 
 }  // namespace example
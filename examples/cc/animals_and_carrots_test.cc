@@ -16,6 +16,10 @@
 
 #include "animals_and_carrots.h"
 
+#include <cstdio>
+#include <fstream>
+#include <string>
+
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -57,6 +61,87 @@ TEST(CarrotReporterTest, PrivacyBudget) {
   EXPECT_EQ(reporter.PrivacyBudget(), 0.0);
 }
 
+TEST(CarrotReporterTest, ParallelLoadMatchesSequentialLoad) {
+  CarrotReporter sequential(kDatafile, 1);
+  CarrotReporter parallel(kDatafile, 1, /*num_threads=*/4);
+  EXPECT_EQ(parallel.Sum(), sequential.Sum());
+  EXPECT_EQ(parallel.Max(), sequential.Max());
+  EXPECT_EQ(parallel.CountAbove(-1), sequential.CountAbove(-1));
+  EXPECT_EQ(parallel.CountAbove(50), sequential.CountAbove(50));
+}
+
+TEST(CarrotReporterTest, LoadSkipsEmptyLinesAndAcceptsMissingNewline) {
+  const std::string filename =
+      std::string(::testing::TempDir()) + "/carrots.csv";
+  {
+    std::ofstream file(filename);
+    file << "Ant,3\n\nBee,5\nCat,7";
+  }
+  for (int num_threads : {1, 2, 3, 8}) {
+    CarrotReporter reporter(filename, 1, num_threads);
+    EXPECT_EQ(reporter.Sum(), 15);
+    EXPECT_EQ(reporter.CountAbove(0), 3);
+    EXPECT_EQ(reporter.Max(), 7);
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(CarrotReporterTest, LoadKeepsLastLineOfEachAnimal) {
+  const std::string filename =
+      std::string(::testing::TempDir()) + "/duplicate_carrots.csv";
+  {
+    std::ofstream file(filename);
+    file << "Ant,3\nBee,5\nAnt,7\nCat,1\nBee,2\n";
+  }
+  for (int num_threads : {1, 2, 3, 8}) {
+    CarrotReporter reporter(filename, 1, num_threads);
+    EXPECT_EQ(reporter.Sum(), 10);
+    EXPECT_EQ(reporter.CountAbove(0), 3);
+    EXPECT_EQ(reporter.Max(), 7);
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(CarrotReporterTest, PrivateQueries) {
+  CarrotReporter reporter(kDatafile, 1, /*num_threads=*/3);
+  base::StatusOr<std::vector<Output>> outputs =
+      reporter.PrivateQueries({{CarrotQuery::Type::kSum, .25},
+                               {CarrotQuery::Type::kCountAbove, .25, 90},
+                               {CarrotQuery::Type::kMax, .25}});
+  ASSERT_OK(outputs);
+  EXPECT_EQ(outputs.ValueOrDie().size(), 3);
+  EXPECT_EQ(reporter.PrivacyBudget(), .25);
+}
+
+TEST(CarrotReporterTest, PrivateQueriesOverBudgetSpendsNothing) {
+  CarrotReporter reporter(kDatafile, 1);
+  EXPECT_EQ(reporter
+                .PrivateQueries({{CarrotQuery::Type::kSum, .5},
+                                 {CarrotQuery::Type::kMax, .75}})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(reporter.PrivacyBudget(), 1.0);
+}
+
+TEST(CarrotReporterTest, PrivateQueriesInvalidBudgetSpendsNothing) {
+  CarrotReporter reporter(kDatafile, 1);
+  // The negative budget would lower the total to what the sum alone spends.
+  EXPECT_EQ(reporter
+                .PrivateQueries({{CarrotQuery::Type::kSum, .5},
+                                 {CarrotQuery::Type::kMax, -.25}})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(reporter
+                .PrivateQueries({{CarrotQuery::Type::kSum, .5},
+                                 {CarrotQuery::Type::kMax, 0}})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(reporter.PrivacyBudget(), 1.0);
+}
+
 }  // namespace
 }  // namespace example
 }  // namespace differential_privacy
@@ -36,6 +36,8 @@ ABSL_FLAG(std::string, CarrotsDataFile,
           "animals_and_carrots.csv",
           "Path to the datafile where the data is stored on the number of "
           "carrots each animal has eaten.");
+ABSL_FLAG(int, NumThreads, 1,
+          "Number of threads used to load the datafile and answer queries.");
 
 int main(int argc, char **argv) {
   PrintF(
@@ -45,7 +47,8 @@ int main(int argc, char **argv) {
   // Load the carrot data into the CarrotReporter. We use a higher epsilon to
   // obtain a higher accuracy since our dataset is very small.
   const double epsilon = 4 * DefaultEpsilon();
-  CarrotReporter reporter(absl::GetFlag(FLAGS_CarrotsDataFile), epsilon);
+  CarrotReporter reporter(absl::GetFlag(FLAGS_CarrotsDataFile), epsilon,
+                          absl::GetFlag(FLAGS_NumThreads));
 
   // Query for the total number of carrots. Notice that we explicitly use 25% of
   // our privacy budget.
@@ -26,24 +26,33 @@ namespace testing {
 
 const std::string count_samples_folder = "../statisticaltester/countsamples";
 
-// Construct Count algorithm.
-int64_t DPCount(const std::vector<int>& values, double epsilon,
+// Returns a factory of samplers that each construct one Count algorithm and
+// reuse it for every sample.
+SamplerFactory DPCountSampler(std::vector<int> values, double epsilon,
   int max_partitions) {
-  std::unique_ptr<Count<int64_t>> count = Count<int64_t>::Builder()
-    .SetEpsilon(epsilon)
-    .SetMaxPartitionsContributed(max_partitions) 
-    .Build()
-    .ValueOrDie();
-  base::StatusOr<Output> result = count->Result(values.begin(), values.end());
-  Output obj = result.ValueOrDie();
-  return GetValue<int64_t>(obj);
+  return [values, epsilon, max_partitions](RandomSource* random) -> Sampler {
+    std::shared_ptr<Count<int64_t>> count = Count<int64_t>::Builder()
+      .SetEpsilon(epsilon)
+      .SetMaxPartitionsContributed(max_partitions)
+      .SetLaplaceMechanism(LaplaceBuilder(random))
+      .Build()
+      .ValueOrDie();
+    return [count, values]() {
+      // Result() resets the algorithm and its privacy budget before adding
+      // the values, so every sample is independent.
+      base::StatusOr<Output> result = count->Result(values.begin(), values.end());
+      return static_cast<double>(GetValue<int64_t>(result.ValueOrDie()));
+    };
+  };
 }
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 10 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
 void CreateSingleScenarioCount(int scenario, double true_value, int number_of_samples,
-  int increment, int max_partitions, double epsilon, double ratio) { 
+  int increment, int max_partitions, double epsilon, double ratio,
+  std::vector<SampleJob>* jobs) {
   double neighbor_value = true_value + increment;
   double implemented_epsilon = epsilon / ratio;
 // Create pairs of vectors with arbitrary value of 100.
@@ -52,59 +61,67 @@ void CreateSingleScenarioCount(int scenario, double true_value, int number_of_sa
   std::string filepath = count_samples_folder+"/R"
     +std::to_string(static_cast<int>(ratio*100))+"/Scenario"+std::to_string(scenario);
   mkdir(filepath.c_str(), 0777);
-  for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
-    for (int i=0; i<number_of_samples; i++) {
-      int64_t outputA = DPCount(sampleA, implemented_epsilon, max_partitions);
-      samplefileA << outputA << "\n";
-      int64_t outputB = DPCount(sampleB, implemented_epsilon,max_partitions);
-        samplefileB << outputB << "\n";
-    }
-  samplefileA.close();
-  samplefileB.close();
+  for (int i=0; i<kNumRunsPerScenario; i++) {
+    SampleJob job;
+    job.path_a = filepath+"/TestCase"+std::to_string(i)+"A.txt";
+    job.path_b = filepath+"/TestCase"+std::to_string(i)+"B.txt";
+    job.path_columnar = filepath+"/TestCase"+std::to_string(i)+".samples";
+    job.metadata = {
+      {"algorithm", "count"},
+      {"scenario", std::to_string(scenario)},
+      {"run", std::to_string(i)},
+      {"ratio", MetadataValue(ratio)},
+      {"epsilon", MetadataValue(epsilon)},
+      {"implemented_epsilon", MetadataValue(implemented_epsilon)},
+      {"true_value", MetadataValue(true_value)},
+      {"increment", std::to_string(increment)},
+      {"max_partitions", std::to_string(max_partitions)},
+    };
+    job.number_of_samples = number_of_samples;
+    job.sampler_a = DPCountSampler(sampleA, implemented_epsilon, max_partitions);
+    job.sampler_b = DPCountSampler(sampleB, implemented_epsilon, max_partitions);
+    job.integral = true;
+    jobs->push_back(std::move(job));
   }
 }
 
-// Runs each sample-pair with parameters that replicate those specified in:
+// Adds jobs for each sample-pair with parameters that replicate those specified in:
 // https://github.com/google/differential-privacy/blob/main/proto/testing/count_dp_test_cases.textproto
-void GenerateAllScenariosCount(double ratio) {
+void GenerateAllScenariosCount(double ratio, std::vector<SampleJob>* jobs) {
   const int num_of_samples = 100;
   double small_epsilon = 0.01;
   double default_epsilon = std::log(3);
   double large_epsilon = 2*std::log(3);
 
 // Laplace noise, empty count, default parameters
-  CreateSingleScenarioCount(1,0,num_of_samples,1,1,default_epsilon,ratio);
+  CreateSingleScenarioCount(1,0,num_of_samples,1,1,default_epsilon,ratio,jobs);
 
 // Laplace noise, empty count, two partitions contributed
-  CreateSingleScenarioCount(2,0,num_of_samples,2,2,default_epsilon,ratio);
+  CreateSingleScenarioCount(2,0,num_of_samples,2,2,default_epsilon,ratio,jobs);
 
 // Laplace noise, empty count, many partitions contributed
-  CreateSingleScenarioCount(3,0,num_of_samples,250,250,default_epsilon,ratio);
+  CreateSingleScenarioCount(3,0,num_of_samples,250,250,default_epsilon,ratio,jobs);
 
 // Laplace noise, empty count, small epsilon
-  CreateSingleScenarioCount(4,0,num_of_samples,1,1,small_epsilon,ratio);
+  CreateSingleScenarioCount(4,0,num_of_samples,1,1,small_epsilon,ratio,jobs);
 
 // Laplace noise, empty count, large epsilon
-  CreateSingleScenarioCount(5,0,num_of_samples,1,1,large_epsilon,ratio);
+  CreateSingleScenarioCount(5,0,num_of_samples,1,1,large_epsilon,ratio,jobs);
 
 // Laplace noise, small count, default parameters
-  CreateSingleScenarioCount(6,28,num_of_samples,1,1,default_epsilon,ratio);
+  CreateSingleScenarioCount(6,28,num_of_samples,1,1,default_epsilon,ratio,jobs);
 
 // Laplace noise, small count, two partitions contributed
-  CreateSingleScenarioCount(7,28,num_of_samples,2,2,default_epsilon,ratio);
+  CreateSingleScenarioCount(7,28,num_of_samples,2,2,default_epsilon,ratio,jobs);
 
 // Laplace noise, small count, many partitions contributed
-  CreateSingleScenarioCount(8,28,num_of_samples,250,250,default_epsilon,ratio);
+  CreateSingleScenarioCount(8,28,num_of_samples,250,250,default_epsilon,ratio,jobs);
 
 // Laplace noise, small count, small epsilon
-  CreateSingleScenarioCount(9,28,num_of_samples,1,1,small_epsilon,ratio);
+  CreateSingleScenarioCount(9,28,num_of_samples,1,1,small_epsilon,ratio,jobs);
 
 // Laplace noise, small count, large epsilon
-  CreateSingleScenarioCount(10,28,num_of_samples,1,1,large_epsilon,ratio);
+  CreateSingleScenarioCount(10,28,num_of_samples,1,1,large_epsilon,ratio,jobs);
 }
 } // testing
 } // differential_privacy
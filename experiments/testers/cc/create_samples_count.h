@@ -41,6 +41,7 @@
 #include "base/statusor.h"
 #include "proto/data.pb.h"
 #include "testing/sequence.h"
+#include "sample_job_runner.h"
 
 namespace differential_privacy {
 
@@ -54,19 +55,22 @@ namespace testing {
 extern const std::string count_samples_folder;
 //std::string count_samples_folder = "../statisticaltester/countsamples";
 
-// Construct Count algorithm.
-int64_t DPCount(const std::vector<int>& values, double epsilon,
+// Returns a factory of samplers that each construct one Count algorithm and
+// reuse it for every sample.
+SamplerFactory DPCountSampler(std::vector<int> values, double epsilon,
   int max_partitions);
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 10 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
 void CreateSingleScenarioCount(int scenario, double true_value, int number_of_samples,
-  int increment, int max_partitions, double epsilon, double ratio);
+  int increment, int max_partitions, double epsilon, double ratio,
+  std::vector<SampleJob>* jobs);
 
-// Runs each sample-pair with parameters that replicate those specified in:
+// Adds jobs for each sample-pair with parameters that replicate those specified in:
 // https://github.com/google/differential-privacy/blob/main/proto/testing/count_dp_test_cases.textproto
-void GenerateAllScenariosCount(double ratio);
+void GenerateAllScenariosCount(double ratio, std::vector<SampleJob>* jobs);
 
 } // testing
 } // differential_privacy
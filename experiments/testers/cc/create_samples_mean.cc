@@ -43,58 +43,70 @@ double DiscretizeMean(double true_value, double granularity) {
   }
 }
 
-// Construct the BoundedMean algorithm.
-double DPMean(std::vector<double> values, double granularity,
-  double epsilon, int max_partitions, int max_contributions, int lower, int upper) {
-    std::unique_ptr<BoundedMean<double>> boundedmean =
-    BoundedMean<double>::Builder()
+namespace {
+
+std::shared_ptr<BoundedMean<double>> BuildMean(double epsilon,
+  int max_partitions, int max_contributions, int lower, int upper,
+  RandomSource* random) {
+  return BoundedMean<double>::Builder()
     .SetEpsilon(epsilon)
     .SetMaxPartitionsContributed(max_partitions)
     .SetMaxContributionsPerPartition(max_contributions)
     .SetLower(lower)
-    .SetUpper(upper) 
+    .SetUpper(upper)
+    .SetLaplaceMechanism(LaplaceBuilder(random))
     .Build()
     .ValueOrDie();
-
-  base::StatusOr<Output> result = boundedmean->Result(values.begin(),
-    values.end());
-  Output obj = result.ValueOrDie();
-  return GetValue<double>(obj);
 }
 
-// Construct the BoundedMean algorithm for large values.
-// Additional parameters enable large values to be added
-// to the algorithm one by one.
-double DPLargeMean(double initial_value, double extra_values_length, 
-  double extra_value, double granularity, double epsilon, int max_partitions,
-  int max_contributions, int lower, int upper) {
-    std::unique_ptr<BoundedMean<double>> boundedmean =
-    BoundedMean<double>::Builder()
-    .SetEpsilon(epsilon)
-    .SetMaxPartitionsContributed(max_partitions)
-    .SetMaxContributionsPerPartition(max_contributions)
-    .SetLower(lower)
-    .SetUpper(upper) 
-    .Build()
-    .ValueOrDie();
+} // namespace
 
-// Add entry with initial value
-  boundedmean->AddEntry(initial_value,granularity);
-// Add entry with subsequent values
-  for (int i=0; i<extra_values_length; i++) {
-    boundedmean->AddEntry(extra_value);
-  }
-  return GetValue<double>(boundedmean->PartialResult().ValueOrDie());
+// Returns a factory of samplers that each construct one BoundedMean algorithm
+// and reuse it for every sample. Samples are discretized to granularity.
+SamplerFactory DPMeanSampler(std::vector<double> values, double granularity,
+  double epsilon, int max_partitions, int max_contributions, int lower, int upper) {
+  return [=](RandomSource* random) -> Sampler {
+    std::shared_ptr<BoundedMean<double>> boundedmean = BuildMean(epsilon,
+      max_partitions, max_contributions, lower, upper, random);
+    return [boundedmean, values, granularity]() {
+      base::StatusOr<Output> result = boundedmean->Result(values.begin(),
+        values.end());
+      return DiscretizeMean(GetValue<double>(result.ValueOrDie()), granularity);
+    };
+  };
+}
+
+// Same as above for large values: every sample adds initial_value followed by
+// extra_values_length copies of extra_value, one by one.
+SamplerFactory DPLargeMeanSampler(double initial_value,
+  double extra_values_length, double extra_value, double granularity,
+  double epsilon, int max_partitions, int max_contributions, int lower,
+  int upper) {
+  return [=](RandomSource* random) -> Sampler {
+    std::shared_ptr<BoundedMean<double>> boundedmean = BuildMean(epsilon,
+      max_partitions, max_contributions, lower, upper, random);
+    return [=]() {
+      boundedmean->Reset();
+      boundedmean->AddEntry(initial_value);
+      for (int i=0; i<extra_values_length; i++) {
+        boundedmean->AddEntry(extra_value);
+      }
+      return DiscretizeMean(
+        GetValue<double>(boundedmean->PartialResult().ValueOrDie()),
+        granularity);
+    };
+  };
 }
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 22 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
-void CreateSingleScenarioMean(int scenario, std::vector<double>valuesA,
-  std::vector<double>valuesB, double granularity, double epsilon,
-  int max_partitions, int max_contributions, int lower, int upper,
-  int number_of_samples, double ratio, double initial_value,
-  double extra_values_length, double extra_value) { 
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
+void CreateSingleScenarioMean(std::vector<SampleJob>* jobs, int scenario,
+  std::vector<double>valuesA, std::vector<double>valuesB, double granularity,
+  double epsilon, int max_partitions, int max_contributions, int lower,
+  int upper, int number_of_samples, double ratio, double initial_value,
+  double extra_values_length, double extra_value) {
 
   double implemented_epsilon = epsilon / ratio;
   std::string filepath = mean_samples_folder+"/R"
@@ -102,46 +114,41 @@ void CreateSingleScenarioMean(int scenario, std::vector<double>valuesA,
     +std::to_string(scenario);
   mkdir(filepath.c_str(), 0777);
 
-  for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
-
+  for (int i=0; i<kNumRunsPerScenario; i++) {
+    SampleJob job;
+    job.path_a = filepath+"/TestCase"+std::to_string(i)+"A.txt";
+    job.path_b = filepath+"/TestCase"+std::to_string(i)+"B.txt";
+    job.path_columnar = filepath+"/TestCase"+std::to_string(i)+".samples";
+    job.metadata = {
+      {"algorithm", "bounded_mean"},
+      {"scenario", std::to_string(scenario)},
+      {"run", std::to_string(i)},
+      {"ratio", MetadataValue(ratio)},
+      {"epsilon", MetadataValue(epsilon)},
+      {"implemented_epsilon", MetadataValue(implemented_epsilon)},
+      {"granularity", MetadataValue(granularity)},
+      {"max_partitions", std::to_string(max_partitions)},
+      {"max_contributions", std::to_string(max_contributions)},
+      {"lower", std::to_string(lower)},
+      {"upper", std::to_string(upper)},
+    };
+    job.number_of_samples = number_of_samples;
+    job.sampler_a = DPMeanSampler(valuesA, granularity, implemented_epsilon,
+      max_partitions, max_contributions, lower, upper);
     if (extra_values_length == 0) {
-      for (int i=0; i<number_of_samples; i++) {
-        double outputA = DPMean(valuesA, granularity,
-          implemented_epsilon, max_partitions, max_contributions, lower, upper);
-        double discretized_outputA = DiscretizeMean(outputA, granularity);
-        samplefileA << discretized_outputA << "\n";
-        double outputB = DPMean(valuesB, granularity,
-          implemented_epsilon, max_partitions, max_contributions, lower, upper);
-        double discretized_outputB = DiscretizeMean(outputB, granularity);
-        samplefileB << discretized_outputB << "\n";
-      }
-      samplefileA.close();
-      samplefileB.close();
-    }
-    else {
-      for (int i=0; i<number_of_samples; i++) {
-      double outputA = DPMean(valuesA, granularity,
-        implemented_epsilon, max_partitions, max_contributions, lower, upper);
-      double discretized_outputA = DiscretizeMean(outputA, granularity);
-        samplefileA << discretized_outputA << "\n";
-      double outputB = DPLargeMean(initial_value, extra_values_length,
+      job.sampler_b = DPMeanSampler(valuesB, granularity, implemented_epsilon,
+        max_partitions, max_contributions, lower, upper);
+    } else {
+      job.sampler_b = DPLargeMeanSampler(initial_value, extra_values_length,
         extra_value, granularity, implemented_epsilon, max_partitions,
         max_contributions, lower, upper);
-      double discretized_outputB = DiscretizeMean(outputB, granularity);
-        samplefileB << discretized_outputB << "\n";
-      }
-      samplefileA.close();
-      samplefileB.close();
     }
-  }   
+    jobs->push_back(std::move(job));
+  }
 }
-// Runs each sample-pair with parameters that replicate those specified in:
+// Adds jobs for each sample-pair with parameters that replicate those specified in:
 // https://github.com/google/differential-privacy/blob/main/proto/testing/bounded_mean_dp_test_cases.textproto.
-void GenerateAllScenariosMean(double ratio) {
+void GenerateAllScenariosMean(double ratio, std::vector<SampleJob>* jobs) {
 
   const int num_of_samples = 100;
   double small_epsilon = 0.1;
@@ -151,101 +158,101 @@ void GenerateAllScenariosMean(double ratio) {
 // Laplace noise, empty mean, default parameters
   std::vector<double>zero_vector{0};
   std::vector<double>valuesB1{1000};
-  CreateSingleScenarioMean(1,zero_vector,valuesB1,0.0078125,default_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,1,zero_vector,valuesB1,0.0078125,default_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, empty mean, many partitions contributed
   std::vector<double>valuesB2(1000,25);
-  CreateSingleScenarioMean(2,zero_vector,valuesB2,0.25,default_epsilon,25,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,2,zero_vector,valuesB2,0.25,default_epsilon,25,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, empty mean, many contributions per partition
   std::vector<double>valuesB3(1000,10);
-  CreateSingleScenarioMean(3,zero_vector,valuesB3,0.25,default_epsilon,1,10,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,3,zero_vector,valuesB3,0.25,default_epsilon,1,10,0,1,num_of_samples,ratio);
 
 // Laplace noise, empty mean, large bounds
   std::vector<double>valuesB4{-50000};
-  CreateSingleScenarioMean(4,zero_vector,valuesB4,0.25,default_epsilon,1,1,-50,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,4,zero_vector,valuesB4,0.25,default_epsilon,1,1,-50,50,num_of_samples,ratio);
 
 // Laplace noise, empty mean, small epsilon
   std::vector<double>valuesB5{1000};
-  CreateSingleScenarioMean(5,zero_vector,valuesB5,0.0625,small_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,5,zero_vector,valuesB5,0.0625,small_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, empty mean, large epsilon
   std::vector<double>valuesB6{1000};
-  CreateSingleScenarioMean(6,zero_vector,valuesB6,0.03125,large_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,6,zero_vector,valuesB6,0.03125,large_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, small positive mean, default parameters
   std::vector<double>valuesA7{1};
   std::vector<double>valuesB7{1,-1000};
-  CreateSingleScenarioMean(7,valuesA7,valuesB7,0.015625,default_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,7,valuesA7,valuesB7,0.015625,default_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, small positive mean, many partitions contributed
-  CreateSingleScenarioMean(8,zero_vector,zero_vector,0.25,default_epsilon,25,1,0,1,num_of_samples,ratio,
+  CreateSingleScenarioMean(jobs,8,zero_vector,zero_vector,0.25,default_epsilon,25,1,0,1,num_of_samples,ratio,
       1,25,-1000);
 
 // Laplace noise, small positive mean, many contributions per partition
-  CreateSingleScenarioMean(9,zero_vector,zero_vector,0.25,default_epsilon,1,10,0,1,num_of_samples,ratio,
+  CreateSingleScenarioMean(jobs,9,zero_vector,zero_vector,0.25,default_epsilon,1,10,0,1,num_of_samples,ratio,
     1,10,-1000);
 
 // Laplace noise, small positive mean, small epsilon
   std::vector<double>valuesA10{1};
   std::vector<double>valuesB10{1,-1000};
-  CreateSingleScenarioMean(10,valuesA10,valuesB10,0.0625,small_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,10,valuesA10,valuesB10,0.0625,small_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, small positive mean, large epsilon
   std::vector<double>valuesA11{1};
   std::vector<double>valuesB11{1,-1000};
-  CreateSingleScenarioMean(11,valuesA11,valuesB11,0.0625,large_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,11,valuesA11,valuesB11,0.0625,large_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, small positive mean, multiple entries
   std::vector<double>valuesA12{0.64872,0.12707,0.00128,0.14684,0.86507};
   std::vector<double>valuesB12{0.64872,0.12707,0.00128,0.14684,0.86507,1000};
-  CreateSingleScenarioMean(12,valuesA12,valuesB12,0.015625,default_epsilon,1,1,0,1,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,12,valuesA12,valuesB12,0.015625,default_epsilon,1,1,0,1,num_of_samples,ratio);
 
 // Laplace noise, large positive mean, default parameters
   std::vector<double>valuesA13{50};
   std::vector<double>valuesB13{50,-1000};
-  CreateSingleScenarioMean(13,valuesA13,valuesB13,0.25,default_epsilon,1,1,0,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,13,valuesA13,valuesB13,0.25,default_epsilon,1,1,0,50,num_of_samples,ratio);
 
 // Laplace noise, large positive mean, many partitions contributed 
-  CreateSingleScenarioMean(14,zero_vector,zero_vector,2,default_epsilon,25,1,0,50,
+  CreateSingleScenarioMean(jobs,14,zero_vector,zero_vector,2,default_epsilon,25,1,0,50,
     num_of_samples,ratio,50,25,-1000);
 
 // Laplace noise, large positive mean, many contributions per partition
-  CreateSingleScenarioMean(15,zero_vector,zero_vector,1,default_epsilon,1,10,0,50,
+  CreateSingleScenarioMean(jobs,15,zero_vector,zero_vector,1,default_epsilon,1,10,0,50,
     num_of_samples,ratio,50,10,-1000);
 
 // Laplace noise, large positive mean, small epsilon
   std::vector<double>valuesA16{50};
   std::vector<double>valuesB16{50,-1000};
-  CreateSingleScenarioMean(16,valuesA16,valuesB16,2,small_epsilon,1,1,0,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,16,valuesA16,valuesB16,2,small_epsilon,1,1,0,50,num_of_samples,ratio);
 
 // Laplace noise, large positive mean, large epsilon
   std::vector<double>valuesA17{50};
   std::vector<double>valuesB17{50,-1000};
-  CreateSingleScenarioMean(17,valuesA17,valuesB17,0.5,large_epsilon,1,1,0,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,17,valuesA17,valuesB17,0.5,large_epsilon,1,1,0,50,num_of_samples,ratio);
 
 // Laplace noise, large positive mean, multiple entries
   std::vector<double>valuesA18{32,43606,35.35006,40.73424,32.53939,7.081785};
   std::vector<double>valuesB18{32,43606,35.35006,40.73424,32.53939,7.081785,-1000};
-  CreateSingleScenarioMean(18,valuesA18,valuesB18,0.25,default_epsilon,1,1,0,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,18,valuesA18,valuesB18,0.25,default_epsilon,1,1,0,50,num_of_samples,ratio);
 
 // Laplace noise, large mixed mean, default parameters
   std::vector<double>valuesA19{-50};
   std::vector<double>valuesB19{-50,50000};
-  CreateSingleScenarioMean(19,valuesA19,valuesB19,0.5,default_epsilon,1,1,-50,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,19,valuesA19,valuesB19,0.5,default_epsilon,1,1,-50,50,num_of_samples,ratio);
 
 // Laplace noise, large mixed mean, many partitions contributed
-  CreateSingleScenarioMean(20,zero_vector,zero_vector,2,default_epsilon,25,1,-50,50,
+  CreateSingleScenarioMean(jobs,20,zero_vector,zero_vector,2,default_epsilon,25,1,-50,50,
     num_of_samples,ratio,-50,25,50000);
 
 // Laplace noise, large mixed mean, many contributions per partition
-  CreateSingleScenarioMean(21,zero_vector,zero_vector,2,default_epsilon,1,10,-50,50,
+  CreateSingleScenarioMean(jobs,21,zero_vector,zero_vector,2,default_epsilon,1,10,-50,50,
     num_of_samples,ratio,-50,10,50000);
 
 // Laplace noise, large mixed mean, multiple entries
   std::vector<double>valuesA22{-32.43606,35.35006,-40.73424,-32.53939,7.081785};
   std::vector<double>valuesB22{-32.43606,35.35006,-40.73424,-32.53939,7.081785,50000};
-  CreateSingleScenarioMean(22,valuesA22,valuesB22,0.5,default_epsilon,1,1,-50,50,num_of_samples,ratio);
+  CreateSingleScenarioMean(jobs,22,valuesA22,valuesB22,0.5,default_epsilon,1,1,-50,50,num_of_samples,ratio);
 }
 } // testing
 } // differential_privacy
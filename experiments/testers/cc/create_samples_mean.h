@@ -43,6 +43,7 @@
 #include "base/statusor.h"
 #include "proto/data.pb.h"
 #include "testing/sequence.h"
+#include "sample_job_runner.h"
 
 namespace differential_privacy {
 
@@ -57,27 +58,31 @@ extern const std::string mean_samples_folder;
 
 double DiscretizeMean(double true_value, double granularity);
 
-// Construct the BoundedMean algorithm.
-double DPMean(std::vector<double> values, double granularity,
+// Returns a factory of samplers that each construct one BoundedMean algorithm
+// and reuse it for every sample. Samples are discretized to granularity.
+SamplerFactory DPMeanSampler(std::vector<double> values, double granularity,
   double epsilon, int max_partitions, int max_contributions, int lower, int upper);
 
-// Construct the BoundedMean algorithm for large values.
-double DPLargeMean(double initial_value, double extra_values_length, 
-  double extra_value, double granularity, double epsilon, int max_partitions,
-  int max_contributions, int lower, int upper);
+// Same as above for large values: every sample adds initial_value followed by
+// extra_values_length copies of extra_value.
+SamplerFactory DPLargeMeanSampler(double initial_value,
+  double extra_values_length, double extra_value, double granularity,
+  double epsilon, int max_partitions, int max_contributions, int lower,
+  int upper);
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 22 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
-void CreateSingleScenarioMean(int scenario, std::vector<double>valuesA,
-  std::vector<double>valuesB, double granularity, double epsilon,
-  int max_partitions, int max_contributions, int lower, int upper,
-  int number_of_samples, double ratio, double initial_value = 0,
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
+void CreateSingleScenarioMean(std::vector<SampleJob>* jobs, int scenario,
+  std::vector<double>valuesA, std::vector<double>valuesB, double granularity,
+  double epsilon, int max_partitions, int max_contributions, int lower,
+  int upper, int number_of_samples, double ratio, double initial_value = 0,
   double extra_values_length = 0, double extra_value = 0);
 
-// Runs each sample-pair with parameters that replicate those specified in:
+// Adds jobs for each sample-pair with parameters that replicate those specified in:
 // https://github.com/google/differential-privacy/blob/main/proto/testing/bounded_mean_dp_test_cases.textproto.
-void GenerateAllScenariosMean(double ratio);
+void GenerateAllScenariosMean(double ratio, std::vector<SampleJob>* jobs);
 
 } // testing
 } // differential_privacy
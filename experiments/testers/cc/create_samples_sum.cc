@@ -43,29 +43,38 @@ double DiscretizeSum(double true_value, double granularity) {
   }
 }
 
-// Construct the BoundedSum algorithm.
-double BoundedSumAlgorithm(std::vector<double> values, double granularity,
+// Returns a factory of samplers that each construct one BoundedSum algorithm
+// and reuse it for every sample. Samples are discretized to granularity.
+SamplerFactory BoundedSumSampler(std::vector<double> values, double granularity,
   double epsilon, int max_partitions, int lower, int upper) {
-    std::unique_ptr<BoundedSum<double>> boundedsum = BoundedSum<double>::Builder()
-    .SetEpsilon(epsilon)
-    .SetMaxPartitionsContributed(max_partitions)
-    .SetLower(lower)
-    .SetUpper(upper) 
-    .Build()
-    .ValueOrDie();
-
-  base::StatusOr<Output> result = boundedsum->Result(values.begin(),
-    values.end());
-  Output obj = result.ValueOrDie();
-  return GetValue<double>(obj);
+  return [=](RandomSource* random) -> Sampler {
+    std::shared_ptr<BoundedSum<double>> boundedsum = BoundedSum<double>::Builder()
+      .SetEpsilon(epsilon)
+      .SetMaxPartitionsContributed(max_partitions)
+      .SetLower(lower)
+      .SetUpper(upper)
+      .SetLaplaceMechanism(LaplaceBuilder(random))
+      .Build()
+      .ValueOrDie();
+    return [boundedsum, values, granularity]() {
+      base::StatusOr<Output> result = boundedsum->Result(values.begin(),
+        values.end());
+      // The sum is truncated to an integer before discretizing, as the samples
+      // have always been generated.
+      int64_t output = GetValue<double>(result.ValueOrDie());
+      return DiscretizeSum(output, granularity);
+    };
+  };
 }
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 17 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
 void CreateSingleScenarioSum(int scenario, std::vector<double> values,
   double granularity, double epsilon, int max_partitions,
-	int lower, int upper, int number_of_samples, int increment, double ratio) { 
+	int lower, int upper, int number_of_samples, int increment, double ratio,
+  std::vector<SampleJob>* jobs) {
   std::vector<double> neighbor_values = values;
   neighbor_values.push_back(increment);
   double implemented_epsilon = epsilon / ratio;
@@ -73,27 +82,34 @@ void CreateSingleScenarioSum(int scenario, std::vector<double> values,
     +std::to_string(static_cast<int>(ratio*100))+"/Scenario"
     +std::to_string(scenario);
   mkdir(filepath.c_str(), 0777);
-  for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
-    for (int i=0; i<number_of_samples; i++) {
-      int64_t outputA = BoundedSumAlgorithm(values, granularity,
-        implemented_epsilon, max_partitions, lower, upper);
-      double discretized_outputA = DiscretizeSum(outputA, granularity);
-      samplefileA << discretized_outputA << "\n";
-      int64_t outputB = BoundedSumAlgorithm(neighbor_values, granularity,
-        implemented_epsilon, max_partitions, lower, upper);
-      double discretized_outputB = DiscretizeSum(outputB, granularity);
-      samplefileB << discretized_outputB << "\n";
-    }
-  samplefileA.close();
-  samplefileB.close();
+  for (int i=0; i<kNumRunsPerScenario; i++) {
+    SampleJob job;
+    job.path_a = filepath+"/TestCase"+std::to_string(i)+"A.txt";
+    job.path_b = filepath+"/TestCase"+std::to_string(i)+"B.txt";
+    job.path_columnar = filepath+"/TestCase"+std::to_string(i)+".samples";
+    job.metadata = {
+      {"algorithm", "bounded_sum"},
+      {"scenario", std::to_string(scenario)},
+      {"run", std::to_string(i)},
+      {"ratio", MetadataValue(ratio)},
+      {"epsilon", MetadataValue(epsilon)},
+      {"implemented_epsilon", MetadataValue(implemented_epsilon)},
+      {"granularity", MetadataValue(granularity)},
+      {"max_partitions", std::to_string(max_partitions)},
+      {"lower", std::to_string(lower)},
+      {"upper", std::to_string(upper)},
+      {"increment", std::to_string(increment)},
+    };
+    job.number_of_samples = number_of_samples;
+    job.sampler_a = BoundedSumSampler(values, granularity,
+      implemented_epsilon, max_partitions, lower, upper);
+    job.sampler_b = BoundedSumSampler(neighbor_values, granularity,
+      implemented_epsilon, max_partitions, lower, upper);
+    jobs->push_back(std::move(job));
   }
 }
 
-void GenerateAllScenariosSum(double ratio) {
+void GenerateAllScenariosSum(double ratio, std::vector<SampleJob>* jobs) {
   const int num_of_samples = 100;
   double small_epsilon = 0.1;
   double default_epsilon = std::log(3);
@@ -102,70 +118,70 @@ void GenerateAllScenariosSum(double ratio) {
 // Laplace noise, empty sum, default parameters
   std::vector<double>zero_vector{0};
   CreateSingleScenarioSum(1,zero_vector,0.015625,default_epsilon,1,0,1,num_of_samples,
-    1000,ratio);
+    1000,ratio,jobs);
 
 // Laplace noise, empty sum, many partitions contributed
   CreateSingleScenarioSum(2,zero_vector,0.125,default_epsilon,25,0,1,num_of_samples,
-    25000,ratio);
+    25000,ratio,jobs);
 
 // Laplace noise, empty sum, large bounds
   CreateSingleScenarioSum(3,zero_vector,0.25,default_epsilon,1,-50,49,num_of_samples,
-    -50000,ratio);
+    -50000,ratio,jobs);
 
 // Laplace noise, empty sum, small epsilon
   CreateSingleScenarioSum(4,zero_vector,0.0625,default_epsilon,1,0,1,num_of_samples,
-    1000,ratio);
+    1000,ratio,jobs);
 
 // Laplace noise, empty sum, large epsilon
   CreateSingleScenarioSum(5,zero_vector,0.03125,large_epsilon,1,0,1,num_of_samples,
-    1000,ratio);
+    1000,ratio,jobs);
 
 // Laplace noise, small positive sum, default parameters
   std::vector<double>vec1{0.64872,0.12707,0.00128,0.14684,0.86507};
   CreateSingleScenarioSum(6,vec1,0.015625,default_epsilon,1,0,1,num_of_samples,1000,
-    ratio);
+    ratio,jobs);
 
 // Laplace noise, small positive sum, many partitions contributed
   CreateSingleScenarioSum(7,vec1,0.125,default_epsilon,25,0,1,num_of_samples,25000,
-    ratio);
+    ratio,jobs);
 
 // Laplace noise, small positive sum, small epsilon
-  CreateSingleScenarioSum(8,vec1,0.0625,small_epsilon,1,0,1,num_of_samples,1000,ratio);
+  CreateSingleScenarioSum(8,vec1,0.0625,small_epsilon,1,0,1,num_of_samples,1000,ratio,jobs);
 
 // Laplace noise, small positive sum, large epsilon
-  CreateSingleScenarioSum(9,vec1,0.0625,large_epsilon,1,0,1,num_of_samples,1000,ratio);
+  CreateSingleScenarioSum(9,vec1,0.0625,large_epsilon,1,0,1,num_of_samples,1000,ratio,jobs);
 
 // Laplace noise, large positive sum, default parameters
   std::vector<double>vec2{32.43606,35.35006,40.73424,32.53939,7.081785};
   CreateSingleScenarioSum(10,vec2,0.25,default_epsilon,1,0,50,num_of_samples,50000,
-    ratio);
+    ratio,jobs);
 
 // Laplace noise, large positive sum, many partitions contributed
   CreateSingleScenarioSum(11,vec2,1,default_epsilon,25,0,50,num_of_samples,50000*25,
-    ratio);
+    ratio,jobs);
 
 // Laplace noise, large positive sum, small epsilon
-  CreateSingleScenarioSum(12,vec2,1,small_epsilon,1,0,50,num_of_samples,50000,ratio);
+  CreateSingleScenarioSum(12,vec2,1,small_epsilon,1,0,50,num_of_samples,50000,ratio,jobs);
 
 // Laplace noise, large positive sum, large epsilon
-  CreateSingleScenarioSum(13,vec2,0.5,large_epsilon,1,0,50,num_of_samples,50000,ratio);
+  CreateSingleScenarioSum(13,vec2,0.5,large_epsilon,1,0,50,num_of_samples,50000,ratio,jobs);
 
 // Laplace noise, large mixed sum, default parameters
   std::vector<double>vec3{-32.43606,35.35006,-40.73424,-32.53939,7.081785};
   CreateSingleScenarioSum(14,vec3,0.25,default_epsilon,1,-50,49.9,num_of_samples,
-    -50000,ratio);
+    -50000,ratio,jobs);
 
 // Laplace noise, large mixed sum, many partitions contributed
   CreateSingleScenarioSum(15,vec3,1,default_epsilon,1,-50,49.9,num_of_samples,
-    -50000*25,ratio);
+    -50000*25,ratio,jobs);
 
 // Laplace noise, large mixed sum, small epsilon
   CreateSingleScenarioSum(16,vec3,1,small_epsilon,1,-50,49.9,num_of_samples,-50000,
-    ratio);
+    ratio,jobs);
 
 // Laplace noise, large mixed sum, large epsilon
   CreateSingleScenarioSum(17,vec3,0.5,large_epsilon,1,-50,49.9,num_of_samples,-50000,
-    ratio);
+    ratio,jobs);
 }
 } // testing
 } // differential_privacy
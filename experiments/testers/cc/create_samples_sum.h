@@ -41,6 +41,7 @@
 #include "base/statusor.h"
 #include "proto/data.pb.h"
 #include "testing/sequence.h"
+#include "sample_job_runner.h"
 
 namespace differential_privacy {
 
@@ -50,18 +51,21 @@ extern const std::string sum_samples_folder;
 
 double DiscretizeSum(double true_value, double granularity);
 
-// Construct the BoundedSum algorithm.
-double BoundedSumAlgorithm(std::vector<double> values, double granularity,
+// Returns a factory of samplers that each construct one BoundedSum algorithm
+// and reuse it for every sample. Samples are discretized to granularity.
+SamplerFactory BoundedSumSampler(std::vector<double> values, double granularity,
   double epsilon, int max_partitions, int lower, int upper);
 
 // Creates a folder to contain all samples with a particular ratio value
 // (e.g., R95). Every folder contains 17 subfolders for each unique sample-pair.
-// Every subfolder contains seven runs of each sample-pair (14 files in total).
+// Every subfolder contains seven runs of each sample-pair (14 files in total),
+// one job per run is added to jobs.
 void CreateSingleScenarioSum(int scenario, std::vector<double> values,
   double granularity, double epsilon, int max_partitions,
-	int lower, int upper, int number_of_samples, int increment, double ratio);
+	int lower, int upper, int number_of_samples, int increment, double ratio,
+  std::vector<SampleJob>* jobs);
 
-void GenerateAllScenariosSum(double ratio);
+void GenerateAllScenariosSum(double ratio, std::vector<SampleJob>* jobs);
 
 } // testing
 } // differential_privacy
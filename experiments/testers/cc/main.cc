@@ -17,6 +17,7 @@
 #include "create_samples_count.h"
 #include "create_samples_sum.h"
 #include "create_samples_mean.h"
+#include "sample_job_runner.h"
 
 #include <chrono>
 #include <ctime>
@@ -27,6 +28,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -67,6 +69,9 @@ int main(int argc, char *argv[]) {
   double ratio_min = 0.80;
   double ratio_max = 0.85;
   double increment = 0.01;
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  differential_privacy::testing::SampleFormat sample_format =
+    differential_privacy::testing::SampleFormat::kText;
 
   std::string header = "test_name,algorithm,expected,actual,ratio,num_datasets,num_samples,time(sec)";
   std::string filepath = "../results/";
@@ -74,8 +79,24 @@ int main(int argc, char *argv[]) {
   time_t now = time(0); 
   char* dt = ctime(&now);
 
-// Specify ratio_min, ratio_max, number of samples, and name of files on the command line. 
-  if (argc==7) {
+// Specify ratio_min, ratio_max, number of samples, and name of files on the command line,
+// optionally followed by the number of threads used to generate samples and the
+// sample format ("text", "columnar" or "both").
+  if (argc==9) {
+    std::string format_name = argv[8];
+    if (format_name == "columnar") {
+      sample_format = differential_privacy::testing::SampleFormat::kColumnar;
+    } else if (format_name == "both") {
+      sample_format = differential_privacy::testing::SampleFormat::kBoth;
+    } else if (format_name != "text") {
+      std::cout << "Unknown sample format " << format_name
+        << ", writing text." << std::endl;
+    }
+  }
+  if (argc==8 || argc==9) {
+    num_threads = std::max(1, atoi(argv[7]));
+  }
+  if (argc>=7 && argc<=9) {
 
     double ratio_min = strtod(argv[1],NULL);
     double ratio_max = strtod(argv[2],NULL);
@@ -111,40 +132,40 @@ int main(int argc, char *argv[]) {
       mean_num_datasets,num_samples_per_histogram,ratio_min,ratio_max,0.01,meanfile);
     meanfile.close();
 
-// Generates samples of Count algorithm with insufficient noise.
+// Builds the matrix of sample jobs for every algorithm, ratio, scenario and
+// run, then generates all samples in parallel.
+  std::vector<differential_privacy::testing::SampleJob> jobs;
   mkdir(differential_privacy::testing::count_samples_folder.c_str(), 0777);
+  mkdir(differential_privacy::testing::sum_samples_folder.c_str(), 0777);
+  mkdir(differential_privacy::testing::mean_samples_folder.c_str(), 0777);
   int num_iterations = ceil((ratio_max - ratio_min) / increment);
   for (double i=0; i <= num_iterations; ++i) {
     double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string count_path = differential_privacy::testing::count_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(count_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosCount(ratio);
+    std::string ratio_folder = "/R"+std::to_string((int)lround(ratio*100));
+
+// Samples of Count algorithm with insufficient noise.
+    mkdir((differential_privacy::testing::count_samples_folder
+      +ratio_folder).c_str(), 0777);
+    differential_privacy::testing::GenerateAllScenariosCount(ratio, &jobs);
+
+// Samples of BoundedSum algorithm with insufficient noise.
+    mkdir((differential_privacy::testing::sum_samples_folder
+      +ratio_folder).c_str(), 0777);
+    differential_privacy::testing::GenerateAllScenariosSum(ratio, &jobs);
+
+// Samples of BoundedMean algorithm with insufficient noise.
+    mkdir((differential_privacy::testing::mean_samples_folder
+      +ratio_folder).c_str(), 0777);
+    differential_privacy::testing::GenerateAllScenariosMean(ratio, &jobs);
   }
 
-// // Generates samples of BoundedSum algorithm with insufficient noise.
-  mkdir(differential_privacy::testing::sum_samples_folder.c_str(), 0777);
-  for (double i=0; i <= num_iterations; ++i) {
-    double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string sum_path = differential_privacy::testing::sum_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(sum_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosSum(ratio);
-  }
+  auto start = std::chrono::steady_clock::now();
+  differential_privacy::testing::RunSampleJobs(jobs, num_threads,
+    sample_format);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Generated " << jobs.size() << " sample-pair runs on "
+    << num_threads << " thread(s) in " << elapsed.count() << " sec." << std::endl;
 
-// // Generates samples of BoundedMean algorithm with insufficient noise.
-  mkdir(differential_privacy::testing::mean_samples_folder.c_str(), 0777);
-  for (double i=0; i <= num_iterations; ++i) {
-    double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string mean_path = differential_privacy::testing::mean_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(mean_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosMean(ratio);
-  }
-  
   return 0;
 }
 
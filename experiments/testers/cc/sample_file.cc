@@ -0,0 +1,197 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "sample_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace differential_privacy {
+
+namespace testing {
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'P', 'S', 'A', 'M', 'P', 'L', 'S'};
+constexpr uint32_t kVersion = 1;
+
+static_assert(sizeof(double) == 8, "Samples are stored as float64.");
+
+template <typename V>
+void Append(V value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(V));
+}
+
+void AppendString(const std::string& value, std::string* out) {
+  Append(static_cast<uint32_t>(value.size()), out);
+  out->append(value);
+}
+
+// Reads from a bounded buffer, failing instead of reading past its end.
+class Cursor {
+ public:
+  Cursor(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename V>
+  bool Read(V* value) {
+    if (size_ - offset_ < sizeof(V)) return false;
+    std::memcpy(value, data_ + offset_, sizeof(V));
+    offset_ += sizeof(V);
+    return true;
+  }
+
+  bool ReadString(std::string* value) {
+    uint32_t length;
+    if (!Read(&length) || size_ - offset_ < length) return false;
+    value->assign(data_ + offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  bool Skip(size_t bytes) {
+    if (size_ - offset_ < bytes) return false;
+    offset_ += bytes;
+    return true;
+  }
+
+  size_t offset() const { return offset_; }
+  size_t remaining() const { return size_ - offset_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+} // namespace
+
+std::string MetadataValue(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+  return buffer;
+}
+
+bool WriteSampleFile(const std::string& path, const SampleMetadata& metadata,
+  const std::vector<SampleColumn>& columns) {
+  const uint64_t num_rows = columns.empty() ? 0 : columns[0].values.size();
+  for (const SampleColumn& column : columns) {
+    if (column.values.size() != num_rows) return false;
+  }
+
+  std::string header(kMagic, sizeof(kMagic));
+  Append(kVersion, &header);
+  Append(static_cast<uint32_t>(metadata.size()), &header);
+  Append(static_cast<uint32_t>(columns.size()), &header);
+  Append(uint32_t{0}, &header);
+  Append(num_rows, &header);
+  for (const auto& entry : metadata) {
+    AppendString(entry.first, &header);
+    AppendString(entry.second, &header);
+  }
+  for (const SampleColumn& column : columns) {
+    AppendString(column.name, &header);
+  }
+  header.resize((header.size() + 7) / 8 * 8, '\0');
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(header.data(), header.size());
+  for (const SampleColumn& column : columns) {
+    file.write(reinterpret_cast<const char*>(column.values.data()),
+      column.values.size() * sizeof(double));
+  }
+  return static_cast<bool>(file);
+}
+
+SampleFileReader::~SampleFileReader() { Close(); }
+
+void SampleFileReader::Close() {
+  if (mapped_ != nullptr) {
+    munmap(mapped_, size_);
+  }
+  mapped_ = nullptr;
+  size_ = 0;
+  metadata_.clear();
+  names_.clear();
+  num_rows_ = 0;
+  data_ = nullptr;
+}
+
+bool SampleFileReader::Open(const std::string& path) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_ = file_stat.st_size;
+  mapped_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped_ == MAP_FAILED) {
+    mapped_ = nullptr;
+    size_ = 0;
+    return false;
+  }
+
+  Cursor cursor(static_cast<const char*>(mapped_), size_);
+  char magic[sizeof(kMagic)];
+  uint32_t version, num_metadata, num_columns, reserved;
+  bool ok = cursor.Read(&magic) &&
+    std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+    cursor.Read(&version) && version == kVersion &&
+    cursor.Read(&num_metadata) && cursor.Read(&num_columns) &&
+    cursor.Read(&reserved) && cursor.Read(&num_rows_);
+  for (uint32_t i = 0; ok && i < num_metadata; i++) {
+    std::pair<std::string, std::string> entry;
+    ok = cursor.ReadString(&entry.first) && cursor.ReadString(&entry.second);
+    metadata_.push_back(std::move(entry));
+  }
+  for (uint32_t i = 0; ok && i < num_columns; i++) {
+    std::string name;
+    ok = cursor.ReadString(&name);
+    names_.push_back(std::move(name));
+  }
+  ok = ok && cursor.Skip((8 - cursor.offset() % 8) % 8);
+  // Compare by division so that a corrupt row count cannot overflow.
+  const uint64_t num_values = cursor.remaining() / sizeof(double);
+  ok = ok && cursor.remaining() % sizeof(double) == 0 &&
+    (num_columns == 0 ? num_values == 0 :
+      num_values % num_columns == 0 && num_values / num_columns == num_rows_);
+  if (!ok) {
+    Close();
+    return false;
+  }
+  data_ = reinterpret_cast<const double*>(
+    static_cast<const char*>(mapped_) + cursor.offset());
+  return true;
+}
+
+const double* SampleFileReader::Column(const std::string& name) const {
+  for (size_t i = 0; i < names_.size(); i++) {
+    if (names_[i] == name) return data_ + i * num_rows_;
+  }
+  return nullptr;
+}
+
+} // testing
+} // differential_privacy
@@ -0,0 +1,96 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef SAMPLE_FILE_H
+#define SAMPLE_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace differential_privacy {
+
+namespace testing {
+
+// A compact columnar container for samples. All integers are little-endian.
+//
+//   char[8]  magic "DPSAMPLS"
+//   uint32   version (1)
+//   uint32   number of metadata entries
+//   uint32   number of columns
+//   uint32   reserved (0)
+//   uint64   number of rows
+//   metadata entries, each as uint32 key length, key, uint32 value length,
+//     value
+//   column names, each as uint32 length and name
+//   zero padding up to the next multiple of 8 bytes
+//   float64 values, stored column after column, num_rows per column
+//
+// The metadata holds the scenario parameters as strings. Because the values
+// are 8-byte aligned, a reader can map the file and use the columns in place.
+
+using SampleMetadata = std::vector<std::pair<std::string, std::string>>;
+
+struct SampleColumn {
+  std::string name;
+  std::vector<double> values;
+};
+
+// Formats a metadata value so that it parses back to exactly the same double.
+std::string MetadataValue(double value);
+
+// Writes columns, which must all have the same number of values, to path.
+// Returns false if the file could not be written.
+bool WriteSampleFile(const std::string& path, const SampleMetadata& metadata,
+  const std::vector<SampleColumn>& columns);
+
+// Reads a sample file through a read-only memory mapping. Column values point
+// into the mapping and stay valid as long as the reader is alive.
+class SampleFileReader {
+ public:
+  SampleFileReader() = default;
+  ~SampleFileReader();
+
+  SampleFileReader(const SampleFileReader&) = delete;
+  SampleFileReader& operator=(const SampleFileReader&) = delete;
+
+  // Maps the file at path. Returns false if it cannot be read or is not a
+  // valid sample file.
+  bool Open(const std::string& path);
+
+  const SampleMetadata& metadata() const { return metadata_; }
+  const std::vector<std::string>& column_names() const { return names_; }
+  uint64_t num_rows() const { return num_rows_; }
+
+  // Returns the values of the named column, or nullptr if there is none.
+  const double* Column(const std::string& name) const;
+
+ private:
+  void Close();
+
+  void* mapped_ = nullptr;
+  size_t size_ = 0;
+  SampleMetadata metadata_;
+  std::vector<std::string> names_;
+  uint64_t num_rows_ = 0;
+  const double* data_ = nullptr;
+};
+
+} // testing
+} // differential_privacy
+
+#endif // SAMPLE_FILE_H
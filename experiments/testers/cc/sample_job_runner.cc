@@ -0,0 +1,114 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "sample_job_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+
+namespace testing {
+
+namespace {
+
+std::vector<double> DrawSamples(const Sampler& sampler,
+  int number_of_samples, bool integral) {
+  std::vector<double> samples;
+  samples.reserve(number_of_samples);
+  for (int i = 0; i < number_of_samples; i++) {
+    const double sample = sampler();
+    samples.push_back(integral ? static_cast<int64_t>(sample) : sample);
+  }
+  return samples;
+}
+
+void WriteTextSamples(const std::string& path,
+  const std::vector<double>& samples, bool integral) {
+  std::ostringstream buffer;
+  for (const double sample : samples) {
+    if (integral) {
+      buffer << static_cast<int64_t>(sample) << "\n";
+    } else {
+      buffer << sample << "\n";
+    }
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  const std::string contents = buffer.str();
+  file.write(contents.data(), contents.size());
+}
+
+void RunSampleJob(const SampleJob& job, uint64_t index, SampleFormat format) {
+  // Noise is drawn from fast seeded sources instead of the secure generator,
+  // so that the samples are reproducible. Each side of each job has its own
+  // seed, regardless of which thread runs it.
+  test_utils::SeededRandomSource random_a(2 * index);
+  test_utils::SeededRandomSource random_b(2 * index + 1);
+  // Samples for A are drawn before those for B, as they always have been.
+  std::vector<double> samples_a = DrawSamples(job.sampler_a(&random_a),
+    job.number_of_samples, job.integral);
+  std::vector<double> samples_b = DrawSamples(job.sampler_b(&random_b),
+    job.number_of_samples, job.integral);
+  if (format != SampleFormat::kColumnar) {
+    WriteTextSamples(job.path_a, samples_a, job.integral);
+    WriteTextSamples(job.path_b, samples_b, job.integral);
+  }
+  if (format != SampleFormat::kText) {
+    std::vector<SampleColumn> columns(2);
+    columns[0] = {"A", std::move(samples_a)};
+    columns[1] = {"B", std::move(samples_b)};
+    if (!WriteSampleFile(job.path_columnar, job.metadata, columns)) {
+      std::cerr << "Failed to write " << job.path_columnar << std::endl;
+    }
+  }
+}
+
+} // namespace
+
+std::unique_ptr<NumericalMechanismBuilder> LaplaceBuilder(RandomSource* random) {
+  auto builder = absl::make_unique<LaplaceMechanism::Builder>();
+  builder->SetRandomSource(random);
+  return builder;
+}
+
+void RunSampleJobs(const std::vector<SampleJob>& jobs, int num_threads,
+  SampleFormat format) {
+  std::atomic<size_t> next_job(0);
+  auto worker = [&jobs, &next_job, format]() {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      RunSampleJob(jobs[i], i, format);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::max(num_threads, 1); i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+} // testing
+} // differential_privacy
@@ -0,0 +1,82 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef SAMPLE_JOB_RUNNER_H
+#define SAMPLE_JOB_RUNNER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/rand.h"
+#include "sample_file.h"
+
+namespace differential_privacy {
+
+namespace testing {
+
+// Number of runs (TestCase files) generated for every scenario and ratio.
+constexpr int kNumRunsPerScenario = 7;
+
+// Draws one noisy output. A sampler owns its algorithm instance and is only
+// ever used by a single thread.
+using Sampler = std::function<double()>;
+
+// Creates a sampler. Called on the worker thread that runs the job, so every
+// thread builds its own algorithm instances and reuses them for all samples
+// of the job.
+// Creates a sampler that draws its noise from random, which outlives the
+// sampler.
+using SamplerFactory = std::function<Sampler(RandomSource* random)>;
+
+// Returns a Laplace mechanism builder that draws its noise from random.
+std::unique_ptr<NumericalMechanismBuilder> LaplaceBuilder(RandomSource* random);
+
+// Formats samples are written in. kText writes one value per line to the
+// A and B files that the statistical checkers have always read. kColumnar
+// writes both datasets as columns "A" and "B" of a single sample file (see
+// sample_file.h), which is far smaller and needs no parsing. kBoth writes both.
+enum class SampleFormat { kText, kColumnar, kBoth };
+
+// Generates one run of a sample-pair: number_of_samples outputs for dataset A
+// and as many for the neighbouring dataset B. As text they are written to
+// path_a and path_b, as columns to path_columnar.
+struct SampleJob {
+  std::string path_a;
+  std::string path_b;
+  std::string path_columnar;
+  // Scenario parameters recorded in the header of the columnar file.
+  SampleMetadata metadata;
+  int number_of_samples;
+  SamplerFactory sampler_a;
+  SamplerFactory sampler_b;
+  // Whether samples are integers and should be written without a fractional
+  // part, as the count samples always have been.
+  bool integral = false;
+};
+
+// Runs all jobs on num_threads threads and returns once they are finished.
+// Every job writes only its own files, and samples are buffered in memory and
+// written with a single call per file.
+void RunSampleJobs(const std::vector<SampleJob>& jobs, int num_threads,
+  SampleFormat format = SampleFormat::kText);
+
+} // testing
+} // differential_privacy
+
+#endif // SAMPLE_JOB_RUNNER_H
@@ -19,6 +19,13 @@ import static java.nio.charset.StandardCharsets.UTF_8;
 import com.google.privacy.differentialprivacy.testing.StatisticalTestsUtil;
 import java.io.*;
 import java.lang.*;
+import java.nio.ByteOrder;
+import java.nio.DoubleBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.file.Files;
+import java.nio.file.Paths;
+import java.nio.file.StandardOpenOption;
 import java.util.*;
 import java.sql.Timestamp;
 import java.text.SimpleDateFormat;
@@ -48,6 +55,54 @@ public class StatisticalUtils {
 	    return sample_array;
 	}
 
+// Reads in one column of a columnar sample file written by the C++ sample
+// generators (see experiments/testers/cc/sample_file.h). The file is memory
+// mapped and the values are read in place, without any parsing.
+	protected static Long[] getColumnarData(String filepath, String column) {
+
+	  try (FileChannel channel = FileChannel.open(Paths.get(filepath),
+	      StandardOpenOption.READ)) {
+	    MappedByteBuffer buffer = channel.map(FileChannel.MapMode.READ_ONLY, 0,
+	    	channel.size());
+	    buffer.order(ByteOrder.LITTLE_ENDIAN);
+	    byte[] magic = new byte[8];
+	    buffer.get(magic);
+	    if (!new String(magic, UTF_8).equals("DPSAMPLS") || buffer.getInt() != 1) {
+	    	throw new IOException("Not a sample file: " + filepath);
+	    }
+	    int numMetadata = buffer.getInt();
+	    int numColumns = buffer.getInt();
+	    buffer.getInt();
+	    int numRows = (int) buffer.getLong();
+	    for (int i = 0; i < 2 * numMetadata; i++) {
+	    	int length = buffer.getInt();
+	    	buffer.position(buffer.position() + length);
+	    }
+	    int columnIndex = -1;
+	    for (int i = 0; i < numColumns; i++) {
+	    	byte[] name = new byte[buffer.getInt()];
+	    	buffer.get(name);
+	    	if (new String(name, UTF_8).equals(column)) {
+	    		columnIndex = i;
+	    	}
+	    }
+	    if (columnIndex < 0) {
+	    	throw new IOException("No column " + column + " in " + filepath);
+	    }
+	    buffer.position((buffer.position() + 7) / 8 * 8 + 8 * columnIndex * numRows);
+	    DoubleBuffer values = buffer.slice().order(ByteOrder.LITTLE_ENDIAN)
+	    	.asDoubleBuffer();
+	    Long sample_array[] = new Long[numRows];
+	    for (int i = 0; i < numRows; i++) {
+	    	sample_array[i] = Long.valueOf((int) values.get(i));
+	    }
+	    return sample_array;
+	  } catch (IOException e) {
+	      e.printStackTrace();
+	  }
+	  return new Long[0];
+	}
+
 // Runs the Statistical Tester on a given pair of differentially protected samples.
 // Desired outcome is 0 or false since the samples are known to violate DP.
 	protected static boolean getOutcome(
@@ -65,6 +120,22 @@ public class StatisticalUtils {
 	  	delta, l2Tolerance);
 	}
 
+// Runs the Statistical Tester on the pair of samples stored as columns A and B
+// of a columnar sample file.
+	protected static boolean getColumnarOutcome(
+		String file,
+	  int numberOfSamples,
+	  double epsilon,
+	  double delta,
+	  double l2Tolerance) {
+
+		Long[] samplesA = getColumnarData(file, "A");
+		Long[] samplesB = getColumnarData(file, "B");
+
+	  return StatisticalTestsUtil.verifyApproximateDp(samplesA, samplesB, epsilon,
+	  	delta, l2Tolerance);
+	}
+
 // Determines overall outcome of the test by taking a majority vote. 
 	protected static int getMajorityVote(
 		String subfolder,
@@ -77,9 +148,17 @@ public class StatisticalUtils {
 		int numPassed = 0;
 		
 		for (int i = 0; i < numberOfVotes; i++) {
-  		String fileA = subfolder+"TestCase"+Integer.toString(i)+"A.txt";
-  		String fileB = subfolder+"TestCase"+Integer.toString(i)+"B.txt";
-  		boolean Outcome = getOutcome(fileA,fileB,numberOfSamples,epsilon,delta,l2Tolerance);
+  		String columnarFile = subfolder+"TestCase"+Integer.toString(i)+".samples";
+  		boolean Outcome;
+  		// Prefer the columnar file when the samples were generated in that format.
+  		if (Files.exists(Paths.get(columnarFile))) {
+  			Outcome = getColumnarOutcome(columnarFile,numberOfSamples,epsilon,delta,
+  				l2Tolerance);
+  		} else {
+  			String fileA = subfolder+"TestCase"+Integer.toString(i)+"A.txt";
+  			String fileB = subfolder+"TestCase"+Integer.toString(i)+"B.txt";
+  			Outcome = getOutcome(fileA,fileB,numberOfSamples,epsilon,delta,l2Tolerance);
+  		}
   		if (Outcome == true) {
   			numPassed++;
   		}